@@ -381,12 +381,13 @@ int main(int argc, char *argv[])
 
         int n_tests = 10;
         double comm_time = 0;
+        aligned_vector<index_t> recv_cols;
         for (int j = 0; j < n_tests; j++)
         {
             clear_cache(cache_array);
             MPI_Barrier(MPI_COMM_WORLD);
             t0 = MPI_Wtime();
-            CSRMatrix* recv_mat = Al->comm->communicate(Pl);
+            CSRMatrix* recv_mat = Al->comm->communicate(Pl, recv_cols);
             comm_time += (MPI_Wtime() - t0);
             delete recv_mat;
         }
@@ -28,6 +28,13 @@ int aggregate(ParCSRMatrix* A, ParCSRMatrix* S, aligned_vector<int>& states,
     aligned_vector<double> r;
     aligned_vector<double> off_proc_r;
 
+    // Aggregates hold global rows, communicated as int
+    if (S->global_num_rows > (index_t) INT_MAX)
+    {
+        printf("Aggregation requires fewer than 2^31 global rows.\n");
+        exit(-1);
+    }
+
     CommPkg* comm = S->comm;
     if (tap_comm)
     {
@@ -17,14 +17,15 @@ ParCSRMatrix* fit_candidates(ParCSRMatrix* A,
     int col_start, col_end;
     int row, idx_B, ctr;
     int col_start_k;
-    int global_col, local_col, col;
+    int local_col;
+    index_t global_col;
     double val, scale;
     CommPkg* comm;
 
     // Calculate off_proc_column_map and num off_proc cols
     int off_proc_num_cols;
-    std::set<int> off_proc_col_set;
-    aligned_vector<int> off_proc_column_map;
+    std::set<index_t> off_proc_col_set;
+    aligned_vector<index_t> off_proc_column_map;
     for (aligned_vector<int>::const_iterator it = aggregates.begin();
             it != aggregates.end(); ++it)
     {
@@ -35,8 +36,8 @@ ParCSRMatrix* fit_candidates(ParCSRMatrix* A,
             off_proc_col_set.insert(*it);
         }
     } 
-    std::map<int, int> global_to_local;
-    for (std::set<int>::iterator it = off_proc_col_set.begin();
+    std::map<index_t, int> global_to_local;
+    for (std::set<index_t>::iterator it = off_proc_col_set.begin();
             it != off_proc_col_set.end(); ++it)
     {
         global_to_local[*it] = off_proc_column_map.size();
@@ -78,8 +79,10 @@ ParCSRMatrix* fit_candidates(ParCSRMatrix* A,
     delete[] on_proc_partition_to_col;
 
     // Initialize CSC Matrix for tentative interpolation
-    int global_num_cols;
-    MPI_Allreduce(&n_aggs, &global_num_cols, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    index_t global_num_cols;
+    index_t local_num_aggs = n_aggs;
+    MPI_Allreduce(&local_num_aggs, &global_num_cols, 1, MPI_INDEX_T, MPI_SUM, 
+            MPI_COMM_WORLD);
     ParCSCMatrix* T_csc = new ParCSCMatrix(A->partition, A->global_num_rows, global_num_cols, 
             A->local_num_rows, n_aggs, off_proc_num_cols);
         
@@ -213,8 +216,68 @@ ParCSRMatrix* fit_candidates(ParCSRMatrix* A,
     return T;
 }
 
+ParBSRMatrix* block_tentative(ParCSRMatrix* T, int b_size)
+{
+    int b = b_size;
+    Partition* T_part = T->partition;
+    Partition* part = new Partition(T_part->global_num_rows * b, 
+            T_part->global_num_cols * b, T_part->local_num_rows * b, 
+            T_part->local_num_cols * b, T_part->first_local_row * b,
+            T_part->first_local_col * b, T_part->topology);
+    ParBSRMatrix* P = new ParBSRMatrix(part, b, b);
+    part->num_shared = 0;
 
+    P->local_num_rows = T->local_num_rows * b;
+    P->on_proc_num_cols = T->on_proc_num_cols * b;
+    P->off_proc_num_cols = T->off_proc_num_cols * b;
+    for (int i = 0; i < T->local_num_rows; i++)
+    {
+        for (int c = 0; c < b; c++)
+        {
+            P->local_row_map.push_back(T->local_row_map[i] * b + c);
+        }
+    }
+    for (int i = 0; i < T->on_proc_num_cols; i++)
+    {
+        for (int c = 0; c < b; c++)
+        {
+            P->on_proc_column_map.push_back(T->on_proc_column_map[i] * b + c);
+        }
+    }
+    for (int i = 0; i < T->off_proc_num_cols; i++)
+    {
+        for (int c = 0; c < b; c++)
+        {
+            P->off_proc_column_map.push_back(T->off_proc_column_map[i] * b + c);
+        }
+    }
 
+    // Each entry t of T is the block t*I
+    Matrix* T_mats[2] = {T->on_proc, T->off_proc};
+    Matrix* P_mats[2] = {P->on_proc, P->off_proc};
+    int n_cols[2] = {P->on_proc_num_cols, P->off_proc_num_cols};
+    for (int k = 0; k < 2; k++)
+    {
+        BSRMatrix* P_mat = (BSRMatrix*) P_mats[k];
+        P_mat->n_rows = P->local_num_rows;
+        P_mat->n_cols = n_cols[k];
+        P_mat->idx1 = T_mats[k]->idx1;
+        P_mat->idx2 = T_mats[k]->idx2;
+        P_mat->vals.resize(T_mats[k]->idx2.size() * b * b, 0.0);
+        for (int j = 0; j < (int) T_mats[k]->idx2.size(); j++)
+        {
+            for (int c = 0; c < b; c++)
+            {
+                P_mat->vals[j * b * b + c * b + c] = T_mats[k]->vals[j];
+            }
+        }
+        P_mat->n_blocks = P_mat->idx2.size();
+        P_mat->nnz = P_mat->n_blocks * b * b;
+    }
+    P->local_nnz = P->on_proc->nnz + P->off_proc->nnz;
 
+    P->comm = new ParComm(P->partition, P->off_proc_column_map, 
+            P->on_proc_column_map);
 
-
+    return P;
+}
@@ -14,4 +14,10 @@ ParCSRMatrix* fit_candidates(ParCSRMatrix* A, const int n_aggs,
         const aligned_vector<double>& B, aligned_vector<double>& R,
         int num_candidates, bool tag_comm = false, double tol = 1e-10,
         data_t* comm_t = NULL);
+
+// Expands tentative interpolation T of a node matrix (with columns 
+// numbered contiguously, as by contiguous_cols) to interpolation of 
+// b_size unknowns per node, kron(T, I).  The returned matrix has 
+// b_size x b_size blocks and a ParComm.
+ParBSRMatrix* block_tentative(ParCSRMatrix* T, int b_size);
 #endif
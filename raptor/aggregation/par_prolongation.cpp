@@ -108,3 +108,111 @@ ParCSRMatrix* jacobi_prolongation(ParCSRMatrix* A, ParCSRMatrix* T, bool tap_com
     return P;
 }
 
+
+// Block version : each scalar row of A is scaled by its absolute row sum,
+// so blocks are scaled row by row
+ParBSRMatrix* jacobi_prolongation(ParBSRMatrix* A, ParBSRMatrix* T, bool tap_comm,
+        double omega, int num_smooth_steps, data_t* comm_t, data_t* comm_mat_t)
+{
+    ParBSRMatrix* AP_tmp;
+    ParBSRMatrix* P_tmp;
+    ParBSRMatrix* P = T->copy();
+    ParBSRMatrix* scaled_A = A->copy();
+
+    BSRMatrix* A_on = (BSRMatrix*) A->on_proc;
+    BSRMatrix* A_off = (BSRMatrix*) A->off_proc;
+    BSRMatrix* scaled_on = (BSRMatrix*) scaled_A->on_proc;
+    BSRMatrix* scaled_off = (BSRMatrix*) scaled_A->off_proc;
+    int b_rows = A->b_rows;
+    int b_cols = A->b_cols;
+    int b_size = A->b_size;
+    int n_block_rows = A->local_num_rows / b_rows;
+
+    // Get absolute row sum for each row
+    int row_start_on, row_end_on;
+    int row_start_off, row_end_off;
+    int idx;
+    double row_sum, inv_sum;
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        row_start_on = A_on->idx1[i];
+        row_end_on = A_on->idx1[i+1];
+        row_start_off = A_off->idx1[i];
+        row_end_off = A_off->idx1[i+1];
+        for (int r = 0; r < b_rows; r++)
+        {
+            row_sum = 0.0;
+            for (int j = row_start_on; j < row_end_on; j++)
+            {
+                idx = j * b_size + r * b_cols;
+                for (int c = 0; c < b_cols; c++)
+                {
+                    row_sum += fabs(A_on->vals[idx + c]);
+                }
+            }
+            for (int j = row_start_off; j < row_end_off; j++)
+            {
+                idx = j * b_size + r * b_cols;
+                for (int c = 0; c < b_cols; c++)
+                {
+                    row_sum += fabs(A_off->vals[idx + c]);
+                }
+            }
+
+            inv_sum = 0.0;
+            if (row_sum)
+            {
+                inv_sum = (1.0 / fabs(row_sum)) * omega;
+            }
+
+            for (int j = row_start_on; j < row_end_on; j++)
+            {
+                idx = j * b_size + r * b_cols;
+                for (int c = 0; c < b_cols; c++)
+                {
+                    scaled_on->vals[idx + c] *= inv_sum;
+                }
+            }
+            for (int j = row_start_off; j < row_end_off; j++)
+            {
+                idx = j * b_size + r * b_cols;
+                for (int c = 0; c < b_cols; c++)
+                {
+                    scaled_off->vals[idx + c] *= inv_sum;
+                }
+            }
+        }
+    }
+
+    // P = P - (scaled_A*P)
+    for (int i = 0; i < num_smooth_steps; i++)
+    {
+        // Block rows of P are exchanged through the block comm 
+        // package of scaled_A
+        if (comm_mat_t) *comm_mat_t -= MPI_Wtime();
+        AP_tmp = scaled_A->mult(P, tap_comm);
+        if (comm_mat_t) *comm_mat_t += MPI_Wtime();
+
+        P_tmp = P->subtract(AP_tmp);
+        delete AP_tmp;
+        delete P;
+        P = P_tmp;
+        P_tmp = NULL;
+    }
+
+    if (A->comm)
+    {
+        P->comm = new ParComm(P->partition, P->off_proc_column_map, 
+                P->on_proc_column_map, 9283, MPI_COMM_WORLD, comm_t);
+    }
+
+    if (A->tap_comm)
+    {
+        P->tap_comm = new TAPComm(P->partition, P->off_proc_column_map, 
+                P->on_proc_column_map, true, MPI_COMM_WORLD, comm_t);
+    }
+
+    delete scaled_A;
+    
+    return P;
+}
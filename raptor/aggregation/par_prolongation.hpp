@@ -12,5 +12,8 @@ using namespace raptor;
 ParCSRMatrix* jacobi_prolongation(ParCSRMatrix* A, ParCSRMatrix* T, bool tap_comm = false,
         double omega = 4.0/3, int num_smooth_steps = 1, data_t* comm_t = NULL,
         data_t* comm_mat_t = NULL);
+ParBSRMatrix* jacobi_prolongation(ParBSRMatrix* A, ParBSRMatrix* T, bool tap_comm = false,
+        double omega = 4.0/3, int num_smooth_steps = 1, data_t* comm_t = NULL,
+        data_t* comm_mat_t = NULL);
 #endif
 
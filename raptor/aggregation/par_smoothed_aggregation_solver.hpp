@@ -30,6 +30,7 @@ namespace raptor
 
         ~ParSmoothedAggregationSolver()
         {
+            clear_tentatives();
         }
 
         void setup(ParCSRMatrix* Af) 
@@ -50,13 +51,49 @@ namespace raptor
                 B[i] = 1.0;
             }
 
+            clear_tentatives();
             setup_helper(Af);
         }
 
+        // Setup for block systems : aggregates nodes (block rows) of Af
+        // with the near nullspace of constants for each unknown of a
+        // node (see extend_block_hierarchy)
+        void setup(ParBSRMatrix* Af)
+        {
+            if (track_times)
+            {
+                n_setup_times = 7;
+                setup_times = new aligned_vector<double>[n_setup_times];
+                setup_comm_times = new aligned_vector<double>[n_setup_times];
+                setup_mat_comm_times = new aligned_vector<double>[n_setup_times];
+            }
+
+            num_candidates = 1;
+            int n_nodes = Af->local_num_rows / Af->b_rows;
+            B.resize(n_nodes);
+            for (int i = 0; i < n_nodes; i++)
+            {
+                B[i] = 1.0;
+            }
+
+            clear_tentatives();
+            setup_helper(Af);
+        }
+
+        void clear_tentatives()
+        {
+            for (std::vector<ParCSRMatrix*>::iterator it = tentatives.begin();
+                    it != tentatives.end(); ++it)
+            {
+                delete *it;
+            }
+            tentatives.clear();
+        }
+
         void extend_hierarchy()
         {
             int level_ctr = levels.size() - 1;
-            bool tap_level = tap_amg >= 0 && tap_amg <= level_ctr;
+            bool tap_level = use_tap(level_ctr);
 
             data_t* total_time = NULL;
             data_t* strength_time = NULL;
@@ -97,7 +134,6 @@ namespace raptor
             ParCSRMatrix* S;
             ParCSRMatrix* T;
             ParCSRMatrix* P;
-            ParCSRMatrix* AP;
 
             aligned_vector<int> states;
             aligned_vector<int> off_proc_states;
@@ -143,23 +179,39 @@ namespace raptor
             if (setup_times) setup_times[4][level_ctr] += MPI_Wtime();
             levels[level_ctr]->P = P;
 
+            // Redistribute coarse level (and candidates) onto fewer 
+            // processes if needed
+            int n_coarse = P->on_proc_num_cols;
+            P = agglomerate(P, level_ctr);
+
             // Form coarse grid operator
             levels.push_back(new ParLevel());
 
-            if (setup_times) setup_times[5][level_ctr] -= MPI_Wtime();
-            AP = A->mult(levels[level_ctr]->P, tap_level, AP_mat_time);
-            if (setup_times) setup_times[5][level_ctr] += MPI_Wtime();
-
+            // Galerkin product P^T*A*P, without forming A*P
             if (setup_times) setup_times[6][level_ctr] -= MPI_Wtime();
-            A = AP->mult_T(P, tap_level, PTAP_mat_time);
+            A = galerkin_product(level_ctr, P, PTAP_mat_time);
+            A = agglomerate_coarse(A, level_ctr);
+            P = levels[level_ctr]->P;
             if (setup_times) setup_times[6][level_ctr] += MPI_Wtime();
 
+            if (levels[level_ctr]->agg_parts)
+            {
+                aligned_vector<double> agg_R;
+                repartition_vector(R, agg_R, n_coarse, 
+                        A->local_num_rows, num_candidates);
+                R.swap(agg_R);
+                if (B.size() < R.size())
+                {
+                    B.resize(R.size());
+                }
+            }
 
             level_ctr++;
+            form_level_comm(level_ctr);
             levels[level_ctr]->A = A;
             A->comm = new ParComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map, P->comm->key, P->comm->mpi_comm,
-                    total_time);
+                    A->on_proc_column_map, P->comm->key, 
+                    levels[level_ctr]->mpi_comm, total_time);
             levels[level_ctr]->x.resize(A->global_num_rows, A->local_num_rows,
                     A->partition->first_local_row);
             levels[level_ctr]->b.resize(A->global_num_rows, A->local_num_rows,
@@ -168,7 +220,7 @@ namespace raptor
                     A->partition->first_local_row);
             levels[level_ctr]->P = NULL;
 
-            if (tap_amg >= 0 && tap_amg <= level_ctr)
+            if (use_tap(level_ctr))
             {
                 levels[level_ctr]->A->tap_comm = new TAPComm(
                         levels[level_ctr]->A->partition,
@@ -179,8 +231,7 @@ namespace raptor
 
             std::copy(R.begin(), R.end(), B.begin());
 
-            delete AP;
-            delete T;
+            tentatives.push_back(T);
             delete S;
 
             if (setup_times) 
@@ -194,6 +245,141 @@ namespace raptor
             }
         }    
 
+        /**************************************************************
+         *****   Extend Block Hierarchy
+         **************************************************************
+         ***** Coarsens the block level matrix A through its node 
+         ***** matrix (block Frobenius norms) : strength, MIS(2) 
+         ***** aggregation, and tentative interpolation are formed for
+         ***** nodes, the tentative interpolation is expanded to 
+         ***** kron(T, I) over the unknowns of each node, and smoothed
+         ***** with block Jacobi prolongation.  The coarse matrix is the 
+         ***** block Galerkin product P^T*A*P.
+         **************************************************************/
+        void extend_block_hierarchy()
+        {
+            int level_ctr = levels.size() - 1;
+
+            data_t* strength_time = NULL;
+            data_t* agg_time = NULL;
+            data_t* interp_time = NULL;
+            data_t* prolong_time = NULL;
+            data_t* prolong_mat_time = NULL;
+            data_t* PTAP_mat_time = NULL;
+            if (setup_times)
+            {
+                setup_times[0][level_ctr] -= MPI_Wtime();
+                strength_time = &setup_comm_times[1][level_ctr];
+                agg_time = &setup_comm_times[2][level_ctr];
+                interp_time = &setup_comm_times[3][level_ctr];
+                prolong_time = &setup_comm_times[4][level_ctr];
+                prolong_mat_time = &setup_mat_comm_times[4][level_ctr];
+                PTAP_mat_time = &setup_mat_comm_times[6][level_ctr];
+            }
+
+            ParBSRMatrix* A = levels[level_ctr]->A_bsr;
+            ParCSRMatrix* N;
+            ParCSRMatrix* S;
+            ParCSRMatrix* T_agg;
+            ParCSRMatrix* T_node;
+            ParBSRMatrix* T;
+            ParBSRMatrix* P;
+
+            aligned_vector<int> states;
+            aligned_vector<int> off_proc_states;
+            aligned_vector<int> aggregates;
+            aligned_vector<double> R;
+            int n_aggs;
+
+            // Form strength of connection between nodes
+            if (setup_times) setup_times[1][level_ctr] -= MPI_Wtime();
+            N = A->block_norms();
+            S = N->strength(strength_type, strong_threshold, false, 
+                    1, NULL, strength_time);
+            if (setup_times) setup_times[1][level_ctr] += MPI_Wtime();
+
+            // Aggregate Nodes
+            if (setup_times) setup_times[2][level_ctr] -= MPI_Wtime();
+            switch (agg_type)
+            {
+                case MIS:
+                    mis2(S, states, off_proc_states, false, weights, agg_time);
+                    n_aggs = aggregate(N, S, states, off_proc_states, 
+                            aggregates, false, NULL, agg_time);
+                    break;
+            }
+            if (setup_times) setup_times[2][level_ctr] += MPI_Wtime();
+
+            // Form tentative interpolation of nodes, numbered 
+            // contiguously, and expand to the unknowns of each node
+            if (setup_times) setup_times[3][level_ctr] -= MPI_Wtime();
+            T_agg = fit_candidates(N, n_aggs, aggregates, B, R, 
+                    num_candidates, false, interp_tol, interp_time);
+            T_node = contiguous_cols(T_agg);
+            T = block_tentative(T_node, A->b_rows);
+            if (setup_times) setup_times[3][level_ctr] += MPI_Wtime();
+            delete T_agg;
+            delete T_node;
+            delete S;
+            delete N;
+
+            if (setup_times) setup_times[4][level_ctr] -= MPI_Wtime();
+            switch (prolong_type)
+            {
+                case JacobiProlongation:
+                    P = jacobi_prolongation(A, T, false, prolong_weight, 
+                            prolong_smooth_steps, prolong_time, prolong_mat_time);
+                    break;
+            }
+            if (setup_times) setup_times[4][level_ctr] += MPI_Wtime();
+            delete T;
+            if (P->comm == NULL)
+            {
+                P->comm = new ParComm(P->partition, P->off_proc_column_map,
+                        P->on_proc_column_map);
+            }
+            levels[level_ctr]->P_bsr = P;
+
+            // Galerkin product P^T*A*P, without forming A*P
+            if (setup_times) setup_times[6][level_ctr] -= MPI_Wtime();
+            if (PTAP_mat_time) *PTAP_mat_time -= MPI_Wtime();
+            A = A->RAP(P);
+            if (PTAP_mat_time) *PTAP_mat_time += MPI_Wtime();
+            if (setup_times) setup_times[6][level_ctr] += MPI_Wtime();
+
+            levels.push_back(new ParLevel());
+            level_ctr++;
+            levels[level_ctr]->A_bsr = A;
+            A->comm = new ParComm(A->partition, A->off_proc_column_map,
+                    A->on_proc_column_map);
+            levels[level_ctr]->x.resize(A->global_num_rows, A->local_num_rows,
+                    A->partition->first_local_row);
+            levels[level_ctr]->b.resize(A->global_num_rows, A->local_num_rows,
+                    A->partition->first_local_row);
+            levels[level_ctr]->tmp.resize(A->global_num_rows, A->local_num_rows,
+                    A->partition->first_local_row);
+
+            std::copy(R.begin(), R.end(), B.begin());
+
+            if (setup_times) 
+            {
+                setup_times[0][level_ctr-1] += MPI_Wtime();
+            }
+        }
+
+        ParCSRMatrix* reform_interpolation(int level)
+        {
+            ParCSRMatrix* P = NULL;
+            switch (prolong_type)
+            {
+                case JacobiProlongation:
+                    P = jacobi_prolongation(levels[level]->A, tentatives[level],
+                            use_tap(level), prolong_weight, prolong_smooth_steps);
+                    break;
+            }
+            return P;
+        }
+
         void print_setup_times()
         {
             if (setup_times == NULL) return;
@@ -303,6 +489,9 @@ namespace raptor
         int prolong_smooth_steps;
         int num_candidates;
 
+        // Tentative interpolation of each level, reused by resetup()
+        std::vector<ParCSRMatrix*> tentatives;
+
     };
 }
    
@@ -52,7 +52,6 @@ namespace raptor
             CSRMatrix* A = levels[level_ctr]->A;
             CSRMatrix* S;
             CSRMatrix* P;
-            CSRMatrix* AP;
             CSRMatrix* T;
             CSCMatrix* P_csc;
             aligned_vector<int> states;
@@ -86,9 +85,9 @@ namespace raptor
 
             // Form coarse-grid operator
             levels.push_back(new Level());
-            AP = A->mult(P);
             P_csc = P->to_CSC();
-            A = AP->mult_T(P_csc);
+            A = new CSRMatrix(P->n_cols, P->n_cols);
+            levels[level_ctr]->A->RAP(*P_csc, A);
 
             level_ctr++;
             levels[level_ctr]->A = A;
@@ -100,7 +99,6 @@ namespace raptor
             std::copy(R.begin(), R.end(), B.begin());
 
             delete T;
-            delete AP;
             delete P_csc;
             delete S;
         }
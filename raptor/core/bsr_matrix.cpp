@@ -0,0 +1,406 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "core/matrix.hpp"
+
+using namespace raptor;
+
+/**************************************************************
+*****   BSR Kernels
+**************************************************************
+***** Kernels templated on the block size B, for square B x B
+***** blocks.  With B known at compile time the block loops are
+***** fully unrolled (and vectorized), and each block row keeps
+***** its B sums in registers over all of its blocks.  The
+***** generic kernels (b_rows x b_cols known at runtime) are used
+***** for all other block sizes.
+**************************************************************/
+namespace
+{
+    struct BSRKernels
+    {
+        void (*mult_append)(const BSRMatrix* A, const double* x, double* b,
+                double alpha);
+        void (*mult_append_T)(const BSRMatrix* A, const double* x, double* b,
+                double alpha);
+        void (*residual)(const BSRMatrix* A, const double* x, const double* b,
+                double* r);
+        void (*apply_inv_diag)(const BSRMatrix* A, const double* inv_diag,
+                const double* r, double* x, double omega);
+    };
+
+    template <int B>
+    void mult_append_kernel(const BSRMatrix* A, const double* x, double* b,
+            double alpha)
+    {
+        const int n_block_rows = A->n_rows / B;
+        const int* rowptr = A->idx1.data();
+        const int* cols = A->idx2.data();
+        const double* vals = A->vals.data();
+
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+        for (int i = 0; i < n_block_rows; i++)
+        {
+            double sum[B];
+            for (int r = 0; r < B; r++)
+            {
+                sum[r] = 0.0;
+            }
+            for (int j = rowptr[i]; j < rowptr[i+1]; j++)
+            {
+                const double* block = &(vals[j*B*B]);
+                const double* x_block = &(x[cols[j]*B]);
+                for (int r = 0; r < B; r++)
+                {
+                    for (int c = 0; c < B; c++)
+                    {
+                        sum[r] += block[r*B + c] * x_block[c];
+                    }
+                }
+            }
+            double* b_block = &(b[i*B]);
+            for (int r = 0; r < B; r++)
+            {
+                b_block[r] += alpha * sum[r];
+            }
+        }
+    }
+
+    // Blocks in different rows scatter into the same columns,
+    // so the transpose is not threaded
+    template <int B>
+    void mult_append_T_kernel(const BSRMatrix* A, const double* x, double* b,
+            double alpha)
+    {
+        const int n_block_rows = A->n_rows / B;
+        const int* rowptr = A->idx1.data();
+        const int* cols = A->idx2.data();
+        const double* vals = A->vals.data();
+
+        for (int i = 0; i < n_block_rows; i++)
+        {
+            double x_block[B];
+            for (int r = 0; r < B; r++)
+            {
+                x_block[r] = alpha * x[i*B + r];
+            }
+            for (int j = rowptr[i]; j < rowptr[i+1]; j++)
+            {
+                const double* block = &(vals[j*B*B]);
+                double* b_block = &(b[cols[j]*B]);
+                for (int c = 0; c < B; c++)
+                {
+                    double sum = 0.0;
+                    for (int r = 0; r < B; r++)
+                    {
+                        sum += block[r*B + c] * x_block[r];
+                    }
+                    b_block[c] += sum;
+                }
+            }
+        }
+    }
+
+    template <int B>
+    void residual_kernel(const BSRMatrix* A, const double* x, const double* b,
+            double* r)
+    {
+        const int n_block_rows = A->n_rows / B;
+        const int* rowptr = A->idx1.data();
+        const int* cols = A->idx2.data();
+        const double* vals = A->vals.data();
+
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+        for (int i = 0; i < n_block_rows; i++)
+        {
+            double sum[B];
+            for (int k = 0; k < B; k++)
+            {
+                sum[k] = b[i*B + k];
+            }
+            for (int j = rowptr[i]; j < rowptr[i+1]; j++)
+            {
+                const double* block = &(vals[j*B*B]);
+                const double* x_block = &(x[cols[j]*B]);
+                for (int k = 0; k < B; k++)
+                {
+                    for (int c = 0; c < B; c++)
+                    {
+                        sum[k] -= block[k*B + c] * x_block[c];
+                    }
+                }
+            }
+            for (int k = 0; k < B; k++)
+            {
+                r[i*B + k] = sum[k];
+            }
+        }
+    }
+
+    template <int B>
+    void apply_inv_diag_kernel(const BSRMatrix* A, const double* inv_diag,
+            const double* r, double* x, double omega)
+    {
+        const int n_block_rows = A->n_rows / B;
+
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+        for (int i = 0; i < n_block_rows; i++)
+        {
+            const double* inv_block = &(inv_diag[i*B*B]);
+            const double* r_block = &(r[i*B]);
+            for (int k = 0; k < B; k++)
+            {
+                double sum = 0.0;
+                for (int c = 0; c < B; c++)
+                {
+                    sum += inv_block[k*B + c] * r_block[c];
+                }
+                x[i*B + k] += omega * sum;
+            }
+        }
+    }
+
+    void generic_mult_append(const BSRMatrix* A, const double* x, double* b,
+            double alpha)
+    {
+        const int b_rows = A->b_rows;
+        const int b_cols = A->b_cols;
+        const int n_block_rows = A->n_rows / b_rows;
+
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+        for (int i = 0; i < n_block_rows; i++)
+        {
+            double* b_block = &(b[i*b_rows]);
+            for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+            {
+                const double* block = &(A->vals[j*A->b_size]);
+                const double* x_block = &(x[A->idx2[j]*b_cols]);
+                for (int r = 0; r < b_rows; r++)
+                {
+                    double sum = 0.0;
+                    for (int c = 0; c < b_cols; c++)
+                    {
+                        sum += block[r*b_cols + c] * x_block[c];
+                    }
+                    b_block[r] += alpha * sum;
+                }
+            }
+        }
+    }
+
+    void generic_mult_append_T(const BSRMatrix* A, const double* x, double* b,
+            double alpha)
+    {
+        const int b_rows = A->b_rows;
+        const int b_cols = A->b_cols;
+        const int n_block_rows = A->n_rows / b_rows;
+
+        for (int i = 0; i < n_block_rows; i++)
+        {
+            const double* x_block = &(x[i*b_rows]);
+            for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+            {
+                const double* block = &(A->vals[j*A->b_size]);
+                double* b_block = &(b[A->idx2[j]*b_cols]);
+                for (int r = 0; r < b_rows; r++)
+                {
+                    double x_val = alpha * x_block[r];
+                    for (int c = 0; c < b_cols; c++)
+                    {
+                        b_block[c] += block[r*b_cols + c] * x_val;
+                    }
+                }
+            }
+        }
+    }
+
+    void generic_residual(const BSRMatrix* A, const double* x, const double* b,
+            double* r)
+    {
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            r[i] = b[i];
+        }
+        generic_mult_append(A, x, r, -1.0);
+    }
+
+    void generic_apply_inv_diag(const BSRMatrix* A, const double* inv_diag,
+            const double* r, double* x, double omega)
+    {
+        const int B = A->b_rows;
+        const int n_block_rows = A->n_rows / B;
+
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+        for (int i = 0; i < n_block_rows; i++)
+        {
+            const double* inv_block = &(inv_diag[i*B*B]);
+            const double* r_block = &(r[i*B]);
+            for (int k = 0; k < B; k++)
+            {
+                double sum = 0.0;
+                for (int c = 0; c < B; c++)
+                {
+                    sum += inv_block[k*B + c] * r_block[c];
+                }
+                x[i*B + k] += omega * sum;
+            }
+        }
+    }
+
+    template <int B>
+    BSRKernels fixed_kernels()
+    {
+        BSRKernels kernels = {mult_append_kernel<B>, mult_append_T_kernel<B>,
+            residual_kernel<B>, apply_inv_diag_kernel<B>};
+        return kernels;
+    }
+
+    // Dispatch table, indexed by the (square) block size
+    const int max_fixed_block_size = 6;
+    const BSRKernels generic_kernels = {generic_mult_append,
+        generic_mult_append_T, generic_residual, generic_apply_inv_diag};
+    const BSRKernels kernel_table[max_fixed_block_size + 1] = {
+        generic_kernels,
+        generic_kernels,
+        fixed_kernels<2>(),
+        fixed_kernels<3>(),
+        fixed_kernels<4>(),
+        fixed_kernels<5>(),
+        fixed_kernels<6>()
+    };
+
+    const BSRKernels& bsr_kernels(const BSRMatrix* A)
+    {
+        if (A->b_rows == A->b_cols && A->b_rows <= max_fixed_block_size)
+        {
+            return kernel_table[A->b_rows];
+        }
+        return generic_kernels;
+    }
+}
+
+void BSRMatrix::block_mult_append(const double* x, double* b, double alpha)
+{
+    bsr_kernels(this).mult_append(this, x, b, alpha);
+}
+
+void BSRMatrix::block_mult_append_T(const double* x, double* b, double alpha)
+{
+    bsr_kernels(this).mult_append_T(this, x, b, alpha);
+}
+
+void BSRMatrix::block_residual(const double* x, const double* b, double* r)
+{
+    bsr_kernels(this).residual(this, x, b, r);
+}
+
+/**************************************************************
+*****   BSRMatrix Form Inverse Diagonal Blocks
+**************************************************************
+***** Inverts the diagonal block of each block row with
+***** Gauss-Jordan elimination (partial pivoting), storing the
+***** row-major inverses contiguously in inv_diag
+**************************************************************/
+void BSRMatrix::form_inv_diag_blocks(aligned_vector<double>& inv_diag) const
+{
+    if (b_rows != b_cols)
+    {
+        printf("Block Jacobi requires square blocks.\n");
+        exit(-1);
+    }
+
+    const int B = b_rows;
+    const int n_block_rows = n_rows / B;
+    aligned_vector<double> work(b_size);
+
+    inv_diag.resize(n_block_rows * b_size);
+    std::fill(inv_diag.begin(), inv_diag.end(), 0.0);
+
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        int diag_pos = -1;
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            if (idx2[j] == i)
+            {
+                diag_pos = j;
+                break;
+            }
+        }
+        if (diag_pos < 0) continue;
+
+        double* inv = &(inv_diag[i*b_size]);
+        std::copy(vals.begin() + diag_pos*b_size, vals.begin() + (diag_pos+1)*b_size,
+                work.begin());
+        for (int k = 0; k < B; k++)
+        {
+            inv[k*B + k] = 1.0;
+        }
+
+        bool singular = false;
+        for (int k = 0; k < B; k++)
+        {
+            // Pivot on largest entry in column k
+            int pivot = k;
+            for (int r = k + 1; r < B; r++)
+            {
+                if (fabs(work[r*B + k]) > fabs(work[pivot*B + k]))
+                {
+                    pivot = r;
+                }
+            }
+            if (fabs(work[pivot*B + k]) < zero_tol)
+            {
+                singular = true;
+                break;
+            }
+            if (pivot != k)
+            {
+                for (int c = 0; c < B; c++)
+                {
+                    std::swap(work[k*B + c], work[pivot*B + c]);
+                    std::swap(inv[k*B + c], inv[pivot*B + c]);
+                }
+            }
+
+            double pivot_inv = 1.0 / work[k*B + k];
+            for (int c = 0; c < B; c++)
+            {
+                work[k*B + c] *= pivot_inv;
+                inv[k*B + c] *= pivot_inv;
+            }
+            for (int r = 0; r < B; r++)
+            {
+                if (r == k) continue;
+                double factor = work[r*B + k];
+                if (factor == 0.0) continue;
+                for (int c = 0; c < B; c++)
+                {
+                    work[r*B + c] -= factor * work[k*B + c];
+                    inv[r*B + c] -= factor * inv[k*B + c];
+                }
+            }
+        }
+
+        if (singular)
+        {
+            std::fill(inv, inv + b_size, 0.0);
+        }
+    }
+}
+
+void BSRMatrix::apply_inv_diag_blocks(const aligned_vector<double>& inv_diag,
+        const double* r, double* x, double omega)
+{
+    bsr_kernels(this).apply_inv_diag(this, inv_diag.data(), r, x, omega);
+}
+
+void BSRMatrix::block_jacobi(Vector& x, Vector& b, Vector& tmp,
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega)
+{
+    for (int iter = 0; iter < num_sweeps; iter++)
+    {
+        block_residual(x.values.data(), b.values.data(), tmp.values.data());
+        apply_inv_diag_blocks(inv_diag, tmp.values.data(), x.values.data(), omega);
+    }
+}
@@ -18,4 +18,16 @@ aligned_vector<int>& CommData::get_buffer<int>()
     return int_buffer;
 }
 
+template<>
+aligned_vector<MPI_Request>& CommData::get_persistent_requests<double>()
+{
+    return persistent_requests;
+}
+
+template<>
+aligned_vector<MPI_Request>& CommData::get_persistent_requests<int>()
+{
+    return int_persistent_requests;
+}
+
 }
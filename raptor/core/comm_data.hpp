@@ -138,6 +138,9 @@ public:
     template<typename T>
     aligned_vector<T>& get_buffer();
 
+    template<typename T>
+    aligned_vector<MPI_Request>& get_persistent_requests();
+
     int num_msgs;
     int size_msgs;
     aligned_vector<int> procs;
@@ -148,6 +151,16 @@ public:
     aligned_vector<double> buffer;
     aligned_vector<int> int_buffer;
 
+    // Persistent requests bound to buffer / int_buffer, and per-message
+    // counts for neighborhood collectives (only set when a ParComm
+    // uses a non-standard comm_mode_t)
+    aligned_vector<MPI_Request> persistent_requests;
+    aligned_vector<MPI_Request> int_persistent_requests;
+    aligned_vector<int> counts;
+
+    // Interleaved values for communicating several vectors at once 
+    // (size_msgs * vec_size), resized as needed
+    aligned_vector<double> vec_buffer;
 };
 }
 #endif
@@ -185,15 +185,24 @@ void CommPkg::init_comm(ParVector& v)
     init_double_comm(v.local.data());
 }
 
-CSRMatrix* CommPkg::communicate(ParCSRMatrix* A)
+aligned_vector<double>& CommPkg::communicate(ParMultiVector& v)
+{
+    return communicate_vecs(v.values.data(), v.num_vectors);
+}
+
+void CommPkg::init_comm(ParMultiVector& v)
+{
+    init_comm_vecs(v.values.data(), v.num_vectors);
+}
+
+CSRMatrix* CommPkg::communicate(ParCSRMatrix* A, aligned_vector<index_t>& recv_cols)
 {
     int start, end;
     int ctr;
-    int global_col;
 
     int nnz = A->on_proc->nnz + A->off_proc->nnz;
     aligned_vector<int> rowptr(A->local_num_rows + 1);
-    aligned_vector<int> col_indices;
+    aligned_vector<index_t> col_indices;
     aligned_vector<double> values;
     if (nnz)
     {
@@ -209,8 +218,7 @@ CSRMatrix* CommPkg::communicate(ParCSRMatrix* A)
         end = A->on_proc->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            global_col = A->on_proc_column_map[A->on_proc->idx2[j]];
-            col_indices[ctr] = global_col;
+            col_indices[ctr] = A->on_proc_column_map[A->on_proc->idx2[j]];
             values[ctr++] = A->on_proc->vals[j];
         }
 
@@ -218,194 +226,79 @@ CSRMatrix* CommPkg::communicate(ParCSRMatrix* A)
         end = A->off_proc->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            global_col = A->off_proc_column_map[A->off_proc->idx2[j]];
-            col_indices[ctr] = global_col;
+            col_indices[ctr] = A->off_proc_column_map[A->off_proc->idx2[j]];
             values[ctr++] = A->off_proc->vals[j];
         }
         rowptr[i+1] = ctr;
     }
-    return communicate(rowptr, col_indices, values);
+    return communicate(rowptr, col_indices, values, recv_cols);
 }
 
-CSRMatrix* communication_helper(const aligned_vector<int>& rowptr,
-        const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
-        CommData* send_comm, CommData* recv_comm, int key, MPI_Comm mpi_comm)
+CSRMatrix* CommPkg::communicate(ParBSRMatrix* A, aligned_vector<index_t>& recv_cols)
 {
-    int start, end, proc;
-    int ctr, prev_ctr, size;
-    int row, row_start, row_end;
-    int count, row_count, row_size;
-
-    MPI_Status recv_status;
-
-    // Number of rows in recv_mat = size_recvs
-    // Don't know number of columns, but does not matter (CSR)
-    CSRMatrix* recv_mat = new CSRMatrix(recv_comm->size_msgs, -1);
-
-    // Only sending and recving a single buffer
-    aligned_vector<PairData> send_buffer;
-    aligned_vector<PairData> recv_buffer;
-    aligned_vector<int> send_ptr(send_comm->num_msgs+1);
-    send_ptr[0] = 0;
-
-    // Send pair_data for each row using MPI_DOUBLE_INT
-    ctr = 0;
-    if (send_comm->indptr_T.size())
-    {        
-        int size_pos, idx_start, idx_end;
-        for (int i = 0; i < send_comm->num_msgs; i++)
-        {
-            start = send_comm->indptr[i];
-            end = send_comm->indptr[i+1];
-            for (int j = start; j < end; j++)
-            {
-                size_pos = ctr;
-                send_buffer.push_back(PairData());
-                send_buffer[ctr++].index = 0;
-                idx_start = send_comm->indptr_T[j];
-                idx_end = send_comm->indptr_T[j+1];
-                for (int k = idx_start; k < idx_end; k++)
-                {
-                    row = send_comm->indices[k];
-                    row_start = rowptr[row];
-                    row_end = rowptr[row+1];
-		            send_buffer[size_pos].index += (row_end - row_start);
-                    for (int l = row_start; l < row_end; l++)
-                    {
-                        send_buffer.push_back(PairData());
-                        send_buffer[ctr].index = col_indices[l];
-                        send_buffer[ctr++].val = values[l];
-                    }
-                }
-                if (ctr > size_pos + 1)
-                {
-                    std::sort(send_buffer.begin() + size_pos + 1, send_buffer.begin() + ctr, 
-                            [&](const PairData& lhs, const PairData& rhs)
-                            {
-                                return lhs.index < rhs.index;
-                            });
-                    int pos = size_pos + 1;
-                    for (int k = size_pos + 2; k < ctr; k++)
-                    {
-                        if (send_buffer[k].index == send_buffer[pos].index)
-                        {
-                            send_buffer[pos].val += send_buffer[k].val;
-			    send_buffer[size_pos].index--;
-                        }
-                        else
-                        {
-                            pos++;
-                            send_buffer[pos].index = send_buffer[k].index;
-                            send_buffer[pos].val = send_buffer[k].val;
-                        }
-                    }
-		            ctr = pos + 1;
-                    send_buffer.resize(ctr);
-                }
-            }
-            send_ptr[i+1] = send_buffer.size();
-        }
-    }
-    else if (send_comm->indices.size())
-    {
-        for (int i = 0; i < send_comm->num_msgs; i++)
-        {
-            start = send_comm->indptr[i];
-            end = send_comm->indptr[i+1];
-            for (int j = start; j < end; j++)
-            {
-                row = send_comm->indices[j];
-                row_start = rowptr[row];
-                row_end = rowptr[row+1];
-                send_buffer.push_back(PairData());
-                send_buffer[ctr++].index = row_end - row_start;
-                for (int k = row_start; k < row_end; k++)
-                {
-                    send_buffer.push_back(PairData());
-                    send_buffer[ctr].index = col_indices[k];
-                    send_buffer[ctr++].val = values[k];
-                }
-            }
-            send_ptr[i+1] = ctr;
-        }
-    }
-    else
-    {
-        for (int i = 0; i < send_comm->num_msgs; i++)
-        {
-            start = send_comm->indptr[i];
-            end = send_comm->indptr[i+1];
-            for (int j = start; j < end; j++)
-            {
-                row = j;
-                row_start = rowptr[row];
-                row_end = rowptr[row+1];
-                send_buffer.push_back(PairData());
-                send_buffer[ctr++].index = row_end - row_start;
-                for (int k = row_start; k < row_end; k++)
-                {
-                    send_buffer.push_back(PairData());
-                    send_buffer[ctr].index = col_indices[k];
-                    send_buffer[ctr++].val = values[k];
-                }
-            }
-            send_ptr[i+1] = ctr;
-        }
-    }
-
+    int start, end;
+    int ctr;
+    int b_cols = A->b_cols;
+    int b_size = A->b_size;
+    int n_block_rows = A->local_num_rows / A->b_rows;
 
-    for (int i = 0; i < send_comm->num_msgs; i++)
+    int n_blocks = A->on_proc->idx2.size() + A->off_proc->idx2.size();
+    aligned_vector<int> rowptr(n_block_rows + 1);
+    aligned_vector<index_t> col_indices;
+    aligned_vector<double> values;
+    if (n_blocks)
     {
-        proc = send_comm->procs[i];
-        start = send_ptr[i];
-        end = send_ptr[i+1];
-        MPI_Isend(&(send_buffer[start]), end - start, MPI_DOUBLE_INT, proc, 
-                key, mpi_comm, &(send_comm->requests[i]));
+        col_indices.resize(n_blocks);
+        values.resize(n_blocks * b_size);
     }
 
-    // Recv pair_data for each row, and add to recv_mat
-    row_count = 0;
-    for (int i = 0; i < recv_comm->num_msgs; i++)
+    ctr = 0;
+    rowptr[0] = ctr;
+    for (int i = 0; i < n_block_rows; i++)
     {
-        proc = recv_comm->procs[i];
-        start = recv_comm->indptr[i];
-        end = recv_comm->indptr[i+1];
-        size = end - start;
-        MPI_Probe(proc, key, mpi_comm, &recv_status);
-        MPI_Get_count(&recv_status, MPI_DOUBLE_INT, &count);
-        if (count > recv_buffer.size())
+        start = A->on_proc->idx1[i];
+        end = A->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
         {
-            recv_buffer.resize(count);
+            col_indices[ctr] = A->on_proc_column_map[A->on_proc->idx2[j] * b_cols] 
+                / b_cols;
+            std::copy(A->on_proc->vals.begin() + j * b_size, 
+                    A->on_proc->vals.begin() + (j+1) * b_size, 
+                    values.begin() + ctr * b_size);
+            ctr++;
         }
-        MPI_Recv((&recv_buffer[0]), count, MPI_DOUBLE_INT, proc, key, mpi_comm,
-            &recv_status);
-        ctr = 0;
-        for (int j = 0; j < size; j++)
+
+        start = A->off_proc->idx1[i];
+        end = A->off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
         {
-            row_size = recv_buffer[ctr++].index;
-            recv_mat->idx1[row_count+1] = recv_mat->idx1[row_count] + row_size;
-            row_count++;
-            for (int k = 0; k < row_size; k++)
-            {
-                recv_mat->idx2.push_back(recv_buffer[ctr].index);
-                recv_mat->vals.push_back(recv_buffer[ctr++].val);
-            }
+            col_indices[ctr] = A->off_proc_column_map[A->off_proc->idx2[j] * b_cols] 
+                / b_cols;
+            std::copy(A->off_proc->vals.begin() + j * b_size, 
+                    A->off_proc->vals.begin() + (j+1) * b_size, 
+                    values.begin() + ctr * b_size);
+            ctr++;
         }
+        rowptr[i+1] = ctr;
     }
-    recv_mat->nnz = recv_mat->idx2.size();
-
-    MPI_Waitall(send_comm->num_msgs, send_comm->requests.data(), MPI_STATUSES_IGNORE);
-
-    return recv_mat;
-}    
-
+    return communicate_blocks(rowptr, col_indices, values, b_size, recv_cols);
+}
 
-CSRMatrix* communication_helper(const aligned_vector<int>& rowptr,
-        const aligned_vector<int>& col_indices, CommData* send_comm, 
-        CommData* recv_comm, int key, MPI_Comm mpi_comm)
+// Sends the rows of (rowptr, col_indices, values) described by send_comm,
+// and receives the rows described by recv_comm.  Each message holds the
+// size and global columns of each row (MPI_INDEX_T), and is followed by
+// a message of the values of these rows (MPI_DOUBLE) if values is not
+// NULL, with b_size values for each column (a dense block).  If 
+// send_comm has indptr_T, the rows sent for each index are summed into 
+// a single row.  Columns of the received rows are returned in recv_cols
+// (idx2 of the returned matrix is left empty).
+static CSRMatrix* communication_helper(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>* values,
+        aligned_vector<index_t>& recv_cols, CommData* send_comm, CommData* recv_comm,
+        int key, MPI_Comm mpi_comm, int b_size = 1)
 {
     int start, end, proc;
-    int ctr, prev_ctr, size;
+    int ctr, size, size_pos;
     int row, row_start, row_end;
     int count, row_count, row_size;
 
@@ -415,83 +308,66 @@ CSRMatrix* communication_helper(const aligned_vector<int>& rowptr,
     // Don't know number of columns, but does not matter (CSR)
     CSRMatrix* recv_mat = new CSRMatrix(recv_comm->size_msgs, -1);
 
-    // Only sending and recving a single buffer
-    aligned_vector<int> send_buffer;
-    aligned_vector<int> recv_buffer;
+    aligned_vector<index_t> send_buffer;
+    aligned_vector<double> send_vals;
+    aligned_vector<index_t> recv_buffer;
     aligned_vector<int> send_ptr(send_comm->num_msgs+1);
-
-    // Send pair_data for each row using MPI_DOUBLE_INT
-    ctr = 0;
+    aligned_vector<int> vals_ptr(send_comm->num_msgs+1);
+    aligned_vector<MPI_Request> vals_requests(send_comm->num_msgs);
     send_ptr[0] = 0;
+    vals_ptr[0] = 0;
+
     if (send_comm->indptr_T.size())
-    {        
-        int size_pos, idx_start, idx_end;
+    {
+        // Entries of the merged rows, as (column, position in col_indices)
+        aligned_vector<std::pair<index_t, int> > row_entries;
         for (int i = 0; i < send_comm->num_msgs; i++)
         {
             start = send_comm->indptr[i];
             end = send_comm->indptr[i+1];
             for (int j = start; j < end; j++)
             {
-                size_pos = ctr;
-                send_buffer.push_back(0);
-                idx_start = send_comm->indptr_T[j];
-                idx_end = send_comm->indptr_T[j+1];
-                for (int k = idx_start; k < idx_end; k++)
+                row_entries.clear();
+                for (int k = send_comm->indptr_T[j]; k < send_comm->indptr_T[j+1]; k++)
                 {
                     row = send_comm->indices[k];
-                    row_start = rowptr[row];
-                    row_end = rowptr[row+1];
-		            send_buffer[size_pos] += (row_end - row_start);
-                    for (int l = row_start; l < row_end; l++)
+                    for (int l = rowptr[row]; l < rowptr[row+1]; l++)
                     {
-                        send_buffer.push_back(col_indices[l]);
+                        row_entries.push_back(std::make_pair(col_indices[l], l));
                     }
                 }
-                if (ctr > size_pos + 1)
+                std::sort(row_entries.begin(), row_entries.end(),
+                        [&](const std::pair<index_t, int>& lhs,
+                            const std::pair<index_t, int>& rhs)
+                        {
+                            return lhs.first < rhs.first;
+                        });
+
+                size_pos = send_buffer.size();
+                send_buffer.push_back(0);
+                for (int k = 0; k < (int) row_entries.size(); k++)
                 {
-                    std::sort(send_buffer.begin() + size_pos + 1, send_buffer.begin() + ctr, 
-                            [&](const int lhs, const int rhs)
-                            {
-                                return lhs < rhs;
-                            });
-                    int pos = size_pos + 1;
-                    for (int k = size_pos + 2; k < ctr; k++)
+                    const double* vals = values ? 
+                        values->data() + row_entries[k].second * b_size : NULL;
+                    if (k && row_entries[k].first == row_entries[k-1].first)
                     {
-                        if (send_buffer[k] == send_buffer[pos])
-                        {
-			                send_buffer[size_pos]--;
-                        }
-                        else
+                        if (values)
                         {
-                            pos++;
-                            send_buffer[pos] = send_buffer[k];
+                            double* sum = send_vals.data() + send_vals.size() - b_size;
+                            for (int v = 0; v < b_size; v++)
+                            {
+                                sum[v] += vals[v];
+                            }
                         }
+                        continue;
                     }
-		            ctr = pos + 1;
-                    send_buffer.resize(ctr);
-                }
-            }
-            send_ptr[i+1] = send_buffer.size();
-        }
-    }
-    else if (send_comm->indices.size())
-    {
-        for (int i = 0; i < send_comm->num_msgs; i++)
-        {
-            start = send_comm->indptr[i];
-            end = send_comm->indptr[i+1];
-            for (int j = start; j < end; j++)
-            {
-                row = send_comm->indices[j];
-                row_start = rowptr[row];
-                row_end = rowptr[row+1];
-                send_buffer.push_back(row_end - row_start);
-                for (int k = row_start; k < row_end; k++)
-                {
-                    send_buffer.push_back(col_indices[k]);
+                    send_buffer[size_pos]++;
+                    send_buffer.push_back(row_entries[k].first);
+                    if (values) send_vals.insert(send_vals.end(), vals, vals + b_size);
                 }
             }
             send_ptr[i+1] = send_buffer.size();
+            vals_ptr[i+1] = send_vals.size();
         }
     }
     else
@@ -502,44 +378,52 @@ CSRMatrix* communication_helper(const aligned_vector<int>& rowptr,
             end = send_comm->indptr[i+1];
             for (int j = start; j < end; j++)
             {
-                row = j;
+                row = send_comm->indices.size() ? send_comm->indices[j] : j;
                 row_start = rowptr[row];
                 row_end = rowptr[row+1];
                 send_buffer.push_back(row_end - row_start);
-                for (int k = row_start; k < row_end; k++)
+                send_buffer.insert(send_buffer.end(), col_indices.begin() + row_start,
+                        col_indices.begin() + row_end);
+                if (values)
                 {
-                    send_buffer.push_back(col_indices[k]);
+                    send_vals.insert(send_vals.end(), 
+                            values->begin() + row_start * b_size,
+                            values->begin() + row_end * b_size);
                 }
             }
             send_ptr[i+1] = send_buffer.size();
+            vals_ptr[i+1] = send_vals.size();
         }
     }
 
     for (int i = 0; i < send_comm->num_msgs; i++)
     {
         proc = send_comm->procs[i];
-        start = send_ptr[i];
-        end = send_ptr[i+1];
-        MPI_Isend(&(send_buffer[start]), end - start, MPI_INT, proc, 
-                key, mpi_comm, &(send_comm->requests[i]));
+        MPI_Isend(send_buffer.data() + send_ptr[i], send_ptr[i+1] - send_ptr[i],
+                MPI_INDEX_T, proc, key, mpi_comm, &(send_comm->requests[i]));
+        if (values)
+        {
+            MPI_Isend(send_vals.data() + vals_ptr[i], vals_ptr[i+1] - vals_ptr[i],
+                    MPI_DOUBLE, proc, key, mpi_comm, &(vals_requests[i]));
+        }
     }
 
-    // Recv pair_data for each row, and add to recv_mat
+    // Recv sizes and columns of each row, followed by values (messages
+    // from a process are matched in the order they were sent)
+    recv_cols.clear();
     row_count = 0;
     recv_mat->idx1[0] = 0;
     for (int i = 0; i < recv_comm->num_msgs; i++)
     {
         proc = recv_comm->procs[i];
-        start = recv_comm->indptr[i];
-        end = recv_comm->indptr[i+1];
-        size = end - start;
+        size = recv_comm->indptr[i+1] - recv_comm->indptr[i];
         MPI_Probe(proc, key, mpi_comm, &recv_status);
-        MPI_Get_count(&recv_status, MPI_INT, &count);
-        if (count > recv_buffer.size())
+        MPI_Get_count(&recv_status, MPI_INDEX_T, &count);
+        if (count > (int) recv_buffer.size())
         {
             recv_buffer.resize(count);
         }
-        MPI_Recv((&recv_buffer[0]), count, MPI_INT, proc, key, mpi_comm,
+        MPI_Recv(recv_buffer.data(), count, MPI_INDEX_T, proc, key, mpi_comm,
             &recv_status);
         ctr = 0;
         for (int j = 0; j < size; j++)
@@ -547,54 +431,44 @@ CSRMatrix* communication_helper(const aligned_vector<int>& rowptr,
             row_size = recv_buffer[ctr++];
             recv_mat->idx1[row_count+1] = recv_mat->idx1[row_count] + row_size;
             row_count++;
-            for (int k = 0; k < row_size; k++)
-            {
-                recv_mat->idx2.push_back(recv_buffer[ctr++]);
-            }
+            recv_cols.insert(recv_cols.end(), recv_buffer.begin() + ctr,
+                    recv_buffer.begin() + ctr + row_size);
+            ctr += row_size;
+        }
+        if (values)
+        {
+            start = recv_mat->vals.size();
+            recv_mat->vals.resize(start + (count - size) * b_size);
+            MPI_Recv(recv_mat->vals.data() + start, (count - size) * b_size, 
+                    MPI_DOUBLE, proc, key, mpi_comm, &recv_status);
         }
     }
-    recv_mat->nnz = recv_mat->idx2.size();
+    recv_mat->nnz = recv_cols.size();
 
     MPI_Waitall(send_comm->num_msgs, send_comm->requests.data(), MPI_STATUSES_IGNORE);
+    if (values)
+    {
+        MPI_Waitall(send_comm->num_msgs, vals_requests.data(), MPI_STATUSES_IGNORE);
+    }
 
-    return recv_mat;
-}  
-
-
-
-
-CSRMatrix* ParComm::communicate(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double>& values)
-{
-    CSRMatrix* recv_mat = communication_helper(rowptr, col_indices, values,
-            send_data, recv_data, key, mpi_comm);
-    key++;
-    return recv_mat;
-}
-
-CSRMatrix* ParComm::communicate(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices)
-{
-    CSRMatrix* recv_mat = communication_helper(rowptr, col_indices, send_data, 
-            recv_data, key, mpi_comm);
-    key++;
     return recv_mat;
 }
 
-CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
-        const int n_result_rows)
+// Gathers rows received by communicate_T into rows of the result, where
+// received row i is added to local row send_data->indices[i] (with 
+// b_size values per entry)
+static CSRMatrix* gather_T_rows(CSRMatrix* recv_mat_T,
+        const aligned_vector<index_t>& recv_cols_T, CommData* send_data,
+        const int n_result_rows, aligned_vector<index_t>& recv_cols,
+        int b_size = 1)
 {
     int idx, ptr;
     int start, end;
+    bool has_vals = recv_mat_T->vals.size();
 
     aligned_vector<int> row_sizes;
     if (n_result_rows) row_sizes.resize(n_result_rows, 0);
 
-    CSRMatrix* recv_mat_T = communication_helper(rowptr, col_indices, values,
-            recv_data, send_data, key, mpi_comm);
-
-
     CSRMatrix* recv_mat = new CSRMatrix(n_result_rows, -1);
 
     for (int i = 0; i < send_data->size_msgs; i++)
@@ -611,10 +485,10 @@ CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr,
         row_sizes[i] = 0;
     }
     recv_mat->nnz = recv_mat->idx1[n_result_rows];
-    if (recv_mat->nnz)
+    recv_cols.resize(recv_mat->nnz);
+    if (has_vals && recv_mat->nnz)
     {
-        recv_mat->idx2.resize(recv_mat->nnz);
-        recv_mat->vals.resize(recv_mat->nnz);
+        recv_mat->vals.resize(recv_mat->nnz * b_size);
     }
 
     for (int i = 0; i < send_data->size_msgs; i++)
@@ -625,340 +499,374 @@ CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr,
         for (int j = start; j < end; j++)
         {
             ptr = recv_mat->idx1[idx] + row_sizes[idx]++;
-            recv_mat->idx2[ptr] = recv_mat_T->idx2[j];
-            recv_mat->vals[ptr] = recv_mat_T->vals[j];
+            recv_cols[ptr] = recv_cols_T[j];
+            if (has_vals)
+            {
+                std::copy(recv_mat_T->vals.begin() + j * b_size,
+                        recv_mat_T->vals.begin() + (j+1) * b_size,
+                        recv_mat->vals.begin() + ptr * b_size);
+            }
         }
     }
 
-    delete recv_mat_T;
+    return recv_mat;
+}
 
+CSRMatrix* ParComm::communicate(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        aligned_vector<index_t>& recv_cols)
+{
+    CSRMatrix* recv_mat = communication_helper(rowptr, col_indices, &values,
+            recv_cols, send_data, recv_data, key, mpi_comm);
+    key++;
     return recv_mat;
 }
 
-CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const int n_result_rows)
+CSRMatrix* ParComm::communicate(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, aligned_vector<index_t>& recv_cols)
 {
-    int idx, ptr;
-    int start, end;
+    CSRMatrix* recv_mat = communication_helper(rowptr, col_indices, NULL,
+            recv_cols, send_data, recv_data, key, mpi_comm);
+    key++;
+    return recv_mat;
+}
 
-    aligned_vector<int> row_sizes;
-    if (n_result_rows) row_sizes.resize(n_result_rows, 0);
+CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        const int n_result_rows, aligned_vector<index_t>& recv_cols)
+{
+    aligned_vector<index_t> recv_cols_T;
+    CSRMatrix* recv_mat_T = communication_helper(rowptr, col_indices, &values,
+            recv_cols_T, recv_data, send_data, key, mpi_comm);
+    CSRMatrix* recv_mat = gather_T_rows(recv_mat_T, recv_cols_T, send_data,
+            n_result_rows, recv_cols);
+    delete recv_mat_T;
 
-    CSRMatrix* recv_mat_T = communication_helper(rowptr, col_indices, 
-            recv_data, send_data, key, mpi_comm);
+    return recv_mat;
+}
 
+CSRMatrix* ParComm::communicate_blocks(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        const int b_size, aligned_vector<index_t>& recv_cols)
+{
+    CSRMatrix* recv_mat = communication_helper(rowptr, col_indices, &values,
+            recv_cols, send_data, recv_data, key, mpi_comm, b_size);
+    key++;
+    return recv_mat;
+}
 
-    CSRMatrix* recv_mat = new CSRMatrix(n_result_rows, -1);
+CSRMatrix* ParComm::communicate_T_blocks(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        const int b_size, const int n_result_rows, aligned_vector<index_t>& recv_cols)
+{
+    aligned_vector<index_t> recv_cols_T;
+    CSRMatrix* recv_mat_T = communication_helper(rowptr, col_indices, &values,
+            recv_cols_T, recv_data, send_data, key, mpi_comm, b_size);
+    key++;
+    CSRMatrix* recv_mat = gather_T_rows(recv_mat_T, recv_cols_T, send_data,
+            n_result_rows, recv_cols, b_size);
+    delete recv_mat_T;
 
-    for (int i = 0; i < send_data->size_msgs; i++)
-    {
-        idx = send_data->indices[i];
-        start = recv_mat_T->idx1[i];
-        end = recv_mat_T->idx1[i+1];
-        row_sizes[idx] += (end - start);
-    }
-    recv_mat->idx1[0] = 0;
-    for (int i = 0; i < n_result_rows; i++)
-    {
-        recv_mat->idx1[i+1] = recv_mat->idx1[i] + row_sizes[i];
-        row_sizes[i] = 0;
-    }
-    recv_mat->nnz = recv_mat->idx1[n_result_rows];
-    if (recv_mat->nnz)
-    {
-        recv_mat->idx2.resize(recv_mat->nnz);
-    }
+    return recv_mat;
+}
 
-    for (int i = 0; i < send_data->size_msgs; i++)
-    {
-        idx = send_data->indices[i];
-        start = recv_mat_T->idx1[i];
-        end = recv_mat_T->idx1[i+1];
-        for (int j = start; j < end; j++)
-        {
-            ptr = recv_mat->idx1[idx] + row_sizes[idx]++;
-            recv_mat->idx2[ptr] = recv_mat_T->idx2[j];
-        }
-    }
+CSRMatrix* ParComm::communicate_T_rows(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        aligned_vector<index_t>& recv_cols)
+{
+    CSRMatrix* recv_mat_T = communication_helper(rowptr, col_indices, &values,
+            recv_cols, recv_data, send_data, key, mpi_comm);
+    key++;
+    return recv_mat_T;
+}
 
+CSRMatrix* ParComm::communicate_T(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const int n_result_rows,
+        aligned_vector<index_t>& recv_cols)
+{
+    aligned_vector<index_t> recv_cols_T;
+    CSRMatrix* recv_mat_T = communication_helper(rowptr, col_indices, NULL,
+            recv_cols_T, recv_data, send_data, key, mpi_comm);
+    CSRMatrix* recv_mat = gather_T_rows(recv_mat_T, recv_cols_T, send_data,
+            n_result_rows, recv_cols);
     delete recv_mat_T;
 
     return recv_mat;
 }
 
 
-    
-CSRMatrix* TAPComm::communicate(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double>& values)
-{   
-    int ctr, idx, row;
-    int start, end;
 
-    CSRMatrix* L_mat = local_L_par_comm->communicate(rowptr, col_indices,
-            values);
+template<typename T>
+void init_persistent_requests(CommData* send_data, CommData* recv_data, 
+        int key, MPI_Comm mpi_comm)
+{
+    int start, end;
+    aligned_vector<T>& sendbuf = send_data->get_buffer<T>();
+    aligned_vector<T>& recvbuf = recv_data->get_buffer<T>();
+    aligned_vector<MPI_Request>& send_requests = send_data->get_persistent_requests<T>();
+    aligned_vector<MPI_Request>& recv_requests = recv_data->get_persistent_requests<T>();
+    MPI_Datatype type = CommPkg::get_type(sendbuf);
 
-    CSRMatrix* G_mat;
-    if (local_S_par_comm)
+    send_requests.resize(send_data->num_msgs);
+    for (int i = 0; i < send_data->num_msgs; i++)
     {
-        CSRMatrix* S_mat = local_S_par_comm->communicate(rowptr, col_indices, values);
-        G_mat = global_par_comm->communicate(S_mat->idx1, S_mat->idx2, 
-                S_mat->vals);
-        delete S_mat;
-    }
-    else
-    {
-        G_mat = global_par_comm->communicate(rowptr, col_indices, values);
+        start = send_data->indptr[i];
+        end = send_data->indptr[i+1];
+        MPI_Send_init(&(sendbuf[start]), end - start, type, send_data->procs[i],
+                key, mpi_comm, &(send_requests[i]));
     }
 
-    CSRMatrix* R_mat = local_R_par_comm->communicate(G_mat->idx1, G_mat->idx2, 
-            G_mat->vals);
-    delete G_mat;
-
-
-    // Create recv_mat (combination of L_mat and R_mat)
-    CSRMatrix* recv_mat = new CSRMatrix(L_mat->n_rows + R_mat->n_rows, -1);
-    aligned_vector<int>& row_sizes = get_recv_buffer<int>();
-    recv_mat->nnz = L_mat->nnz + R_mat->nnz;
-    int ptr;
-    if (recv_mat->nnz)
+    recv_requests.resize(recv_data->num_msgs);
+    for (int i = 0; i < recv_data->num_msgs; i++)
     {
-        recv_mat->idx2.resize(recv_mat->nnz);
-        recv_mat->vals.resize(recv_mat->nnz);
+        start = recv_data->indptr[i];
+        end = recv_data->indptr[i+1];
+        MPI_Recv_init(&(recvbuf[start]), end - start, type, recv_data->procs[i],
+                key, mpi_comm, &(recv_requests[i]));
     }
+}
 
-    for (int i = 0; i < R_mat->n_rows; i++)
-    {
-        start = R_mat->idx1[i];
-        end = R_mat->idx1[i+1];
-        row = local_R_par_comm->recv_data->indices[i];
-        row_sizes[row] = end - start;
-    }
-    for (int i = 0; i < L_mat->n_rows; i++)
+void free_persistent_requests(aligned_vector<MPI_Request>& requests)
+{
+    for (aligned_vector<MPI_Request>::iterator it = requests.begin();
+            it != requests.end(); ++it)
     {
-        start = L_mat->idx1[i];
-        end = L_mat->idx1[i+1];
-        row = local_L_par_comm->recv_data->indices[i];
-        row_sizes[row] = end - start;
+        MPI_Request_free(&(*it));
     }
-    recv_mat->idx1[0] = 0;
-    for (int i = 0; i < recv_mat->n_rows; i++)
+    requests.clear();
+}
+
+void ParComm::set_comm_mode(comm_mode_t mode)
+{
+    free_comm_mode();
+    comm_mode = mode;
+
+    if (comm_mode == PersistentComm)
     {
-        recv_mat->idx1[i+1] = recv_mat->idx1[i] + row_sizes[i];
-        row_sizes[i] = 0;
+        // Tags of persistent requests are fixed, so use current key
+        init_persistent_requests<double>(send_data, recv_data, key, mpi_comm);
+        init_persistent_requests<int>(send_data, recv_data, key, mpi_comm);
+        key++;
     }
-    for (int i = 0; i < R_mat->n_rows; i++)
+    else if (comm_mode == NeighborComm)
     {
-        start = R_mat->idx1[i];
-        end = R_mat->idx1[i+1];
-        row = local_R_par_comm->recv_data->indices[i];
-        for (int j = start; j < end; j++)
+        // Sources are processes this process recvs from, destinations
+        // those it sends to.  Neighbor order matches the messages
+        // in recv_data and send_data (no reordering).
+        MPI_Dist_graph_create_adjacent(mpi_comm, 
+                recv_data->num_msgs, recv_data->procs.data(), MPI_UNWEIGHTED,
+                send_data->num_msgs, send_data->procs.data(), MPI_UNWEIGHTED,
+                MPI_INFO_NULL, 0, &neighbor_comm);
+
+        send_data->counts.resize(send_data->num_msgs + 1);
+        for (int i = 0; i < send_data->num_msgs; i++)
         {
-            ptr = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[ptr] = R_mat->idx2[j];
-            recv_mat->vals[ptr] = R_mat->vals[j];
+            send_data->counts[i] = send_data->indptr[i+1] - send_data->indptr[i];
         }
-    }
-    for (int i = 0; i < L_mat->n_rows; i++)
-    {
-        start = L_mat->idx1[i];
-        end = L_mat->idx1[i+1];
-        row = local_L_par_comm->recv_data->indices[i];
-        for (int j = start; j < end; j++)
+        recv_data->counts.resize(recv_data->num_msgs + 1);
+        for (int i = 0; i < recv_data->num_msgs; i++)
         {
-            ptr = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[ptr] = L_mat->idx2[j];
-            recv_mat->vals[ptr] = L_mat->vals[j];
+            recv_data->counts[i] = recv_data->indptr[i+1] - recv_data->indptr[i];
         }
     }
+    else if (comm_mode == SharedComm)
+    {
+        init_shared_window();
+    }
+}
 
-    delete R_mat;
-    delete L_mat;
+void ParComm::init_shared_window()
+{
+    int num_procs, shared_procs, all_shared;
+    MPI_Comm shared_comm;
 
-    return recv_mat;
-}
+    // Shared windows require every process in mpi_comm to share memory
+    MPI_Comm_size(mpi_comm, &num_procs);
+    MPI_Comm_split_type(mpi_comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+            &shared_comm);
+    MPI_Comm_size(shared_comm, &shared_procs);
+    MPI_Comm_free(&shared_comm);
+    int is_shared = shared_procs == num_procs;
+    MPI_Allreduce(&is_shared, &all_shared, 1, MPI_INT, MPI_MIN, mpi_comm);
+    if (!all_shared)
+    {
+        comm_mode = StandardComm;
+        return;
+    }
 
-CSRMatrix* TAPComm::communicate_T(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const aligned_vector<double>& values,
-        const int n_result_rows)
-{   
-    int n_rows = rowptr.size() - 1;
-    int idx, ptr;
-    int start, end, row;
-    int ctr, size;
-    int row_start, row_end, row_size;
-
-    CSRMatrix* L_mat = communication_helper(rowptr, col_indices, 
-            values, local_L_par_comm->recv_data, 
-            local_L_par_comm->send_data, local_L_par_comm->key,
-            local_L_par_comm->mpi_comm);
-    local_L_par_comm->key++;
-
-    CSRMatrix* R_mat = communication_helper(rowptr, col_indices, 
-            values, local_R_par_comm->recv_data, 
-            local_R_par_comm->send_data, local_R_par_comm->key,
-            local_R_par_comm->mpi_comm);
-    local_R_par_comm->key++;
-
-    CSRMatrix* G_mat = communication_helper(R_mat->idx1, R_mat->idx2,
-            R_mat->vals, global_par_comm->recv_data, global_par_comm->send_data,
-            global_par_comm->key, global_par_comm->mpi_comm);
-    global_par_comm->key++;
-    delete R_mat;
+    MPI_Aint size = 2 * send_data->size_msgs * sizeof(double);
+    MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, mpi_comm, &shared_base, 
+            &shared_win);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, shared_win);
+    shared_parity = 0;
 
-    CSRMatrix* final_mat;
-    ParComm* final_comm;
-    if (local_S_par_comm)
+    // Each recv proc needs the position of its message in the send 
+    // buffer of the sending proc
+    shared_recv_offset.resize(recv_data->num_msgs);
+    for (int i = 0; i < send_data->num_msgs; i++)
     {
-        final_mat = communication_helper(G_mat->idx1, G_mat->idx2,
-                G_mat->vals, local_S_par_comm->recv_data, local_S_par_comm->send_data, 
-                local_S_par_comm->key, local_S_par_comm->mpi_comm);
-        local_S_par_comm->key++;
-        delete G_mat;
-        final_comm = local_S_par_comm;
+        MPI_Isend(&(send_data->indptr[i]), 1, MPI_INT, send_data->procs[i], 
+                key, mpi_comm, &(send_data->requests[i]));
     }
-    else
+    for (int i = 0; i < recv_data->num_msgs; i++)
     {
-        final_mat = G_mat;
-        final_comm = global_par_comm;
+        MPI_Irecv(&(shared_recv_offset[i]), 1, MPI_INT, recv_data->procs[i],
+                key, mpi_comm, &(recv_data->requests[i]));
     }
-
-    CSRMatrix* recv_mat = new CSRMatrix(n_result_rows, -1);
-    aligned_vector<int> row_sizes(n_result_rows, 0);
-    int nnz = L_mat->nnz + final_mat->nnz;
-    if (nnz)
+    if (send_data->num_msgs)
     {
-        recv_mat->idx2.reserve(nnz);
-        recv_mat->vals.reserve(nnz);
+        MPI_Waitall(send_data->num_msgs, send_data->requests.data(), MPI_STATUSES_IGNORE);
     }
-    for (int i = 0; i < final_comm->send_data->size_msgs; i++)
+    if (recv_data->num_msgs)
     {
-        row = final_comm->send_data->indices[i];
-        row_size = final_mat->idx1[i+1] - final_mat->idx1[i];
-        row_sizes[row] += row_size;
+        MPI_Waitall(recv_data->num_msgs, recv_data->requests.data(), MPI_STATUSES_IGNORE);
     }
-    for (int i = 0; i < local_L_par_comm->send_data->size_msgs; i++)
+    key++;
+
+    int disp_unit;
+    MPI_Aint proc_size;
+    shared_recv_base.resize(recv_data->num_msgs);
+    shared_recv_half.resize(recv_data->num_msgs);
+    for (int i = 0; i < recv_data->num_msgs; i++)
     {
-        row = local_L_par_comm->send_data->indices[i];
-        row_size = L_mat->idx1[i+1] - L_mat->idx1[i];
-        row_sizes[row] += row_size;
+        MPI_Win_shared_query(shared_win, recv_data->procs[i], &proc_size,
+                &disp_unit, &(shared_recv_base[i]));
+        shared_recv_half[i] = proc_size / 2;
     }
-    recv_mat->idx1[0] = 0;
-    for (int i = 0; i < n_result_rows; i++)
+}
+
+void ParComm::free_comm_mode()
+{
+    if (comm_mode == PersistentComm)
     {
-        recv_mat->idx1[i+1] = recv_mat->idx1[i] + row_sizes[i];
-        row_sizes[i] = 0;
+        free_persistent_requests(send_data->persistent_requests);
+        free_persistent_requests(send_data->int_persistent_requests);
+        free_persistent_requests(recv_data->persistent_requests);
+        free_persistent_requests(recv_data->int_persistent_requests);
     }
-    for (int i = 0; i < final_comm->send_data->size_msgs; i++)
+    else if (comm_mode == NeighborComm)
     {
-        row = final_comm->send_data->indices[i];
-        row_start = final_mat->idx1[i];
-        row_end = final_mat->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            idx = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[idx] = final_mat->idx2[j];
-            recv_mat->vals[idx] = final_mat->vals[j];
-        }
+        MPI_Comm_free(&neighbor_comm);
+        send_data->counts.clear();
+        recv_data->counts.clear();
     }
-    for (int i = 0; i < local_L_par_comm->send_data->size_msgs; i++)
+    else if (comm_mode == SharedComm)
     {
-        row = local_L_par_comm->send_data->indices[i];
-        row_start = L_mat->idx1[i];
-        row_end = L_mat->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            idx = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[idx] = L_mat->idx2[j];
-            recv_mat->vals[idx] = L_mat->vals[j];
-        }
+        MPI_Win_unlock_all(shared_win);
+        MPI_Win_free(&shared_win);
+        shared_base = NULL;
+        shared_parity = 0;
+        shared_recv_base.clear();
+        shared_recv_half.clear();
+        shared_recv_offset.clear();
     }
-    recv_mat->nnz = recv_mat->idx2.size();
-    recv_mat->sort();
-
-    delete L_mat;
-    delete final_mat;
-
-
-    return recv_mat;
-    
+    comm_mode = StandardComm;
 }
 
-
-
-CSRMatrix* TAPComm::communicate(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices)
-{   
-    int ctr, idx, row;
-    int start, end;
-
-    CSRMatrix* L_mat = local_L_par_comm->communicate(rowptr, col_indices);
+// Sends rows through each step of TAP communication (local_S, global,
+// and local_R, or local_L for rows sent within the node), with b_size
+// values per column.  Columns of the received rows are returned in 
+// recv_cols.
+static CSRMatrix* tap_communication_helper(TAPComm* tap_comm,
+        const aligned_vector<int>& rowptr, const aligned_vector<index_t>& col_indices,
+        const aligned_vector<double>* values, aligned_vector<index_t>& recv_cols,
+        int b_size = 1)
+{
+    int start, end, row, ptr;
+    ParComm* L_comm = tap_comm->local_L_par_comm;
+    ParComm* S_comm = tap_comm->local_S_par_comm;
+    ParComm* G_comm = tap_comm->global_par_comm;
+    ParComm* R_comm = tap_comm->local_R_par_comm;
+    aligned_vector<index_t> L_cols, S_cols, G_cols, R_cols;
+
+    CSRMatrix* L_mat = communication_helper(rowptr, col_indices, values, L_cols,
+            L_comm->send_data, L_comm->recv_data, L_comm->key, L_comm->mpi_comm,
+            b_size);
+    L_comm->key++;
 
     CSRMatrix* G_mat;
-    if (local_S_par_comm)
-    {
-        CSRMatrix* S_mat = local_S_par_comm->communicate(rowptr, col_indices);
-        G_mat = global_par_comm->communicate(S_mat->idx1, S_mat->idx2);
+    if (S_comm)
+    {
+        CSRMatrix* S_mat = communication_helper(rowptr, col_indices, values, S_cols,
+                S_comm->send_data, S_comm->recv_data, S_comm->key, S_comm->mpi_comm,
+                b_size);
+        S_comm->key++;
+        G_mat = communication_helper(S_mat->idx1, S_cols, values ? &(S_mat->vals) : NULL,
+                G_cols, G_comm->send_data, G_comm->recv_data, G_comm->key,
+                G_comm->mpi_comm, b_size);
         delete S_mat;
     }
     else
     {
-        G_mat = global_par_comm->communicate(rowptr, col_indices);
+        G_mat = communication_helper(rowptr, col_indices, values, G_cols,
+                G_comm->send_data, G_comm->recv_data, G_comm->key, G_comm->mpi_comm,
+                b_size);
     }
+    G_comm->key++;
 
-    CSRMatrix* R_mat = local_R_par_comm->communicate(G_mat->idx1, G_mat->idx2);
+    CSRMatrix* R_mat = communication_helper(G_mat->idx1, G_cols,
+            values ? &(G_mat->vals) : NULL, R_cols, R_comm->send_data,
+            R_comm->recv_data, R_comm->key, R_comm->mpi_comm, b_size);
+    R_comm->key++;
     delete G_mat;
 
-
     // Create recv_mat (combination of L_mat and R_mat)
     CSRMatrix* recv_mat = new CSRMatrix(L_mat->n_rows + R_mat->n_rows, -1);
-    aligned_vector<int>& row_sizes = get_recv_buffer<int>();
+    aligned_vector<int> row_sizes(recv_mat->n_rows, 0);
     recv_mat->nnz = L_mat->nnz + R_mat->nnz;
-    int ptr;
-    if (recv_mat->nnz)
+    recv_cols.resize(recv_mat->nnz);
+    if (values && recv_mat->nnz)
     {
-        recv_mat->idx2.resize(recv_mat->nnz);
+        recv_mat->vals.resize(recv_mat->nnz * b_size);
     }
 
     for (int i = 0; i < R_mat->n_rows; i++)
     {
-        start = R_mat->idx1[i];
-        end = R_mat->idx1[i+1];
-        row = local_R_par_comm->recv_data->indices[i];
-        row_sizes[row] = end - start;
+        row = R_comm->recv_data->indices[i];
+        row_sizes[row] = R_mat->idx1[i+1] - R_mat->idx1[i];
     }
     for (int i = 0; i < L_mat->n_rows; i++)
     {
-        start = L_mat->idx1[i];
-        end = L_mat->idx1[i+1];
-        row = local_L_par_comm->recv_data->indices[i];
-        row_sizes[row] = end - start;
+        row = L_comm->recv_data->indices[i];
+        row_sizes[row] = L_mat->idx1[i+1] - L_mat->idx1[i];
     }
     recv_mat->idx1[0] = 0;
     for (int i = 0; i < recv_mat->n_rows; i++)
     {
         recv_mat->idx1[i+1] = recv_mat->idx1[i] + row_sizes[i];
-        row_sizes[i] = 0;
     }
     for (int i = 0; i < R_mat->n_rows; i++)
     {
         start = R_mat->idx1[i];
         end = R_mat->idx1[i+1];
-        row = local_R_par_comm->recv_data->indices[i];
+        ptr = recv_mat->idx1[R_comm->recv_data->indices[i]];
         for (int j = start; j < end; j++)
         {
-            ptr = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[ptr] = R_mat->idx2[j];
+            recv_cols[ptr] = R_cols[j];
+            if (values)
+            {
+                std::copy(R_mat->vals.begin() + j * b_size, 
+                        R_mat->vals.begin() + (j+1) * b_size,
+                        recv_mat->vals.begin() + ptr * b_size);
+            }
+            ptr++;
         }
     }
     for (int i = 0; i < L_mat->n_rows; i++)
     {
         start = L_mat->idx1[i];
         end = L_mat->idx1[i+1];
-        row = local_L_par_comm->recv_data->indices[i];
+        ptr = recv_mat->idx1[L_comm->recv_data->indices[i]];
         for (int j = start; j < end; j++)
         {
-            ptr = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[ptr] = L_mat->idx2[j];
+            recv_cols[ptr] = L_cols[j];
+            if (values)
+            {
+                std::copy(L_mat->vals.begin() + j * b_size, 
+                        L_mat->vals.begin() + (j+1) * b_size,
+                        recv_mat->vals.begin() + ptr * b_size);
+            }
+            ptr++;
         }
     }
 
@@ -968,64 +876,71 @@ CSRMatrix* TAPComm::communicate(const aligned_vector<int>& rowptr,
     return recv_mat;
 }
 
-CSRMatrix* TAPComm::communicate_T(const aligned_vector<int>& rowptr, 
-        const aligned_vector<int>& col_indices, const int n_result_rows)
-{   
-    int n_rows = rowptr.size() - 1;
-    int idx, ptr;
-    int start, end, row;
-    int ctr, size;
-    int row_start, row_end, row_size;
-
-    CSRMatrix* L_mat = communication_helper(rowptr, col_indices, 
-            local_L_par_comm->recv_data, 
-            local_L_par_comm->send_data, local_L_par_comm->key,
-            local_L_par_comm->mpi_comm);
-
-    CSRMatrix* R_mat = communication_helper(rowptr, col_indices, 
-            local_R_par_comm->recv_data, 
-            local_R_par_comm->send_data, local_R_par_comm->key,
-            local_R_par_comm->mpi_comm);
-
-    CSRMatrix* G_mat = communication_helper(R_mat->idx1, R_mat->idx2,
-            global_par_comm->recv_data, global_par_comm->send_data,
-            global_par_comm->key, global_par_comm->mpi_comm);
+// Sends rows in the reverse direction of tap_communication_helper, and
+// gathers the received rows into the n_result_rows local rows
+static CSRMatrix* tap_communication_helper_T(TAPComm* tap_comm,
+        const aligned_vector<int>& rowptr, const aligned_vector<index_t>& col_indices,
+        const aligned_vector<double>* values, const int n_result_rows,
+        aligned_vector<index_t>& recv_cols, int b_size = 1)
+{
+    int row, ptr;
+    ParComm* L_comm = tap_comm->local_L_par_comm;
+    ParComm* S_comm = tap_comm->local_S_par_comm;
+    ParComm* G_comm = tap_comm->global_par_comm;
+    ParComm* R_comm = tap_comm->local_R_par_comm;
+    aligned_vector<index_t> L_cols, R_cols, G_cols, final_cols;
+
+    CSRMatrix* L_mat = communication_helper(rowptr, col_indices, values, L_cols,
+            L_comm->recv_data, L_comm->send_data, L_comm->key, L_comm->mpi_comm,
+            b_size);
+    L_comm->key++;
+
+    CSRMatrix* R_mat = communication_helper(rowptr, col_indices, values, R_cols,
+            R_comm->recv_data, R_comm->send_data, R_comm->key, R_comm->mpi_comm,
+            b_size);
+    R_comm->key++;
+
+    CSRMatrix* G_mat = communication_helper(R_mat->idx1, R_cols,
+            values ? &(R_mat->vals) : NULL, G_cols, G_comm->recv_data,
+            G_comm->send_data, G_comm->key, G_comm->mpi_comm, b_size);
+    G_comm->key++;
     delete R_mat;
 
     CSRMatrix* final_mat;
     ParComm* final_comm;
-    if (local_S_par_comm)
+    if (S_comm)
     {
-        final_mat = communication_helper(G_mat->idx1, G_mat->idx2,
-                local_S_par_comm->recv_data, local_S_par_comm->send_data, 
-                local_S_par_comm->key, local_S_par_comm->mpi_comm);
+        final_mat = communication_helper(G_mat->idx1, G_cols,
+                values ? &(G_mat->vals) : NULL, final_cols, S_comm->recv_data,
+                S_comm->send_data, S_comm->key, S_comm->mpi_comm, b_size);
+        S_comm->key++;
         delete G_mat;
-        final_comm = local_S_par_comm;
+        final_comm = S_comm;
     }
     else
     {
         final_mat = G_mat;
-        final_comm = global_par_comm;
+        final_cols.swap(G_cols);
+        final_comm = G_comm;
     }
 
     CSRMatrix* recv_mat = new CSRMatrix(n_result_rows, -1);
     aligned_vector<int> row_sizes(n_result_rows, 0);
-    int nnz = L_mat->nnz + final_mat->nnz;
-    if (nnz)
+    recv_mat->nnz = L_mat->nnz + final_mat->nnz;
+    recv_cols.resize(recv_mat->nnz);
+    if (values && recv_mat->nnz)
     {
-        recv_mat->idx2.reserve(nnz);
+        recv_mat->vals.resize(recv_mat->nnz * b_size);
     }
     for (int i = 0; i < final_comm->send_data->size_msgs; i++)
     {
         row = final_comm->send_data->indices[i];
-        row_size = final_mat->idx1[i+1] - final_mat->idx1[i];
-        row_sizes[row] += row_size;
+        row_sizes[row] += final_mat->idx1[i+1] - final_mat->idx1[i];
     }
-    for (int i = 0; i < local_L_par_comm->send_data->size_msgs; i++)
+    for (int i = 0; i < L_comm->send_data->size_msgs; i++)
     {
-        row = local_L_par_comm->send_data->indices[i];
-        row_size = L_mat->idx1[i+1] - L_mat->idx1[i];
-        row_sizes[row] += row_size;
+        row = L_comm->send_data->indices[i];
+        row_sizes[row] += L_mat->idx1[i+1] - L_mat->idx1[i];
     }
     recv_mat->idx1[0] = 0;
     for (int i = 0; i < n_result_rows; i++)
@@ -1036,32 +951,81 @@ CSRMatrix* TAPComm::communicate_T(const aligned_vector<int>& rowptr,
     for (int i = 0; i < final_comm->send_data->size_msgs; i++)
     {
         row = final_comm->send_data->indices[i];
-        row_start = final_mat->idx1[i];
-        row_end = final_mat->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
+        for (int j = final_mat->idx1[i]; j < final_mat->idx1[i+1]; j++)
         {
-            idx = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[idx] = final_mat->idx2[j];
+            ptr = recv_mat->idx1[row] + row_sizes[row]++;
+            recv_cols[ptr] = final_cols[j];
+            if (values)
+            {
+                std::copy(final_mat->vals.begin() + j * b_size, 
+                        final_mat->vals.begin() + (j+1) * b_size,
+                        recv_mat->vals.begin() + ptr * b_size);
+            }
         }
     }
-    for (int i = 0; i < local_L_par_comm->send_data->size_msgs; i++)
+    for (int i = 0; i < L_comm->send_data->size_msgs; i++)
     {
-        row = local_L_par_comm->send_data->indices[i];
-        row_start = L_mat->idx1[i];
-        row_end = L_mat->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
+        row = L_comm->send_data->indices[i];
+        for (int j = L_mat->idx1[i]; j < L_mat->idx1[i+1]; j++)
         {
-            idx = recv_mat->idx1[row] + row_sizes[row]++;
-            recv_mat->idx2[idx] = L_mat->idx2[j];
+            ptr = recv_mat->idx1[row] + row_sizes[row]++;
+            recv_cols[ptr] = L_cols[j];
+            if (values)
+            {
+                std::copy(L_mat->vals.begin() + j * b_size, 
+                        L_mat->vals.begin() + (j+1) * b_size,
+                        recv_mat->vals.begin() + ptr * b_size);
+            }
         }
     }
-    recv_mat->nnz = recv_mat->idx2.size();
-    recv_mat->sort();
 
     delete L_mat;
     delete final_mat;
 
-
     return recv_mat;
-    
+}
+
+CSRMatrix* TAPComm::communicate(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        aligned_vector<index_t>& recv_cols)
+{
+    return tap_communication_helper(this, rowptr, col_indices, &values, recv_cols);
+}
+
+CSRMatrix* TAPComm::communicate_T(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        const int n_result_rows, aligned_vector<index_t>& recv_cols)
+{
+    return tap_communication_helper_T(this, rowptr, col_indices, &values,
+            n_result_rows, recv_cols);
+}
+
+CSRMatrix* TAPComm::communicate(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, aligned_vector<index_t>& recv_cols)
+{
+    return tap_communication_helper(this, rowptr, col_indices, NULL, recv_cols);
+}
+
+CSRMatrix* TAPComm::communicate_T(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const int n_result_rows,
+        aligned_vector<index_t>& recv_cols)
+{
+    return tap_communication_helper_T(this, rowptr, col_indices, NULL,
+            n_result_rows, recv_cols);
+}
+
+CSRMatrix* TAPComm::communicate_blocks(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        const int b_size, aligned_vector<index_t>& recv_cols)
+{
+    return tap_communication_helper(this, rowptr, col_indices, &values, recv_cols, 
+            b_size);
+}
+
+CSRMatrix* TAPComm::communicate_T_blocks(const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+        const int b_size, const int n_result_rows, aligned_vector<index_t>& recv_cols)
+{
+    return tap_communication_helper_T(this, rowptr, col_indices, &values,
+            n_result_rows, recv_cols, b_size);
 }
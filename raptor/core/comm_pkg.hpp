@@ -8,6 +8,7 @@
 #include "matrix.hpp"
 #include "partition.hpp"
 #include "par_vector.hpp"
+#include "par_multivector.hpp"
 
 #define STANDARD_PPN 4
 #define STANDARD_PROC_LAYOUT 1
@@ -30,6 +31,7 @@
 namespace raptor
 {
     class ParCSRMatrix;
+    class ParBSRMatrix;
 
     class CommPkg
     {
@@ -64,41 +66,79 @@ namespace raptor
         virtual void update(const aligned_vector<int>& off_proc_col_exists,
                 data_t* comm_t = NULL) = 0;
 
-        static MPI_Datatype get_type(aligned_vector<int> buffer)
+        // Select how halo exchanges are performed (see comm_mode_t).
+        // Collective over the communicator(s) of the package.
+        virtual void set_comm_mode(comm_mode_t mode) = 0;
+
+        static MPI_Datatype get_type(const aligned_vector<int>& buffer)
         {
             return MPI_INT;
         }
-        static MPI_Datatype get_type(aligned_vector<double> buffer)
+        static MPI_Datatype get_type(const aligned_vector<double>& buffer)
         {
             return MPI_DOUBLE;
         }
 
 
         // Matrix Communication
+        // Rows are sent with global column indices (index_t).  The 
+        // returned matrix holds the row pointer and values of the 
+        // received rows, and their columns are returned in recv_cols.
         virtual CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double>& values) = 0;
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+                aligned_vector<index_t>& recv_cols) = 0;
         virtual CSRMatrix* communicate_T(const aligned_vector<int>& rowptr,
-                const aligned_vector<int>& col_indices, const aligned_vector<double>& values, 
-                const int n_result_rows) = 0;
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values, 
+                const int n_result_rows, aligned_vector<index_t>& recv_cols) = 0;
         virtual CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices) = 0;
+                const aligned_vector<index_t>& col_indices, 
+                aligned_vector<index_t>& recv_cols) = 0;
         virtual CSRMatrix* communicate_T(const aligned_vector<int>& rowptr,
-                const aligned_vector<int>& col_indices, const int n_result_rows) = 0;
+                const aligned_vector<index_t>& col_indices, const int n_result_rows,
+                aligned_vector<index_t>& recv_cols) = 0;
+
+        // Block rows are sent as rows, with one global block column 
+        // (index_t) and b_size values for each block.  The returned 
+        // matrix holds b_size values per entry.
+        virtual CSRMatrix* communicate_blocks(const aligned_vector<int>& rowptr, 
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+                const int b_size, aligned_vector<index_t>& recv_cols) = 0;
+        virtual CSRMatrix* communicate_T_blocks(const aligned_vector<int>& rowptr,
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values, 
+                const int b_size, const int n_result_rows, 
+                aligned_vector<index_t>& recv_cols) = 0;
+
+        CSRMatrix* communicate(ParCSRMatrix* A, aligned_vector<index_t>& recv_cols);
+        // Block rows of a BSR matrix are sent with global block columns
+        // (through a package over block rows, such as 
+        // ParBSRMatrix::get_block_comm)
+        CSRMatrix* communicate(ParBSRMatrix* A, aligned_vector<index_t>& recv_cols);
+
+        // Vector Communication
+        aligned_vector<double>& communicate(ParVector& v);
+        void init_comm(ParVector& v);
 
-        CSRMatrix* communicate(ParCSRMatrix* A);
-        CSRMatrix* communicate(CSRMatrix* A)
+        // Multiple Vector Communication : values hold vec_size 
+        // interleaved values per row (see ParMultiVector), and all
+        // values of a row travel in the same message
+        aligned_vector<double>& communicate(ParMultiVector& v);
+        void init_comm(ParMultiVector& v);
+        aligned_vector<double>& communicate_vecs(const double* values, int vec_size)
         {
-            return communicate(A->idx1, A->idx2, A->vals);
+            init_comm_vecs(values, vec_size);
+            return complete_comm_vecs(vec_size);
         }
-        CSRMatrix* communicate_T(CSRMatrix* A)
+        void communicate_vecs_T(const double* values, aligned_vector<double>& result,
+                int vec_size)
         {
-            return communicate_T(A->idx1, A->idx2, A->vals,
-                    A->n_rows);
+            init_comm_vecs_T(values, vec_size);
+            complete_comm_vecs_T(result, vec_size);
         }
-
-        // Vector Communication
-        aligned_vector<double>& communicate(ParVector& v);
-        void init_comm(ParVector& v);
+        virtual void init_comm_vecs(const double* values, int vec_size) = 0;
+        virtual aligned_vector<double>& complete_comm_vecs(int vec_size) = 0;
+        virtual void init_comm_vecs_T(const double* values, int vec_size) = 0;
+        virtual void complete_comm_vecs_T(aligned_vector<double>& result, 
+                int vec_size) = 0;
 
         // Standard Communication
         template<typename T>
@@ -256,6 +296,7 @@ namespace raptor
         ParComm(Partition* partition, int _key = 0, 
                 MPI_Comm _comm = MPI_COMM_WORLD) : CommPkg(partition)
         {
+            init_comm_mode();
             mpi_comm = _comm;
             key = _key;
             send_data = new CommData();
@@ -264,6 +305,7 @@ namespace raptor
         ParComm(Topology* topology, int _key = 0, 
                 MPI_Comm _comm = MPI_COMM_WORLD) : CommPkg(topology)
         {
+            init_comm_mode();
             mpi_comm = _comm;
             key = _key;
             send_data = new CommData();
@@ -277,28 +319,30 @@ namespace raptor
         *****
         ***** Parameters
         ***** -------------
-        ***** off_proc_column_map : aligned_vector<int>&
+        ***** off_proc_column_map : aligned_vector<index_t>&
         *****    Maps local off_proc columns indices to global
         ***** _key : int (optional)
         *****    Tag to be used in MPI Communication (default 9999)
         **************************************************************/
         ParComm(Partition* partition,
-                const aligned_vector<int>& off_proc_column_map,
+                const aligned_vector<index_t>& off_proc_column_map,
                 int _key = 9999,
                 MPI_Comm comm = MPI_COMM_WORLD,
                 data_t* comm_t = NULL) : CommPkg(partition)
         {
+            init_comm_mode();
             mpi_comm = comm;
             init_par_comm(partition, off_proc_column_map, _key, comm, comm_t);
         }
 
         ParComm(Partition* partition,
-                const aligned_vector<int>& off_proc_column_map,
-                const aligned_vector<int>& on_proc_column_map,
+                const aligned_vector<index_t>& off_proc_column_map,
+                const aligned_vector<index_t>& on_proc_column_map,
                 int _key = 9999, 
                 MPI_Comm comm = MPI_COMM_WORLD,
                 data_t* comm_t = NULL) : CommPkg(partition)
         {
+            init_comm_mode();
             mpi_comm = comm;
             int idx;
             int ctr = 0;
@@ -310,7 +354,7 @@ namespace raptor
             {
                 part_col_to_new.resize(partition->local_num_cols, -1);
             }
-            for (aligned_vector<int>::const_iterator it = on_proc_column_map.begin();
+            for (aligned_vector<index_t>::const_iterator it = on_proc_column_map.begin();
                     it != on_proc_column_map.end(); ++it)
             {
                 part_col_to_new[*it - partition->first_local_col] = ctr++;
@@ -326,14 +370,9 @@ namespace raptor
         }
 
         void init_par_comm(Partition* partition,
-                const aligned_vector<int>& off_proc_column_map,
+                const aligned_vector<index_t>& off_proc_column_map,
                 int _key, MPI_Comm comm, data_t* comm_t = NULL)
         {
-            // Get MPI Information
-            int rank, num_procs;
-            MPI_Comm_rank(comm, &rank);
-            MPI_Comm_size(comm, &num_procs);
-
             // Initialize class variables
             key = _key;
             send_data = new CommData();
@@ -342,16 +381,20 @@ namespace raptor
             // Declare communication variables
             int send_start, send_end;
             int proc, prev_proc;
-            int count;
             int tag = 12345;  // TODO -- switch this to key?
             int off_proc_num_cols = off_proc_column_map.size();
             MPI_Status recv_status;
 
             aligned_vector<int> off_proc_col_to_proc(off_proc_num_cols);
-            aligned_vector<int> tmp_send_buffer;
+            aligned_vector<index_t> tmp_send_buffer;
 
             partition->form_col_to_proc(off_proc_column_map, off_proc_col_to_proc);
 
+            // Processes outside comm (those without rows on an agglomerated
+            // level) hold no columns, and only take part in the partition's
+            // lookup of column owners
+            if (comm == MPI_COMM_NULL) return;
+
             // Determine processes columns are received from,
             // and adds corresponding messages to recv data.
             // Assumes columns are partitioned across processes
@@ -392,8 +435,8 @@ namespace raptor
                 {
                     tmp_send_buffer[j] = off_proc_column_map[j];
                 }
-                MPI_Issend(&(tmp_send_buffer[send_start]), send_end - send_start, MPI_INT, 
-                        proc, tag, comm, &(recv_data->requests[i]));
+                MPI_Issend(&(tmp_send_buffer[send_start]), send_end - send_start, 
+                        MPI_INDEX_T, proc, tag, comm, &(recv_data->requests[i]));
             }
 
             // Determine which processes to which I send messages,
@@ -410,15 +453,7 @@ namespace raptor
                     MPI_Iprobe(MPI_ANY_SOURCE, tag, comm, &msg_avail, &recv_status);
                     if (msg_avail)
                     {
-                        MPI_Get_count(&recv_status, MPI_INT, &count);
-                        proc = recv_status.MPI_SOURCE;
-                        int recvbuf[count];
-                        MPI_Recv(recvbuf, count, MPI_INT, proc, tag, comm, &recv_status);
-                        for (int i = 0; i < count; i++)
-                        {
-                            recvbuf[i] -= partition->first_local_col;
-                        }
-                        send_data->add_msg(proc, count, recvbuf);
+                        recv_col_msg(partition, recv_status, comm, tag);
                     }
                     MPI_Testall(recv_data->num_msgs, recv_data->requests.data(), &finished,
                             MPI_STATUSES_IGNORE);
@@ -431,15 +466,7 @@ namespace raptor
                 MPI_Iprobe(MPI_ANY_SOURCE, tag, comm, &msg_avail, &recv_status);
                 if (msg_avail)
                 {
-                    MPI_Get_count(&recv_status, MPI_INT, &count);
-                    proc = recv_status.MPI_SOURCE;
-                    int recvbuf[count];
-                    MPI_Recv(recvbuf, count, MPI_INT, proc, tag, comm, &recv_status);
-                    for (int i = 0; i < count; i++)
-                    {
-                        recvbuf[i] -= partition->first_local_col;
-                    }
-                    send_data->add_msg(proc, count, recvbuf);
+                    recv_col_msg(partition, recv_status, comm, tag);
                 }
                 MPI_Test(&barrier_request, &finished, MPI_STATUS_IGNORE);
             }
@@ -452,8 +479,28 @@ namespace raptor
             }
         }
 
+        // Receives the global columns a process needs from this 
+        // process, adding a send message of their local indices
+        void recv_col_msg(Partition* partition, MPI_Status& recv_status,
+                MPI_Comm comm, int tag)
+        {
+            int count;
+            int proc = recv_status.MPI_SOURCE;
+            MPI_Get_count(&recv_status, MPI_INDEX_T, &count);
+            aligned_vector<index_t> recvbuf(count);
+            aligned_vector<int> local_cols(count);
+            MPI_Recv(recvbuf.data(), count, MPI_INDEX_T, proc, tag, comm, 
+                    &recv_status);
+            for (int i = 0; i < count; i++)
+            {
+                local_cols[i] = recvbuf[i] - partition->first_local_col;
+            }
+            send_data->add_msg(proc, count, local_cols.data());
+        }
+
         ParComm(ParComm* comm) : CommPkg(comm->topology)
         {
+            init_comm_mode();
             mpi_comm = comm->mpi_comm;
             send_data = new CommData(comm->send_data);
             recv_data = new CommData(comm->recv_data);
@@ -464,6 +511,7 @@ namespace raptor
                 data_t* comm_t = NULL)
             : CommPkg(comm->topology)
         {
+            init_comm_mode();
             mpi_comm = comm->mpi_comm;
             bool comm_proc;
             int proc, start, end;
@@ -486,6 +534,7 @@ namespace raptor
                 const aligned_vector<int>& off_proc_col_to_new, data_t* comm_t = NULL) 
             : CommPkg(comm->topology)
         {
+            init_comm_mode();
             mpi_comm = comm->mpi_comm;
             bool comm_proc;
             int proc, start, end;
@@ -659,10 +708,49 @@ namespace raptor
         **************************************************************/
         ~ParComm()
         {
+            free_comm_mode();
             delete send_data;
             delete recv_data;
         }
 
+        /**************************************************************
+        *****   ParComm Set Communication Mode
+        **************************************************************
+        ***** Selects how initialize / complete exchange values.  The
+        ***** pattern of a ParComm is fixed once formed, so the per-
+        ***** message setup can be done once here rather than on every
+        ***** exchange.  Transpose communication is not affected.
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** mode : comm_mode_t
+        *****    StandardComm : MPI_Isend / MPI_Irecv on every exchange
+        *****    PersistentComm : MPI_Send_init / MPI_Recv_init once, 
+        *****        restarted with MPI_Startall on every exchange
+        *****    NeighborComm : MPI_Ineighbor_alltoallv on a distributed
+        *****        graph communicator formed from send and recv procs.
+        *****        Every process in mpi_comm must then take part in
+        *****        each exchange.
+        *****    SharedComm : values are packed into an MPI-3 shared
+        *****        memory window and read directly by the recv procs
+        *****        after a barrier on mpi_comm (so every process must
+        *****        take part in each exchange).  Only formed if all
+        *****        processes in mpi_comm share memory, otherwise 
+        *****        StandardComm is kept.
+        **************************************************************/
+        void set_comm_mode(comm_mode_t mode);
+        void free_comm_mode();
+        void init_shared_window();
+        void init_comm_mode()
+        {
+            comm_mode = StandardComm;
+            neighbor_comm = MPI_COMM_NULL;
+            neighbor_request = MPI_REQUEST_NULL;
+            shared_win = MPI_WIN_NULL;
+            shared_base = NULL;
+            shared_parity = 0;
+        }
+
         void update(const aligned_vector<int>& off_proc_col_exists, 
                 data_t* comm_t = NULL)
         {
@@ -670,6 +758,11 @@ namespace raptor
             int start, end;
             int idx;
 
+            // Persistent requests and graph are bound to the current 
+            // messages, so are formed again once the update is complete
+            comm_mode_t mode = comm_mode;
+            free_comm_mode();
+
             if (comm_t) *comm_t -= MPI_Wtime();
             communicate_T(off_proc_col_exists);
             if (comm_t) *comm_t += MPI_Wtime();
@@ -756,6 +849,11 @@ namespace raptor
                 send_data->buffer.resize(send_data->size_msgs);
                 send_data->int_buffer.resize(send_data->size_msgs);
             }
+
+            if (mode != StandardComm)
+            {
+                set_comm_mode(mode);
+            }
         }
 
         // Standard Communication
@@ -789,6 +887,12 @@ namespace raptor
         template<typename T>
         void initialize(const T* values)
         {
+            if (comm_mode != StandardComm)
+            {
+                initialize_fixed(values);
+                return;
+            }
+
             int start, end;
             int proc;
 
@@ -821,6 +925,11 @@ namespace raptor
         template<typename T>
         aligned_vector<T>& complete()
         {
+            if (comm_mode != StandardComm)
+            {
+                return complete_fixed<T>();
+            }
+
             if (send_data->num_msgs)
             {
                 MPI_Waitall(send_data->num_msgs, send_data->requests.data(), MPI_STATUS_IGNORE);
@@ -836,6 +945,256 @@ namespace raptor
             return get_recv_buffer<T>();
         }
 
+        // Exchange over the persistent requests, neighbor graph, or 
+        // shared window formed in set_comm_mode
+        template<typename T>
+        void initialize_fixed(const T* values)
+        {
+            aligned_vector<T>& sendbuf = send_data->get_buffer<T>();
+            aligned_vector<T>& recvbuf = recv_data->get_buffer<T>();
+
+            if (comm_mode == SharedComm)
+            {
+                // Pack directly into the half of the window not read 
+                // during the previous exchange
+                T* shared_send = (T*) (shared_base + shared_parity * 
+                        send_data->size_msgs * sizeof(double));
+                for (int i = 0; i < send_data->size_msgs; i++)
+                {
+                    shared_send[i] = values[send_data->indices[i]];
+                }
+                MPI_Win_sync(shared_win);
+                return;
+            }
+
+            for (int i = 0; i < send_data->size_msgs; i++)
+            {
+                sendbuf[i] = values[send_data->indices[i]];
+            }
+
+            if (comm_mode == PersistentComm)
+            {
+                if (recv_data->num_msgs)
+                {
+                    MPI_Startall(recv_data->num_msgs, 
+                            recv_data->get_persistent_requests<T>().data());
+                }
+                if (send_data->num_msgs)
+                {
+                    MPI_Startall(send_data->num_msgs, 
+                            send_data->get_persistent_requests<T>().data());
+                }
+            }
+            else
+            {
+                MPI_Datatype type = get_type(sendbuf);
+                MPI_Ineighbor_alltoallv(sendbuf.data(), send_data->counts.data(),
+                        send_data->indptr.data(), type, recvbuf.data(),
+                        recv_data->counts.data(), recv_data->indptr.data(), type,
+                        neighbor_comm, &neighbor_request);
+            }
+        }
+
+        template<typename T>
+        aligned_vector<T>& complete_fixed()
+        {
+            if (comm_mode == SharedComm)
+            {
+                aligned_vector<T>& recvbuf = recv_data->get_buffer<T>();
+
+                // Values of all procs are packed once every process has
+                // reached the barrier
+                MPI_Barrier(mpi_comm);
+                MPI_Win_sync(shared_win);
+
+                int start, end;
+                const T* shared_recv;
+                for (int i = 0; i < recv_data->num_msgs; i++)
+                {
+                    start = recv_data->indptr[i];
+                    end = recv_data->indptr[i+1];
+                    shared_recv = (const T*) (shared_recv_base[i] + 
+                            shared_parity * shared_recv_half[i]) + shared_recv_offset[i];
+                    for (int j = start; j < end; j++)
+                    {
+                        recvbuf[j] = shared_recv[j - start];
+                    }
+                }
+                shared_parity = 1 - shared_parity;
+
+                return recvbuf;
+            }
+
+            if (comm_mode == PersistentComm)
+            {
+                if (send_data->num_msgs)
+                {
+                    MPI_Waitall(send_data->num_msgs, 
+                            send_data->get_persistent_requests<T>().data(),
+                            MPI_STATUSES_IGNORE);
+                }
+                if (recv_data->num_msgs)
+                {
+                    MPI_Waitall(recv_data->num_msgs, 
+                            recv_data->get_persistent_requests<T>().data(),
+                            MPI_STATUSES_IGNORE);
+                }
+            }
+            else
+            {
+                MPI_Wait(&neighbor_request, MPI_STATUS_IGNORE);
+            }
+
+            return get_recv_buffer<T>();
+        }
+
+        // Multiple Vector Communication
+        void init_comm_vecs(const double* values, int vec_size)
+        {
+            int start, end;
+            int proc, idx;
+
+            aligned_vector<double>& sendbuf = send_data->vec_buffer;
+            aligned_vector<double>& recvbuf = recv_data->vec_buffer;
+            sendbuf.resize(send_data->size_msgs * vec_size);
+            recvbuf.resize(recv_data->size_msgs * vec_size);
+
+            for (int i = 0; i < send_data->num_msgs; i++)
+            {
+                proc = send_data->procs[i];
+                start = send_data->indptr[i];
+                end = send_data->indptr[i+1];
+                for (int j = start; j < end; j++)
+                {
+                    idx = send_data->indices[j] * vec_size;
+                    for (int v = 0; v < vec_size; v++)
+                    {
+                        sendbuf[j*vec_size + v] = values[idx + v];
+                    }
+                }
+                MPI_Isend(&(sendbuf[start*vec_size]), (end - start)*vec_size, 
+                        MPI_DOUBLE, proc, key, mpi_comm, &(send_data->requests[i]));
+            }
+            for (int i = 0; i < recv_data->num_msgs; i++)
+            {
+                proc = recv_data->procs[i];
+                start = recv_data->indptr[i];
+                end = recv_data->indptr[i+1];
+                MPI_Irecv(&(recvbuf[start*vec_size]), (end - start)*vec_size,
+                        MPI_DOUBLE, proc, key, mpi_comm, &(recv_data->requests[i]));
+            }
+        }
+
+        aligned_vector<double>& complete_comm_vecs(int vec_size)
+        {
+            if (send_data->num_msgs)
+            {
+                MPI_Waitall(send_data->num_msgs, send_data->requests.data(), MPI_STATUSES_IGNORE);
+            }
+            if (recv_data->num_msgs)
+            {
+                MPI_Waitall(recv_data->num_msgs, recv_data->requests.data(), MPI_STATUSES_IGNORE);
+            }
+            key++;
+
+            return recv_data->vec_buffer;
+        }
+
+        void init_comm_vecs_T(const double* values, int vec_size)
+        {
+            int start, end;
+            int proc, idx, pos;
+
+            aligned_vector<double>& sendbuf = send_data->vec_buffer;
+            aligned_vector<double>& recvbuf = recv_data->vec_buffer;
+            sendbuf.resize(send_data->size_msgs * vec_size);
+            recvbuf.resize(recv_data->size_msgs * vec_size);
+
+            for (int i = 0; i < recv_data->num_msgs; i++)
+            {
+                proc = recv_data->procs[i];
+                start = recv_data->indptr[i];
+                end = recv_data->indptr[i+1];
+                for (int j = start; j < end; j++)
+                {
+                    pos = j * vec_size;
+                    if (recv_data->indptr_T.size())
+                    {
+                        for (int v = 0; v < vec_size; v++)
+                        {
+                            recvbuf[pos + v] = 0.0;
+                        }
+                        for (int k = recv_data->indptr_T[j]; k < recv_data->indptr_T[j+1]; k++)
+                        {
+                            idx = recv_data->indices[k] * vec_size;
+                            for (int v = 0; v < vec_size; v++)
+                            {
+                                recvbuf[pos + v] += values[idx + v];
+                            }
+                        }
+                    }
+                    else
+                    {
+                        if (recv_data->indices.size()) 
+                            idx = recv_data->indices[j] * vec_size;
+                        else 
+                            idx = pos;
+                        for (int v = 0; v < vec_size; v++)
+                        {
+                            recvbuf[pos + v] = values[idx + v];
+                        }
+                    }
+                }
+                MPI_Isend(&(recvbuf[start*vec_size]), (end - start)*vec_size,
+                        MPI_DOUBLE, proc, key, mpi_comm, &(recv_data->requests[i]));
+            }
+            for (int i = 0; i < send_data->num_msgs; i++)
+            {
+                proc = send_data->procs[i];
+                start = send_data->indptr[i];
+                end = send_data->indptr[i+1];
+                MPI_Irecv(&(sendbuf[start*vec_size]), (end - start)*vec_size,
+                        MPI_DOUBLE, proc, key, mpi_comm, &(send_data->requests[i]));
+            }
+        }
+
+        // Completes transpose communication, leaving the received 
+        // values in send_data->vec_buffer
+        void complete_comm_vecs_T(int vec_size)
+        {
+            if (send_data->num_msgs)
+            {
+                MPI_Waitall(send_data->num_msgs, send_data->requests.data(), MPI_STATUSES_IGNORE);
+            }
+            if (recv_data->num_msgs)
+            {
+                MPI_Waitall(recv_data->num_msgs, recv_data->requests.data(), MPI_STATUSES_IGNORE);
+            }
+            key++;
+        }
+
+        void complete_comm_vecs_T(aligned_vector<double>& result, int vec_size)
+        {
+            complete_comm_vecs_T(vec_size);
+
+            int idx;
+            aligned_vector<double>& sendbuf = send_data->vec_buffer;
+            for (int i = 0; i < send_data->size_msgs; i++)
+            {
+                idx = send_data->indices[i] * vec_size;
+                for (int v = 0; v < vec_size; v++)
+                {
+                    result[idx + v] += sendbuf[i*vec_size + v];
+                }
+            }
+        }
+
+        void communicate_vecs_T(const double* values, int vec_size)
+        {
+            init_comm_vecs_T(values, vec_size);
+            complete_comm_vecs_T(vec_size);
+        }
+
         // Transpose Communication
         void init_double_comm_T(const double* values,
                 std::function<double(double, double)> init_result_func = 
@@ -1223,25 +1582,37 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
         // Matrix Communication
         CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double>& values);
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+                aligned_vector<index_t>& recv_cols);
         CSRMatrix* communicate_T(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double>& values, 
-                const int n_result_rows);
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values, 
+                const int n_result_rows, aligned_vector<index_t>& recv_cols);
         CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices);
+                const aligned_vector<index_t>& col_indices, 
+                aligned_vector<index_t>& recv_cols);
         CSRMatrix* communicate_T(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const int n_result_rows);
-        CSRMatrix* communicate(ParCSRMatrix* A)
-        {
-            return CommPkg::communicate(A);
-        }
-        CSRMatrix* communicate(CSRMatrix* A)
+                const aligned_vector<index_t>& col_indices, const int n_result_rows,
+                aligned_vector<index_t>& recv_cols);
+        CSRMatrix* communicate_blocks(const aligned_vector<int>& rowptr, 
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+                const int b_size, aligned_vector<index_t>& recv_cols);
+        CSRMatrix* communicate_T_blocks(const aligned_vector<int>& rowptr, 
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values, 
+                const int b_size, const int n_result_rows, aligned_vector<index_t>& recv_cols);
+
+        // Sends rows as communicate_T does, but returns the rows as 
+        // received (row i for local row send_data->indices[i]), 
+        // without adding them into the rows of the result
+        CSRMatrix* communicate_T_rows(const aligned_vector<int>& rowptr, 
+                const aligned_vector<index_t>& col_indices, 
+                const aligned_vector<double>& values, aligned_vector<index_t>& recv_cols);
+        CSRMatrix* communicate(ParCSRMatrix* A, aligned_vector<index_t>& recv_cols)
         {
-            return CommPkg::communicate(A);
+            return CommPkg::communicate(A, recv_cols);
         }
-        CSRMatrix* communicate_T(CSRMatrix* A)
+        CSRMatrix* communicate(ParBSRMatrix* A, aligned_vector<index_t>& recv_cols)
         {
-            return CommPkg::communicate_T(A);
+            return CommPkg::communicate(A, recv_cols);
         }
 
 
@@ -1254,6 +1625,14 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         {
             CommPkg::init_comm(v);
         }
+        aligned_vector<double>& communicate(ParMultiVector& v)
+        {
+            return CommPkg::communicate(v);
+        }
+        void init_comm(ParMultiVector& v)
+        {
+            CommPkg::init_comm(v);
+        }
 
         // Helper Methods
         aligned_vector<double>& get_double_recv_buffer()
@@ -1278,6 +1657,21 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         CommData* send_data;
         CommData* recv_data;
         MPI_Comm mpi_comm;
+
+        comm_mode_t comm_mode;
+        MPI_Comm neighbor_comm;
+        MPI_Request neighbor_request;
+
+        // Shared window (SharedComm) : two halves of size_msgs doubles,
+        // alternated between exchanges, and for each recv message the
+        // sending proc's window, half size (bytes), and offset of the 
+        // message within a half
+        MPI_Win shared_win;
+        char* shared_base;
+        int shared_parity;
+        aligned_vector<char*> shared_recv_base;
+        aligned_vector<MPI_Aint> shared_recv_half;
+        aligned_vector<int> shared_recv_offset;
     };
 
 
@@ -1334,7 +1728,7 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         *****
         ***** Parameters
         ***** -------------
-        ***** off_proc_column_map : aligned_vector<int>&
+        ***** off_proc_column_map : aligned_vector<index_t>&
         *****    Maps local off_proc columns indices to global
         ***** global_num_cols : int
         *****    Number of global columns in matrix
@@ -1342,7 +1736,7 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         *****    Number of columns local to rank
         **************************************************************/
         TAPComm(Partition* partition, 
-                const aligned_vector<int>& off_proc_column_map,
+                const aligned_vector<index_t>& off_proc_column_map,
                 bool form_S = true,
                 MPI_Comm comm = MPI_COMM_WORLD,
                 data_t* comm_t = NULL) : CommPkg(partition)
@@ -1358,8 +1752,8 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         }
 
         TAPComm(Partition* partition,
-                const aligned_vector<int>& off_proc_column_map,
-                const aligned_vector<int>& on_proc_column_map,
+                const aligned_vector<index_t>& off_proc_column_map,
+                const aligned_vector<index_t>& on_proc_column_map,
                 bool form_S = true,
                 MPI_Comm comm = MPI_COMM_WORLD,
                 data_t* comm_t = NULL) : CommPkg(partition)
@@ -1581,8 +1975,27 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
             delete local_L_par_comm;
         }
 
+        /**************************************************************
+        *****   TAPComm int_column_map
+        **************************************************************
+        ***** Node-aware setup routes global column indices through 
+        ***** the (int) indices of its CommData objects.  Copies the
+        ***** column map to ints, exiting if the global columns do not
+        ***** fit in 32 bits.
+        **************************************************************/
+        static aligned_vector<int> int_column_map(Partition* partition,
+                const aligned_vector<index_t>& column_map)
+        {
+            if (partition->global_num_cols > (index_t) INT_MAX)
+            {
+                printf("TAPComm requires fewer than 2^31 global columns.\n");
+                exit(-1);
+            }
+            return aligned_vector<int>(column_map.begin(), column_map.end());
+        }
+
         void init_tap_comm(Partition* partition,
-                const aligned_vector<int>& off_proc_column_map,
+                const aligned_vector<index_t>& off_proc_column_map,
                 MPI_Comm comm, data_t* comm_t = NULL)
         {
             // Get MPI Information
@@ -1615,7 +2028,7 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
             partition->form_col_to_proc(off_proc_column_map, off_proc_col_to_proc);
 
             // Partition off_proc cols into on_node and off_node
-            split_off_proc_cols(off_proc_column_map, off_proc_col_to_proc,
+            split_off_proc_cols(int_column_map(partition, off_proc_column_map), off_proc_col_to_proc,
                    on_node_column_map, on_node_col_to_proc, on_node_to_off_proc,
                    off_node_column_map, off_node_col_to_node, off_node_to_off_proc);
 
@@ -1673,7 +2086,7 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         }
 
         void init_tap_comm_simple(Partition* partition,
-                const aligned_vector<int>& off_proc_column_map,
+                const aligned_vector<index_t>& off_proc_column_map,
                 MPI_Comm comm, data_t* comm_t = NULL)
         {
             // Get MPI Information
@@ -1703,14 +2116,14 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
             partition->form_col_to_proc(off_proc_column_map, off_proc_col_to_proc);
 
             // Partition off_proc cols into on_node and off_node
-            split_off_proc_cols(off_proc_column_map, off_proc_col_to_proc,
+            split_off_proc_cols(int_column_map(partition, off_proc_column_map), off_proc_col_to_proc,
                    on_node_column_map, on_node_col_to_proc, on_node_to_off_proc,
                    off_node_column_map, off_node_col_to_proc, off_node_to_off_proc);
 
             // Form local recv communicator.  Will recv from local rank
             // corresponding to global rank on which data originates.  E.g. if
             // data is on rank r = (p, n), and my rank is s = (q, m), I will
-            // recv data from (p, m).
+            // recv data from (p % PPN, m).
             form_simple_R_par_comm(off_node_column_map, off_node_col_to_proc, comm_t);
 
             // Form global par comm.. Will recv from proc on which data
@@ -1766,6 +2179,20 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
             // TODO
         }
 
+        // Sets comm_mode_t of each local and global ParComm.  With
+        // SharedComm, only the on-node steps read from shared windows,
+        // and inter-node messages remain standard sends and recvs.
+        void set_comm_mode(comm_mode_t mode)
+        {
+            local_L_par_comm->set_comm_mode(mode);
+            if (local_S_par_comm)
+            {
+                local_S_par_comm->set_comm_mode(mode);
+            }
+            global_par_comm->set_comm_mode(mode == SharedComm ? StandardComm : mode);
+            local_R_par_comm->set_comm_mode(mode);
+        }
+
 
         // Helper methods for forming TAPComm:
         void split_off_proc_cols(const aligned_vector<int>& off_proc_column_map,
@@ -1873,6 +2300,110 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         }
 
 
+        // Multiple Vector Communication
+        void init_comm_vecs(const double* values, int vec_size)
+        {
+            // Messages with origin and final destination on node
+            local_L_par_comm->communicate_vecs(values, vec_size);
+
+            if (local_S_par_comm)
+            {
+                // Initial redistribution among node
+                aligned_vector<double>& S_vals = 
+                    local_S_par_comm->communicate_vecs(values, vec_size);
+
+                // Begin inter-node communication 
+                global_par_comm->init_comm_vecs(S_vals.data(), vec_size);
+            }
+            else
+            {
+                global_par_comm->init_comm_vecs(values, vec_size);
+            }
+        }
+
+        aligned_vector<double>& complete_comm_vecs(int vec_size)
+        {
+            // Complete inter-node communication
+            aligned_vector<double>& G_vals = global_par_comm->complete_comm_vecs(vec_size);
+
+            // Redistributing recvd inter-node values
+            local_R_par_comm->communicate_vecs(G_vals.data(), vec_size);
+
+            vec_recv_buffer.resize(recv_buffer.size() * vec_size);
+            aligned_vector<double>& R_recvbuf = local_R_par_comm->recv_data->vec_buffer;
+            aligned_vector<double>& L_recvbuf = local_L_par_comm->recv_data->vec_buffer;
+
+            int idx;
+            int R_recv_size = local_R_par_comm->recv_data->size_msgs;
+            int L_recv_size = local_L_par_comm->recv_data->size_msgs;
+            for (int i = 0; i < R_recv_size; i++)
+            {
+                idx = local_R_par_comm->recv_data->indices[i] * vec_size;
+                for (int v = 0; v < vec_size; v++)
+                {
+                    vec_recv_buffer[idx + v] = R_recvbuf[i*vec_size + v];
+                }
+            }
+            for (int i = 0; i < L_recv_size; i++)
+            {
+                idx = local_L_par_comm->recv_data->indices[i] * vec_size;
+                for (int v = 0; v < vec_size; v++)
+                {
+                    vec_recv_buffer[idx + v] = L_recvbuf[i*vec_size + v];
+                }
+            }
+
+            return vec_recv_buffer;
+        }
+
+        void init_comm_vecs_T(const double* values, int vec_size)
+        {
+            // Messages with origin and final destination on node
+            local_L_par_comm->communicate_vecs_T(values, vec_size);
+
+            // Initial redistribution among node
+            local_R_par_comm->communicate_vecs_T(values, vec_size);
+
+            // Begin inter-node communication 
+            global_par_comm->init_comm_vecs_T(
+                    local_R_par_comm->send_data->vec_buffer.data(), vec_size);
+        }
+
+        void complete_comm_vecs_T(aligned_vector<double>& result, int vec_size)
+        {
+            // Complete inter-node communication
+            global_par_comm->complete_comm_vecs_T(vec_size);
+
+            ParComm* final_comm = global_par_comm;
+            if (local_S_par_comm)
+            {
+                local_S_par_comm->communicate_vecs_T(
+                        global_par_comm->send_data->vec_buffer.data(), vec_size);
+                final_comm = local_S_par_comm;
+            }
+
+            int idx;
+            aligned_vector<double>& L_sendbuf = local_L_par_comm->send_data->vec_buffer;
+            for (int i = 0; i < local_L_par_comm->send_data->size_msgs; i++)
+            {
+                idx = local_L_par_comm->send_data->indices[i] * vec_size;
+                for (int v = 0; v < vec_size; v++)
+                {
+                    result[idx + v] += L_sendbuf[i*vec_size + v];
+                }
+            }
+
+            aligned_vector<double>& final_sendbuf = final_comm->send_data->vec_buffer;
+            for (int i = 0; i < final_comm->send_data->size_msgs; i++)
+            {
+                idx = final_comm->send_data->indices[i] * vec_size;
+                for (int v = 0; v < vec_size; v++)
+                {
+                    result[idx + v] += final_sendbuf[i*vec_size + v];
+                }
+            }
+        }
+
         // Transpose Communication
         void init_double_comm_T(const double* values,
                 std::function<double(double, double)> init_result_func = 
@@ -2035,25 +2566,30 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
         // Matrix Communication
         CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double>& values);
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+                aligned_vector<index_t>& recv_cols);
         CSRMatrix* communicate_T(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const aligned_vector<double>& values, 
-                const int n_result_rows);
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values, 
+                const int n_result_rows, aligned_vector<index_t>& recv_cols);
         CSRMatrix* communicate(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices);
+                const aligned_vector<index_t>& col_indices, 
+                aligned_vector<index_t>& recv_cols);
         CSRMatrix* communicate_T(const aligned_vector<int>& rowptr, 
-                const aligned_vector<int>& col_indices, const int n_result_rows);
-        CSRMatrix* communicate(ParCSRMatrix* A)
-        {
-            return CommPkg::communicate(A);
-        }
-        CSRMatrix* communicate(CSRMatrix* A)
+                const aligned_vector<index_t>& col_indices, const int n_result_rows,
+                aligned_vector<index_t>& recv_cols);
+        CSRMatrix* communicate_blocks(const aligned_vector<int>& rowptr, 
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values,
+                const int b_size, aligned_vector<index_t>& recv_cols);
+        CSRMatrix* communicate_T_blocks(const aligned_vector<int>& rowptr, 
+                const aligned_vector<index_t>& col_indices, const aligned_vector<double>& values, 
+                const int b_size, const int n_result_rows, aligned_vector<index_t>& recv_cols);
+        CSRMatrix* communicate(ParCSRMatrix* A, aligned_vector<index_t>& recv_cols)
         {
-            return CommPkg::communicate(A);
+            return CommPkg::communicate(A, recv_cols);
         }
-        CSRMatrix* communicate_T(CSRMatrix* A)
+        CSRMatrix* communicate(ParBSRMatrix* A, aligned_vector<index_t>& recv_cols)
         {
-            return CommPkg::communicate_T(A);
+            return CommPkg::communicate(A, recv_cols);
         }
 
         // Vector Communication        
@@ -2066,6 +2602,14 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         {
             CommPkg::init_comm(v);
         }
+        aligned_vector<double>& communicate(ParMultiVector& v)
+        {
+            return CommPkg::communicate(v);
+        }
+        void init_comm(ParMultiVector& v)
+        {
+            CommPkg::init_comm(v);
+        }
 
         // Helper Methods
         aligned_vector<double>& get_double_recv_buffer()
@@ -2084,6 +2628,7 @@ int rank;MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         ParComm* global_par_comm;
         aligned_vector<double> recv_buffer;
         aligned_vector<int> int_recv_buffer;
+        aligned_vector<double> vec_recv_buffer;
     };
 }
 #endif
@@ -138,8 +138,48 @@ Matrix* CSCMatrix::transpose()
 
 Matrix* BSRMatrix::transpose()
 {
-    printf("Currently not implemented.\n");	
-    return NULL;
+    int n_block_rows = n_rows / b_rows;
+    int n_block_cols = n_cols / b_cols;
+
+    BSRMatrix* T = new BSRMatrix(n_cols, n_rows, b_cols, b_rows, 1);
+    T->n_blocks = n_blocks;
+    T->nnz = nnz;
+    T->idx2.resize(n_blocks);
+    T->vals.resize(n_blocks * b_size);
+
+    // Count blocks in each block column
+    std::fill(T->idx1.begin(), T->idx1.end(), 0);
+    for (int i = 0; i < n_blocks; i++)
+    {
+        T->idx1[idx2[i] + 1]++;
+    }
+    for (int i = 0; i < n_block_cols; i++)
+    {
+        T->idx1[i+1] += T->idx1[i];
+    }
+
+    // Copy each block, transposed, to row idx2 of T
+    aligned_vector<int> ctr(n_block_cols, 0);
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            int col = idx2[j];
+            int pos = T->idx1[col] + ctr[col]++;
+            T->idx2[pos] = i;
+            const double* block = &(vals[j * b_size]);
+            double* block_T = &(T->vals[pos * b_size]);
+            for (int r = 0; r < b_rows; r++)
+            {
+                for (int c = 0; c < b_cols; c++)
+                {
+                    block_T[c * b_rows + r] = block[r * b_cols + c];
+                }
+            }
+        }
+    }
+
+    return T;
 }
 
 /**************************************************************
@@ -617,7 +657,40 @@ void CSRMatrix::copy_helper(const CSCMatrix* A)
 }
 void CSRMatrix::copy_helper(const BSRMatrix* A)
 {
-    printf("Currently not implemented\n");
+    n_rows = A->n_rows;
+    n_cols = A->n_cols;
+
+    idx1.resize(n_rows + 1);
+    idx2.clear();
+    vals.clear();
+    idx2.reserve(A->nnz);
+    vals.reserve(A->nnz);
+
+    // Zeros within blocks are not copied
+    idx1[0] = 0;
+    for (int i = 0; i < A->n_rows / A->b_rows; i++)
+    {
+        int row_start = A->idx1[i];
+        int row_end = A->idx1[i+1];
+        for (int r = 0; r < A->b_rows; r++)
+        {
+            for (int j = row_start; j < row_end; j++)
+            {
+                int first_col = A->idx2[j] * A->b_cols;
+                const double* block = &(A->vals[j * A->b_size + r * A->b_cols]);
+                for (int c = 0; c < A->b_cols; c++)
+                {
+                    if (fabs(block[c]) > zero_tol)
+                    {
+                        idx2.push_back(first_col + c);
+                        vals.push_back(block[c]);
+                    }
+                }
+            }
+            idx1[i * A->b_rows + r + 1] = idx2.size();
+        }
+    }
+    nnz = idx2.size();
 }
 
 /**************************************************************
@@ -861,6 +934,299 @@ void CSRMatrix::remove_duplicates()
     vals.resize(nnz);
 }
 
+/**************************************************************
+*****  CSRMatrix Form Thread Rows
+**************************************************************
+***** Splits rows across threads, with each thread holding
+***** (approximately) the same number of nonzeros.  The split is
+***** cached in thread_rows, and only reformed if the number of
+***** rows, nonzeros, or threads has changed.
+*****
+***** Returns
+***** -------------
+***** int : number of threads
+**************************************************************/
+int CSRMatrix::form_thread_rows()
+{
+    int num_threads = get_num_threads();
+    int row_nnz = 0;
+    if ((int) idx1.size() > n_rows) row_nnz = idx1[n_rows];
+
+    if ((int) thread_rows.size() == num_threads + 1 
+            && thread_rows[num_threads] == n_rows
+            && thread_rows_nnz == row_nnz)
+    {
+        return num_threads;
+    }
+
+    thread_rows.resize(num_threads + 1);
+    thread_rows_nnz = row_nnz;
+    thread_rows[0] = 0;
+    int row = 0;
+    for (int t = 1; t < num_threads; t++)
+    {
+        long target = ((long) row_nnz * t) / num_threads;
+        while (row < n_rows && idx1[row] < target)
+        {
+            row++;
+        }
+        thread_rows[t] = row;
+    }
+    thread_rows[num_threads] = n_rows;
+
+    return num_threads;
+}
+
+/**************************************************************
+*****  CSRMatrix Threaded Transpose Multiply
+**************************************************************
+***** Computes b += alpha * A^T x with each thread accumulating
+***** its rows into a private section of thread_buffer, which
+***** are then summed into b.
+**************************************************************/
+template <typename V>
+void CSRMatrix::thread_mult_append_T(const V* v, aligned_vector<double>& x, 
+        aligned_vector<double>& b, double alpha, int num_threads)
+{
+    thread_buffer.resize(num_threads * n_cols);
+
+#pragma omp parallel num_threads(num_threads)
+    {
+#pragma omp for schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
+        {
+            int start, end;
+            double* buffer = &(thread_buffer[t * n_cols]);
+            for (int i = 0; i < n_cols; i++)
+            {
+                buffer[i] = 0.0;
+            }
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+            {
+                start = idx1[i];
+                end = idx1[i+1];
+                for (int j = start; j < end; j++)
+                {
+                    buffer[idx2[j]] += v[j] * x[i];
+                }
+            }
+        }
+
+#pragma omp for schedule(static)
+        for (int i = 0; i < n_cols; i++)
+        {
+            double sum = 0.0;
+            for (int k = 0; k < num_threads; k++)
+            {
+                sum += thread_buffer[k * n_cols + i];
+            }
+            b[i] += alpha * sum;
+        }
+    }
+}
+template void CSRMatrix::thread_mult_append_T<double>(const double* v,
+        aligned_vector<double>& x, aligned_vector<double>& b, double alpha,
+        int num_threads);
+template void CSRMatrix::thread_mult_append_T<float>(const float* v,
+        aligned_vector<double>& x, aligned_vector<double>& b, double alpha,
+        int num_threads);
+
+/**************************************************************
+*****  CSRMatrix Single Precision Storage
+**************************************************************
+***** Moves values between vals (double) and sp_vals (float),
+***** releasing the memory of the other.
+**************************************************************/
+void CSRMatrix::to_single()
+{
+    if (single_precision() || nnz == 0) return;
+
+    sp_vals.resize(nnz);
+    for (int i = 0; i < nnz; i++)
+    {
+        sp_vals[i] = (float) vals[i];
+    }
+    aligned_vector<double>().swap(vals);
+}
+
+void CSRMatrix::to_double()
+{
+    if (!single_precision()) return;
+
+    vals.resize(nnz);
+    for (int i = 0; i < nnz; i++)
+    {
+        vals[i] = sp_vals[i];
+    }
+    aligned_vector<float>().swap(sp_vals);
+}
+
+
+/**************************************************************
+*****  CSRMatrix SpMM
+**************************************************************
+***** Multiplies the matrix by a block of k vectors, stored
+***** row-major (x[col*k + v]), so every nonzero is read once
+***** for the whole block:
+*****    spmm : b = A*x
+*****    spmm_append : b += A*x
+*****    spmm_append_neg : b -= A*x
+*****    spmm_append_T : b += A^T*x
+*****    spmm_residual : r = b - A*x
+**************************************************************/
+void CSRMatrix::spmm(const double* x, double* b, int k)
+{
+    if (single_precision()) spmm_kernel(sp_vals.data(), x, b, k);
+    else spmm_kernel(vals.data(), x, b, k);
+}
+
+template <typename V>
+void CSRMatrix::spmm_kernel(const V* v, const double* x, double* b, int k)
+{
+    int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int t = 0; t < num_threads; t++)
+    {
+        for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+        {
+            double* b_row = &(b[i*k]);
+            for (int v = 0; v < k; v++)
+            {
+                b_row[v] = 0.0;
+            }
+            for (int j = idx1[i]; j < idx1[i+1]; j++)
+            {
+                double val = v[j];
+                const double* x_row = &(x[idx2[j]*k]);
+                for (int v = 0; v < k; v++)
+                {
+                    b_row[v] += val * x_row[v];
+                }
+            }
+        }
+    }
+}
+
+void CSRMatrix::spmm_append(const double* x, double* b, int k)
+{
+    if (single_precision()) spmm_append_kernel(sp_vals.data(), x, b, k);
+    else spmm_append_kernel(vals.data(), x, b, k);
+}
+
+template <typename V>
+void CSRMatrix::spmm_append_kernel(const V* v, const double* x, double* b, int k)
+{
+    int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int t = 0; t < num_threads; t++)
+    {
+        for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+        {
+            double* b_row = &(b[i*k]);
+            for (int j = idx1[i]; j < idx1[i+1]; j++)
+            {
+                double val = v[j];
+                const double* x_row = &(x[idx2[j]*k]);
+                for (int v = 0; v < k; v++)
+                {
+                    b_row[v] += val * x_row[v];
+                }
+            }
+        }
+    }
+}
+
+void CSRMatrix::spmm_append_neg(const double* x, double* b, int k)
+{
+    if (single_precision()) spmm_append_neg_kernel(sp_vals.data(), x, b, k);
+    else spmm_append_neg_kernel(vals.data(), x, b, k);
+}
+
+template <typename V>
+void CSRMatrix::spmm_append_neg_kernel(const V* v, const double* x, double* b, int k)
+{
+    int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int t = 0; t < num_threads; t++)
+    {
+        for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+        {
+            double* b_row = &(b[i*k]);
+            for (int j = idx1[i]; j < idx1[i+1]; j++)
+            {
+                double val = v[j];
+                const double* x_row = &(x[idx2[j]*k]);
+                for (int v = 0; v < k; v++)
+                {
+                    b_row[v] -= val * x_row[v];
+                }
+            }
+        }
+    }
+}
+
+void CSRMatrix::spmm_append_T(const double* x, double* b, int k)
+{
+    if (single_precision()) spmm_append_T_kernel(sp_vals.data(), x, b, k);
+    else spmm_append_T_kernel(vals.data(), x, b, k);
+}
+
+template <typename V>
+void CSRMatrix::spmm_append_T_kernel(const V* v, const double* x, double* b, int k)
+{
+    for (int i = 0; i < n_rows; i++)
+    {
+        const double* x_row = &(x[i*k]);
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            double val = v[j];
+            double* b_row = &(b[idx2[j]*k]);
+            for (int v = 0; v < k; v++)
+            {
+                b_row[v] += val * x_row[v];
+            }
+        }
+    }
+}
+
+void CSRMatrix::spmm_residual(const double* x, const double* b, double* r, int k)
+{
+    if (single_precision()) spmm_residual_kernel(sp_vals.data(), x, b, r, k);
+    else spmm_residual_kernel(vals.data(), x, b, r, k);
+}
+
+template <typename V>
+void CSRMatrix::spmm_residual_kernel(const V* v, const double* x, const double* b,
+        double* r, int k)
+{
+    int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int t = 0; t < num_threads; t++)
+    {
+        for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+        {
+            double* r_row = &(r[i*k]);
+            for (int v = 0; v < k; v++)
+            {
+                r_row[v] = b[i*k + v];
+            }
+            for (int j = idx1[i]; j < idx1[i+1]; j++)
+            {
+                double val = v[j];
+                const double* x_row = &(x[idx2[j]*k]);
+                for (int v = 0; v < k; v++)
+                {
+                    r_row[v] -= val * x_row[v];
+                }
+            }
+        }
+    }
+}
+
 /**************************************************************
 *****  BSRMatrix Copy
 **************************************************************
@@ -903,31 +1269,70 @@ void BSRMatrix::copy_helper(const CSRMatrix* A)
     n_rows = A->n_rows;
     n_cols = A->n_cols;
 
-    aligned_vector<double> A_dense = A->to_dense();
-    double block_dense[n_rows*n_cols];
+    int n_block_rows = n_rows / b_rows;
+    int n_block_cols = n_cols / b_cols;
+    int start, end, col, block_col, first_block;
 
-    int block_ind, glob_i, glob_j;
-    for (int k = 0; k < n_rows/b_rows; k++)
+    // Position of each block column in the current block row
+    aligned_vector<int> block_pos(n_block_cols, -1);
+    aligned_vector<int> row_block_cols;
+
+    idx1.resize(n_block_rows + 1);
+    idx2.clear();
+    vals.clear();
+
+    idx1[0] = 0;
+    for (int i = 0; i < n_block_rows; i++)
     {
-        for (int w = 0; w < n_cols/b_cols; w++)
-	{
-            for (int i = 0; i < b_rows; i++)
-	    {
-                for (int j = 0; j < b_cols; j++)
-		{
-                    block_ind = k*n_cols/b_cols + w;
-		    glob_i = k * b_rows + i;
-		    glob_j = w * b_cols + j;
-		    block_dense[block_ind * b_size + i * b_cols + j] = A_dense[glob_i * n_cols + glob_j];
-		}
-	    }
-	}
-    }
+        // Find block columns of block row i, in sorted order
+        for (int row = i * b_rows; row < (i+1) * b_rows; row++)
+        {
+            start = A->idx1[row];
+            end = A->idx1[row+1];
+            for (int j = start; j < end; j++)
+            {
+                block_col = A->idx2[j] / b_cols;
+                if (block_pos[block_col] == -1)
+                {
+                    block_pos[block_col] = 0;
+                    row_block_cols.push_back(block_col);
+                }
+            }
+        }
+        std::sort(row_block_cols.begin(), row_block_cols.end());
 
-    const BSRMatrix* B = new BSRMatrix(n_rows, n_cols, b_rows, b_cols, block_dense);
-    copy_helper(B);
+        first_block = idx2.size();
+        for (int k = 0; k < (int) row_block_cols.size(); k++)
+        {
+            block_pos[row_block_cols[k]] = first_block + k;
+            idx2.push_back(row_block_cols[k]);
+        }
+        vals.resize(idx2.size() * b_size, 0.0);
 
-    delete B;
+        // Add values to their blocks
+        for (int r = 0; r < b_rows; r++)
+        {
+            start = A->idx1[i * b_rows + r];
+            end = A->idx1[i * b_rows + r + 1];
+            for (int j = start; j < end; j++)
+            {
+                col = A->idx2[j];
+                vals[block_pos[col / b_cols] * b_size + r * b_cols + (col % b_cols)] 
+                    += A->vals[j];
+            }
+        }
+
+        for (aligned_vector<int>::iterator it = row_block_cols.begin();
+                it != row_block_cols.end(); ++it)
+        {
+            block_pos[*it] = -1;
+        }
+        row_block_cols.clear();
+        idx1[i+1] = idx2.size();
+    }
+
+    n_blocks = idx2.size();
+    nnz = n_blocks * b_size;
 }
 
 void BSRMatrix::copy_helper(const CSCMatrix* A)
@@ -1490,7 +1895,9 @@ COOMatrix* BSRMatrix::to_COO()
 
 CSRMatrix* BSRMatrix::to_CSR()
 {
-    return NULL;
+    CSRMatrix* A = new CSRMatrix();
+    A->copy_helper(this);
+    return A;
 }
 
 CSCMatrix* BSRMatrix::to_CSC()
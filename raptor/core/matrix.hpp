@@ -54,6 +54,7 @@ namespace raptor
   class CSRMatrix;
   class CSCMatrix;
   class BSRMatrix;
+  class SELLMatrix;
 
   class Matrix
   {
@@ -489,6 +490,9 @@ namespace raptor
  *****     to each nonzero
  ***** data()
  *****     Returns aligned_vector<double>& containing the nonzero values
+ ***** to_single() / to_double()
+ *****     Stores the values in single (sp_vals) or double (vals)
+ *****     precision
  **************************************************************/
   class CSRMatrix : public Matrix
   {
@@ -606,11 +610,16 @@ namespace raptor
     void move_diag();
     void remove_duplicates();
 
+    // Threaded kernels split rows across threads with the cached
+    // thread_rows (see form_thread_rows), so no scheduling is done
+    // per call.  Transpose products accumulate into per-thread 
+    // buffers, which are then summed.  Each kernel reads sp_vals
+    // if the matrix is stored in single precision (see to_single),
+    // accumulating in double.
     void mult_helper(aligned_vector<double>& x, aligned_vector<double>& b)
     {
-        for (int i = 0; i < n_rows; i++)
-            b[i] = 0.0;
-        mult_append_helper(x, b);
+        if (single_precision()) mult_kernel(sp_vals.data(), x, b);
+        else mult_kernel(vals.data(), x, b);
     }
     void mult_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
 
@@ -622,74 +631,229 @@ namespace raptor
     }
     void mult_append_helper(aligned_vector<double>& x, aligned_vector<double>& b)
     { 
-        int start, end;
-        for (int i = 0; i < n_rows; i++)
+        if (single_precision()) mult_append_kernel(sp_vals.data(), x, b);
+        else mult_append_kernel(vals.data(), x, b);
+    }
+    void mult_append_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    {
+        if (single_precision()) mult_append_T_kernel(sp_vals.data(), x, b, 1.0);
+        else mult_append_T_kernel(vals.data(), x, b, 1.0);
+    }
+    void mult_append_neg_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    {
+        if (single_precision()) mult_append_neg_kernel(sp_vals.data(), x, b);
+        else mult_append_neg_kernel(vals.data(), x, b);
+    }
+    void mult_append_neg_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    {
+        if (single_precision()) mult_append_T_kernel(sp_vals.data(), x, b, -1.0);
+        else mult_append_T_kernel(vals.data(), x, b, -1.0);
+    }
+    void residual_helper(const aligned_vector<double>& x, const aligned_vector<double>& b, 
+            aligned_vector<double>& r)
+    {
+        if (single_precision()) residual_kernel(sp_vals.data(), x, b, r);
+        else residual_kernel(vals.data(), x, b, r);
+    }
+
+    template <typename V> 
+    void mult_kernel(const V* v, aligned_vector<double>& x, aligned_vector<double>& b)
+    {
+        int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
         {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
+            int start, end;
+            double sum;
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
             {
-                b[i] += vals[j] * x[idx2[j]];
+                sum = 0.0;
+                start = idx1[i];
+                end = idx1[i+1];
+                for (int j = start; j < end; j++)
+                {
+                    sum += v[j] * x[idx2[j]];
+                }
+                b[i] = sum;
             }
         }
     }
-    void mult_append_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    template <typename V>
+    void mult_append_kernel(const V* v, aligned_vector<double>& x, 
+            aligned_vector<double>& b)
     {
-        int start, end;
-        for (int i = 0; i < n_rows; i++)
+        int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
         {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
+            int start, end;
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
             {
-                b[idx2[j]] += vals[j] * x[i];
+                start = idx1[i];
+                end = idx1[i+1];
+                for (int j = start; j < end; j++)
+                {
+                    b[i] += v[j] * x[idx2[j]];
+                }
             }
         }
     }
-    void mult_append_neg_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    template <typename V>
+    void mult_append_neg_kernel(const V* v, aligned_vector<double>& x, 
+            aligned_vector<double>& b)
     {
-        int start, end;
-        for (int i = 0; i < n_rows; i++)
+        int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
         {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
+            int start, end;
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
             {
-                b[i] -= vals[j] * x[idx2[j]];
+                start = idx1[i];
+                end = idx1[i+1];
+                for (int j = start; j < end; j++)
+                {
+                    b[i] -= v[j] * x[idx2[j]];
+                }
             }
         }
     }
-    void mult_append_neg_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    // b += A^T x (alpha = 1) or b -= A^T x (alpha = -1)
+    template <typename V>
+    void mult_append_T_kernel(const V* v, aligned_vector<double>& x, 
+            aligned_vector<double>& b, double alpha)
     {
+        int num_threads = form_thread_rows();
+        if (num_threads > 1)
+        {
+            thread_mult_append_T(v, x, b, alpha, num_threads);
+            return;
+        }
+
         int start, end;
         for (int i = 0; i < n_rows; i++)
         {
             start = idx1[i];
             end = idx1[i+1];
-            for (int j = start; j < end; j++)
+            if (alpha > 0)
             {
-                b[idx2[j]] -= vals[j] * x[i];
+                for (int j = start; j < end; j++)
+                {
+                    b[idx2[j]] += v[j] * x[i];
+                }
+            }
+            else
+            {
+                for (int j = start; j < end; j++)
+                {
+                    b[idx2[j]] -= v[j] * x[i];
+                }
             }
         }
     }
-    void residual_helper(const aligned_vector<double>& x, const aligned_vector<double>& b, 
-            aligned_vector<double>& r)
+    template <typename V>
+    void residual_kernel(const V* v, const aligned_vector<double>& x, 
+            const aligned_vector<double>& b, aligned_vector<double>& r)
     {
-        for (int i = 0; i < n_rows; i++)
-            r[i] = b[i];
-     
-        int start, end;
-        for (int i = 0; i < n_rows; i++)
+        int num_threads = form_thread_rows();
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
         {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
+            int start, end;
+            double sum;
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
             {
-                r[i] -= vals[j] * x[idx2[j]];
+                sum = b[i];
+                start = idx1[i];
+                end = idx1[i+1];
+                for (int j = start; j < end; j++)
+                {
+                    sum -= v[j] * x[idx2[j]];
+                }
+                r[i] = sum;
             }
         }
     }
 
+    // Returns res - (row i of A) * x, used by row-wise relaxation
+    double row_residual(int i, const double* x, double res) const
+    {
+        if (single_precision()) return row_residual(i, sp_vals.data(), x, res);
+        return row_residual(i, vals.data(), x, res);
+    }
+    template <typename V>
+    double row_residual(int i, const V* v, const double* x, double res) const
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            res -= v[j] * x[idx2[j]];
+        }
+        return res;
+    }
+
+    // Block form : res[0:k] -= (row i of A) * x, with x stored row-major
+    void row_residual(int i, const double* x, double* res, int k) const
+    {
+        if (single_precision()) row_residual(i, sp_vals.data(), x, res, k);
+        else row_residual(i, vals.data(), x, res, k);
+    }
+    template <typename V>
+    void row_residual(int i, const V* v, const double* x, double* res, int k) const
+    {
+        for (int j = idx1[i]; j < idx1[i+1]; j++)
+        {
+            double val = v[j];
+            const double* x_row = &(x[idx2[j]*k]);
+            for (int w = 0; w < k; w++)
+            {
+                res[w] -= val * x_row[w];
+            }
+        }
+    }
+
+    /**************************************************************
+    *****   Single Precision Storage
+    **************************************************************
+    ***** to_single() moves the values into sp_vals (float), 
+    ***** releasing vals, and to_double() moves them back.  While 
+    ***** single precision, only products, residuals, and row-wise
+    ***** relaxation are supported (all accumulate in double); 
+    ***** convert back before any other operation.
+    **************************************************************/
+    void to_single();
+    void to_double();
+    bool single_precision() const
+    {
+        return sp_vals.size() > 0;
+    }
+
+    int form_thread_rows();
+    template <typename V>
+    void thread_mult_append_T(const V* v, aligned_vector<double>& x, 
+            aligned_vector<double>& b, double alpha, int num_threads);
+
+    // Sparse matrix times a block of k vectors, stored row-major 
+    // (x[col*k + v]), so each nonzero is read once for all k vectors
+    void spmm(const double* x, double* b, int k);
+    void spmm_append(const double* x, double* b, int k);
+    void spmm_append_neg(const double* x, double* b, int k);
+    void spmm_append_T(const double* x, double* b, int k);
+    void spmm_residual(const double* x, const double* b, double* r, int k);
+    template <typename V> void spmm_kernel(const V* v, const double* x, 
+            double* b, int k);
+    template <typename V> void spmm_append_kernel(const V* v, const double* x,
+            double* b, int k);
+    template <typename V> void spmm_append_neg_kernel(const V* v, const double* x,
+            double* b, int k);
+    template <typename V> void spmm_append_T_kernel(const V* v, const double* x,
+            double* b, int k);
+    template <typename V> void spmm_residual_kernel(const V* v, const double* x,
+            const double* b, double* r, int k);
+
     CSRMatrix* spgemm(const CSRMatrix* B);
     CSRMatrix* spgemm_T(const CSCMatrix* A);
 
@@ -733,6 +897,15 @@ namespace raptor
     {
         return vals;
     }
+
+    // First row of each thread (plus n_rows), and the number of
+    // nonzeros when formed.  Cached between kernel calls.
+    aligned_vector<int> thread_rows;
+    int thread_rows_nnz;
+    aligned_vector<double> thread_buffer;
+
+    // Values when stored in single precision (vals is then empty)
+    aligned_vector<float> sp_vals;
 };
 
 /**************************************************************
@@ -1232,201 +1405,83 @@ namespace raptor
     void move_diag();
     void remove_duplicates();
 
-    // STANDARD MULTIPLICATION
+    // Products, residuals and block Jacobi dispatch on the block 
+    // size (see bsr_matrix.cpp) : square blocks of size 2 through 6
+    // use kernels with the block size fixed at compile time, so the
+    // block loops are unrolled and the row sums of a block row stay
+    // in registers.  Other block sizes use a generic kernel.
     void mult_helper(aligned_vector<double>& x, aligned_vector<double>& b)
     {
         for (int i = 0; i < n_rows; i++)
             b[i] = 0.0;
         mult_append_helper(x, b);
     }
-
-    // TRANSPOSE MULTIPLICATION
     void mult_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
-
     {
         for (int i = 0; i < n_cols; i++)
             b[i] = 0.0;
 
         mult_append_T_helper(x, b);    
     }
-
-    // STANDARD MULTIPLICATION HELPER
     void mult_append_helper(aligned_vector<double>& x, aligned_vector<double>& b)
     { 
-        int start, end;
-        int rowsOfBlocks = n_rows/b_rows;
-        for (int i = 0; i < rowsOfBlocks; i++)
-        {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
-            {
-                // Dense multiplication on block
-                block_mult_helper(i, j, idx2[j], x, b);
-            }
-        }
+        block_mult_append(x.data(), b.data(), 1.0);
     }
-
-    void block_mult_helper(int row, int num_blocks_prev, int col,
-                    aligned_vector<double>& x, aligned_vector<double>& b)
-    {
-        int upper_i = row * b_rows;
-        int upper_j = col * b_cols;
-        int data_offset = num_blocks_prev * b_size;
-
-        int glob_i, glob_j, ind;
-        for(int i=0; i<b_rows; i++){
-            for(int j=0; j<b_cols; j++){
-                glob_i = upper_i + i;
-                glob_j = upper_j + j;
-                ind = i * b_cols + j + data_offset;
-                b[glob_i] += vals[ind] * x[glob_j];
-            }
-        }
-    }
-
     void mult_append_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
     {
-        int start, end;
-        for (int i = 0; i < n_rows/b_rows; i++)
-        {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
-            {
-                // Dense transpose multiplication on block
-                block_mult_T_helper(i, j, idx2[j], x, b);
-            }
-        }
+        block_mult_append_T(x.data(), b.data(), 1.0);
     }
-
-    void block_mult_T_helper(int row, int num_blocks_prev, int col,
-                    aligned_vector<double>& x, aligned_vector<double>& b)
-    {
-        int upper_i = row * b_rows;
-        int upper_j = col * b_cols;
-        int data_offset = num_blocks_prev * b_size;
-
-        int glob_i, glob_j, ind;
-        for(int i=0; i<b_rows; i++){
-            for(int j=0; j<b_cols; j++){
-                glob_i = upper_i + i;
-                glob_j = upper_j + j;
-                ind = i * b_cols + j + data_offset;
-                b[glob_j] += vals[ind] * x[glob_i];
-            }
-        }
-    }
-
     void mult_append_neg_helper(aligned_vector<double>& x, aligned_vector<double>& b)
     {
-        int start, end;
-        for (int i = 0; i < n_rows/b_rows; i++)
-        {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
-            {
-                // Dense negative multiplication on block
-                block_mult_neg_helper(i, j, idx2[j], x, b);
-            }
-        }
-    }
-
-    void block_mult_neg_helper(int row, int num_blocks_prev, int col,
-                    aligned_vector<double>& x, aligned_vector<double>& b)
-    {
-        int upper_i = row * b_rows;
-        int upper_j = col * b_cols;
-        int data_offset = num_blocks_prev * b_size;
-
-        int glob_i, glob_j, ind;
-        for(int i=0; i<b_rows; i++){
-            for(int j=0; j<b_cols; j++){
-                glob_i = upper_i + i;
-                glob_j = upper_j + j;
-                ind = i * b_cols + j + data_offset;
-                b[glob_i] -= vals[ind] * x[glob_j];
-            }
-        }
+        block_mult_append(x.data(), b.data(), -1.0);
     }
-
     void mult_append_neg_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
     {
-        int start, end;
-        for (int i = 0; i < n_rows/b_rows; i++)
-        {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
-            {
-                block_mult_neg_T_helper(i, j, idx2[j], x, b);
-            }
-        }
-    }
-
-    void block_mult_neg_T_helper(int row, int num_blocks_prev, int col,
-                    aligned_vector<double>& x, aligned_vector<double>& b)
-    {
-        int upper_i = row * b_rows;
-        int upper_j = col * b_cols;
-        int data_offset = num_blocks_prev * b_size;
-
-        int glob_i, glob_j, ind;
-        for(int i=0; i<b_rows; i++){
-            for(int j=0; j<b_cols; j++){
-                glob_i = upper_i + i;
-                glob_j = upper_j + j;
-                ind = i * b_cols + j + data_offset;
-                b[glob_j] -= vals[ind] * x[glob_i];
-            }
-        }
+        block_mult_append_T(x.data(), b.data(), -1.0);
     }
-
     void residual_helper(const aligned_vector<double>& x, const aligned_vector<double>& b, 
             aligned_vector<double>& r)
     {
-        for (int i = 0; i < n_rows; i++)
-            r[i] = b[i];
-
-        int start, end;
-        for (int i = 0; i < n_rows/b_rows; i++)
-        {
-            start = idx1[i];
-            end = idx1[i+1];
-            for (int j = start; j < end; j++)
-            {
-                block_res_helper(i, j, idx2[j], x, r);
-            }
-        }
+        block_residual(x.data(), b.data(), r.data());
     }
 
-    void block_res_helper(int row, int num_blocks_prev, int col,
-                    const aligned_vector<double>& x, aligned_vector<double>& r)
-    {
-        int upper_i = row * b_rows;
-        int upper_j = col * b_cols;
-        int data_offset = num_blocks_prev * b_size;
+    // b += alpha * A * x, b += alpha * A^T * x, and r = b - A*x
+    void block_mult_append(const double* x, double* b, double alpha);
+    void block_mult_append_T(const double* x, double* b, double alpha);
+    void block_residual(const double* x, const double* b, double* r);
 
-        int glob_i, glob_j, ind;
-        for(int i=0; i<b_rows; i++){
-            for(int j=0; j<b_cols; j++){
-                glob_i = upper_i + i;
-                glob_j = upper_j + j;
-                ind = i * b_cols + j + data_offset;
-                r[glob_i] -= vals[ind] * x[glob_j];
-            }
-        }
-    }
+    /**************************************************************
+    *****   BSRMatrix Block Jacobi
+    **************************************************************
+    ***** form_inv_diag_blocks inverts the diagonal block of each
+    ***** block row (square blocks only), storing zeros for 
+    ***** missing or singular blocks.  apply_inv_diag_blocks sets
+    ***** x += omega * D^{-1} r, and block_jacobi performs sweeps
+    ***** of x += omega * D^{-1} (b - A*x), using tmp for the 
+    ***** residual.
+    **************************************************************/
+    void form_inv_diag_blocks(aligned_vector<double>& inv_diag) const;
+    void apply_inv_diag_blocks(const aligned_vector<double>& inv_diag,
+            const double* r, double* x, double omega);
+    void block_jacobi(Vector& x, Vector& b, Vector& tmp, 
+            const aligned_vector<double>& inv_diag, int num_sweeps = 1,
+            double omega = 1.0);
+
+    // Products with scalar matrices are formed from the CSR form 
+    // of this matrix
+    CSRMatrix* spgemm(const CSRMatrix* B);
+    CSRMatrix* spgemm_T(const CSCMatrix* A);
 
-    CSRMatrix* spgemm(const CSRMatrix* B)
-    {
-        return NULL;
-    }
-    CSRMatrix* spgemm_T(const CSCMatrix* A)
-    {
-        return NULL;
-    }
+    /**************************************************************
+    *****   BSRMatrix Block SpGEMM
+    **************************************************************
+    ***** spgemm returns the BSR product this*B, and spgemm_T 
+    ***** returns A^T*this, multiplying dense blocks so that only 
+    ***** block indices are formed.  Block columns of this (rows of
+    ***** A) must match the block rows of B (this).
+    **************************************************************/
+    BSRMatrix* spgemm(const BSRMatrix* B);
+    BSRMatrix* spgemm_T(const BSRMatrix* A);
 
     COOMatrix* to_COO();
     CSRMatrix* to_CSR();
@@ -1485,6 +1540,169 @@ namespace raptor
 
 };
 
+
+/**************************************************************
+ *****   SELLMatrix Class (Inherits from Matrix Base Class)
+ **************************************************************
+ ***** This class stores a sparse matrix in SELL-C-sigma (sliced
+ ***** ELLPACK) format, for use in the solve phase.  Rows are 
+ ***** grouped into chunks of chunk_size (C) rows, each padded 
+ ***** with explicit zeros to the length of its longest row and 
+ ***** stored column-major, so that one SIMD lane handles each 
+ ***** row of a chunk.  Within each window of sigma rows, rows are
+ ***** sorted by decreasing length before chunking to limit the 
+ ***** padding.
+ *****
+ ***** Products and residuals use AVX-512 or AVX2 (gather + FMA)
+ ***** when compiled for them (see WITH_AVX), and a loop over the 
+ ***** chunk lanes otherwise.  Transpose products scatter into 
+ ***** columns, which may conflict within a chunk, so they are not
+ ***** vectorized.  A SELLMatrix is formed from a finalized 
+ ***** CSRMatrix, and does not support adding values, 
+ ***** relaxation, or the setup phase; convert to CSR (to_CSR) 
+ ***** for these.
+ *****
+ ***** Attributes
+ ***** -------------
+ ***** idx1 : aligned_vector<int>
+ *****    Position in idx2/vals of the start of each chunk
+ ***** idx2 : aligned_vector<int>
+ *****    Column of each (padded) entry, column-major per chunk
+ ***** vals : aligned_vector<double>
+ *****    Value of each (padded) entry, zero for padding
+ ***** chunk_len : aligned_vector<int>
+ *****    Number of columns (padded row length) in each chunk
+ ***** row_perm : aligned_vector<int>
+ *****    Row held by each chunk lane (-1 past n_rows)
+ ***** row_len : aligned_vector<int>
+ *****    Number of nonzeros in each chunk lane
+ ***** sigma : int
+ *****    Number of rows in each sorting window
+ **************************************************************/
+  class SELLMatrix : public Matrix
+  {
+
+  public:
+
+    static const int chunk_size = 8;
+
+    /**************************************************************
+    *****   SELLMatrix Class Constructor
+    **************************************************************
+    ***** Initializes an empty SELLMatrix, or forms one from a 
+    ***** CSRMatrix
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** A : const CSRMatrix*
+    *****    CSRMatrix from which to copy data
+    ***** _sigma : int
+    *****    Number of rows in each sorting window (rounded up
+    *****    to a multiple of chunk_size)
+    **************************************************************/
+    SELLMatrix(int _sigma = 64) : Matrix()
+    {
+        set_sigma(_sigma);
+        n_chunks = 0;
+        idx1.resize(1, 0);
+    }
+
+    SELLMatrix(const CSRMatrix* A, int _sigma = 64) : Matrix()
+    {
+        set_sigma(_sigma);
+        copy_helper(A);
+    }
+
+    ~SELLMatrix()
+    {
+
+    }
+
+    void set_sigma(int _sigma)
+    {
+        if (_sigma < chunk_size) _sigma = chunk_size;
+        sigma = ((_sigma + chunk_size - 1) / chunk_size) * chunk_size;
+    }
+
+    Matrix* transpose();
+
+    void print();
+
+    void copy_helper(const COOMatrix* A);
+    void copy_helper(const CSRMatrix* A);
+    void copy_helper(const CSCMatrix* A);
+    void copy_helper(const BSRMatrix* A);
+    void copy_helper(const SELLMatrix* A);
+
+    // Formed from a sorted CSRMatrix, so these are no-ops
+    void sort()
+    {
+        sorted = true;
+    }
+    void move_diag()
+    {
+    }
+    void remove_duplicates()
+    {
+    }
+
+    void add_value(int row, int col, double value);
+    void add_block(int row, int col, aligned_vector<double>& values);
+
+    void mult_helper(aligned_vector<double>& x, aligned_vector<double>& b);
+    void mult_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    {
+        for (int i = 0; i < n_cols; i++)
+            b[i] = 0.0;
+
+        mult_append_T_helper(x, b);
+    }
+    void mult_append_helper(aligned_vector<double>& x, aligned_vector<double>& b);
+    void mult_append_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    {
+        mult_append_T_kernel(x, b, 1.0);
+    }
+    void mult_append_neg_helper(aligned_vector<double>& x, aligned_vector<double>& b);
+    void mult_append_neg_T_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+    {
+        mult_append_T_kernel(x, b, -1.0);
+    }
+    void residual_helper(const aligned_vector<double>& x, const aligned_vector<double>& b,
+            aligned_vector<double>& r);
+    void mult_append_T_kernel(const aligned_vector<double>& x, 
+            aligned_vector<double>& b, double alpha);
+
+    CSRMatrix* spgemm(const CSRMatrix* B);
+    CSRMatrix* spgemm_T(const CSCMatrix* A);
+
+    COOMatrix* to_COO();
+    CSRMatrix* to_CSR();
+    CSCMatrix* to_CSC();
+    SELLMatrix* copy()
+    {
+        SELLMatrix* A = new SELLMatrix(sigma);
+        A->copy_helper(this);
+        return A;
+    }
+
+    format_t format()
+    {
+        return SELL;
+    }
+
+    // Number of stored (padded) entries
+    int padded_nnz()
+    {
+        return idx1[n_chunks];
+    }
+
+    int sigma;
+    int n_chunks;
+    aligned_vector<int> chunk_len;
+    aligned_vector<int> row_perm;
+    aligned_vector<int> row_len;
+};
+
 }
 
 #endif
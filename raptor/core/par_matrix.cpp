@@ -13,7 +13,7 @@ using namespace raptor;
 *****
 ***** Parameters
 ***** -------------
-***** row : index_t
+***** row : int
 *****    Local row of value
 ***** global_col : index_t 
 *****    Global column of value
@@ -32,10 +32,35 @@ void ParMatrix::add_value(
     }
     else 
     {
-        off_proc->add_value(row, global_col, value);
+        off_proc->add_value(row, stage_off_proc_col(global_col), value);
     }
 }
 
+/**************************************************************
+*****   ParMatrix Stage Off Proc Column
+**************************************************************
+***** Returns the position of global_col in off_proc_column_map,
+***** appending it if not yet staged
+*****
+***** Parameters
+***** -------------
+***** global_col : index_t 
+*****    Global column (not local to this process)
+**************************************************************/
+int ParMatrix::stage_off_proc_col(index_t global_col)
+{
+    std::map<index_t, int>::iterator it = off_proc_staged_cols.find(global_col);
+    if (it != off_proc_staged_cols.end())
+    {
+        return it->second;
+    }
+
+    int staged_col = off_proc_column_map.size();
+    off_proc_staged_cols[global_col] = staged_col;
+    off_proc_column_map.push_back(global_col);
+    return staged_col;
+}
+
 /**************************************************************
 *****   ParMatrix Add Global Value
 **************************************************************
@@ -80,16 +105,43 @@ void ParMatrix::condense_off_proc()
         return;
     }
 
-    int prev_col = -1;
+    // Columns staged by add_value : idx2 holds positions in 
+    // off_proc_column_map, renumbered in global column order
+    if (off_proc_staged_cols.size())
+    {
+        aligned_vector<int> staged_to_new(off_proc_column_map.size());
+        off_proc_num_cols = 0;
+        for (std::map<index_t, int>::iterator it = off_proc_staged_cols.begin();
+                it != off_proc_staged_cols.end(); ++it)
+        {
+            staged_to_new[it->second] = off_proc_num_cols;
+            off_proc_column_map[off_proc_num_cols++] = it->first;
+        }
+        off_proc_column_map.resize(off_proc_num_cols);
+        off_proc_staged_cols.clear();
 
-    std::map<int, int> orig_to_new;
+        for (aligned_vector<int>::iterator it = off_proc->idx2.begin();
+                it != off_proc->idx2.end(); ++it)
+        {
+            *it = staged_to_new[*it];
+        }
+
+        // Sorted on staged positions in finalize, so re-sort
+        off_proc->sorted = false;
+        off_proc->sort();
+        return;
+    }
+
+    index_t prev_col = -1;
+
+    std::map<index_t, int> orig_to_new;
 
     std::copy(off_proc->idx2.begin(), off_proc->idx2.end(),
             std::back_inserter(off_proc_column_map));
     std::sort(off_proc_column_map.begin(), off_proc_column_map.end());
 
     off_proc_num_cols = 0;
-    for (aligned_vector<int>::iterator it = off_proc_column_map.begin(); 
+    for (aligned_vector<index_t>::iterator it = off_proc_column_map.begin(); 
             it != off_proc_column_map.end(); ++it)
     {
         if (*it != prev_col)
@@ -188,6 +240,10 @@ void ParMatrix::finalize(bool create_comm, int b_cols)
                 off_proc_column_map[i] += on_proc_num_cols;
             }
         }
+
+        // Off_proc columns are scalar columns, b_cols per block
+        off_proc_num_cols = off_proc_column_map.size();
+        off_proc->resize(local_num_rows, off_proc_num_cols);
     }
 
     if (create_comm){
@@ -243,6 +299,15 @@ ParCSCMatrix* ParCSRMatrix::to_ParCSC()
     A->copy_helper(this);
     return A;
 }
+ParBSRMatrix* ParCSRMatrix::to_ParBSR(int _brows, int _bcols)
+{
+    ParBSRMatrix* A = new ParBSRMatrix();
+    A->b_rows = _brows;
+    A->b_cols = _bcols;
+    A->b_size = _brows * _bcols;
+    A->copy_helper(this);
+    return A;
+}
 ParCOOMatrix* ParCSCMatrix::to_ParCOO()
 {
     ParCOOMatrix* A = new ParCOOMatrix();
@@ -265,7 +330,9 @@ ParCOOMatrix* ParBSRMatrix::to_ParCOO()
 }
 ParCSRMatrix* ParBSRMatrix::to_ParCSR()
 {
-    return NULL;
+    ParCSRMatrix* A = new ParCSRMatrix();
+    A->copy_helper(this);
+    return A;
 }
 ParCSCMatrix* ParBSRMatrix::to_ParCSC()
 {
@@ -553,7 +620,158 @@ void ParCSRMatrix::copy_helper(ParCOOMatrix* A)
 
 void ParCSRMatrix::copy_helper(ParBSRMatrix* A)
 {
-    printf("Currently not implemented\n");
+    if (on_proc)
+    {   
+        delete on_proc;
+    }
+    if (off_proc)
+    {
+        delete off_proc;
+    }
+
+    on_proc = A->on_proc->to_CSR();
+    off_proc = A->off_proc->to_CSR();
+
+    ParMatrix::copy_helper(A);
+
+    // Off_proc columns of A are scalar columns, b_cols per block
+    off_proc->n_cols = off_proc_num_cols;
+    local_nnz = on_proc->nnz + off_proc->nnz;
+}
+
+// Maps each nonzero of A to the position of the same entry in B, if 
+// each row of A holds the same columns (of n_cols) as the row of B (in
+// any order)
+static bool map_local_pattern(const Matrix* A, const Matrix* B, 
+        int n_cols, aligned_vector<int>& A_to_B)
+{
+    int start, end, ctr;
+
+    if (A->n_rows != B->n_rows || A->nnz != B->nnz)
+    {
+        return false;
+    }
+
+    aligned_vector<int> pos(n_cols, -1);
+    A_to_B.resize(A->nnz);
+    for (int i = 0; i < B->n_rows; i++)
+    {
+        start = B->idx1[i];
+        end = B->idx1[i+1];
+        if (A->idx1[i+1] - A->idx1[i] != end - start)
+        {
+            return false;
+        }
+        for (int j = start; j < end; j++)
+        {
+            pos[B->idx2[j]] = j;
+        }
+        ctr = 0;
+        for (int j = A->idx1[i]; j < A->idx1[i+1]; j++)
+        {
+            A_to_B[j] = pos[A->idx2[j]];
+            if (A_to_B[j] == -1) break;
+            ctr++;
+        }
+        for (int j = start; j < end; j++)
+        {
+            pos[B->idx2[j]] = -1;
+        }
+        if (ctr != end - start) 
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ParCSRMatrix::copy_values(ParCSRMatrix* A)
+{
+    aligned_vector<int> on_to_this;
+    aligned_vector<int> off_to_this;
+
+    if (A->local_num_rows != local_num_rows 
+            || A->on_proc_column_map != on_proc_column_map
+            || A->off_proc_column_map != off_proc_column_map
+            || !map_local_pattern(A->on_proc, on_proc, on_proc_num_cols, on_to_this)
+            || !map_local_pattern(A->off_proc, off_proc, off_proc_num_cols, 
+                off_to_this))
+    {
+        return false;
+    }
+
+    for (int j = 0; j < A->on_proc->nnz; j++)
+    {
+        on_proc->vals[on_to_this[j]] = A->on_proc->vals[j];
+    }
+    for (int j = 0; j < A->off_proc->nnz; j++)
+    {
+        off_proc->vals[off_to_this[j]] = A->off_proc->vals[j];
+    }
+
+    return true;
+}
+
+void ParCSRMatrix::to_single()
+{
+    ((CSRMatrix*) on_proc)->to_single();
+    ((CSRMatrix*) off_proc)->to_single();
+}
+
+void ParCSRMatrix::to_double()
+{
+    ((CSRMatrix*) on_proc)->to_double();
+    ((CSRMatrix*) off_proc)->to_double();
+}
+
+void ParCSRMatrix::to_sell(int sigma)
+{
+    if (on_proc->format() == SELL) return;
+
+    SELLMatrix* on_sell = new SELLMatrix((CSRMatrix*) on_proc, sigma);
+    SELLMatrix* off_sell = new SELLMatrix((CSRMatrix*) off_proc, sigma);
+    delete on_proc;
+    delete off_proc;
+    on_proc = on_sell;
+    off_proc = off_sell;
+}
+
+void ParCSRMatrix::from_sell()
+{
+    if (on_proc->format() != SELL) return;
+
+    CSRMatrix* on_csr = on_proc->to_CSR();
+    CSRMatrix* off_csr = off_proc->to_CSR();
+    delete on_proc;
+    delete off_proc;
+    on_proc = on_csr;
+    off_proc = off_csr;
+}
+
+void ParCSRMatrix::form_boundary_rows()
+{
+    int off_nnz = off_proc->idx1[local_num_rows];
+    if ((int) (interior_rows.size() + boundary_rows.size()) == local_num_rows
+            && boundary_rows_nnz == off_nnz)
+    {
+        return;
+    }
+
+    interior_rows.clear();
+    boundary_rows.clear();
+    boundary_rows_nnz = off_nnz;
+    for (int i = 0; i < local_num_rows; i++)
+    {
+        if (off_proc->idx1[i+1] > off_proc->idx1[i])
+        {
+            boundary_rows.push_back(i);
+        }
+        else
+        {
+            interior_rows.push_back(i);
+        }
+    }
 }
 
 void ParCSCMatrix::copy_helper(ParCSRMatrix* A)
@@ -612,9 +830,70 @@ void ParCSCMatrix::copy_helper(ParBSRMatrix* A)
     printf("Currently not implemented\n");
 }
 
+// Block size (b_rows, b_cols) must be set, and block boundaries must
+// align with the partition of A
 void ParBSRMatrix::copy_helper(ParCSRMatrix* A)
 {
-    printf("Currently not implemented.\n");
+    if (b_rows == 0 || b_cols == 0)
+    {
+        printf("Block size must be set before copying to a ParBSRMatrix.\n");
+        return;
+    }
+
+    if (on_proc)
+    {   
+        delete on_proc;
+    }
+    if (off_proc)
+    {
+        delete off_proc;
+    }
+
+    ParMatrix::copy_helper(A);
+
+    // Comm packages of A are formed for its (unexpanded) columns
+    delete comm;
+    delete tap_comm;
+    comm = NULL;
+    tap_comm = NULL;
+    delete block_comm;
+    delete block_tap_comm;
+    block_comm = NULL;
+    block_tap_comm = NULL;
+
+    on_proc = new BSRMatrix((CSRMatrix*) A->on_proc, b_rows, b_cols);
+
+    // Off_proc block columns : each block column holding an off_proc
+    // column of A, expanded to b_cols scalar columns
+    CSRMatrix* off_tmp = (CSRMatrix*) A->off_proc->copy();
+    aligned_vector<int> col_to_block(A->off_proc_num_cols);
+    off_proc_column_map.clear();
+    index_t prev_block = -1;
+    for (int i = 0; i < A->off_proc_num_cols; i++)
+    {
+        index_t block = A->off_proc_column_map[i] / b_cols;
+        if (block != prev_block)
+        {
+            for (int c = 0; c < b_cols; c++)
+            {
+                off_proc_column_map.push_back(block * b_cols + c);
+            }
+            prev_block = block;
+        }
+        col_to_block[i] = off_proc_column_map.size() - b_cols 
+            + (A->off_proc_column_map[i] % b_cols);
+    }
+    off_proc_num_cols = off_proc_column_map.size();
+    for (aligned_vector<int>::iterator it = off_tmp->idx2.begin();
+            it != off_tmp->idx2.end(); ++it)
+    {
+        *it = col_to_block[*it];
+    }
+    off_tmp->n_cols = off_proc_num_cols;
+    off_proc = new BSRMatrix(off_tmp, b_rows, b_cols);
+    delete off_tmp;
+
+    local_nnz = on_proc->nnz + off_proc->nnz;
 }
 
 void ParBSRMatrix::copy_helper(ParCSCMatrix* A)
@@ -629,7 +908,125 @@ void ParBSRMatrix::copy_helper(ParCOOMatrix* A)
 
 void ParBSRMatrix::copy_helper(ParBSRMatrix* A)
 {
-    printf("Currently not implemented\n");
+    if (on_proc)
+    {   
+        delete on_proc;
+    }
+    if (off_proc)
+    {
+        delete off_proc;
+    }
+
+    on_proc = A->on_proc->copy();
+    off_proc = A->off_proc->copy();
+
+    b_rows = A->b_rows;
+    b_cols = A->b_cols;
+    b_size = A->b_size;
+
+    delete block_comm;
+    delete block_tap_comm;
+    block_comm = NULL;
+    block_tap_comm = NULL;
+
+    ParMatrix::copy_helper(A);
+}
+
+// Partition of block rows and block columns (blocks align with the
+// partition of A)
+static Partition* block_partition(ParBSRMatrix* A)
+{
+    Partition* part = A->partition;
+    return new Partition(part->global_num_rows / A->b_rows, 
+            part->global_num_cols / A->b_cols, 
+            part->local_num_rows / A->b_rows, 
+            part->local_num_cols / A->b_cols,
+            part->first_local_row / A->b_rows, 
+            part->first_local_col / A->b_cols, part->topology);
+}
+
+CommPkg* ParBSRMatrix::get_block_comm(bool tap)
+{
+    if (tap && block_tap_comm) return block_tap_comm;
+    if (!tap && block_comm) return block_comm;
+
+    aligned_vector<index_t> off_blocks(off_proc_column_map.size() / b_cols);
+    aligned_vector<index_t> on_blocks(on_proc_column_map.size() / b_cols);
+    for (int i = 0; i < (int) off_blocks.size(); i++)
+    {
+        off_blocks[i] = off_proc_column_map[i * b_cols] / b_cols;
+    }
+    for (int i = 0; i < (int) on_blocks.size(); i++)
+    {
+        on_blocks[i] = on_proc_column_map[i * b_cols] / b_cols;
+    }
+
+    // Comm packages keep only the topology of the partition
+    Partition* part = block_partition(this);
+    if (tap)
+    {
+        block_tap_comm = new TAPComm(part, off_blocks, on_blocks);
+    }
+    else
+    {
+        block_comm = new ParComm(part, off_blocks, on_blocks);
+    }
+    delete part;
+
+    if (tap) return block_tap_comm;
+    return block_comm;
+}
+
+ParCSRMatrix* ParBSRMatrix::block_norms()
+{
+    int start, end;
+    double val;
+    int n_block_rows = local_num_rows / b_rows;
+
+    Partition* part = block_partition(this);
+    ParCSRMatrix* N = new ParCSRMatrix(part, part->global_num_rows, 
+            part->global_num_cols, part->local_num_rows, 
+            part->local_num_cols, 0);
+    part->num_shared = 0;
+
+    N->on_proc->idx1[0] = 0;
+    N->off_proc->idx1[0] = 0;
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        start = on_proc->idx1[i];
+        end = on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            val = 0.0;
+            for (int k = 0; k < b_size; k++)
+            {
+                val += on_proc->vals[j * b_size + k] * on_proc->vals[j * b_size + k];
+            }
+            N->on_proc->idx2.push_back(on_proc->idx2[j]);
+            N->on_proc->vals.push_back(on_proc->idx2[j] == i ? sqrt(val) : -sqrt(val));
+        }
+
+        start = off_proc->idx1[i];
+        end = off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            val = 0.0;
+            for (int k = 0; k < b_size; k++)
+            {
+                val += off_proc->vals[j * b_size + k] * off_proc->vals[j * b_size + k];
+            }
+            N->off_proc->idx2.push_back(N->stage_off_proc_col(
+                        off_proc_column_map[off_proc->idx2[j] * b_cols] / b_cols));
+            N->off_proc->vals.push_back(-sqrt(val));
+        }
+        N->on_proc->idx1[i+1] = N->on_proc->idx2.size();
+        N->off_proc->idx1[i+1] = N->off_proc->idx2.size();
+    }
+    N->on_proc->nnz = N->on_proc->idx2.size();
+    N->off_proc->nnz = N->off_proc->idx2.size();
+    N->finalize();
+
+    return N;
 }
 
 
@@ -715,24 +1112,15 @@ ParMatrix* ParCOOMatrix::transpose()
 ParMatrix* ParCSRMatrix::transpose()
 {
     int start, end;
-    int proc;
-    int col, col_start, col_end;
-    int ctr, size;
-    int col_count, count;
-    int col_size;
-    int idx, row;
-    MPI_Status recv_status;
 
     Partition* part_T;
     Matrix* on_proc_T;
-    Matrix* off_proc_T;
     CSCMatrix* send_mat;
-    CSCMatrix* recv_mat;
+    CSRMatrix* recv_mat;
     ParCSRMatrix* T = NULL;
 
-    aligned_vector<PairData> send_buffer;
-    aligned_vector<PairData> recv_buffer;
-    aligned_vector<int> send_ptr(comm->recv_data->num_msgs+1);
+    aligned_vector<index_t> send_rows;
+    aligned_vector<index_t> recv_rows;
 
     // Transpose partition
     part_T = partition->transpose();
@@ -740,105 +1128,35 @@ ParMatrix* ParCSRMatrix::transpose()
     // Transpose local (on_proc) matrix
     on_proc_T = on_proc->transpose();
 
-    // Allocate vectors for sending off_proc matrix
+    // Send each off_proc column, with global rows, to the process 
+    // holding it, where it forms a row of off_proc_T
     send_mat = off_proc->to_CSC();
-    recv_mat = new CSCMatrix(local_num_rows, comm->send_data->size_msgs);
-
-    // Add off_proc cols of matrix to send buffer
-    ctr = 0;
-    send_ptr[0] = 0;
-    for (int i = 0; i < comm->recv_data->num_msgs; i++)
-    {
-        start = comm->recv_data->indptr[i];
-        end = comm->recv_data->indptr[i+1];
-        for (int j = start; j < end; j++)
-        {
-            col = j;
-            col_start = send_mat->idx1[col];
-            col_end = send_mat->idx1[col+1];
-            send_buffer.push_back(PairData());
-            send_buffer[ctr++].index = col_end - col_start;
-            for (int k = col_start; k < col_end; k++)
-            {
-                send_buffer.push_back(PairData());
-                send_buffer[ctr].index = local_row_map[send_mat->idx2[k]];
-                send_buffer[ctr++].val = send_mat->vals[k];
-            }
-        }
-        send_ptr[i+1] = send_buffer.size();
-    }
-    for (int i = 0; i < comm->recv_data->num_msgs; i++)
-    {
-        proc = comm->recv_data->procs[i];
-        start = send_ptr[i];
-        end = send_ptr[i+1];
-        MPI_Isend(&(send_buffer[start]), end - start, MPI_DOUBLE_INT, proc,
-                comm->key, comm->mpi_comm, &(comm->recv_data->requests[i]));
-    }
-    col_count = 0;
-    recv_mat->idx1[0] = 0;
-    for (int i = 0; i < comm->send_data->num_msgs; i++)
-    {
-        proc = comm->send_data->procs[i];
-        start = comm->send_data->indptr[i];
-        end = comm->send_data->indptr[i+1];
-        size = end - start;
-        MPI_Probe(proc, comm->key, comm->mpi_comm, &recv_status);
-        MPI_Get_count(&recv_status, MPI_DOUBLE_INT, &count);
-        if (count > recv_buffer.size())
-        {
-            recv_buffer.resize(count);
-        }
-        MPI_Recv(&(recv_buffer[0]), count, MPI_DOUBLE_INT, proc,
-                comm->key, comm->mpi_comm, &recv_status);
-        ctr = 0;
-        for (int j = 0; j < size; j++)
-        {
-            col_size = recv_buffer[ctr++].index;
-            recv_mat->idx1[col_count+1] = recv_mat->idx1[col_count] + col_size;
-            col_count++;
-            for (int k = 0; k < col_size; k++)
-            {
-                recv_mat->idx2.push_back(recv_buffer[ctr].index);
-                recv_mat->vals.push_back(recv_buffer[ctr++].val);
-            }
-        }
-    }
-    recv_mat->nnz = recv_mat->idx2.size();
-    MPI_Waitall(comm->recv_data->num_msgs, comm->recv_data->requests.data(), MPI_STATUSES_IGNORE);
-
-    off_proc_T = new CSRMatrix(on_proc_num_cols, -1);
-    aligned_vector<int> off_T_sizes(on_proc_num_cols, 0);
-    for (int i = 0; i < comm->send_data->size_msgs; i++)
-    {
-        row = comm->send_data->indices[i];
-        start = recv_mat->idx1[i];
-        end = recv_mat->idx1[i+1];
-        off_T_sizes[row] += (end - start);
-    }
-    off_proc_T->idx1[0] = 0;
-    for (int i = 0; i < off_proc_T->n_rows; i++)
+    send_rows.resize(send_mat->nnz);
+    for (int i = 0; i < send_mat->nnz; i++)
     {
-        off_proc_T->idx1[i+1] = off_proc_T->idx1[i] + off_T_sizes[i];
-        off_T_sizes[i] = 0;
+        send_rows[i] = local_row_map[send_mat->idx2[i]];
     }
-    off_proc_T->nnz = off_proc_T->idx1[off_proc_T->n_rows];
-    off_proc_T->idx2.resize(off_proc_T->nnz);
-    off_proc_T->vals.resize(off_proc_T->nnz);
-    for (int i = 0; i < comm->send_data->size_msgs; i++)
+    recv_mat = comm->communicate_T(send_mat->idx1, send_rows, send_mat->vals, 
+            on_proc_num_cols, recv_rows);
+
+    T = new ParCSRMatrix(part_T, part_T->global_num_rows, part_T->global_num_cols,
+            part_T->local_num_rows, part_T->local_num_cols, 0);
+    delete T->on_proc;
+    T->on_proc = on_proc_T;
+    T->off_proc->idx1[0] = 0;
+    for (int i = 0; i < recv_mat->n_rows; i++)
     {
-        row = comm->send_data->indices[i];
         start = recv_mat->idx1[i];
         end = recv_mat->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            idx = off_proc_T->idx1[row] + off_T_sizes[row]++;
-            off_proc_T->idx2[idx] = recv_mat->idx2[j];
-            off_proc_T->vals[idx] = recv_mat->vals[j];
+            T->off_proc->idx2.push_back(T->stage_off_proc_col(recv_rows[j]));
+            T->off_proc->vals.push_back(recv_mat->vals[j]);
         }
+        T->off_proc->idx1[i+1] = T->off_proc->idx2.size();
     }
-
-    T = new ParCSRMatrix(part_T, on_proc_T, off_proc_T);
+    T->off_proc->nnz = T->off_proc->idx2.size();
+    T->finalize();
 
     delete send_mat;
     delete recv_mat;
@@ -9,6 +9,7 @@
 
 #include "matrix.hpp"
 #include "par_vector.hpp"
+#include "par_multivector.hpp"
 #include "comm_pkg.hpp"
 #include "types.hpp"
 #include "partition.hpp"
@@ -41,7 +42,7 @@
  *****    Matrix storing local off-diagonal block
  ***** offd_num_cols : index_t
  *****    Number of columns in the off-diagonal matrix
- ***** offd_column_map : aligned_vector<int>
+ ***** offd_column_map : aligned_vector<index_t>
  *****    Maps local columns of offd Matrix to global
  ***** comm : ParComm*
  *****    Parallel communicator for matrix
@@ -201,14 +202,14 @@ namespace raptor
     *****
     ***** Parameters
     ***** -------------
-    ***** local_row : index_t
+    ***** local_row : int
     *****    Local row of value 
     ***** global_col : index_t 
     *****    Global column of value
     ***** value : data_t
     *****    Value to be added to parallel matrix
     **************************************************************/
-    void add_value(index_t row, index_t global_col, data_t value);
+    void add_value(int row, index_t global_col, data_t value);
 
     /**************************************************************
     *****   ParMatrix Add Global Value
@@ -226,7 +227,21 @@ namespace raptor
     ***** value : data_t
     *****    Value to be added to parallel matrix
     **************************************************************/
-    void add_global_value(int row, int global_col, double value);
+    void add_global_value(index_t global_row, index_t global_col, data_t value);
+
+    /**************************************************************
+    *****   ParMatrix Stage Off Proc Column
+    **************************************************************
+    ***** Returns the position of an off_proc global column in 
+    ***** off_proc_column_map, appending it if not yet staged.  
+    ***** off_proc idx2 holds these positions until finalize.
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** global_col : index_t 
+    *****    Global column (not local to this process)
+    **************************************************************/
+    int stage_off_proc_col(index_t global_col);
 
     /**************************************************************
     *****   ParMatrix Finalize
@@ -265,17 +280,17 @@ namespace raptor
 
     virtual ParMatrix* transpose() = 0;
 
-    aligned_vector<int>& get_off_proc_column_map()
+    aligned_vector<index_t>& get_off_proc_column_map()
     {
         return off_proc_column_map;
     }
 
-    aligned_vector<int>& get_on_proc_column_map()
+    aligned_vector<index_t>& get_on_proc_column_map()
     {
         return on_proc_column_map;
     }
 
-    aligned_vector<int>& get_local_row_map()
+    aligned_vector<index_t>& get_local_row_map()
     {
         return local_row_map;
     }
@@ -294,8 +309,8 @@ namespace raptor
     // Store dimensions of parallel matrix
     int local_nnz;
     int local_num_rows;
-    int global_num_rows;
-    int global_num_cols;
+    index_t global_num_rows;
+    index_t global_num_cols;
     int off_proc_num_cols;
     int on_proc_num_cols;
 
@@ -310,9 +325,14 @@ namespace raptor
     // It will be condensed to only store columns with 
     // nonzeros, and these must be mapped to 
     // global column indices
-    aligned_vector<int> off_proc_column_map; // Maps off_proc local to global
-    aligned_vector<int> on_proc_column_map; // Maps on_proc local to global
-    aligned_vector<int> local_row_map; // Maps local rows to global
+    aligned_vector<index_t> off_proc_column_map; // Maps off_proc local to global
+    aligned_vector<index_t> on_proc_column_map; // Maps on_proc local to global
+    aligned_vector<index_t> local_row_map; // Maps local rows to global
+
+    // Off_proc columns added through add_value are staged here 
+    // (global to position in off_proc_column_map) so that off_proc
+    // never holds global (possibly 64-bit) indices before finalize
+    std::map<index_t, int> off_proc_staged_cols;
 
     // Parallel communication package indicating which 
     // processes hold vector values associated with off_proc,
@@ -372,15 +392,15 @@ namespace raptor
                 partition->local_num_rows*5);
 
         // Add values to on/off proc matrices
-        int val_start = partition->first_local_row * partition->global_num_cols;
-        int val_end = (partition->first_local_row + partition->local_num_rows) 
+        index_t val_start = partition->first_local_row * partition->global_num_cols;
+        index_t val_end = (partition->first_local_row + partition->local_num_rows) 
             * partition->global_num_cols;
         for (index_t i = val_start; i < val_end; i++)
         {
             if (fabs(values[i]) > zero_tol)
             {
-                int global_col = i % partition->global_num_cols;
-                int global_row = i / partition->global_num_cols;
+                index_t global_col = i % partition->global_num_cols;
+                index_t global_row = i / partition->global_num_cols;
                 add_value(global_row - partition->first_local_row, global_col, values[i]);
             }
         }
@@ -414,6 +434,73 @@ namespace raptor
     ParMatrix* transpose();
   };
 
+  /**************************************************************
+   *****   RAP Structure
+   **************************************************************
+   ***** Symbolic structure of a Galerkin product C = P^T*A*P, 
+   ***** recorded by ParCSRMatrix::RAP_symbolic, with which 
+   ***** RAP_numeric forms the product again for new values of A 
+   ***** and P (with the same patterns) without a symbolic phase.
+   ***** Patterns keep structural zeros.  Columns of A*P are the 
+   ***** on_proc columns of P, followed by the remaining columns of
+   ***** A*P (AP numbering).  Columns of C are its on_proc columns, 
+   ***** followed by its off_proc columns (C numbering).
+   *****
+   ***** Attributes
+   ***** -------------
+   ***** recv_P : CSRMatrix*
+   *****    Rows of P received for the off_proc columns of A, in
+   *****    AP numbering
+   ***** P_off_to_AP : aligned_vector<int>
+   *****    AP column of each off_proc column of P
+   ***** AP : CSRMatrix*
+   *****    Pattern of the local rows of A*P
+   ***** Ctmp : CSRMatrix*
+   *****    Pattern of P_off^T*A*P (rows sent to the owners of the 
+   *****    off_proc columns of P), in AP numbering
+   ***** C_loc : CSRMatrix*
+   *****    Pattern of P_on^T*A*P, in C numbering
+   ***** recv_C : CSRMatrix*
+   *****    Rows of Ctmp received from other processes (row i for 
+   *****    local row P->comm->send_data->indices[i]), in C numbering
+   ***** recv_to_C : CSRMatrix*
+   *****    Adds each row of recv_C to its row of C
+   ***** AP_to_C : aligned_vector<int>
+   *****    C column of each AP column (-1 if not in C)
+   **************************************************************/
+  class RAPStructure
+  {
+  public:
+    RAPStructure()
+    {
+        recv_P = NULL;
+        AP = NULL;
+        Ctmp = NULL;
+        C_loc = NULL;
+        recv_C = NULL;
+        recv_to_C = NULL;
+    }
+
+    ~RAPStructure()
+    {
+        delete recv_P;
+        delete AP;
+        delete Ctmp;
+        delete C_loc;
+        delete recv_C;
+        delete recv_to_C;
+    }
+
+    CSRMatrix* recv_P;
+    aligned_vector<int> P_off_to_AP;
+    CSRMatrix* AP;
+    CSRMatrix* Ctmp;
+    CSRMatrix* C_loc;
+    CSRMatrix* recv_C;
+    CSRMatrix* recv_to_C;
+    aligned_vector<int> AP_to_C;
+  };
+
   class ParCSRMatrix : public ParMatrix
   {
   public:
@@ -487,16 +574,16 @@ namespace raptor
         on_proc->idx1[0] = 0;
         off_proc->idx1[0] = 0;
 
-        int val_start = partition->first_local_row * partition->global_num_cols;
+        index_t val_start = partition->first_local_row * partition->global_num_cols;
         for (int i = 0; i < partition->local_num_rows; i++)
         {
-            for (int j = 0; j < partition->global_num_cols; j++)
+            for (index_t j = 0; j < partition->global_num_cols; j++)
             {
-                int idx = val_start + (i*partition->global_num_cols) + j;
+                index_t idx = val_start + (i*partition->global_num_cols) + j;
 
                 if (fabs(values[idx]) > zero_tol)
                 {
-                    int global_col = idx % partition->global_num_cols;
+                    index_t global_col = j;
                     
                     if (global_col >= partition->first_local_col && 
                         global_col < partition->first_local_col + partition->local_num_cols)
@@ -506,7 +593,7 @@ namespace raptor
                     }
                     else
                     {
-                        off_proc->idx2.push_back(global_col);
+                        off_proc->idx2.push_back(stage_off_proc_col(global_col));
                         off_proc->vals.push_back(values[idx]);
                     }
 
@@ -526,6 +613,8 @@ namespace raptor
     ParCOOMatrix* to_ParCOO();
     ParCSRMatrix* to_ParCSR();
     ParCSCMatrix* to_ParCSC();
+    // Partition must be aligned with the blocks
+    ParBSRMatrix* to_ParBSR(int _brows, int _bcols);
     ParCSRMatrix* copy()
     {
         ParCSRMatrix* A = new ParCSRMatrix();
@@ -538,6 +627,28 @@ namespace raptor
     void copy_helper(ParCOOMatrix* A);
     void copy_helper(ParBSRMatrix* A);
 
+    // Copies values of A if A has the same sparsity pattern (columns 
+    // within a row may be ordered differently).  Returns false, leaving
+    // this matrix unchanged, if the patterns differ.
+    bool copy_values(ParCSRMatrix* A);
+
+    // Stores the values of on_proc and off_proc in single (or double)
+    // precision (see CSRMatrix::to_single)
+    void to_single();
+    void to_double();
+
+    // Stores on_proc and off_proc in SELL-C-sigma format for the 
+    // solve phase, or back in CSR.  While in SELL format, only
+    // products and residuals are supported (see SELLMatrix).
+    void to_sell(int sigma = 64);
+    void from_sell();
+
+    // Splits local rows into interior rows (no off_proc nonzeros), which
+    // need no communicated values, and boundary rows.  The split is 
+    // cached, and only reformed if the number of rows or off_proc 
+    // nonzeros has changed.
+    void form_boundary_rows();
+
     ParCSRMatrix* strength(strength_t strength_type, double theta = 0.0, 
             bool tap_amg = false, int num_variables = 1, int* variables = NULL,
             data_t* comm_t = NULL);
@@ -551,12 +662,38 @@ namespace raptor
     void tap_mult(ParVector& x, ParVector& b, data_t* comm_t = NULL);
     void mult_T(ParVector& x, ParVector& b, bool tap = false, data_t* comm_t = NULL);
     void tap_mult_T(ParVector& x, ParVector& b, data_t* comm_t = NULL);
+    void residual(ParVector& x, ParVector& b, ParVector& r, bool tap = false,
+            data_t* comm_t = NULL);
+
+    // Products with a block of vectors (SpMM), reading the matrix once
+    // and sending one message per neighbor for all vectors
+    void mult(ParMultiVector& x, ParMultiVector& b, bool tap = false, 
+            data_t* comm_t = NULL);
+    void mult_T(ParMultiVector& x, ParMultiVector& b, bool tap = false, 
+            data_t* comm_t = NULL);
+    void residual(ParMultiVector& x, ParMultiVector& b, ParMultiVector& r,
+            bool tap = false, data_t* comm_t = NULL);
+
     ParCSRMatrix* mult(ParCSRMatrix* B, bool tap = false, data_t* comm_t = NULL);
     ParCSRMatrix* tap_mult(ParCSRMatrix* B, data_t* comm_t = NULL);
     ParCSRMatrix* mult_T(ParCSCMatrix* A, bool tap = false, data_t* comm_t = NULL);
     ParCSRMatrix* mult_T(ParCSRMatrix* A, bool tap = false, data_t* comm_t = NULL);
     ParCSRMatrix* tap_mult_T(ParCSCMatrix* A, data_t* comm_t = NULL);
     ParCSRMatrix* tap_mult_T(ParCSRMatrix* A, data_t* comm_t = NULL);
+    ParCSRMatrix* RAP(ParCSRMatrix* P, bool tap = false, data_t* comm_t = NULL,
+            bool keep_zeros = false);
+
+    // Forms P^T*A*P as RAP does (with standard communication), keeping
+    // structural zeros, and records its symbolic structure.  
+    // RAP_numeric then refills the values of C = RAP_symbolic(P) for
+    // new values of A and P, sending only values over the existing 
+    // communication packages.  The patterns of A and P, the order of
+    // entries in P, and the pattern of C (in any order) must be 
+    // unchanged.
+    ParCSRMatrix* RAP_symbolic(ParCSRMatrix* P, RAPStructure* structure,
+            data_t* comm_t = NULL);
+    void RAP_numeric(ParCSRMatrix* P, ParCSRMatrix* C, RAPStructure* structure,
+            data_t* comm_t = NULL);
     ParCSRMatrix* add(ParCSRMatrix* A);
     ParCSRMatrix* subtract(ParCSRMatrix* B);
 
@@ -569,15 +706,20 @@ namespace raptor
     void print_mult_T(const aligned_vector<int>& proc_distances,
                 const aligned_vector<int>& worst_proc_distances);
     
-    void mult_helper(ParCSRMatrix* B, ParCSRMatrix* C, CSRMatrix* recv);
-    CSRMatrix* mult_T_partial(ParCSCMatrix* A);
-    CSRMatrix* mult_T_partial(CSCMatrix* A_off);
+    void mult_helper(ParCSRMatrix* B, ParCSRMatrix* C, CSRMatrix* recv,
+            const aligned_vector<index_t>& recv_cols);
+    CSRMatrix* mult_T_partial(ParCSCMatrix* A, aligned_vector<index_t>& global_cols);
+    CSRMatrix* mult_T_partial(CSCMatrix* A_off, aligned_vector<index_t>& global_cols);
     void mult_T_combine(ParCSCMatrix* A, ParCSRMatrix* C, CSRMatrix* recv_on,
-            CSRMatrix* recv_off);
+            CSRMatrix* recv_off, const aligned_vector<index_t>& recv_off_cols);
     
     void add_block(int global_row_coarse, int global_col_coarse, aligned_vector<double>& data);
 
     ParMatrix* transpose();
+
+    aligned_vector<int> interior_rows;
+    aligned_vector<int> boundary_rows;
+    int boundary_rows_nnz = -1;
   };
 
   class ParCSCMatrix : public ParMatrix
@@ -671,13 +813,16 @@ namespace raptor
     // or blocks
     ParBSRMatrix() : ParMatrix()
     {
-        on_proc = new BSRMatrix(0, 0, 0, 0);
-        off_proc = new BSRMatrix(0, 0, 0, 0);
+        on_proc = new BSRMatrix(0, 0, 1, 1);
+        off_proc = new BSRMatrix(0, 0, 1, 1);
 
         local_nnz = 0;
         b_rows = 0;
         b_cols = 0;
         b_size = 0;
+
+        block_comm = NULL;
+        block_tap_comm = NULL;
     }
 
     // Creates an empty ParBSRMatrix of size glob_rows x glob_cols with blocks of
@@ -705,6 +850,9 @@ namespace raptor
         b_rows = _brows;
         b_cols = _bcols;
         b_size = b_rows * b_cols;
+
+        block_comm = NULL;
+        block_tap_comm = NULL;
     }
 
     // Creates a ParBSRMatrix based on a given partitioning
@@ -722,6 +870,9 @@ namespace raptor
         b_rows = _brows;
         b_cols = _bcols;
         b_size = b_rows * b_cols;
+
+        block_comm = NULL;
+        block_tap_comm = NULL;
     }
 
     // Creates a ParBSRMatrix based on a given partitioning and 
@@ -734,6 +885,8 @@ namespace raptor
         off_proc_num_cols = off_proc->n_cols;
         local_num_rows = on_proc->n_rows;
         local_nnz = on_proc->nnz + off_proc->nnz;
+        block_comm = NULL;
+        block_tap_comm = NULL;
         finalize(true, _on_proc->b_cols);
     }
 
@@ -759,6 +912,15 @@ namespace raptor
         b_rows = _brows;
         b_cols = _bcols;
         b_size = b_rows * b_cols;
+
+        block_comm = NULL;
+        block_tap_comm = NULL;
+    }
+
+    ~ParBSRMatrix()
+    {
+        delete block_comm;
+        delete block_tap_comm;
     }
 
     ParCOOMatrix* to_ParCOO();
@@ -766,7 +928,9 @@ namespace raptor
     ParCSCMatrix* to_ParCSC();
     ParBSRMatrix* copy()
     {
-        return NULL;
+        ParBSRMatrix* A = new ParBSRMatrix();
+        A->copy_helper(this);
+        return A;
     }
 
     void copy_helper(ParCSRMatrix* A);
@@ -781,16 +945,73 @@ namespace raptor
     void tap_mult(ParVector& x, ParVector& b, data_t* comm_t = NULL);
     void mult_T(ParVector& x, ParVector& b, bool tap = false, data_t* comm_t = NULL);
     void tap_mult_T(ParVector& x, ParVector& b, data_t* comm_t = NULL);
+
+    /**************************************************************
+    *****   ParBSRMatrix Block Communication
+    **************************************************************
+    ***** Returns the communication package over block rows and 
+    ***** block columns (block_comm, or block_tap_comm if tap), 
+    ***** forming it on first use.  Block rows of a ParBSRMatrix 
+    ***** are exchanged through this package with one global block
+    ***** column per block.
+    *****
+    ***** Parameters
+    ***** -------------
+    ***** tap : bool (optional)
+    *****    Return the node-aware package (default false)
+    **************************************************************/
+    CommPkg* get_block_comm(bool tap = false);
+
+    /**************************************************************
+    *****   ParBSRMatrix Block Norms
+    **************************************************************
+    ***** Returns the matrix of Frobenius norms of the blocks, with
+    ***** one row and column per block row and column (on the 
+    ***** block partition), and a ParComm.  Norms of off-diagonal 
+    ***** blocks are negated, so the sign-based strength of 
+    ***** connection treats every coupling between nodes as an 
+    ***** M-matrix entry.  Used as the node matrix when coarsening 
+    ***** block systems.
+    **************************************************************/
+    ParCSRMatrix* block_norms();
+
+    /**************************************************************
+    *****   ParBSRMatrix Block SpGEMM
+    **************************************************************
+    ***** mult returns this*B and mult_T returns A^T*this, keeping
+    ***** the product in BSR form (blocks of C are b_rows of the 
+    ***** left matrix by b_cols of the right).  Block rows needed 
+    ***** from other processes are exchanged through the block 
+    ***** comm package of the left matrix, one global block column
+    ***** per block.  RAP returns the Galerkin product P^T*A*P, 
+    ***** forming the block rows of A*P needed by each set of 
+    ***** block rows of P^T in turn (as ParCSRMatrix::RAP does), 
+    ***** so A*P is not stored.  Columns of on_proc must be the 
+    ***** local column range, and block boundaries must align with
+    ***** the partition.
+    **************************************************************/
     ParBSRMatrix* mult(ParBSRMatrix* B, bool tap = false, data_t* comm_t = NULL);
     ParBSRMatrix* tap_mult(ParBSRMatrix* B, data_t* comm_t = NULL);
     ParBSRMatrix* mult_T(ParBSRMatrix* A, bool tap = false, data_t* comm_t = NULL);
     ParBSRMatrix* tap_mult_T(ParBSRMatrix* A, data_t* comm_t = NULL);
+    ParBSRMatrix* RAP(ParBSRMatrix* P, bool tap = false, data_t* comm_t = NULL);
+    ParBSRMatrix* add(ParBSRMatrix* B);
+    ParBSRMatrix* subtract(ParBSRMatrix* B);
+
+    void mult_helper(ParBSRMatrix* B, ParBSRMatrix* C, CSRMatrix* recv,
+            const aligned_vector<index_t>& recv_cols);
+    BSRMatrix* mult_T_partial(ParBSRMatrix* A, aligned_vector<index_t>& global_cols);
+    void mult_T_combine(ParBSRMatrix* A, ParBSRMatrix* C, CSRMatrix* recv,
+            const aligned_vector<index_t>& recv_cols);
     
     ParMatrix* transpose();
 
     int b_rows; // rows in a block
     int b_cols; // columns in a block
     int b_size; // nnz per dense block
+
+    ParComm* block_comm; // communicates block rows
+    TAPComm* block_tap_comm;
   };
 
 }
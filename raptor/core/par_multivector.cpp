@@ -0,0 +1,150 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "par_multivector.hpp"
+
+using namespace raptor;
+
+/**************************************************************
+*****   ParMultiVector Set Constant Value
+**************************************************************
+***** Sets each value of each local vector to a constant
+**************************************************************/
+void ParMultiVector::set_const_value(data_t alpha)
+{
+    std::fill(values.begin(), values.end(), alpha);
+}
+
+/**************************************************************
+*****   ParMultiVector Set Random Values
+**************************************************************
+***** Sets each value of each local vector to a random value
+**************************************************************/
+void ParMultiVector::set_rand_values()
+{
+    for (int i = 0; i < (int) values.size(); i++)
+    {
+        values[i] = ((double)rand()) / RAND_MAX;
+    }
+}
+
+/**************************************************************
+*****   ParMultiVector AXPY
+**************************************************************
+***** Sums alpha * x into each vector of the block
+**************************************************************/
+void ParMultiVector::axpy(ParMultiVector& x, data_t alpha)
+{
+    int n = local_n * num_vectors;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+    {
+        values[i] += alpha * x.values[i];
+    }
+}
+
+/**************************************************************
+*****   ParMultiVector Scale
+**************************************************************
+***** Multiplies each value by alpha
+**************************************************************/
+void ParMultiVector::scale(data_t alpha)
+{
+    int n = local_n * num_vectors;
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+    {
+        values[i] *= alpha;
+    }
+}
+
+/**************************************************************
+*****   ParMultiVector Norms
+**************************************************************
+***** Calculates the 2-norm of each vector, with a single 
+***** MPI_Allreduce for the block
+*****
+***** Parameters
+***** -------------
+***** result : data_t*
+*****    Array of size num_vectors to hold the norms
+**************************************************************/
+void ParMultiVector::norms(data_t* result)
+{
+    inner_products(*this, result);
+    for (int v = 0; v < num_vectors; v++)
+    {
+        result[v] = sqrt(result[v]);
+    }
+}
+
+/**************************************************************
+*****   ParMultiVector Inner Products
+**************************************************************
+***** Calculates <v_k, x_k> for each vector k of the block, with
+***** a single MPI_Allreduce
+*****
+***** Parameters
+***** -------------
+***** x : ParMultiVector&
+*****    Block with the same dimensions
+***** result : data_t*
+*****    Array of size num_vectors to hold the inner products
+**************************************************************/
+void ParMultiVector::inner_products(ParMultiVector& x, data_t* result)
+{
+    if (local_n != x.local_n || num_vectors != x.num_vectors)
+    {
+        printf("Error.  Cannot perform inner product.  Dimensions do not match.\n");
+        exit(-1);
+    }
+
+    for (int v = 0; v < num_vectors; v++)
+    {
+        result[v] = 0.0;
+    }
+
+    for (int i = 0; i < local_n; i++)
+    {
+        int pos = i * num_vectors;
+        for (int v = 0; v < num_vectors; v++)
+        {
+            result[v] += values[pos + v] * x.values[pos + v];
+        }
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, result, num_vectors, MPI_DATA_T, MPI_SUM, 
+            MPI_COMM_WORLD);
+}
+
+/**************************************************************
+*****   ParMultiVector Get Vector
+**************************************************************
+***** Copies vector v of the block into x
+**************************************************************/
+void ParMultiVector::get_vector(int v, ParVector& x)
+{
+    if (x.local_n != local_n)
+    {
+        x.resize(global_n, local_n, first_local);
+    }
+
+    for (int i = 0; i < local_n; i++)
+    {
+        x[i] = values[i * num_vectors + v];
+    }
+}
+
+/**************************************************************
+*****   ParMultiVector Set Vector
+**************************************************************
+***** Copies x into vector v of the block
+**************************************************************/
+void ParMultiVector::set_vector(int v, ParVector& x)
+{
+    for (int i = 0; i < local_n; i++)
+    {
+        values[i * num_vectors + v] = x[i];
+    }
+}
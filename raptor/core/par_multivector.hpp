@@ -0,0 +1,132 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_CORE_PARMULTIVECTOR_HPP
+#define RAPTOR_CORE_PARMULTIVECTOR_HPP
+
+#include <mpi.h>
+#include <math.h>
+
+#include "types.hpp"
+#include "par_vector.hpp"
+
+/**************************************************************
+ *****   ParMultiVector Class
+ **************************************************************
+ ***** This class constructs a block of num_vectors parallel 
+ ***** vectors sharing a row distribution.  Local values are 
+ ***** stored row-major, so the num_vectors values of each row 
+ ***** are contiguous (values[row*num_vectors + v]).  This lets 
+ ***** SpMM stream the matrix once for all vectors, and halo 
+ ***** exchanges send all values of a row in a single message.
+ *****
+ ***** Attributes
+ ***** -------------
+ ***** values : aligned_vector<double>
+ *****    Interleaved local values
+ ***** global_n : index_t
+ *****    Number of rows in each global vector
+ ***** local_n : index_t
+ *****    Number of rows stored locally
+ ***** first_local : index_t
+ *****    Position of local rows inside the global vectors
+ ***** num_vectors : int
+ *****    Number of vectors in the block
+ ***** 
+ ***** Methods
+ ***** -------
+ ***** set_const_value(data_t alpha)
+ *****    Sets every value to a constant
+ ***** set_rand_values()
+ *****    Sets every value to a random value
+ ***** axpy(ParMultiVector& x, data_t alpha)
+ *****    Performs axpy on each vector
+ ***** scale(data_t alpha)
+ *****    Multiplies every value by a constant
+ ***** norms(data_t* result)
+ *****    Calculates the 2-norm of each vector (one reduction)
+ ***** inner_products(ParMultiVector& x, data_t* result)
+ *****    Calculates the inner product of each pair of vectors
+ ***** get_vector(int v, ParVector& x) / set_vector(int v, ParVector& x)
+ *****    Copies vector v out of / into the block
+ **************************************************************/
+namespace raptor
+{
+    class ParMultiVector
+    {
+    public:
+        /**************************************************************
+        *****   ParMultiVector Class Constructor
+        **************************************************************
+        ***** Sets the dimensions of the block and initializes the
+        ***** local values
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** glbl_n : index_t
+        *****    Number of rows in each global vector
+        ***** lcl_n : index_t
+        *****    Number of rows stored locally
+        ***** first_lcl : index_t
+        *****    Position of local rows inside global vectors
+        ***** n_vecs : int
+        *****    Number of vectors in the block
+        **************************************************************/
+        ParMultiVector(index_t glbl_n, int lcl_n, index_t first_lcl, int n_vecs)
+        {
+            resize(glbl_n, lcl_n, first_lcl, n_vecs);
+        }
+
+        ParMultiVector()
+        {
+            global_n = 0;
+            local_n = 0;
+            first_local = 0;
+            num_vectors = 0;
+        }
+
+        void resize(index_t glbl_n, int lcl_n, index_t first_lcl, int n_vecs)
+        {
+            global_n = glbl_n;
+            local_n = lcl_n;
+            first_local = first_lcl;
+            num_vectors = n_vecs;
+            values.resize(local_n * num_vectors);
+        }
+
+        void copy(const ParMultiVector& x)
+        {
+            global_n = x.global_n;
+            local_n = x.local_n;
+            first_local = x.first_local;
+            num_vectors = x.num_vectors;
+            values = x.values;
+        }
+
+        void set_const_value(data_t alpha);
+        void set_rand_values();
+        void axpy(ParMultiVector& x, data_t alpha);
+        void scale(data_t alpha);
+        void norms(data_t* result);
+        void inner_products(ParMultiVector& x, data_t* result);
+        void get_vector(int v, ParVector& x);
+        void set_vector(int v, ParVector& x);
+
+        data_t& operator()(const int row, const int v)
+        {
+            return values[row * num_vectors + v];
+        }
+
+        const data_t& operator()(const int row, const int v) const
+        {
+            return values[row * num_vectors + v];
+        }
+
+        aligned_vector<double> values;
+        index_t global_n;
+        int local_n;
+        index_t first_local;
+        int num_vectors;
+    };
+
+}
+#endif
@@ -121,3 +121,129 @@ data_t ParVector::inner_product(ParVector& x)
 }
 
 
+/**************************************************************
+*****   ParVector Local Inner Products
+**************************************************************
+***** Calculates the local portions of <v, x_k> for each x_k,
+***** reading each local value of v once
+**************************************************************/
+void ParVector::local_inner_products(aligned_vector<ParVector*>& x, data_t* inner)
+{
+    int n = x.size();
+    aligned_vector<data_t*> x_vals(n);
+
+    for (int k = 0; k < n; k++)
+    {
+        if (local_n != x[k]->local_n)
+        {
+            printf("Error.  Cannot perform inner product.  Dimensions do not match.\n");
+            exit(-1);
+        }
+        x_vals[k] = x[k]->local.values.data();
+        inner[k] = 0.0;
+    }
+
+    if (local_n == 0 || n == 0) return;
+
+    data_t* vals = local.values.data();
+    int num_threads = get_num_threads();
+    if (num_threads > local_n) num_threads = local_n;
+
+    // Each thread sums a contiguous block of rows into its own partial 
+    // sums, which are added in thread order (so the result does not 
+    // depend on thread timing)
+    aligned_vector<data_t> thread_sums(num_threads * n, 0.0);
+
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+    for (int t = 0; t < num_threads; t++)
+    {
+        data_t* sums = &(thread_sums[t * n]);
+        int first = ((long) local_n * t) / num_threads;
+        int last = ((long) local_n * (t + 1)) / num_threads;
+        for (int i = first; i < last; i++)
+        {
+            data_t val = vals[i];
+            for (int k = 0; k < n; k++)
+            {
+                sums[k] += val * x_vals[k][i];
+            }
+        }
+    }
+
+    for (int t = 0; t < num_threads; t++)
+    {
+        for (int k = 0; k < n; k++)
+        {
+            inner[k] += thread_sums[t * n + k];
+        }
+    }
+}
+
+/**************************************************************
+*****   ParVector Inner Products
+**************************************************************
+***** Calculates <v, x_k> for each x_k with a single (optionally
+***** non-blocking) reduction
+**************************************************************/
+void ParVector::inner_products(aligned_vector<ParVector*>& x, data_t* inner,
+        MPI_Request* request)
+{
+    int n = x.size();
+
+    local_inner_products(x, inner);
+
+    if (request)
+    {
+        MPI_Iallreduce(MPI_IN_PLACE, inner, n, MPI_DATA_T, MPI_SUM,
+                MPI_COMM_WORLD, request);
+    }
+    else
+    {
+        MPI_Allreduce(MPI_IN_PLACE, inner, n, MPI_DATA_T, MPI_SUM, 
+                MPI_COMM_WORLD);
+    }
+}
+
+/**************************************************************
+*****   ParVector AYPX
+**************************************************************
+***** Sets v = x + alpha*v
+**************************************************************/
+void ParVector::aypx(ParVector& x, data_t alpha)
+{
+    data_t* vals = local.values.data();
+    data_t* x_vals = x.local.values.data();
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < local_n; i++)
+    {
+        vals[i] = x_vals[i] + alpha * vals[i];
+    }
+}
+
+/**************************************************************
+*****   ParVector AXPY Residual
+**************************************************************
+***** Performs v += alpha*p and r -= alpha*Ap, returning <r, r>
+**************************************************************/
+data_t ParVector::axpy_residual(ParVector& p, ParVector& r, ParVector& Ap, 
+        data_t alpha)
+{
+    data_t rr = 0.0;
+    data_t* vals = local.values.data();
+    data_t* p_vals = p.local.values.data();
+    data_t* r_vals = r.local.values.data();
+    data_t* Ap_vals = Ap.local.values.data();
+
+#pragma omp parallel for reduction(+:rr) schedule(static)
+    for (int i = 0; i < local_n; i++)
+    {
+        vals[i] += alpha * p_vals[i];
+        r_vals[i] -= alpha * Ap_vals[i];
+        rr += r_vals[i] * r_vals[i];
+    }
+
+    MPI_Allreduce(MPI_IN_PLACE, &rr, 1, MPI_DATA_T, MPI_SUM, MPI_COMM_WORLD);
+
+    return rr;
+}
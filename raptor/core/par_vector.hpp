@@ -40,6 +40,12 @@
  *****    Multiplies entries of the local vector by a constant
  ***** norm(index_t p)
  *****    Calculates the p-norm of the global vector
+ ***** inner_products(aligned_vector<ParVector*>& x, data_t* inner)
+ *****    Calculates several inner products in a single reduction
+ ***** aypx(ParVector& x, data_t alpha)
+ *****    Sets vector to x + alpha * vector in one pass
+ ***** axpy_residual(ParVector& p, ParVector& r, ParVector& Ap, data_t alpha)
+ *****    Updates vector and residual in one pass, returning <r, r>
  **************************************************************/
 namespace raptor
 {
@@ -166,6 +172,70 @@ namespace raptor
 
         data_t inner_product(ParVector& x);        
 
+        /**************************************************************
+        *****   ParVector Inner Products
+        **************************************************************
+        ***** Calculates <v, x_k> for each vector x_k in a single pass 
+        ***** over the local values, and sums all of them with a single
+        ***** MPI_Allreduce.  If request is not NULL, the reduction is
+        ***** started with MPI_Iallreduce, and inner holds the results
+        ***** once request completes.
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** x : aligned_vector<ParVector*>&
+        *****    Vectors to take inner products with
+        ***** inner : data_t*
+        *****    Array of size x.size() to hold the inner products
+        ***** request : MPI_Request* (optional)
+        *****    Request for a non-blocking reduction
+        **************************************************************/
+        void inner_products(aligned_vector<ParVector*>& x, data_t* inner,
+                MPI_Request* request = NULL);
+
+        /**************************************************************
+        *****   ParVector Local Inner Products
+        **************************************************************
+        ***** Calculates the local portions of <v, x_k> without 
+        ***** reducing them, so they can be combined with other 
+        ***** values in one reduction
+        **************************************************************/
+        void local_inner_products(aligned_vector<ParVector*>& x, data_t* inner);
+
+        /**************************************************************
+        *****   ParVector AYPX
+        **************************************************************
+        ***** Sets v = x + alpha*v in one pass (e.g. p = r + beta*p)
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** x : ParVector&
+        *****    Vector to be summed with
+        ***** alpha : data_t
+        *****    Constant value to multiply each element of vector by
+        **************************************************************/
+        void aypx(ParVector& x, data_t alpha);
+
+        /**************************************************************
+        *****   ParVector AXPY Residual
+        **************************************************************
+        ***** Performs v += alpha*p and r -= alpha*Ap in one pass, 
+        ***** returning the global inner product <r, r> of the 
+        ***** updated residual
+        *****
+        ***** Parameters
+        ***** -------------
+        ***** p : ParVector&
+        *****    Search direction
+        ***** r : ParVector&
+        *****    Residual to be updated
+        ***** Ap : ParVector&
+        *****    Product of the matrix with p
+        ***** alpha : data_t
+        *****    Step length
+        **************************************************************/
+        data_t axpy_residual(ParVector& p, ParVector& r, ParVector& Ap, data_t alpha);
+
         const data_t& operator[](const int index) const
         {
             return local.values[index];
@@ -177,9 +247,9 @@ namespace raptor
         }
 
         Vector local;
-        int global_n;
+        index_t global_n;
         int local_n;
-        int first_local;
+        index_t first_local;
     };
 
 }
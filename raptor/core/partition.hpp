@@ -40,7 +40,7 @@ namespace raptor
             Topology* _topology = NULL)
     {
         int rank, num_procs;
-        int avg_num;
+        index_t avg_num;
         int extra;
 
         MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -112,7 +112,7 @@ namespace raptor
             index_t _brows, index_t _bcols, Topology* _topology = NULL)
     {
         int rank, num_procs;
-        int avg_num_blocks, global_num_row_blocks, global_num_col_blocks;
+        index_t avg_num_blocks, global_num_row_blocks, global_num_col_blocks;
         int extra;
 
         MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -290,10 +290,10 @@ namespace raptor
         MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
         
         int proc, num_procs_extra;
-        int ctr, tmp;
-        int recvbuf;
+        int ctr;
+        index_t tmp, recvbuf;
         MPI_Status status;
-        aligned_vector<int> send_buffer;
+        aligned_vector<index_t> send_buffer;
         aligned_vector<MPI_Request> send_requests;
 
         assumed_num_cols = global_num_cols / num_procs;
@@ -316,7 +316,7 @@ namespace raptor
             for (int i = rank + 1; i <= proc; i++)
             {
                 send_buffer[ctr] = first_local_col;
-                MPI_Isend(&(send_buffer[ctr]), 1, MPI_INT, i, 2345, 
+                MPI_Isend(&(send_buffer[ctr]), 1, MPI_INDEX_T, i, 2345, 
                         MPI_COMM_WORLD, &(send_requests[ctr]));
                 ctr++;
             }
@@ -326,7 +326,7 @@ namespace raptor
         assumed_col_ptr.push_back(tmp);
         while (assumed_first_col < tmp)
         {
-            MPI_Recv(&recvbuf, 1, MPI_INT, proc, 2345, MPI_COMM_WORLD, &status);
+            MPI_Recv(&recvbuf, 1, MPI_INDEX_T, proc, 2345, MPI_COMM_WORLD, &status);
             tmp = recvbuf;
             assumed_col_ptr.push_back(tmp);
             proc--;
@@ -356,7 +356,7 @@ namespace raptor
             for (int i = proc; i < rank; i++)
             {
                 send_buffer[ctr] = last_local_col + 1;
-                MPI_Isend(&(send_buffer[ctr]), 1, MPI_INT, i, 2345,
+                MPI_Isend(&(send_buffer[ctr]), 1, MPI_INDEX_T, i, 2345,
                         MPI_COMM_WORLD, &(send_requests[ctr]));
                 ctr++;
             }
@@ -367,7 +367,7 @@ namespace raptor
         assumed_col_procs.push_back(proc);
         while (assumed_last_col > tmp && proc < num_procs)
         {
-            MPI_Recv(&recvbuf, 1, MPI_INT, proc, 2345, MPI_COMM_WORLD, &status);
+            MPI_Recv(&recvbuf, 1, MPI_INDEX_T, proc, 2345, MPI_COMM_WORLD, &status);
             tmp = recvbuf;
             assumed_col_ptr.push_back(recvbuf);
             assumed_col_procs.push_back(++proc);
@@ -378,7 +378,7 @@ namespace raptor
         }
     }
 
-    void form_col_to_proc (const aligned_vector<int>& off_proc_column_map,
+    void form_col_to_proc (const aligned_vector<index_t>& off_proc_column_map,
             aligned_vector<int>& off_proc_col_to_proc) const
     {
         int rank;
@@ -389,7 +389,8 @@ namespace raptor
         int prev_proc;
         int num_sends = 0;
         int proc, start, end;
-        int col, count;
+        index_t col;
+        int count;
         int finished, msg_avail;
 
         aligned_vector<int> send_procs;
@@ -445,7 +446,7 @@ namespace raptor
                 }
                 else
                 {
-                    MPI_Issend(&(off_proc_column_map[start]), end - start, MPI_INT,
+                    MPI_Issend(&(off_proc_column_map[start]), end - start, MPI_INDEX_T,
                             proc, 9753, MPI_COMM_WORLD, &(send_requests[i]));
                 }
             }
@@ -459,10 +460,10 @@ namespace raptor
                 MPI_Iprobe(MPI_ANY_SOURCE, 9753, MPI_COMM_WORLD, &msg_avail, &status);
                 if (msg_avail)
                 {
-                    MPI_Get_count(&status, MPI_INT, &count);
+                    MPI_Get_count(&status, MPI_INDEX_T, &count);
                     proc = status.MPI_SOURCE;
-                    int recvbuf[count];
-                    MPI_Recv(recvbuf, count, MPI_INT, proc, 9753, 
+                    aligned_vector<index_t> recvbuf(count);
+                    MPI_Recv(recvbuf.data(), count, MPI_INDEX_T, proc, 9753, 
                             MPI_COMM_WORLD, &status);
                     sendbuf_procs.push_back(proc);
                     sendbuf_starts.push_back(sendbuf.size());
@@ -489,10 +490,10 @@ namespace raptor
             MPI_Iprobe(MPI_ANY_SOURCE, 9753, MPI_COMM_WORLD, &msg_avail, &status);
             if (msg_avail)
             {
-                MPI_Get_count(&status, MPI_INT, &count);
+                MPI_Get_count(&status, MPI_INDEX_T, &count);
                 proc = status.MPI_SOURCE;
-                int recvbuf[count];
-                MPI_Recv(recvbuf, count, MPI_INT, proc, 9753, 
+                aligned_vector<index_t> recvbuf(count);
+                MPI_Recv(recvbuf.data(), count, MPI_INDEX_T, proc, 9753, 
                         MPI_COMM_WORLD, &status);
                 sendbuf_procs.push_back(proc);
                 sendbuf_starts.push_back(sendbuf.size());
@@ -550,8 +551,8 @@ namespace raptor
 
     index_t assumed_first_col;
     index_t assumed_last_col;
-    int assumed_num_cols;
-    aligned_vector<int> assumed_col_ptr;
+    index_t assumed_num_cols;
+    aligned_vector<index_t> assumed_col_ptr;
     aligned_vector<int> assumed_col_procs;
 
     Topology* topology;
@@ -0,0 +1,402 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "core/matrix.hpp"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace raptor;
+
+/**************************************************************
+*****   SELL Chunk Sums
+**************************************************************
+***** Sums val * x[col] over the len (padded) columns of a
+***** chunk, one lane per row, returning the chunk_size sums.
+***** The AVX-512 kernel handles all 8 lanes in one register,
+***** and the AVX2 kernel in two.
+**************************************************************/
+static inline void chunk_sums(const double* v, const int* col, int len,
+        const double* x, double* sum)
+{
+    const int C = SELLMatrix::chunk_size;
+
+#if defined(__AVX512F__)
+    __m512d s = _mm512_setzero_pd();
+    for (int j = 0; j < len; j++)
+    {
+        __m256i c = _mm256_loadu_si256((const __m256i*) &(col[j*C]));
+        __m512d x_lanes = _mm512_i32gather_pd(c, x, 8);
+        s = _mm512_fmadd_pd(_mm512_loadu_pd(&(v[j*C])), x_lanes, s);
+    }
+    _mm512_storeu_pd(sum, s);
+#elif defined(__AVX2__)
+    __m256d s0 = _mm256_setzero_pd();
+    __m256d s1 = _mm256_setzero_pd();
+    for (int j = 0; j < len; j++)
+    {
+        __m128i c0 = _mm_loadu_si128((const __m128i*) &(col[j*C]));
+        __m128i c1 = _mm_loadu_si128((const __m128i*) &(col[j*C + 4]));
+        __m256d x0 = _mm256_i32gather_pd(x, c0, 8);
+        __m256d x1 = _mm256_i32gather_pd(x, c1, 8);
+#ifdef __FMA__
+        s0 = _mm256_fmadd_pd(_mm256_loadu_pd(&(v[j*C])), x0, s0);
+        s1 = _mm256_fmadd_pd(_mm256_loadu_pd(&(v[j*C + 4])), x1, s1);
+#else
+        s0 = _mm256_add_pd(s0, _mm256_mul_pd(_mm256_loadu_pd(&(v[j*C])), x0));
+        s1 = _mm256_add_pd(s1, _mm256_mul_pd(_mm256_loadu_pd(&(v[j*C + 4])), x1));
+#endif
+    }
+    _mm256_storeu_pd(sum, s0);
+    _mm256_storeu_pd(sum + 4, s1);
+#else
+    for (int r = 0; r < C; r++)
+    {
+        sum[r] = 0.0;
+    }
+    for (int j = 0; j < len; j++)
+    {
+        const double* v_col = &(v[j*C]);
+        const int* c_col = &(col[j*C]);
+        for (int r = 0; r < C; r++)
+        {
+            sum[r] += v_col[r] * x[c_col[r]];
+        }
+    }
+#endif
+}
+
+/**************************************************************
+*****   SELLMatrix Copy From CSR
+**************************************************************
+***** Sorts rows by decreasing length within each window of
+***** sigma rows, groups them into chunks of chunk_size rows,
+***** and stores each chunk column-major, padded with zeros
+***** (in the last column of the row, to keep gathers local).
+**************************************************************/
+void SELLMatrix::copy_helper(const CSRMatrix* A)
+{
+    const int C = chunk_size;
+
+    n_rows = A->n_rows;
+    n_cols = A->n_cols;
+    nnz = A->nnz;
+    n_chunks = (n_rows + C - 1) / C;
+
+    // Sort rows within each sigma window by decreasing length
+    row_perm.resize(n_chunks * C);
+    row_len.resize(n_chunks * C);
+    for (int i = 0; i < n_rows; i++)
+    {
+        row_perm[i] = i;
+    }
+    for (int i = n_rows; i < n_chunks * C; i++)
+    {
+        row_perm[i] = -1;
+    }
+    for (int start = 0; start < n_rows; start += sigma)
+    {
+        int end = start + sigma;
+        if (end > n_rows) end = n_rows;
+        std::stable_sort(row_perm.begin() + start, row_perm.begin() + end,
+                [&](const int i, const int j)
+                {
+                    return A->idx1[i+1] - A->idx1[i] > A->idx1[j+1] - A->idx1[j];
+                });
+    }
+
+    // Chunk widths and offsets
+    chunk_len.resize(n_chunks);
+    idx1.resize(n_chunks + 1);
+    idx1[0] = 0;
+    for (int c = 0; c < n_chunks; c++)
+    {
+        int len = 0;
+        for (int r = 0; r < C; r++)
+        {
+            int row = row_perm[c*C + r];
+            row_len[c*C + r] = 0;
+            if (row >= 0)
+            {
+                row_len[c*C + r] = A->idx1[row+1] - A->idx1[row];
+            }
+            if (row_len[c*C + r] > len) len = row_len[c*C + r];
+        }
+        chunk_len[c] = len;
+        idx1[c+1] = idx1[c] + len * C;
+    }
+
+    idx2.resize(idx1[n_chunks]);
+    vals.resize(idx1[n_chunks]);
+    for (int c = 0; c < n_chunks; c++)
+    {
+        int chunk_start = idx1[c];
+        for (int r = 0; r < C; r++)
+        {
+            int row = row_perm[c*C + r];
+            int len = row_len[c*C + r];
+            int pad_col = 0;
+            if (len)
+            {
+                int row_start = A->idx1[row];
+                for (int j = 0; j < len; j++)
+                {
+                    idx2[chunk_start + j*C + r] = A->idx2[row_start + j];
+                    if (A->single_precision())
+                    {
+                        vals[chunk_start + j*C + r] = A->sp_vals[row_start + j];
+                    }
+                    else
+                    {
+                        vals[chunk_start + j*C + r] = A->vals[row_start + j];
+                    }
+                }
+                pad_col = A->idx2[row_start + len - 1];
+            }
+            for (int j = len; j < chunk_len[c]; j++)
+            {
+                idx2[chunk_start + j*C + r] = pad_col;
+                vals[chunk_start + j*C + r] = 0.0;
+            }
+        }
+    }
+
+    sorted = true;
+    diag_first = A->diag_first;
+}
+
+void SELLMatrix::copy_helper(const SELLMatrix* A)
+{
+    n_rows = A->n_rows;
+    n_cols = A->n_cols;
+    nnz = A->nnz;
+    sigma = A->sigma;
+    n_chunks = A->n_chunks;
+
+    idx1 = A->idx1;
+    idx2 = A->idx2;
+    vals = A->vals;
+    chunk_len = A->chunk_len;
+    row_perm = A->row_perm;
+    row_len = A->row_len;
+
+    sorted = A->sorted;
+    diag_first = A->diag_first;
+}
+
+void SELLMatrix::copy_helper(const COOMatrix* A)
+{
+    CSRMatrix A_csr;
+    A_csr.copy_helper(A);
+    copy_helper(&A_csr);
+}
+
+void SELLMatrix::copy_helper(const CSCMatrix* A)
+{
+    CSRMatrix A_csr;
+    A_csr.copy_helper(A);
+    copy_helper(&A_csr);
+}
+
+void SELLMatrix::copy_helper(const BSRMatrix* A)
+{
+    CSRMatrix A_csr;
+    A_csr.copy_helper(A);
+    copy_helper(&A_csr);
+}
+
+CSRMatrix* SELLMatrix::to_CSR()
+{
+    const int C = chunk_size;
+
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols, nnz);
+    A->idx1[0] = 0;
+    for (int pos = 0; pos < n_chunks * C; pos++)
+    {
+        if (row_perm[pos] >= 0)
+        {
+            A->idx1[row_perm[pos] + 1] = row_len[pos];
+        }
+    }
+    for (int i = 0; i < n_rows; i++)
+    {
+        A->idx1[i+1] += A->idx1[i];
+    }
+
+    A->idx2.resize(nnz);
+    A->vals.resize(nnz);
+    for (int c = 0; c < n_chunks; c++)
+    {
+        int chunk_start = idx1[c];
+        for (int r = 0; r < C; r++)
+        {
+            int row = row_perm[c*C + r];
+            if (row < 0) continue;
+            int row_start = A->idx1[row];
+            for (int j = 0; j < row_len[c*C + r]; j++)
+            {
+                A->idx2[row_start + j] = idx2[chunk_start + j*C + r];
+                A->vals[row_start + j] = vals[chunk_start + j*C + r];
+            }
+        }
+    }
+    A->nnz = nnz;
+    A->sorted = sorted;
+    A->diag_first = diag_first;
+
+    return A;
+}
+
+COOMatrix* SELLMatrix::to_COO()
+{
+    CSRMatrix* A_csr = to_CSR();
+    COOMatrix* A = A_csr->to_COO();
+    delete A_csr;
+    return A;
+}
+
+CSCMatrix* SELLMatrix::to_CSC()
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSCMatrix* A = A_csr->to_CSC();
+    delete A_csr;
+    return A;
+}
+
+Matrix* SELLMatrix::transpose()
+{
+    CSRMatrix* A_csr = to_CSR();
+    Matrix* AT = A_csr->transpose();
+    delete A_csr;
+    return AT;
+}
+
+CSRMatrix* SELLMatrix::spgemm(const CSRMatrix* B)
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSRMatrix* C = A_csr->spgemm(B);
+    delete A_csr;
+    return C;
+}
+
+CSRMatrix* SELLMatrix::spgemm_T(const CSCMatrix* A)
+{
+    CSRMatrix* A_csr = to_CSR();
+    CSRMatrix* C = A_csr->spgemm_T(A);
+    delete A_csr;
+    return C;
+}
+
+void SELLMatrix::print()
+{
+    CSRMatrix* A_csr = to_CSR();
+    A_csr->print();
+    delete A_csr;
+}
+
+void SELLMatrix::add_value(int row, int col, double value)
+{
+    printf("Not implemented.\n");
+}
+
+void SELLMatrix::add_block(int row, int col, aligned_vector<double>& values)
+{
+    printf("Not implemented.\n");
+}
+
+/**************************************************************
+*****   SELLMatrix Products
+**************************************************************
+***** Each chunk is independent, so chunks are split across
+***** threads.  Chunk sums are scattered to rows with row_perm.
+**************************************************************/
+void SELLMatrix::mult_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+{
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+    for (int c = 0; c < n_chunks; c++)
+    {
+        double sum[chunk_size];
+        const int* rows = &(row_perm[c*chunk_size]);
+        chunk_sums(vals.data() + idx1[c], idx2.data() + idx1[c], chunk_len[c],
+                x.data(), sum);
+        for (int r = 0; r < chunk_size; r++)
+        {
+            if (rows[r] >= 0) b[rows[r]] = sum[r];
+        }
+    }
+}
+
+void SELLMatrix::mult_append_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+{
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+    for (int c = 0; c < n_chunks; c++)
+    {
+        double sum[chunk_size];
+        const int* rows = &(row_perm[c*chunk_size]);
+        chunk_sums(vals.data() + idx1[c], idx2.data() + idx1[c], chunk_len[c],
+                x.data(), sum);
+        for (int r = 0; r < chunk_size; r++)
+        {
+            if (rows[r] >= 0) b[rows[r]] += sum[r];
+        }
+    }
+}
+
+void SELLMatrix::mult_append_neg_helper(aligned_vector<double>& x, aligned_vector<double>& b)
+{
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+    for (int c = 0; c < n_chunks; c++)
+    {
+        double sum[chunk_size];
+        const int* rows = &(row_perm[c*chunk_size]);
+        chunk_sums(vals.data() + idx1[c], idx2.data() + idx1[c], chunk_len[c],
+                x.data(), sum);
+        for (int r = 0; r < chunk_size; r++)
+        {
+            if (rows[r] >= 0) b[rows[r]] -= sum[r];
+        }
+    }
+}
+
+void SELLMatrix::residual_helper(const aligned_vector<double>& x,
+        const aligned_vector<double>& b, aligned_vector<double>& r)
+{
+#pragma omp parallel for num_threads(get_num_threads()) schedule(static)
+    for (int c = 0; c < n_chunks; c++)
+    {
+        double sum[chunk_size];
+        const int* rows = &(row_perm[c*chunk_size]);
+        chunk_sums(vals.data() + idx1[c], idx2.data() + idx1[c], chunk_len[c],
+                x.data(), sum);
+        for (int lane = 0; lane < chunk_size; lane++)
+        {
+            int row = rows[lane];
+            if (row >= 0) r[row] = b[row] - sum[lane];
+        }
+    }
+}
+
+// b += alpha * A^T x.  Lanes of a chunk may share columns, so
+// this is a serial scatter (padding adds zeros).
+void SELLMatrix::mult_append_T_kernel(const aligned_vector<double>& x,
+        aligned_vector<double>& b, double alpha)
+{
+    const int C = chunk_size;
+
+    for (int c = 0; c < n_chunks; c++)
+    {
+        int chunk_start = idx1[c];
+        for (int r = 0; r < C; r++)
+        {
+            int row = row_perm[c*C + r];
+            if (row < 0) continue;
+            double x_val = alpha * x[row];
+            for (int j = 0; j < row_len[c*C + r]; j++)
+            {
+                int k = chunk_start + j*C + r;
+                b[idx2[k]] += vals[k] * x_val;
+            }
+        }
+    }
+}
@@ -46,7 +46,7 @@ void TAPComm::split_off_proc_cols(const aligned_vector<int>& off_proc_column_map
     int rank, rank_node, num_procs;
     int proc;
     int node;
-    int global_col;
+    int global_col; // int columns, see TAPComm::int_column_map
     int off_proc_num_cols = off_proc_column_map.size();
 
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -1014,11 +1014,13 @@ void TAPComm::form_simple_R_par_comm(aligned_vector<int>& off_node_column_map,
     aligned_vector<int> local_proc_sizes(topology->PPN, 0);
     aligned_vector<int> proc_size_idx(topology->PPN);
 
-    // Form local_R_par_comm recv_data (currently with global recv indices)
+    // Form local_R_par_comm recv_data (currently with global recv indices).
+    // Nodes may differ in size, so local procs are wrapped by the
+    // number of procs on rank's node.
     for (aligned_vector<int>::iterator it = off_node_col_to_proc.begin();
             it != off_node_col_to_proc.end(); ++it)
     {
-        local_proc = topology->get_local_proc(*it);
+        local_proc = topology->get_local_proc(*it) % topology->PPN;
         local_proc_sizes[local_proc]++;
     }
 
@@ -1046,7 +1048,7 @@ void TAPComm::form_simple_R_par_comm(aligned_vector<int>& off_node_column_map,
     for (int i = 0; i < off_node_num_cols; i++)
     {
         proc = off_node_col_to_proc[i];
-        local_proc = topology->get_local_proc(proc);
+        local_proc = topology->get_local_proc(proc) % topology->PPN;
         proc_idx = proc_size_idx[local_proc];
         idx = local_R_par_comm->recv_data->indptr[proc_idx] + local_proc_sizes[local_proc]++;
         local_R_par_comm->recv_data->indices[idx] = i;
@@ -5,6 +5,8 @@
 #include "core/types.hpp"
 #include "core/matrix.hpp"
 #include "core/vector.hpp"
+#include "gallery/stencil.hpp"
+#include "gallery/laplacian27pt.hpp"
 using namespace raptor;
 
 
@@ -63,3 +65,78 @@ TEST(BSRMatrixTest, TestsInCore)
 
 } // end of TEST(MatrixTest, TestsInCore) //
 
+
+TEST(BSRMatrixTest, TestBlockKernels)
+{
+    // 420 rows, divisible by every block size tested
+    int grid[3] = {6, 10, 7};
+    double* stencil = laplace_stencil_27pt();
+    CSRMatrix* A = stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    Vector x(A->n_rows);
+    Vector b(A->n_rows);
+    Vector r(A->n_rows);
+    Vector r_bsr(A->n_rows);
+    Vector tmp(A->n_rows);
+    for (int i = 0; i < A->n_rows; i++)
+    {
+        x[i] = 1.0 / (i + 1);
+        b[i] = (double) (i % 7);
+    }
+
+    // Sizes 2-6 use fixed size kernels, 1 and 7 the generic kernels
+    for (int block_size = 1; block_size <= 7; block_size++)
+    {
+        BSRMatrix* A_bsr = new BSRMatrix(A, block_size, block_size);
+
+        A->mult(x, r);
+        A_bsr->mult(x, r_bsr);
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            ASSERT_NEAR(r[i], r_bsr[i], 1e-12);
+        }
+
+        A->mult_T(x, r);
+        A_bsr->mult_T(x, r_bsr);
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            ASSERT_NEAR(r[i], r_bsr[i], 1e-12);
+        }
+
+        A->residual(x, b, r);
+        A_bsr->residual(x, b, r_bsr);
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            ASSERT_NEAR(r[i], r_bsr[i], 1e-12);
+        }
+
+        // With only diagonal blocks, one sweep from zero solves D x = b
+        BSRMatrix* D = new BSRMatrix(A->n_rows, A->n_cols, block_size, block_size);
+        for (int i = 0; i < A->n_rows / block_size; i++)
+        {
+            for (int j = A_bsr->idx1[i]; j < A_bsr->idx1[i+1]; j++)
+            {
+                if (A_bsr->idx2[j] != i) continue;
+                aligned_vector<double> block(A_bsr->vals.begin() + j*A_bsr->b_size,
+                        A_bsr->vals.begin() + (j+1)*A_bsr->b_size);
+                D->add_block(i, i, block);
+            }
+        }
+        aligned_vector<double> inv_diag;
+        D->form_inv_diag_blocks(inv_diag);
+        Vector x_d(A->n_rows);
+        x_d.set_const_value(0.0);
+        D->block_jacobi(x_d, b, tmp, inv_diag);
+        D->mult(x_d, r_bsr);
+        for (int i = 0; i < A->n_rows; i++)
+        {
+            ASSERT_NEAR(r_bsr[i], b[i], 1e-10);
+        }
+
+        delete D;
+        delete A_bsr;
+    }
+
+    delete A;
+} // end of TEST(BSRMatrixTest, TestBlockKernels) //
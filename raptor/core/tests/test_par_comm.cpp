@@ -59,7 +59,8 @@ TEST(ParCommTest, TestsInCore)
     }
 
     seq_row.resize(A_seq->n_cols);
-    CSRMatrix* recv_mat = A->comm->communicate(A);
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = A->comm->communicate(A, recv_cols);
     for (int i = 0; i < A->off_proc_num_cols; i++)
     {
         global_row = A->off_proc_column_map[i];
@@ -74,7 +75,7 @@ TEST(ParCommTest, TestsInCore)
         end = recv_mat->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            global_col = recv_mat->idx2[j];
+            global_col = recv_cols[j];
             val = recv_mat->vals[j];
             ASSERT_NEAR(seq_row[global_col], val, 1e-06);
         }
@@ -84,3 +85,86 @@ TEST(ParCommTest, TestsInCore)
     delete recv_mat;
 
 } // end of TEST(ParCommTest, TestsInCore) //
+
+TEST(ParCommTest, TestCommModes)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    double eps = 0.001;
+    double theta = M_PI / 8.0;
+    int grid[2] = {25, 25};
+    double* stencil = diffusion_stencil_2d(eps, theta);
+    comm_mode_t modes[3] = {PersistentComm, NeighborComm, SharedComm};
+
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+    A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
+            A->on_proc_column_map);
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b_std(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    aligned_vector<int> int_vals(A->local_num_rows);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        int_vals[i] = A->local_row_map[i];
+    }
+
+    x.set_rand_values();
+    aligned_vector<double> std_recv = A->comm->communicate(x);
+    A->mult(x, b_std);
+
+    for (int m = 0; m < 3; m++)
+    {
+        A->comm->set_comm_mode(modes[m]);
+        A->tap_comm->set_comm_mode(modes[m]);
+
+        // Repeat to check that fixed requests are restarted correctly
+        for (int iter = 0; iter < 2; iter++)
+        {
+            aligned_vector<double>& recv = A->comm->communicate(x);
+            ASSERT_EQ(recv.size(), std_recv.size());
+            for (int i = 0; i < A->off_proc_num_cols; i++)
+            {
+                ASSERT_NEAR(recv[i], std_recv[i], zero_tol);
+            }
+
+            aligned_vector<double>& tap_recv = A->tap_comm->communicate(x);
+            for (int i = 0; i < A->off_proc_num_cols; i++)
+            {
+                ASSERT_NEAR(tap_recv[i], std_recv[i], zero_tol);
+            }
+
+            aligned_vector<int>& int_recv = A->comm->communicate(int_vals);
+            for (int i = 0; i < A->off_proc_num_cols; i++)
+            {
+                ASSERT_EQ(int_recv[i], A->off_proc_column_map[i]);
+            }
+
+            A->mult(x, b);
+            for (int i = 0; i < A->local_num_rows; i++)
+            {
+                ASSERT_NEAR(b[i], b_std[i], 1e-10);
+            }
+
+            A->tap_mult(x, b);
+            for (int i = 0; i < A->local_num_rows; i++)
+            {
+                ASSERT_NEAR(b[i], b_std[i], 1e-10);
+            }
+        }
+    }
+
+    A->comm->set_comm_mode(StandardComm);
+    A->tap_comm->set_comm_mode(StandardComm);
+    A->mult(x, b);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_NEAR(b[i], b_std[i], 1e-10);
+    }
+
+    delete[] stencil;
+    delete A;
+
+} // end of TEST(ParCommTest, TestCommModes) //
@@ -8,6 +8,7 @@
 #include "gallery/stencil.hpp"
 #include "gallery/par_stencil.hpp"
 #include "gallery/diffusion.hpp"
+#include "gallery/laplacian27pt.hpp"
 
 using namespace raptor;
 
@@ -93,3 +94,116 @@ TEST(ParMatrixTest, TestsInCore)
     delete[] stencil;
 
 } // end of TEST(ParMatrixTest, TestsInCore) //
+
+TEST(ParMatrixTest, TestSinglePrecision)
+{
+    int grid[2] = {25, 25};
+    double* stencil = diffusion_stencil_2d(0.001, M_PI/8.0);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+    ParCSRMatrix* A_sp = par_stencil_grid(stencil, grid, 2);
+    delete[] stencil;
+
+    int n = A->local_num_rows;
+    ParVector x(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector r(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector r_sp(A->global_num_rows, n, A->partition->first_local_row);
+    x.set_rand_values();
+    b.set_rand_values();
+
+    A_sp->to_single();
+    ASSERT_TRUE(A_sp->on_proc->nnz == 0 || ((CSRMatrix*) A_sp->on_proc)->single_precision());
+    ASSERT_EQ((int) A_sp->on_proc->vals.size(), 0);
+
+    // Products accumulate in double, with values rounded to float
+    for (int tap = 0; tap < 2; tap++)
+    {
+        A->mult(x, r, tap);
+        A_sp->mult(x, r_sp, tap);
+        for (int i = 0; i < n; i++)
+        {
+            ASSERT_NEAR(r[i], r_sp[i], 1e-6 * (1.0 + fabs(r[i])));
+        }
+        A->mult_T(x, r, tap);
+        A_sp->mult_T(x, r_sp, tap);
+        for (int i = 0; i < n; i++)
+        {
+            ASSERT_NEAR(r[i], r_sp[i], 1e-6 * (1.0 + fabs(r[i])));
+        }
+        A->residual(x, b, r, tap);
+        A_sp->residual(x, b, r_sp, tap);
+        for (int i = 0; i < n; i++)
+        {
+            ASSERT_NEAR(r[i], r_sp[i], 1e-6 * (1.0 + fabs(r[i])));
+        }
+    }
+
+    A_sp->to_double();
+    ASSERT_EQ(A_sp->on_proc->vals.size(), A->on_proc->vals.size());
+    for (int j = 0; j < A->on_proc->nnz; j++)
+    {
+        ASSERT_FLOAT_EQ(A_sp->on_proc->vals[j], A->on_proc->vals[j]);
+    }
+
+    delete A;
+    delete A_sp;
+} // end of TEST(ParMatrixTest, TestSinglePrecision) //
+
+TEST(ParMatrixTest, TestSELL)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    ParCSRMatrix* A_sell = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    int n = A->local_num_rows;
+    ParVector x(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector r(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector r_sell(A->global_num_rows, n, A->partition->first_local_row);
+    x.set_rand_values();
+    b.set_rand_values();
+
+    // Small sigma so that several sorting windows are formed
+    A_sell->to_sell(16);
+    ASSERT_EQ(A_sell->on_proc->format(), SELL);
+    ASSERT_EQ(A_sell->on_proc->nnz, A->on_proc->nnz);
+    ASSERT_EQ(A_sell->off_proc->nnz, A->off_proc->nnz);
+
+    for (int tap = 0; tap < 2; tap++)
+    {
+        A->mult(x, r, tap);
+        A_sell->mult(x, r_sell, tap);
+        for (int i = 0; i < n; i++)
+        {
+            ASSERT_NEAR(r[i], r_sell[i], 1e-12 * (1.0 + fabs(r[i])));
+        }
+        A->mult_T(x, r, tap);
+        A_sell->mult_T(x, r_sell, tap);
+        for (int i = 0; i < n; i++)
+        {
+            ASSERT_NEAR(r[i], r_sell[i], 1e-12 * (1.0 + fabs(r[i])));
+        }
+        A->residual(x, b, r, tap);
+        A_sell->residual(x, b, r_sell, tap);
+        for (int i = 0; i < n; i++)
+        {
+            ASSERT_NEAR(r[i], r_sell[i], 1e-12 * (1.0 + fabs(r[i])));
+        }
+    }
+
+    A_sell->from_sell();
+    ASSERT_EQ(A_sell->on_proc->format(), CSR);
+    ASSERT_EQ(A_sell->on_proc->idx1, A->on_proc->idx1);
+    ASSERT_EQ(A_sell->on_proc->idx2, A->on_proc->idx2);
+    ASSERT_EQ(A_sell->off_proc->idx1, A->off_proc->idx1);
+    ASSERT_EQ(A_sell->off_proc->idx2, A->off_proc->idx2);
+    for (int j = 0; j < A->on_proc->nnz; j++)
+    {
+        ASSERT_DOUBLE_EQ(A_sell->on_proc->vals[j], A->on_proc->vals[j]);
+    }
+
+    delete A;
+    delete A_sell;
+} // end of TEST(ParMatrixTest, TestSELL) //
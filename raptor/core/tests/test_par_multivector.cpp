@@ -0,0 +1,88 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "core/par_multivector.hpp"
+#include "gallery/par_stencil.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+TEST(ParMultiVectorTest, TestsInCore)
+{
+    int k = 3;
+
+    // Nonsymmetric stencil, so A^T differs from A
+    int grid[2] = {30, 30};
+    double stencil[9] = {0.0, -1.0, 0.0, -3.0, 6.0, -1.0, 0.0, -1.0, 0.0};
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+
+    int global_n = A->global_num_rows;
+    int local_n = A->local_num_rows;
+    int first = A->partition->first_local_row;
+
+    ParMultiVector X(global_n, local_n, first, k);
+    ParMultiVector B(global_n, local_n, first, k);
+    ParMultiVector R(global_n, local_n, first, k);
+    ParMultiVector AX(global_n, local_n, first, k);
+    ParVector x(global_n, local_n, first);
+    ParVector b(global_n, local_n, first);
+    ParVector r(global_n, local_n, first);
+    ParVector ax(global_n, local_n, first);
+    X.set_rand_values();
+    B.set_rand_values();
+
+    // Block norms and inner products match those of each vector
+    aligned_vector<double> norms(k);
+    aligned_vector<double> inner(k);
+    X.norms(norms.data());
+    X.inner_products(B, inner.data());
+    for (int v = 0; v < k; v++)
+    {
+        X.get_vector(v, x);
+        B.get_vector(v, b);
+        ASSERT_NEAR(norms[v], x.norm(2), 1e-10);
+        ASSERT_NEAR(inner[v], x.inner_product(b), 1e-10);
+    }
+
+    // SpMM, residual, and transpose SpMM match products with each vector
+    for (int tap = 0; tap < 2; tap++)
+    {
+        A->mult(X, AX, tap);
+        A->residual(X, B, R, tap);
+        for (int v = 0; v < k; v++)
+        {
+            X.get_vector(v, x);
+            B.get_vector(v, b);
+            A->mult(x, ax, tap);
+            A->residual(x, b, r, tap);
+            for (int i = 0; i < local_n; i++)
+            {
+                ASSERT_NEAR(AX(i, v), ax[i], 1e-12);
+                ASSERT_NEAR(R(i, v), r[i], 1e-12);
+            }
+        }
+
+        A->mult_T(X, AX, tap);
+        for (int v = 0; v < k; v++)
+        {
+            X.get_vector(v, x);
+            A->mult_T(x, ax, tap);
+            for (int i = 0; i < local_n; i++)
+            {
+                ASSERT_NEAR(AX(i, v), ax[i], 1e-12);
+            }
+        }
+    }
+
+    delete A;
+} // end of TEST(ParMultiVectorTest, TestsInCore) //
@@ -70,3 +70,79 @@ TEST(ParVectorTest, TestsInCore)
     
 } // end of TEST(ParVectorTest, TestsInCore) //
 
+
+TEST(ParVectorTest, TestFusedKernels)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int global_n = 100;
+    int local_n = global_n / num_procs;
+    int first_n = rank * ( global_n / num_procs);
+    if (global_n % num_procs > rank)
+    {
+        local_n++;
+        first_n += rank;
+    }
+    else
+    {
+        first_n += (global_n % num_procs);
+    }
+
+    ParVector v(global_n, local_n, first_n);
+    ParVector x(global_n, local_n, first_n);
+    ParVector y(global_n, local_n, first_n);
+    ParVector r(global_n, local_n, first_n);
+    for (int i = 0; i < local_n; i++)
+    {
+        int row = first_n + i;
+        v[i] = 1.0 + row;
+        x[i] = 0.5 * row;
+        y[i] = 1.0 / (1.0 + row);
+        r[i] = 2.0;
+    }
+
+    // Multi-dot matches separate inner products, blocking or not
+    aligned_vector<ParVector*> vecs(3);
+    vecs[0] = &x;
+    vecs[1] = &y;
+    vecs[2] = &v;
+    data_t inner[3];
+    v.inner_products(vecs, inner);
+    ASSERT_NEAR(inner[0], v.inner_product(x), 1e-10);
+    ASSERT_NEAR(inner[1], (double) global_n, 1e-10);
+    ASSERT_NEAR(inner[2], v.inner_product(v), 1e-10);
+
+    MPI_Request request;
+    data_t nb_inner[3];
+    v.inner_products(vecs, nb_inner, &request);
+    MPI_Wait(&request, MPI_STATUS_IGNORE);
+    for (int k = 0; k < 3; k++)
+    {
+        ASSERT_DOUBLE_EQ(nb_inner[k], inner[k]);
+    }
+
+    // aypx : y = x + 2y
+    ParVector y_ref(y);
+    y_ref.scale(2.0);
+    y_ref.axpy(x, 1.0);
+    y.aypx(x, 2.0);
+    for (int i = 0; i < local_n; i++)
+    {
+        ASSERT_DOUBLE_EQ(y[i], y_ref[i]);
+    }
+
+    // axpy_residual : v += 0.5x, r -= 0.5y, returning <r, r>
+    ParVector v_ref(v);
+    ParVector r_ref(r);
+    v_ref.axpy(x, 0.5);
+    r_ref.axpy(y, -0.5);
+    data_t rr = v.axpy_residual(x, r, y, 0.5);
+    ASSERT_NEAR(rr, r_ref.inner_product(r_ref), 1e-10);
+    for (int i = 0; i < local_n; i++)
+    {
+        ASSERT_DOUBLE_EQ(v[i], v_ref[i]);
+        ASSERT_DOUBLE_EQ(r[i], r_ref[i]);
+    }
+} // end of TEST(ParVectorTest, TestFusedKernels) //
@@ -70,9 +70,14 @@ TEST(TAPCommTest, TestsInCore)
         ASSERT_NEAR(tap_recv[i], tap_simp_recv[i], zero_tol);
     }
 
-    CSRMatrix* recv_mat = A->comm->communicate(B);
-    CSRMatrix* tap_recv_mat = A->tap_comm->communicate(B);
-    CSRMatrix* tap_recv_simp_mat = simple_tap->communicate(B);
+    aligned_vector<index_t> recv_cols, tap_recv_cols, tap_recv_simp_cols;
+    CSRMatrix* recv_mat = A->comm->communicate(B, recv_cols);
+    CSRMatrix* tap_recv_mat = A->tap_comm->communicate(B, tap_recv_cols);
+    CSRMatrix* tap_recv_simp_mat = simple_tap->communicate(B, tap_recv_simp_cols);
+    recv_mat->idx2.assign(recv_cols.begin(), recv_cols.end());
+    tap_recv_mat->idx2.assign(tap_recv_cols.begin(), tap_recv_cols.end());
+    tap_recv_simp_mat->idx2.assign(tap_recv_simp_cols.begin(), 
+            tap_recv_simp_cols.end());
     compare(recv_mat, tap_recv_mat);
     compare(tap_recv_mat, tap_recv_simp_mat);
     delete recv_mat;
@@ -0,0 +1,105 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+
+#include "core/types.hpp"
+#include "core/topology.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/par_stencil.hpp"
+#include "gallery/laplacian27pt.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp=RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+void check_topology(Topology* topology)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int local_rank, local_size;
+    MPI_Comm_rank(topology->local_comm, &local_rank);
+    MPI_Comm_size(topology->local_comm, &local_size);
+    ASSERT_EQ(topology->PPN, local_size);
+    ASSERT_EQ(topology->get_local_proc(rank), local_rank);
+    ASSERT_EQ(topology->get_node_size(topology->get_node(rank)), local_size);
+
+    // All procs in local_comm are on the same node
+    int node = topology->get_node(rank);
+    int min_node, max_node;
+    MPI_Allreduce(&node, &min_node, 1, MPI_INT, MPI_MIN, topology->local_comm);
+    MPI_Allreduce(&node, &max_node, 1, MPI_INT, MPI_MAX, topology->local_comm);
+    ASSERT_EQ(min_node, node);
+    ASSERT_EQ(max_node, node);
+
+    int total_size = 0;
+    for (int n = 0; n < topology->num_nodes; n++)
+    {
+        total_size += topology->get_node_size(n);
+    }
+    ASSERT_EQ(total_size, num_procs);
+
+    for (int p = 0; p < num_procs; p++)
+    {
+        ASSERT_EQ(topology->get_global_proc(topology->get_node(p),
+                    topology->get_local_proc(p)), p);
+    }
+}
+
+TEST(TopologyTest, TestsInCore)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    // Nodes detected from shared memory
+    unsetenv("PPN");
+    Topology* topology = new Topology();
+    check_topology(topology);
+    delete topology;
+
+    // Uniform nodes of 3 procs (last node may be smaller)
+    setenv("PPN", "3", 1);
+    topology = new Topology();
+    check_topology(topology);
+    ASSERT_EQ(topology->num_nodes, (num_procs + 2) / 3);
+    ASSERT_EQ(topology->get_node(rank), rank / 3);
+    delete topology;
+
+    // Node-aware communication with nodes of differing sizes
+    int grid[3] = {8, 8, 8};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    ParVector x(A->global_num_cols, A->on_proc_num_cols, A->partition->first_local_col);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b_tap(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    x.set_rand_values();
+    A->mult(x, b);
+
+    for (int form_S = 0; form_S < 2; form_S++)
+    {
+        delete A->tap_comm;
+        A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
+                A->on_proc_column_map, form_S);
+        A->tap_mult(x, b_tap);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_NEAR(b[i], b_tap[i], 1e-10);
+        }
+    }
+
+    delete A;
+    delete[] stencil;
+    unsetenv("PPN");
+
+} // end of TEST(TopologyTest, TestsInCore) //
+
@@ -6,6 +6,8 @@
 #include <mpi.h>
 #include <math.h>
 #include <set>
+#include <stdlib.h>
+#include <string.h>
 
 #include "types.hpp"
 
@@ -13,33 +15,47 @@
  *****   Topology Class
  **************************************************************
  ***** This class holds information about the topology of
- ***** the parallel computer on which Raptor is being run
+ ***** the parallel computer on which Raptor is being run: which
+ ***** node holds each process, and a communicator of the 
+ ***** processes local to rank's node.
+ *****
+ ***** By default, nodes are detected as the processes that share
+ ***** memory (MPI_Comm_split_type), so nodes may differ in size and
+ ***** processes may be placed on nodes in any order.  Setting the
+ ***** environment variable NODE_SPLIT to "socket" or "numa" 
+ ***** groups processes by socket or NUMA domain instead, where the
+ ***** MPI implementation supports it.
+ *****
+ ***** If the environment variable PPN (or _PPN) is set, nodes are
+ ***** instead formed of PPN consecutive processes, or placed 
+ ***** round-robin according to MPICH_RANK_REORDER_METHOD.
  *****
  ***** Attributes
  ***** -------------
- ***** global_num_indices : index_t
- *****    Number of rows to be partitioned
- ***** first_local_idx : index_t
- *****    First global index of a row in partition local to rank
- ***** local_num_indices : index_t
- *****    Number of rows local to rank's partition
- *****
- ***** Methods
- ***** ---------
+ ***** PPN : int
+ *****    Number of processes on rank's node (size of local_comm)
+ ***** num_nodes : int
+ *****    Number of nodes
+ ***** proc_node : aligned_vector<int>
+ *****    Node holding each process
+ ***** proc_local : aligned_vector<int>
+ *****    Index of each process within its node (rank in local_comm)
+ ***** node_ptr, node_procs : aligned_vector<int>
+ *****    Processes of each node, in ascending order
+ ***** local_comm : MPI_Comm
+ *****    Communicator of all processes on rank's node
  **************************************************************/
 namespace raptor
 {
   class Topology
   {
   public:
-    Topology(int _PPN = 16, int _standard_rank_ordering = 1)
+    Topology(int _PPN = 0, int _standard_rank_ordering = 1)
     {     
         int rank, num_procs;
         MPI_Comm_rank(MPI_COMM_WORLD, &rank);
         MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
 
-        int rank_node;
-
         char* proc_layout_c = getenv("MPICH_RANK_REORDER_METHOD");
         char* PPN_c = getenv("PPN");
         if (PPN_c) 
@@ -60,12 +76,66 @@ namespace raptor
             rank_ordering = _standard_rank_ordering;
         }
 
-        num_nodes = num_procs / PPN;
-        if (num_procs % PPN) num_nodes++;
-        rank_node = get_node(rank);
+        proc_node.resize(num_procs);
+        if (PPN > 0)
+        {
+            // Uniform nodes of PPN processes
+            num_nodes = num_procs / PPN;
+            if (num_procs % PPN) num_nodes++;
+            for (int p = 0; p < num_procs; p++)
+            {
+                proc_node[p] = get_ordered_node(p);
+            }
+
+            // Create intra-node communicator
+            MPI_Comm_split(MPI_COMM_WORLD, proc_node[rank], rank, &local_comm);
+        }
+        else
+        {
+            split_shared(rank);
 
-        // Create intra-node communicator
-        MPI_Comm_split(MPI_COMM_WORLD, rank_node, rank, &local_comm);
+            // Number nodes in order of their first process (rank 0 
+            // of local_comm, as local_comm is ordered by rank)
+            int first_proc = rank;
+            MPI_Bcast(&first_proc, 1, MPI_INT, 0, local_comm);
+            aligned_vector<int> proc_first(num_procs);
+            MPI_Allgather(&first_proc, 1, MPI_INT, proc_first.data(), 1, MPI_INT,
+                    MPI_COMM_WORLD);
+            num_nodes = 0;
+            for (int p = 0; p < num_procs; p++)
+            {
+                if (proc_first[p] == p)
+                {
+                    proc_node[p] = num_nodes++;
+                }
+                else
+                {
+                    proc_node[p] = proc_node[proc_first[p]];
+                }
+            }
+        }
+
+        // Processes of each node, ascending (matching local_comm ranks)
+        node_ptr.resize(num_nodes + 1, 0);
+        for (int p = 0; p < num_procs; p++)
+        {
+            node_ptr[proc_node[p] + 1]++;
+        }
+        for (int i = 0; i < num_nodes; i++)
+        {
+            node_ptr[i+1] += node_ptr[i];
+        }
+        aligned_vector<int> node_ctr(num_nodes, 0);
+        node_procs.resize(num_procs);
+        proc_local.resize(num_procs);
+        for (int p = 0; p < num_procs; p++)
+        {
+            int node = proc_node[p];
+            proc_local[p] = node_ctr[node]++;
+            node_procs[node_ptr[node] + proc_local[p]] = p;
+        }
+
+        MPI_Comm_size(local_comm, &PPN);
         num_shared = 0;
     }
 
@@ -74,80 +144,87 @@ namespace raptor
         MPI_Comm_free(&local_comm);
     }
 
-    int get_node(int proc)
+    // Forms local_comm from processes sharing memory (or a socket / 
+    // NUMA domain if requested in NODE_SPLIT)
+    void split_shared(int rank)
     {
-        if (rank_ordering == 0)
-        {
-            return proc % num_nodes;
-        }
-        else if (rank_ordering == 1)
-        {
-            return proc / PPN;
-        }
-        else if (rank_ordering == 2)
+        char* split_c = getenv("NODE_SPLIT");
+        local_comm = MPI_COMM_NULL;
+        if (split_c && (strcmp(split_c, "socket") == 0 || strcmp(split_c, "numa") == 0))
         {
-            if ((proc / num_nodes) % 2 == 0)
-            {
-                return proc % num_nodes;
-            }
-            else
+            bool numa = strcmp(split_c, "numa") == 0;
+#if defined(OPEN_MPI)
+            MPI_Comm_split_type(MPI_COMM_WORLD, 
+                    numa ? OMPI_COMM_TYPE_NUMA : OMPI_COMM_TYPE_SOCKET,
+                    rank, MPI_INFO_NULL, &local_comm);
+#elif MPI_VERSION >= 4
+            MPI_Info info;
+            MPI_Info_create(&info);
+            MPI_Info_set(info, "mpi_hw_resource_type", numa ? "NUMANode" : "Package");
+            MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_HW_GUIDED, 
+                    rank, info, &local_comm);
+            MPI_Info_free(&info);
+#endif
+            // Unbound processes have no socket / NUMA domain
+            int lcl_failed = local_comm == MPI_COMM_NULL;
+            int failed;
+            MPI_Allreduce(&lcl_failed, &failed, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+            if (failed && local_comm != MPI_COMM_NULL)
             {
-                return num_nodes - (proc % num_nodes) - 1;
+                MPI_Comm_free(&local_comm);
             }
         }
-        else
-        { 
-            int rank;
-            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-            if (rank == 0)
-            {
-                printf("This MPI rank ordering is not supported!\n");
-            }
-            return -1;
+
+        if (local_comm == MPI_COMM_NULL)
+        {
+            MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                    MPI_INFO_NULL, &local_comm);
         }
     }
 
+    int get_node(int proc)
+    {
+        return proc_node[proc];
+    }
+
     int get_local_proc(int proc)
     {
-        if (rank_ordering == 0 || rank_ordering == 2)
-        {
-            return proc / num_nodes;
-        }
-        else if (rank_ordering == 1)
-        {
-            return proc % PPN;
-        }
-        else
-        { 
-            int rank;
-            MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-            if (rank == 0)
-            {
-                printf("This MPI rank ordering is not supported!\n");
-            }
-            return -1;
-        }
+        return proc_local[proc];
+    }
+
+    int get_node_size(int node)
+    {
+        return node_ptr[node+1] - node_ptr[node];
     }
 
+    // Process of node with index local_proc, wrapped by the number
+    // of processes on node (as nodes may differ in size)
     int get_global_proc(int node, int local_proc)
+    {
+        return node_procs[node_ptr[node] + (local_proc % get_node_size(node))];
+    }
+
+    // Node of proc, for uniform nodes of PPN processes placed 
+    // according to rank_ordering
+    int get_ordered_node(int proc)
     {
         if (rank_ordering == 0)
         {
-            return local_proc * num_nodes + node;
+            return proc % num_nodes;
         }
         else if (rank_ordering == 1)
         {
-            return local_proc + (node * PPN);
+            return proc / PPN;
         }
         else if (rank_ordering == 2)
         {
-            if (local_proc % 2 == 0)
+            if ((proc / num_nodes) % 2 == 0)
             {
-                return local_proc * num_nodes + node;
+                return proc % num_nodes;
             }
             else
             {
-                return local_proc * num_nodes + num_nodes - node - 1;                
+                return num_nodes - (proc % num_nodes) - 1;
             }
         }
         else
@@ -167,6 +244,11 @@ namespace raptor
     int num_shared;
     int num_nodes;
 
+    aligned_vector<int> proc_node;
+    aligned_vector<int> proc_local;
+    aligned_vector<int> node_ptr;
+    aligned_vector<int> node_procs;
+
     MPI_Comm local_comm;
   };
 }
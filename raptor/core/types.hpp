@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <time.h>
+#include <limits.h>
 
 #include <vector>
 #include <map>
@@ -24,13 +25,31 @@
 using namespace std;
 
 #define zero_tol 1e-16
+#ifdef USING_BIGINT
+#define MPI_INDEX_T MPI_INT64_T
+#else
 #define MPI_INDEX_T MPI_INT
+#endif
 #define MPI_DATA_T MPI_DOUBLE
 
 #ifdef WITH_MPI
 #include <mpi.h>
 #endif
 
+#ifdef USING_OPENMP
+#include <omp.h>
+#endif
+
+// Number of threads used by on-process kernels
+inline int get_num_threads()
+{
+#ifdef USING_OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
 struct PairData 
 {
     double val;
@@ -145,16 +164,24 @@ private:
 namespace raptor
 {
     using data_t = double;
+    // Global row and column indices (local indices are always int)
+#ifdef USING_BIGINT
+    using index_t = int64_t;
+#else
     using index_t = int;
+#endif
     template <typename T>
     using aligned_vector = std::vector<T, AlignAllocator<T, 16>>;
     enum strength_t {Classical, Symmetric};
-    enum format_t {BSR, CSR, CSC, COO};
+    enum format_t {BSR, CSR, CSC, COO, SELL};
     enum coarsen_t {RS, CLJP, Falgout, PMIS, HMIS};
     enum interp_t {Direct, ModClassical, Extended};
     enum agg_t {MIS};
     enum prolong_t {JacobiProlongation};
-    enum relax_t {Jacobi, SOR, SSOR};
+    enum relax_t {Jacobi, SOR, SSOR, Chebyshev, L1Jacobi, L1SOR};
+    enum coarse_solve_t {AutoCoarse, DenseLU, SparseLU, IterativeCG};
+    enum comm_mode_t {StandardComm, PersistentComm, NeighborComm, SharedComm};
+    enum cycle_t {VCycle, WCycle, FCycle, KCycle};
 
     template<typename T, typename U> 
     U sum_func(const U& a, const T&b)
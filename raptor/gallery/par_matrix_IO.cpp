@@ -33,7 +33,7 @@ ParCSRMatrix* readParMatrix(const char* filename,
     uint32_t code;
     uint32_t global_num_rows;
     uint32_t global_num_cols;
-    uint32_t global_nnz;
+    uint32_t global_nnz; // Overflows past 2^32 nonzeros, so summed below
     uint32_t idx;
     double val;
 
@@ -73,7 +73,7 @@ ParCSRMatrix* readParMatrix(const char* filename,
 
     aligned_vector<int> proc_nnz(num_procs);
     aligned_vector<int> row_sizes;
-    aligned_vector<int> col_indices;
+    aligned_vector<index_t> col_indices;
     aligned_vector<double> vals;
     int nnz = 0;
     if (A->local_num_rows)
@@ -82,7 +82,7 @@ ParCSRMatrix* readParMatrix(const char* filename,
     if (is_little_endian)
     {
         // Find row sizes
-        ifs.seekg(A->partition->first_local_row * sizeof_int32, ifs.cur);
+        ifs.seekg((std::streamoff) A->partition->first_local_row * sizeof_int32, ifs.cur);
         for (int i = 0; i < A->local_num_rows; i++)
         {
             ifs.read(reinterpret_cast<char *>(&idx), sizeof_int32);
@@ -90,16 +90,19 @@ ParCSRMatrix* readParMatrix(const char* filename,
             row_sizes[i] = idx;
             nnz += idx;
         }
-        ifs.seekg((A->global_num_rows - A->partition->last_local_row - 1) * sizeof_int32, ifs.cur);
+        ifs.seekg((std::streamoff) (A->global_num_rows - A->partition->last_local_row - 1) 
+                * sizeof_int32, ifs.cur);
 
         // Find nnz per proc (to find first_nnz)
         MPI_Allgather(&nnz, 1, MPI_INT, proc_nnz.data(), 1, MPI_INT, comm);
-        int first_nnz = 0;
-        for (int i = 0; i < rank; i++)
+        std::streamoff first_nnz = 0;
+        std::streamoff total_nnz = 0;
+        for (int i = 0; i < num_procs; i++)
         {
-            first_nnz += proc_nnz[i];
+            if (i < rank) first_nnz += proc_nnz[i];
+            total_nnz += proc_nnz[i];
         }
-        int remaining_nnz = global_nnz - first_nnz - nnz;
+        std::streamoff remaining_nnz = total_nnz - first_nnz - nnz;
 
         // Resize variables
         if (nnz)
@@ -129,23 +132,26 @@ ParCSRMatrix* readParMatrix(const char* filename,
     else
     {
         // Find row sizes
-        ifs.seekg(A->partition->first_local_row * sizeof_int32, ifs.cur);
+        ifs.seekg((std::streamoff) A->partition->first_local_row * sizeof_int32, ifs.cur);
         for (int i = 0; i < A->local_num_rows; i++)
         {
             ifs.read(reinterpret_cast<char *>(&idx), sizeof_int32);
             row_sizes[i] = idx;
             nnz += idx;
         }
-        ifs.seekg((A->global_num_rows - A->partition->last_local_row - 1) * sizeof_int32, ifs.cur);
+        ifs.seekg((std::streamoff) (A->global_num_rows - A->partition->last_local_row - 1) 
+                * sizeof_int32, ifs.cur);
 
         // Find nnz per proc (to find first_nnz)
         MPI_Allgather(&nnz, 1, MPI_INT, proc_nnz.data(), 1, MPI_INT, comm);
-        int first_nnz = 0;
-        for (int i = 0; i < rank; i++)
+        std::streamoff first_nnz = 0;
+        std::streamoff total_nnz = 0;
+        for (int i = 0; i < num_procs; i++)
         {
-            first_nnz += proc_nnz[i];
+            if (i < rank) first_nnz += proc_nnz[i];
+            total_nnz += proc_nnz[i];
         }
-        int remaining_nnz = global_nnz - first_nnz - nnz;
+        std::streamoff remaining_nnz = total_nnz - first_nnz - nnz;
 
         // Resize variables
         if (nnz)
@@ -181,8 +187,8 @@ ParCSRMatrix* readParMatrix(const char* filename,
         {
             idx = col_indices[ctr];
             val = vals[ctr++];
-            if ((int) idx >= A->partition->first_local_col &&
-                    (int) idx <= A->partition->last_local_col)
+            if ((index_t) idx >= A->partition->first_local_col &&
+                    (index_t) idx <= A->partition->last_local_col)
             {
                 A->on_proc->idx2.push_back(idx - A->partition->first_local_col);
                 A->on_proc->vals.push_back(val);
@@ -20,8 +20,10 @@ void BiCGStab(ParCSRMatrix* A, ParVector& x, ParVector& b, aligned_vector<double
 
     int iter;
     data_t alpha, beta, omega;
-    data_t rr_inner, next_inner, Apr_inner, As_inner, AsAs_inner;
+    data_t rr_inner, next_inner, Apr_inner;
+    data_t As_inner[2];
     double norm_r;
+    aligned_vector<ParVector*> s_As(2);
 
     // Same max iterations definition as pyAMG
     if (max_iter <= 0)
@@ -35,6 +37,8 @@ void BiCGStab(ParCSRMatrix* A, ParVector& x, ParVector& b, aligned_vector<double
     p.resize(b.global_n, b.local_n, b.first_local);
     Ap.resize(b.global_n, b.local_n, b.first_local);
     As.resize(b.global_n, b.local_n, b.first_local);
+    s_As[0] = &s;
+    s_As[1] = &As;
 
     // r0 = b - A * x0
     A->residual(x, b, r);
@@ -69,9 +73,8 @@ void BiCGStab(ParCSRMatrix* A, ParVector& x, ParVector& b, aligned_vector<double
 
         // omega_i = (As_i, s_i) / (As_i, As_i)
 	A->mult(s, As);
-	As_inner = As.inner_product(s);
-	AsAs_inner = As.inner_product(As);
-	omega = As_inner / AsAs_inner;
+	As.inner_products(s_As, As_inner);
+	omega = As_inner[0] / As_inner[1];
 
 	// x_{i+1} = x_i + alpha_i * p_i + omega_i * s_i
 	x.axpy(p, alpha);
@@ -86,8 +89,7 @@ void BiCGStab(ParCSRMatrix* A, ParVector& x, ParVector& b, aligned_vector<double
 	beta = (next_inner / rr_inner) * (alpha / omega);
 
 	// p_{i+1} = r_{i+1} + beta_i * (p_i - omega_i * Ap_i)
-	p.scale(beta);
-	p.axpy(r, 1.0);
+	p.aypx(r, beta);
 	p.axpy(Ap, -1.0*beta*omega);
 
         // Update next inner product
@@ -66,25 +66,24 @@ void CG(ParCSRMatrix* A, ParVector& x, ParVector& b, aligned_vector<double>& res
         }
         alpha = rr_inner / App_inner;
 
-        x.axpy(p, alpha);
-
         // x_{i+1} = x_i + alpha_i * p_i
+        // r_{i+1} = r_i - alpha_i * A*p_i, along with (r_{i+1}, r_{i+1})
         if ((iter % recompute_r) && iter > 0)
         {
-            r.axpy(Ap, -1.0*alpha);
+            next_inner = x.axpy_residual(p, r, Ap, alpha);
         }
         else
         {
+            x.axpy(p, alpha);
             A->residual(x, b, r);
+            next_inner = r.inner_product(r);
         }
 
         // beta_i = (r_{i+1}, r_{i+1}) / (r_i, r_i)
-        next_inner = r.inner_product(r);
         beta = next_inner / rr_inner;
 
         // p_{i+1} = r_{i+1} + beta_i * p_i
-        p.scale(beta);
-        p.axpy(r, 1.0);
+        p.aypx(r, beta);
 
         // Update next inner product
         rr_inner = next_inner;
@@ -112,6 +111,25 @@ void CG(ParCSRMatrix* A, ParVector& x, ParVector& b, aligned_vector<double>& res
 }
 
 
+void print_pcg_iters(int iter, int max_iter, aligned_vector<double>& res)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0)
+    {
+        if (iter == max_iter)
+        {
+            printf("Max Iterations Reached.\n");
+        }
+        else
+        {
+            printf("%d Iteration required to converge\n", iter);
+        }
+        printf("Relative Residual: %lg\n\n", res[iter-1]);
+    }
+}
+
 void PCG(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, aligned_vector<double>& res, double tol, int max_iter)
 {
     int rank;
@@ -218,27 +236,281 @@ void PCG(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, aligned
         }
         else
         {
-            p.scale(beta);
-            p.axpy(z, 1.0);
+            p.aypx(z, beta);
         }
 
         // Update next inner product
         rz_inner = next_inner;
     }
 
-    if (rank == 0)
+    print_pcg_iters(iter, max_iter, res);
+
+    return;
+}
+
+
+/**************************************************************
+ *****   Single Reduction PCG (Chronopoulos-Gear)
+ **************************************************************
+ ***** Preconditioned CG in which <r, z> and <Az, z> are reduced
+ ***** together, so each iteration requires a single MPI_Allreduce.
+ ***** Search directions p and s = A*p are updated by recurrence,
+ ***** so A*z is the only SpMV per iteration.  Residual history
+ ***** matches PCG.
+ **************************************************************/
+void SRPCG(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, aligned_vector<double>& res, double tol, int max_iter)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    ParVector r;
+    ParVector z;
+    ParVector w;
+    ParVector p;
+    ParVector s;
+
+    int iter;
+    data_t alpha, beta;
+    data_t b_inner, rz_inner, next_inner, delta;
+    data_t inner[2];
+    double norm_b;
+    aligned_vector<ParVector*> rw(2);
+
+    if (max_iter <= 0)
     {
-        if (iter == max_iter)
+        max_iter = ((int)(1.3*b.global_n)) + 2;
+    }
+
+    // Fixed Constructors
+    r.resize(b.global_n, b.local_n, b.first_local);
+    z.resize(b.global_n, b.local_n, b.first_local);
+    w.resize(b.global_n, b.local_n, b.first_local);
+    p.resize(b.global_n, b.local_n, b.first_local);
+    s.resize(b.global_n, b.local_n, b.first_local);
+    rw[0] = &r;
+    rw[1] = &w;
+
+    // Initial b_norm (preconditioned)
+    z.set_const_value(0.0);
+    ml->cycle(z, b);
+    b_inner = b.inner_product(z);
+    norm_b = sqrt(b_inner);
+    if (norm_b > zero_tol)
+    {
+        tol = tol * norm_b;
+    }
+
+    // r0 = b - A * x0
+    A->residual(x, b, r);
+
+    // z0 = M^{-1}r0, w0 = A*z0
+    z.set_const_value(0.0);
+    ml->cycle(z, r);
+    A->mult(z, w);
+
+    // <r, z> and <w, z> in one reduction
+    z.inner_products(rw, inner);
+    rz_inner = inner[0];
+    delta = inner[1];
+    res.push_back(sqrt(rz_inner));
+
+    // p0 = z0, s0 = w0
+    p.copy(z);
+    s.copy(w);
+    alpha = rz_inner / delta;
+
+    iter = 0;
+
+    // Main CG Loop
+    while (iter < max_iter)
+    {
+        iter++;
+
+        if (delta < 0.0)
         {
-            printf("Max Iterations Reached.\n");
+            if (rank == 0)
+            {
+                printf("Indefinite matrix detected in CG! Aborting...\n");
+            }
+            exit(-1);
+        }
+
+        // x_{i+1} = x_i + alpha_i * p_i
+        // r_{i+1} = r_i - alpha_i * A*p_i
+        x.axpy(p, alpha);
+        r.axpy(s, -1.0*alpha);
+
+        // z_{i+1} = M^{-1}r_{i+1}, w_{i+1} = A*z_{i+1}
+        z.set_const_value(0.0);
+        ml->cycle(z, r);
+        A->mult(z, w);
+
+        z.inner_products(rw, inner);
+        next_inner = inner[0];
+        delta = inner[1];
+
+        res.push_back(next_inner/b_inner);
+        if (next_inner < tol) break;
+
+        // beta_i = (r_{i+1}, z_{i+1}) / (r_i, z_i)
+        // alpha_{i+1} = (r_{i+1}, z_{i+1}) / (A*p_{i+1}, p_{i+1}), where
+        // (A*p_{i+1}, p_{i+1}) = delta - beta_i * (r_{i+1}, z_{i+1}) / alpha_i
+        beta = next_inner / rz_inner;
+        delta = delta - beta * next_inner / alpha;
+        alpha = next_inner / delta;
+
+        // p_{i+1} = z_{i+1} + beta_i * p_i
+        // s_{i+1} = w_{i+1} + beta_i * s_i
+        p.aypx(z, beta);
+        s.aypx(w, beta);
+
+        rz_inner = next_inner;
+    }
+
+    print_pcg_iters(iter, max_iter, res);
+
+    return;
+}
+
+/**************************************************************
+ *****   Pipelined PCG (Ghysels-Vanroose)
+ **************************************************************
+ ***** Preconditioned CG with a single non-blocking reduction per 
+ ***** iteration.  <r, u> and <w, u> are posted with MPI_Iallreduce,
+ ***** and the preconditioner cycle m = M^{-1}w and the SpMV n = A*m
+ ***** are performed while the reduction is in flight.  Additional
+ ***** recurrences for q = M^{-1}s and z = A*q replace the remaining
+ ***** SpMVs.  Residual history matches PCG.
+ **************************************************************/
+void PipelinedPCG(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, aligned_vector<double>& res, double tol, int max_iter)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    ParVector r;    // residual
+    ParVector u;    // M^{-1} r
+    ParVector w;    // A u
+    ParVector m;    // M^{-1} w
+    ParVector n;    // A m
+    ParVector p;    // search direction
+    ParVector s;    // A p
+    ParVector q;    // M^{-1} s
+    ParVector z;    // A q
+
+    int iter;
+    data_t alpha, beta;
+    data_t b_inner, rz_inner, next_inner, delta;
+    data_t inner[2];
+    double norm_b;
+    MPI_Request request;
+    aligned_vector<ParVector*> rw(2);
+
+    if (max_iter <= 0)
+    {
+        max_iter = ((int)(1.3*b.global_n)) + 2;
+    }
+
+    // Fixed Constructors
+    r.resize(b.global_n, b.local_n, b.first_local);
+    u.resize(b.global_n, b.local_n, b.first_local);
+    w.resize(b.global_n, b.local_n, b.first_local);
+    m.resize(b.global_n, b.local_n, b.first_local);
+    n.resize(b.global_n, b.local_n, b.first_local);
+    p.resize(b.global_n, b.local_n, b.first_local);
+    s.resize(b.global_n, b.local_n, b.first_local);
+    q.resize(b.global_n, b.local_n, b.first_local);
+    z.resize(b.global_n, b.local_n, b.first_local);
+    rw[0] = &r;
+    rw[1] = &w;
+
+    // Initial b_norm (preconditioned)
+    u.set_const_value(0.0);
+    ml->cycle(u, b);
+    b_inner = b.inner_product(u);
+    norm_b = sqrt(b_inner);
+    if (norm_b > zero_tol)
+    {
+        tol = tol * norm_b;
+    }
+
+    // r0 = b - A * x0, u0 = M^{-1}r0, w0 = A*u0
+    A->residual(x, b, r);
+    u.set_const_value(0.0);
+    ml->cycle(u, r);
+    A->mult(u, w);
+
+    // Recurrences start from p = s = q = z = 0
+    p.set_const_value(0.0);
+    s.set_const_value(0.0);
+    q.set_const_value(0.0);
+    z.set_const_value(0.0);
+
+    rz_inner = 0.0;
+    alpha = 0.0;
+    iter = 0;
+
+    // Main CG Loop
+    while (iter <= max_iter)
+    {
+        // Post <r, u> and <w, u>
+        u.inner_products(rw, inner, &request);
+
+        // m = M^{-1}w, n = A*m overlap the reduction
+        m.set_const_value(0.0);
+        ml->cycle(m, w);
+        A->mult(m, n);
+
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        next_inner = inner[0];
+        delta = inner[1];
+
+        if (iter == 0)
+        {
+            res.push_back(sqrt(next_inner));
         }
         else
         {
-            printf("%d Iteration required to converge\n", iter);
+            res.push_back(next_inner/b_inner);
+            if (next_inner < tol) break;
         }
-        printf("Relative Residual: %lg\n\n", res[iter-1]);
+        if (iter == max_iter) break;
+        iter++;
+
+        if (iter == 1)
+        {
+            beta = 0.0;
+            alpha = next_inner / delta;
+        }
+        else
+        {
+            beta = next_inner / rz_inner;
+            alpha = next_inner / (delta - beta * next_inner / alpha);
+        }
+        if (alpha < 0.0)
+        {
+            if (rank == 0)
+            {
+                printf("Indefinite matrix detected in CG! Aborting...\n");
+            }
+            exit(-1);
+        }
+
+        // z = n + beta*z, q = m + beta*q, s = w + beta*s, p = u + beta*p
+        z.aypx(n, beta);
+        q.aypx(m, beta);
+        s.aypx(w, beta);
+        p.aypx(u, beta);
+
+        // x += alpha*p, r -= alpha*s, u -= alpha*q, w -= alpha*z
+        x.axpy(p, alpha);
+        r.axpy(s, -1.0*alpha);
+        u.axpy(q, -1.0*alpha);
+        w.axpy(z, -1.0*alpha);
+
+        rz_inner = next_inner;
     }
 
+    print_pcg_iters(iter, max_iter, res);
+
     return;
 }
-
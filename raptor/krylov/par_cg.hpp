@@ -14,4 +14,14 @@ void CG(ParCSRMatrix* A, ParVector& x, ParVector& b, aligned_vector<double>& res
 void PCG(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, 
         aligned_vector<double>& res, double tol = 1e-05, int max_iter = -1);
 
+// Chronopoulos-Gear PCG : both inner products of an iteration are 
+// combined into a single MPI_Allreduce
+void SRPCG(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, 
+        aligned_vector<double>& res, double tol = 1e-05, int max_iter = -1);
+
+// Ghysels-Vanroose pipelined PCG : the single reduction is posted with
+// MPI_Iallreduce and overlapped with the preconditioner and SpMV
+void PipelinedPCG(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, 
+        aligned_vector<double>& res, double tol = 1e-05, int max_iter = -1);
+
 #endif
@@ -0,0 +1,340 @@
+// Copyright (c) 2015, Raptor Developer Team, University of Illinois at Urbana-Champaign
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "krylov/par_gmres.hpp"
+
+using namespace raptor;
+
+// Applies previous Givens rotations to column j of the Hessenberg matrix,
+// eliminates h_{j+1,j}, and returns the updated residual estimate
+static data_t givens_column(aligned_vector<data_t>& H, int ldh, 
+        aligned_vector<data_t>& cs, aligned_vector<data_t>& sn, 
+        aligned_vector<data_t>& g, int j)
+{
+    data_t tmp;
+    data_t* h = &H[j*ldh];
+
+    for (int k = 0; k < j; k++)
+    {
+        tmp = cs[k] * h[k] + sn[k] * h[k+1];
+        h[k+1] = -sn[k] * h[k] + cs[k] * h[k+1];
+        h[k] = tmp;
+    }
+
+    tmp = sqrt(h[j] * h[j] + h[j+1] * h[j+1]);
+    cs[j] = h[j] / tmp;
+    sn[j] = h[j+1] / tmp;
+    h[j] = tmp;
+    h[j+1] = 0.0;
+    g[j+1] = -sn[j] * g[j];
+    g[j] = cs[j] * g[j];
+
+    return fabs(g[j+1]);
+}
+
+/**************************************************************
+ *****   Flexible GMRES
+ **************************************************************
+ ***** Restarted GMRES with a (possibly varying) right preconditioner.
+ ***** Each Arnoldi step applies z_j = M^{-1}v_j and w = A*z_j, and
+ ***** orthogonalizes w against v_0, ..., v_j with classical
+ ***** Gram-Schmidt, reducing all j+1 projections at once.  The norm
+ ***** of the orthogonalized w is a second reduction.
+ *****
+ ***** The low-synchronization variant performs a single reduction per
+ ***** Arnoldi step.  The norm of w is taken from <w, w> - sum h_ij^2,
+ ***** and v_j is reorthogonalized and renormalized one step late, 
+ ***** using <v_i, v_j> reduced along with the projections of the next
+ ***** w (delayed classical Gram-Schmidt with reorthogonalization).
+ ***** Column j of the Hessenberg matrix, and so the residual estimate,
+ ***** is completed during step j+1.
+ *****
+ ***** The residual history holds the 2-norm of the initial residual
+ ***** followed by the Arnoldi estimate after every step.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Matrix of the system
+ ***** ml : ParMultilevel*
+ *****    Preconditioner (NULL for none)
+ ***** x : ParVector&
+ *****    Initial guess, overwritten with the solution
+ ***** b : ParVector&
+ *****    Right-hand side
+ ***** res : aligned_vector<double>&
+ *****    Residual history
+ ***** tol : double
+ *****    Relative residual tolerance
+ ***** max_iter : int
+ *****    Maximum number of Arnoldi steps
+ ***** restart : int
+ *****    Arnoldi steps per restart cycle
+ ***** low_sync : bool
+ *****    Use a single reduction per Arnoldi step
+ **************************************************************/
+void FGMRES(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b, 
+        aligned_vector<double>& res, double tol, int max_iter, int restart, 
+        bool low_sync)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int iter, j, k, n_inner, n_reduce, c_pos;
+    int ldh = restart + 1;
+    bool last, converged = false;
+    data_t norm_r, h_next, ww, tmp, scale;
+    data_t* a;
+    data_t* c;
+    data_t* w_vals;
+    data_t* v_vals;
+
+    if (max_iter <= 0)
+    {
+        max_iter = ((int)(1.3*b.global_n)) + 2;
+    }
+
+    // Krylov basis V and Hessenberg matrix H (column-major), Givens 
+    // rotations (cs, sn) and rhs g.  The solution is updated with the 
+    // vectors z_j A was applied to, kept in Z unless they equal v_j.
+    bool keep_z = ml || low_sync;
+    aligned_vector<ParVector> V(restart + 1);
+    aligned_vector<ParVector> Z(keep_z ? restart : 0);
+    aligned_vector<data_t> H(ldh * restart);
+    aligned_vector<data_t> cs(restart);
+    aligned_vector<data_t> sn(restart);
+    aligned_vector<data_t> g(restart + 1);
+    aligned_vector<data_t> inner(2*restart + 3);
+    aligned_vector<ParVector*> basis;
+    for (j = 0; j <= restart; j++)
+    {
+        V[j].resize(b.global_n, b.local_n, b.first_local);
+    }
+    for (j = 0; j < (int) Z.size(); j++)
+    {
+        Z[j].resize(b.global_n, b.local_n, b.first_local);
+    }
+    ParVector w(b.global_n, b.local_n, b.first_local);
+    w_vals = w.local.values.data();
+
+    // r0 = b - A * x0
+    A->residual(x, b, V[0]);
+    norm_r = V[0].norm(2);
+    res.push_back(norm_r);
+    if (norm_r != 0.0)
+    {
+        tol = tol * norm_r;
+    }
+
+    iter = 0;
+    while (norm_r > tol && iter < max_iter)
+    {
+        // v_0 = r / ||r||, g = ||r|| e_0
+        V[0].scale(1.0 / norm_r);
+        g[0] = norm_r;
+        for (j = 1; j <= restart; j++)
+        {
+            g[j] = 0.0;
+        }
+
+        n_inner = 0;
+        for (j = 0; ; j++)
+        {
+            // Once no Arnoldi step remains, only the delayed completion
+            // of column j-1 is left
+            last = (j == restart || iter == max_iter);
+
+            // w = A * M^{-1} v_j
+            if (!last)
+            {
+                if (ml)
+                {
+                    Z[j].set_const_value(0.0);
+                    ml->cycle(Z[j], V[j]);
+                    A->mult(Z[j], w);
+                }
+                else
+                {
+                    if (keep_z) Z[j].copy(V[j]);
+                    A->mult(V[j], w);
+                }
+            }
+
+            // Local portions of a = V_j^T w, along with <w, w> and 
+            // c = V_j^T v_j for the low-synchronization variant
+            n_reduce = 0;
+            if (!last)
+            {
+                n_reduce = j + 1;
+                if (low_sync) n_reduce++;
+            }
+            c_pos = n_reduce;
+            if (low_sync && j > 0)
+            {
+                n_reduce += j + 1;
+            }
+            basis.resize(j + 1);
+            for (k = 0; k <= j; k++)
+            {
+                basis[k] = &V[k];
+            }
+            if (low_sync && j > 0)
+            {
+                V[j].local_inner_products(basis, &inner[c_pos]);
+            }
+            if (!last)
+            {
+                if (low_sync) basis.push_back(&w);
+                w.local_inner_products(basis, inner.data());
+            }
+            if (n_reduce)
+            {
+                MPI_Allreduce(MPI_IN_PLACE, inner.data(), n_reduce, MPI_DATA_T, 
+                        MPI_SUM, MPI_COMM_WORLD);
+            }
+            a = inner.data();
+            c = inner.data() + c_pos;
+
+            if (low_sync && j > 0)
+            {
+                // Reorthogonalize and normalize v_j :
+                // v_j = (v_j - sum_i c_i v_i) / scale
+                tmp = c[j];
+                for (k = 0; k < j; k++)
+                {
+                    tmp -= c[k] * c[k];
+                }
+                scale = tmp > 0.0 ? sqrt(tmp) : sqrt(c[j]);
+                for (k = 0; k < j; k++)
+                {
+                    v_vals = V[k].local.values.data();
+                    for (int i = 0; i < b.local_n; i++)
+                    {
+                        V[j].local.values[i] -= c[k] * v_vals[i];
+                    }
+                }
+                V[j].scale(1.0 / scale);
+
+                // Column j-1 of H expressed in the corrected v_j
+                for (k = 0; k < j; k++)
+                {
+                    H[(j-1)*ldh + k] += H[(j-1)*ldh + j] * c[k];
+                }
+                H[(j-1)*ldh + j] *= scale;
+
+                // Projection of w onto the corrected v_j
+                if (!last)
+                {
+                    for (k = 0; k < j; k++)
+                    {
+                        a[j] -= c[k] * a[k];
+                    }
+                    a[j] /= scale;
+                }
+
+                norm_r = givens_column(H, ldh, cs, sn, g, j-1);
+                res.push_back(norm_r);
+                if (norm_r < tol)
+                {
+                    converged = true;
+                    n_inner = j;
+                    break;
+                }
+            }
+
+            if (last)
+            {
+                n_inner = j;
+                break;
+            }
+            iter++;
+
+            // w = w - sum_i h_ij v_i
+            for (k = 0; k <= j; k++)
+            {
+                H[j*ldh + k] = a[k];
+                v_vals = V[k].local.values.data();
+                for (int i = 0; i < b.local_n; i++)
+                {
+                    w_vals[i] -= a[k] * v_vals[i];
+                }
+            }
+
+            // h_{j+1,j} = ||w||
+            h_next = -1.0;
+            if (low_sync)
+            {
+                ww = a[j+1];
+                tmp = ww;
+                for (k = 0; k <= j; k++)
+                {
+                    tmp -= a[k] * a[k];
+                }
+                if (tmp > 0.0)
+                {
+                    h_next = sqrt(tmp);
+                }
+            }
+            if (h_next < 0.0)
+            {
+                h_next = w.norm(2);
+            }
+            H[j*ldh + j + 1] = h_next;
+
+            // v_{j+1} = w / h_{j+1,j}
+            if (h_next > zero_tol)
+            {
+                V[j+1].copy(w);
+                V[j+1].scale(1.0 / h_next);
+            }
+
+            // Column j is complete, unless v_{j+1} is corrected next step
+            if (!low_sync || h_next <= zero_tol)
+            {
+                norm_r = givens_column(H, ldh, cs, sn, g, j);
+                res.push_back(norm_r);
+                if (norm_r < tol || h_next <= zero_tol)
+                {
+                    converged = true;
+                    n_inner = j + 1;
+                    break;
+                }
+            }
+        }
+
+        // Solve upper triangular H y = g, storing y in g
+        for (k = n_inner - 1; k >= 0; k--)
+        {
+            for (j = k + 1; j < n_inner; j++)
+            {
+                g[k] -= H[j*ldh + k] * g[j];
+            }
+            g[k] /= H[k*ldh + k];
+        }
+
+        // x = x + Z y (or V y if unpreconditioned)
+        for (k = 0; k < n_inner; k++)
+        {
+            x.axpy(keep_z ? Z[k] : V[k], g[k]);
+        }
+
+        // Restart from the true residual
+        A->residual(x, b, V[0]);
+        norm_r = V[0].norm(2);
+        if (converged) break;
+    }
+
+    if (rank == 0)
+    {
+        if (iter == max_iter && norm_r > tol)
+        {
+            printf("Max Iterations Reached.\n");
+        }
+        else
+        {
+            printf("%d Iteration required to converge\n", iter);
+        }
+        printf("2 Norm of Residual: %lg\n\n", norm_r);
+    }
+
+    return;
+}
@@ -0,0 +1,21 @@
+#ifndef RAPTOR_KRYLOV_PAR_GMRES_HPP
+#define RAPTOR_KRYLOV_PAR_GMRES_HPP
+
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "core/par_vector.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include <vector>
+
+using namespace raptor;
+
+// Restarted flexible GMRES, right preconditioned by ml (or 
+// unpreconditioned if ml is NULL).  Classical Gram-Schmidt reduces all
+// projections of an Arnoldi step in one MPI_Allreduce, followed by a 
+// second for the new norm.  With low_sync, the norm is folded into the
+// same reduction, leaving one MPI_Allreduce per Arnoldi step.
+void FGMRES(ParCSRMatrix* A, ParMultilevel* ml, ParVector& x, ParVector& b,
+        aligned_vector<double>& res, double tol = 1e-05, int max_iter = -1,
+        int restart = 30, bool low_sync = false);
+
+#endif
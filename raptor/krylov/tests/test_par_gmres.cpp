@@ -0,0 +1,88 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "core/par_vector.hpp"
+#include "krylov/par_gmres.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+#include "gallery/par_stencil.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+TEST(ParGMRESTest, TestsInKrylov)
+{
+    // Diffusion plus first-order upwind convection in x (nonsymmetric)
+    int grid[2] = {40, 40};
+    double stencil[9] = {0.0, -1.0, 0.0,
+                         -3.0, 6.0, -1.0,
+                         0.0, -1.0, 0.0};
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector r(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    x.set_const_value(1.0);
+    A->mult(x, b);
+    x.set_const_value(0.0);
+    A->residual(x, b, r);
+    double r0 = r.norm(2);
+
+    // Unpreconditioned, restarted
+    aligned_vector<double> res;
+    x.set_const_value(0.0);
+    FGMRES(A, NULL, x, b, res, 1e-08, -1, 20);
+    A->residual(x, b, r);
+    ASSERT_LT(r.norm(2), 1e-07 * r0);
+    ASSERT_NEAR(res[0], r0, 1e-12 * r0);
+    for (int i = 1; i < 20; i++)
+    {
+        ASSERT_LE(res[i], res[i-1] * (1.0 + 1e-12));
+    }
+
+    // Low-synchronization variant across restarts
+    aligned_vector<double> ls_unprec_res;
+    x.set_const_value(0.0);
+    FGMRES(A, NULL, x, b, ls_unprec_res, 1e-08, -1, 20, true);
+    A->residual(x, b, r);
+    ASSERT_LT(r.norm(2), 1e-07 * r0);
+    for (int i = 0; i < 10; i++)
+    {
+        ASSERT_NEAR(ls_unprec_res[i], res[i], 1e-06 * res[i]);
+    }
+
+    // AMG preconditioned
+    ParMultilevel* ml = new ParRugeStubenSolver(0.25, Falgout, ModClassical, Classical, SOR);
+    ml->setup(A);
+
+    aligned_vector<double> amg_res, ls_res;
+    x.set_const_value(0.0);
+    FGMRES(A, ml, x, b, amg_res, 1e-08);
+    A->residual(x, b, r);
+    ASSERT_LT(r.norm(2), 1e-07 * r0);
+    ASSERT_LT(amg_res.size(), res.size());
+
+    // Low-synchronization variant matches classical Gram-Schmidt
+    x.set_const_value(0.0);
+    FGMRES(A, ml, x, b, ls_res, 1e-08, -1, 30, true);
+    A->residual(x, b, r);
+    ASSERT_LT(r.norm(2), 1e-07 * r0);
+    ASSERT_LE(fabs((int)ls_res.size() - (int)amg_res.size()), 1);
+    for (int i = 0; i < 4; i++)
+    {
+        ASSERT_NEAR(ls_res[i], amg_res[i], 1e-06 * amg_res[i]);
+    }
+
+    delete ml;
+    delete A;
+} // end of TEST(ParGMRESTest, TestsInKrylov) //
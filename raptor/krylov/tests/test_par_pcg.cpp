@@ -0,0 +1,72 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "core/par_vector.hpp"
+#include "krylov/par_cg.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/par_stencil.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+TEST(ParPCGTest, TestsInKrylov)
+{
+    int grid[3] = {15, 15, 15};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector r(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    ParMultilevel* ml = new ParRugeStubenSolver(0.25, PMIS, Extended, Classical, Jacobi);
+    ml->setup(A);
+
+    x.set_const_value(1.0);
+    A->mult(x, b);
+    double b_norm = b.norm(2);
+
+    aligned_vector<double> res, sr_res, pipe_res;
+    x.set_const_value(0.0);
+    PCG(A, ml, x, b, res, 1e-10);
+
+    x.set_const_value(0.0);
+    SRPCG(A, ml, x, b, sr_res, 1e-10);
+    A->residual(x, b, r);
+    ASSERT_LT(r.norm(2), 1e-06 * b_norm);
+
+    x.set_const_value(0.0);
+    PipelinedPCG(A, ml, x, b, pipe_res, 1e-10);
+    A->residual(x, b, r);
+    ASSERT_LT(r.norm(2), 1e-06 * b_norm);
+
+    // All variants start from the same preconditioned residual 
+    // and converge in about as many iterations as PCG
+    ASSERT_NEAR(sr_res[0], res[0], 1e-10 * res[0]);
+    ASSERT_NEAR(pipe_res[0], res[0], 1e-10 * res[0]);
+    ASSERT_LE(fabs((int)sr_res.size() - (int)res.size()), 2);
+    ASSERT_LE(fabs((int)pipe_res.size() - (int)res.size()), 2);
+
+    // With a symmetric (Jacobi) V-cycle, the recurrences are equivalent
+    // to PCG in exact arithmetic, so early iterations agree
+    for (int i = 1; i < 4; i++)
+    {
+        ASSERT_NEAR(sr_res[i], res[i], 1e-08 * res[i]);
+        ASSERT_NEAR(pipe_res[i], res[i], 1e-08 * res[i]);
+    }
+
+    delete ml;
+    delete A;
+} // end of TEST(ParPCGTest, TestsInKrylov) //
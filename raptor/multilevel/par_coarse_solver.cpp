@@ -0,0 +1,745 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "multilevel/par_coarse_solver.hpp"
+
+using namespace raptor;
+
+/**************************************************************
+ *****   Form Active Communicator
+ **************************************************************
+ ***** Splits MPI_COMM_WORLD into the processes holding rows of
+ ***** A, and gathers the number of rows held by each active
+ ***** process.  Processes with no rows get MPI_COMM_NULL.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Coarsest-level matrix
+ **************************************************************/
+void ParCoarseSolver::form_active_comm(ParCSRMatrix* A)
+{
+    int rank;
+    int active_rank, num_active;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    // Gathered coarse rows are indexed (and factored by LAPACK) as int
+    if (A->global_num_rows > (index_t) INT_MAX)
+    {
+        printf("Coarse solvers require fewer than 2^31 global rows.\n");
+        exit(-1);
+    }
+    coarse_n = A->global_num_rows;
+
+    if (active_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&active_comm);
+    }
+    int color = A->local_num_rows ? 0 : MPI_UNDEFINED;
+    MPI_Comm_split(MPI_COMM_WORLD, color, rank, &active_comm);
+    if (active_comm == MPI_COMM_NULL) return;
+
+    MPI_Comm_rank(active_comm, &active_rank);
+    MPI_Comm_size(active_comm, &num_active);
+
+    active_sizes.resize(num_active);
+    active_displs.resize(num_active + 1);
+    MPI_Allgather(&(A->local_num_rows), 1, MPI_INT, active_sizes.data(), 1,
+            MPI_INT, active_comm);
+    active_displs[0] = 0;
+    for (int i = 0; i < num_active; i++)
+    {
+        active_displs[i+1] = active_displs[i] + active_sizes[i];
+    }
+}
+
+
+/**************************************************************
+ *****   Coarse Solve (Multiple Vectors)
+ **************************************************************
+ ***** Default for backends without a block solve: solves for 
+ ***** each vector of b separately.
+ **************************************************************/
+void ParCoarseSolver::solve(ParCSRMatrix* A, ParMultiVector& x, 
+        ParMultiVector& b)
+{
+    ParVector x_v(b.global_n, b.local_n, b.first_local);
+    ParVector b_v(b.global_n, b.local_n, b.first_local);
+    for (int v = 0; v < b.num_vectors; v++)
+    {
+        b.get_vector(v, b_v);
+        x.get_vector(v, x_v);
+        solve(A, x_v, b_v);
+        x.set_vector(v, x_v);
+    }
+}
+
+
+/**************************************************************
+ *****   Dense Coarse Solver Setup
+ **************************************************************
+ ***** Allgathers A onto every active process as a dense
+ ***** coarse_n x coarse_n array and factors it with dgetrf.
+ **************************************************************/
+void ParDenseCoarseSolver::setup(ParCSRMatrix* A)
+{
+    int num_active;
+    index_t global_col;
+    int local_col;
+    int start, end;
+
+    form_active_comm(A);
+    if (active_comm == MPI_COMM_NULL) return;
+
+    MPI_Comm_size(active_comm, &num_active);
+
+    aligned_vector<double> A_coarse_lcl;
+    aligned_vector<int> coarse_sizes(num_active);
+    aligned_vector<int> coarse_displs(num_active + 1);
+    aligned_vector<index_t> global_row_indices(coarse_n);
+
+    // Gather global row indices
+    MPI_Allgatherv(A->local_row_map.data(), A->local_num_rows, MPI_INDEX_T,
+            global_row_indices.data(), active_sizes.data(),
+            active_displs.data(), MPI_INDEX_T, active_comm);
+
+    std::map<index_t, int> global_to_local;
+    int ctr = 0;
+    for (aligned_vector<index_t>::iterator it = global_row_indices.begin();
+            it != global_row_indices.end(); ++it)
+    {
+        global_to_local[*it] = ctr++;
+    }
+
+    A_coarse_lcl.resize(coarse_n*A->local_num_rows, 0);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        start = A->on_proc->idx1[i];
+        end = A->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            global_col = A->on_proc_column_map[A->on_proc->idx2[j]];
+            local_col = global_to_local[global_col];
+            A_coarse_lcl[i*coarse_n + local_col] = A->on_proc->vals[j];
+        }
+
+        start = A->off_proc->idx1[i];
+        end = A->off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            global_col = A->off_proc_column_map[A->off_proc->idx2[j]];
+            local_col = global_to_local[global_col];
+            A_coarse_lcl[i*coarse_n + local_col] = A->off_proc->vals[j];
+        }
+    }
+
+    coarse_displs[0] = 0;
+    for (int i = 0; i < num_active; i++)
+    {
+        coarse_sizes[i] = active_sizes[i] * coarse_n;
+        coarse_displs[i+1] = active_displs[i+1] * coarse_n;
+    }
+
+    A_coarse.resize(coarse_n*coarse_n);
+    MPI_Allgatherv(A_coarse_lcl.data(), A_coarse_lcl.size(), MPI_DOUBLE,
+            A_coarse.data(), coarse_sizes.data(), coarse_displs.data(),
+            MPI_DOUBLE, active_comm);
+
+    LU_permute.resize(coarse_n);
+    int info;
+    dgetrf_(&coarse_n, &coarse_n, A_coarse.data(), &coarse_n,
+            LU_permute.data(), &info);
+}
+
+/**************************************************************
+ *****   Dense Coarse Solver Solve
+ **************************************************************
+ ***** Allgathers b onto every active process, solves with
+ ***** dgetrs, and copies the local portion into x.
+ **************************************************************/
+void ParDenseCoarseSolver::solve(ParCSRMatrix* A, ParVector& x, ParVector& b)
+{
+    if (active_comm == MPI_COMM_NULL) return;
+
+    int active_rank;
+    MPI_Comm_rank(active_comm, &active_rank);
+
+    char trans = 'N'; //No transpose
+    int nhrs = 1; // Number of right hand sides
+    int info; // result
+
+    aligned_vector<double> b_data(coarse_n);
+    MPI_Allgatherv(b.local.data(), b.local_n, MPI_DOUBLE, b_data.data(),
+            active_sizes.data(), active_displs.data(), MPI_DOUBLE, active_comm);
+
+    dgetrs_(&trans, &coarse_n, &nhrs, A_coarse.data(), &coarse_n,
+            LU_permute.data(), b_data.data(), &coarse_n, &info);
+    for (int i = 0; i < b.local_n; i++)
+    {
+        x.local[i] = b_data[i + active_displs[active_rank]];
+    }
+}
+
+
+/**************************************************************
+ *****   Dense Coarse Solve (Multiple Vectors)
+ **************************************************************
+ ***** Gathers all k right-hand sides at once and solves them
+ ***** with a single dgetrs call (nrhs = k).  dgetrs expects
+ ***** column-major right-hand sides, so the interleaved values
+ ***** are transposed after the gather.
+ **************************************************************/
+void ParDenseCoarseSolver::solve(ParCSRMatrix* A, ParMultiVector& x, 
+        ParMultiVector& b)
+{
+    if (active_comm == MPI_COMM_NULL) return;
+
+    int active_rank, num_active;
+    MPI_Comm_rank(active_comm, &active_rank);
+    MPI_Comm_size(active_comm, &num_active);
+
+    char trans = 'N';
+    int k = b.num_vectors;
+    int info;
+
+    aligned_vector<int> sizes(num_active);
+    aligned_vector<int> displs(num_active);
+    for (int i = 0; i < num_active; i++)
+    {
+        sizes[i] = active_sizes[i] * k;
+        displs[i] = active_displs[i] * k;
+    }
+
+    aligned_vector<double> b_gather(coarse_n * k);
+    aligned_vector<double> b_data(coarse_n * k);
+    MPI_Allgatherv(b.values.data(), b.local_n * k, MPI_DOUBLE, b_gather.data(),
+            sizes.data(), displs.data(), MPI_DOUBLE, active_comm);
+    for (int i = 0; i < coarse_n; i++)
+    {
+        for (int v = 0; v < k; v++)
+        {
+            b_data[v*coarse_n + i] = b_gather[i*k + v];
+        }
+    }
+
+    dgetrs_(&trans, &coarse_n, &k, A_coarse.data(), &coarse_n,
+            LU_permute.data(), b_data.data(), &coarse_n, &info);
+
+    int first = active_displs[active_rank];
+    for (int i = 0; i < b.local_n; i++)
+    {
+        for (int v = 0; v < k; v++)
+        {
+            x.values[i*k + v] = b_data[v*coarse_n + first + i];
+        }
+    }
+}
+
+
+/**************************************************************
+ *****   Sparse Coarse Solver Setup
+ **************************************************************
+ ***** Gathers A (CSR, global column indices) onto the root of
+ ***** the active communicator, which then computes the sparse
+ ***** LU factorization.  Only the root stores the factors.
+ **************************************************************/
+void ParSparseCoarseSolver::setup(ParCSRMatrix* A)
+{
+    int active_rank, num_active;
+    int start, end;
+    int local_nnz;
+
+    form_active_comm(A);
+    if (active_comm == MPI_COMM_NULL) return;
+
+    MPI_Comm_rank(active_comm, &active_rank);
+    MPI_Comm_size(active_comm, &num_active);
+
+    // Form local rows with global column indices
+    aligned_vector<int> local_row_sizes(A->local_num_rows);
+    aligned_vector<index_t> local_cols;
+    aligned_vector<double> local_vals;
+    local_cols.reserve(A->local_nnz);
+    local_vals.reserve(A->local_nnz);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        start = A->on_proc->idx1[i];
+        end = A->on_proc->idx1[i+1];
+        local_row_sizes[i] = (end - start) + 
+            (A->off_proc->idx1[i+1] - A->off_proc->idx1[i]);
+        for (int j = start; j < end; j++)
+        {
+            local_cols.push_back(A->on_proc_column_map[A->on_proc->idx2[j]]);
+            local_vals.push_back(A->on_proc->vals[j]);
+        }
+
+        start = A->off_proc->idx1[i];
+        end = A->off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            local_cols.push_back(A->off_proc_column_map[A->off_proc->idx2[j]]);
+            local_vals.push_back(A->off_proc->vals[j]);
+        }
+    }
+    local_nnz = local_cols.size();
+
+    // Gather row indices, row sizes, and nnz per process to root
+    aligned_vector<index_t> global_rows;
+    aligned_vector<int> row_sizes;
+    aligned_vector<int> nnz_sizes;
+    aligned_vector<int> nnz_displs;
+    if (active_rank == 0)
+    {
+        global_rows.resize(coarse_n);
+        row_sizes.resize(coarse_n);
+        nnz_sizes.resize(num_active);
+        nnz_displs.resize(num_active + 1);
+    }
+    MPI_Gatherv(A->local_row_map.data(), A->local_num_rows, MPI_INDEX_T,
+            global_rows.data(), active_sizes.data(), active_displs.data(),
+            MPI_INDEX_T, 0, active_comm);
+    MPI_Gatherv(local_row_sizes.data(), A->local_num_rows, MPI_INT,
+            row_sizes.data(), active_sizes.data(), active_displs.data(),
+            MPI_INT, 0, active_comm);
+    MPI_Gather(&local_nnz, 1, MPI_INT, nnz_sizes.data(), 1, MPI_INT, 0,
+            active_comm);
+
+    aligned_vector<index_t> global_cols;
+    aligned_vector<int> cols;
+    aligned_vector<double> vals;
+    if (active_rank == 0)
+    {
+        nnz_displs[0] = 0;
+        for (int i = 0; i < num_active; i++)
+        {
+            nnz_displs[i+1] = nnz_displs[i] + nnz_sizes[i];
+        }
+        global_cols.resize(nnz_displs[num_active]);
+        cols.resize(nnz_displs[num_active]);
+        vals.resize(nnz_displs[num_active]);
+    }
+    MPI_Gatherv(local_cols.data(), local_nnz, MPI_INDEX_T, global_cols.data(),
+            nnz_sizes.data(), nnz_displs.data(), MPI_INDEX_T, 0, active_comm);
+    MPI_Gatherv(local_vals.data(), local_nnz, MPI_DOUBLE, vals.data(),
+            nnz_sizes.data(), nnz_displs.data(), MPI_DOUBLE, 0, active_comm);
+
+    if (active_rank == 0)
+    {
+        // Map global columns to position in gathered row order
+        std::map<index_t, int> global_to_local;
+        for (int i = 0; i < coarse_n; i++)
+        {
+            global_to_local[global_rows[i]] = i;
+        }
+        for (int i = 0; i < (int) cols.size(); i++)
+        {
+            cols[i] = global_to_local[global_cols[i]];
+        }
+
+        aligned_vector<int> rowptr(coarse_n + 1);
+        rowptr[0] = 0;
+        for (int i = 0; i < coarse_n; i++)
+        {
+            rowptr[i+1] = rowptr[i] + row_sizes[i];
+        }
+
+        factor(rowptr, cols, vals);
+
+        b_data.resize(coarse_n);
+        x_data.resize(coarse_n);
+    }
+}
+
+/**************************************************************
+ *****   Sparse LU Factorization
+ **************************************************************
+ ***** Orders the gathered matrix with reverse Cuthill-McKee to
+ ***** limit fill, and then computes the row-oriented (IKJ) LU
+ ***** factorization without pivoting.  Galerkin coarse matrices
+ ***** of SPD systems are SPD, so pivoting is not required.  A
+ ***** zero pivot (e.g. singular Neumann coarse level) is
+ ***** replaced by 1.0, fixing the null space component.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** rowptr : aligned_vector<int>&
+ *****    Row pointer of gathered matrix
+ ***** cols : aligned_vector<int>&
+ *****    Column indices (gathered row order)
+ ***** vals : aligned_vector<double>&
+ *****    Values of gathered matrix
+ **************************************************************/
+void ParSparseCoarseSolver::factor(const aligned_vector<int>& rowptr,
+        const aligned_vector<int>& cols, const aligned_vector<double>& vals)
+{
+    int n = coarse_n;
+    int start, end, col;
+    int row, k;
+    double val, lik;
+
+    // Form symmetric adjacency of pattern(A + A^T)
+    std::vector<std::vector<int>> adj(n);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = rowptr[i]; j < rowptr[i+1]; j++)
+        {
+            col = cols[j];
+            if (col == i) continue;
+            adj[i].push_back(col);
+            adj[col].push_back(i);
+        }
+    }
+    for (int i = 0; i < n; i++)
+    {
+        std::sort(adj[i].begin(), adj[i].end());
+        adj[i].erase(std::unique(adj[i].begin(), adj[i].end()), adj[i].end());
+    }
+
+    // Reverse Cuthill-McKee ordering (perm[new] = old)
+    perm.resize(n);
+    aligned_vector<int> inv_perm(n, -1);
+    aligned_vector<int> nbrs;
+    aligned_vector<int> by_degree(n);
+    std::iota(by_degree.begin(), by_degree.end(), 0);
+    std::stable_sort(by_degree.begin(), by_degree.end(),
+            [&](int a, int b)
+            {
+                return adj[a].size() < adj[b].size();
+            });
+    int head = 0;
+    int tail = 0;
+    int next_root = 0;
+    while (tail < n)
+    {
+        // Start each component at the unvisited row of minimum degree
+        while (inv_perm[by_degree[next_root]] != -1)
+        {
+            next_root++;
+        }
+        int root = by_degree[next_root];
+        perm[tail] = root;
+        inv_perm[root] = tail++;
+        while (head < tail)
+        {
+            row = perm[head++];
+            nbrs.clear();
+            for (std::vector<int>::iterator it = adj[row].begin();
+                    it != adj[row].end(); ++it)
+            {
+                if (inv_perm[*it] == -1)
+                {
+                    nbrs.push_back(*it);
+                }
+            }
+            std::sort(nbrs.begin(), nbrs.end(),
+                    [&](int a, int b)
+                    {
+                        return adj[a].size() < adj[b].size();
+                    });
+            for (aligned_vector<int>::iterator it = nbrs.begin(); it != nbrs.end(); ++it)
+            {
+                perm[tail] = *it;
+                inv_perm[*it] = tail++;
+            }
+        }
+    }
+    std::reverse(perm.begin(), perm.end());
+    for (int i = 0; i < n; i++)
+    {
+        inv_perm[perm[i]] = i;
+    }
+
+    // IKJ sparse LU on permuted matrix
+    aligned_vector<double> work(n, 0.0);
+    aligned_vector<bool> in_row(n, false);
+    std::set<int> pattern;
+
+    L_rowptr.resize(n + 1);
+    U_rowptr.resize(n + 1);
+    L_rowptr[0] = 0;
+    U_rowptr[0] = 0;
+    L_cols.clear();
+    L_vals.clear();
+    U_cols.clear();
+    U_vals.clear();
+    for (int i = 0; i < n; i++)
+    {
+        row = perm[i];
+        start = rowptr[row];
+        end = rowptr[row+1];
+        for (int j = start; j < end; j++)
+        {
+            col = inv_perm[cols[j]];
+            if (!in_row[col])
+            {
+                in_row[col] = true;
+                pattern.insert(col);
+            }
+            work[col] += vals[j];
+        }
+
+        // Eliminate entries left of the diagonal (new fill is always
+        // to the right of k, so iterators remain ordered)
+        for (std::set<int>::iterator it = pattern.begin();
+                it != pattern.end() && *it < i; ++it)
+        {
+            k = *it;
+            lik = work[k] / U_vals[U_rowptr[k]];
+            work[k] = lik;
+            for (int j = U_rowptr[k] + 1; j < U_rowptr[k+1]; j++)
+            {
+                col = U_cols[j];
+                if (!in_row[col])
+                {
+                    in_row[col] = true;
+                    pattern.insert(col);
+                }
+                work[col] -= lik * U_vals[j];
+            }
+        }
+
+        // Diagonal first in each row of U
+        val = in_row[i] ? work[i] : 0.0;
+        if (fabs(val) < zero_tol) val = 1.0;
+        U_cols.push_back(i);
+        U_vals.push_back(val);
+        for (std::set<int>::iterator it = pattern.begin(); it != pattern.end(); ++it)
+        {
+            col = *it;
+            if (col < i)
+            {
+                L_cols.push_back(col);
+                L_vals.push_back(work[col]);
+            }
+            else if (col > i)
+            {
+                U_cols.push_back(col);
+                U_vals.push_back(work[col]);
+            }
+            work[col] = 0.0;
+            in_row[col] = false;
+        }
+        pattern.clear();
+        L_rowptr[i+1] = L_cols.size();
+        U_rowptr[i+1] = U_cols.size();
+    }
+}
+
+/**************************************************************
+ *****   Sparse Coarse Solver Solve
+ **************************************************************
+ ***** Gathers b to the active root, performs forward and
+ ***** backward substitution, and scatters x to active procs.
+ **************************************************************/
+void ParSparseCoarseSolver::solve(ParCSRMatrix* A, ParVector& x, ParVector& b)
+{
+    if (active_comm == MPI_COMM_NULL) return;
+
+    int active_rank;
+    int start, end;
+    double val;
+    MPI_Comm_rank(active_comm, &active_rank);
+
+    MPI_Gatherv(b.local.data(), b.local_n, MPI_DOUBLE, b_data.data(),
+            active_sizes.data(), active_displs.data(), MPI_DOUBLE, 0, active_comm);
+
+    if (active_rank == 0)
+    {
+        // Forward substitution (L unit lower triangular)
+        for (int i = 0; i < coarse_n; i++)
+        {
+            val = b_data[perm[i]];
+            start = L_rowptr[i];
+            end = L_rowptr[i+1];
+            for (int j = start; j < end; j++)
+            {
+                val -= L_vals[j] * x_data[L_cols[j]];
+            }
+            x_data[i] = val;
+        }
+
+        // Backward substitution (diagonal first in each row of U)
+        for (int i = coarse_n - 1; i >= 0; i--)
+        {
+            val = x_data[i];
+            start = U_rowptr[i];
+            end = U_rowptr[i+1];
+            for (int j = start + 1; j < end; j++)
+            {
+                val -= U_vals[j] * x_data[U_cols[j]];
+            }
+            x_data[i] = val / U_vals[start];
+        }
+
+        // Undo permutation
+        for (int i = 0; i < coarse_n; i++)
+        {
+            b_data[perm[i]] = x_data[i];
+        }
+    }
+
+    MPI_Scatterv(b_data.data(), active_sizes.data(), active_displs.data(),
+            MPI_DOUBLE, x.local.data(), x.local_n, MPI_DOUBLE, 0, active_comm);
+}
+
+
+/**************************************************************
+ *****   Iterative Coarse Solver Setup
+ **************************************************************
+ ***** Forms the inverse diagonal used as the preconditioner
+ ***** and allocates work vectors.  The ParComm of A is created
+ ***** here (collectively) if it does not yet exist, so that
+ ***** only active processes take part in each solve.
+ **************************************************************/
+void ParIterativeCoarseSolver::setup(ParCSRMatrix* A)
+{
+    int start, end;
+
+    if (A->comm == NULL)
+    {
+        A->comm = new ParComm(A->partition, A->off_proc_column_map,
+                A->on_proc_column_map);
+    }
+
+    form_active_comm(A);
+    if (active_comm == MPI_COMM_NULL) return;
+
+    inv_diag.resize(A->local_num_rows);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        inv_diag[i] = 1.0;
+        start = A->on_proc->idx1[i];
+        end = A->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            if (A->on_proc->idx2[j] == i)
+            {
+                if (fabs(A->on_proc->vals[j]) > zero_tol)
+                {
+                    inv_diag[i] = 1.0 / A->on_proc->vals[j];
+                }
+                break;
+            }
+        }
+    }
+
+    index_t first_local = A->partition->first_local_row;
+    r.resize(A->global_num_rows, A->local_num_rows, first_local);
+    z.resize(A->global_num_rows, A->local_num_rows, first_local);
+    p.resize(A->global_num_rows, A->local_num_rows, first_local);
+    Ap.resize(A->global_num_rows, A->local_num_rows, first_local);
+    Az.resize(A->global_num_rows, A->local_num_rows, first_local);
+}
+
+/**************************************************************
+ *****   Iterative Coarse Solver Solve
+ **************************************************************
+ ***** Jacobi preconditioned CG from a zero initial guess,
+ ***** reducing the residual by tol (relative to b).  Uses the
+ ***** Chronopoulos-Gear recurrence : Ap is updated from Az
+ ***** rather than formed from p, so <r, r>, <r, z> and
+ ***** <Az, z> are computed in a single reduction over the
+ ***** active communicator per iteration.
+ **************************************************************/
+void ParIterativeCoarseSolver::solve(ParCSRMatrix* A, ParVector& x, ParVector& b)
+{
+    if (active_comm == MPI_COMM_NULL) return;
+
+    int n = A->local_num_rows;
+    double alpha, beta;
+    double rz, rz_next, zAz;
+    double b_norm2, r_norm2;
+    double lcl_sums[3];
+    double sums[3];
+
+    x.set_const_value(0.0);
+    for (int i = 0; i < n; i++)
+    {
+        r[i] = b[i];
+        z[i] = inv_diag[i] * r[i];
+        p[i] = 0.0;
+        Ap[i] = 0.0;
+    }
+    A->mult(z, Az);
+    lcl_sums[0] = 0.0;
+    lcl_sums[1] = 0.0;
+    lcl_sums[2] = 0.0;
+    for (int i = 0; i < n; i++)
+    {
+        lcl_sums[0] += r[i] * r[i];
+        lcl_sums[1] += r[i] * z[i];
+        lcl_sums[2] += Az[i] * z[i];
+    }
+    MPI_Allreduce(lcl_sums, sums, 3, MPI_DOUBLE, MPI_SUM, active_comm);
+    b_norm2 = sums[0];
+    rz = sums[1];
+    zAz = sums[2];
+    if (b_norm2 < zero_tol || fabs(zAz) < zero_tol) return;
+
+    alpha = rz / zAz;
+    beta = 0.0;
+    for (int iter = 0; iter < max_iter; iter++)
+    {
+        lcl_sums[0] = 0.0;
+        lcl_sums[1] = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            p[i] = z[i] + beta * p[i];
+            Ap[i] = Az[i] + beta * Ap[i];
+            x[i] += alpha * p[i];
+            r[i] -= alpha * Ap[i];
+            z[i] = inv_diag[i] * r[i];
+            lcl_sums[0] += r[i] * r[i];
+            lcl_sums[1] += r[i] * z[i];
+        }
+        A->mult(z, Az);
+        lcl_sums[2] = 0.0;
+        for (int i = 0; i < n; i++)
+        {
+            lcl_sums[2] += Az[i] * z[i];
+        }
+        MPI_Allreduce(lcl_sums, sums, 3, MPI_DOUBLE, MPI_SUM, active_comm);
+        r_norm2 = sums[0];
+        rz_next = sums[1];
+        zAz = sums[2];
+        if (r_norm2 < tol * tol * b_norm2) break;
+
+        beta = rz_next / rz;
+        rz = rz_next;
+        alpha = rz / (zAz - beta * rz / alpha);
+    }
+}
+
+
+ParCoarseSolver* raptor::create_coarse_solver(ParCSRMatrix* A, coarse_solve_t type,
+        int max_dense_rows, long max_sparse_nnz)
+{
+    if (type == AutoCoarse)
+    {
+        long lcl_nnz = A->local_nnz;
+        long nnz;
+        MPI_Allreduce(&lcl_nnz, &nnz, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+        if (A->global_num_rows <= max_dense_rows)
+        {
+            type = DenseLU;
+        }
+        else if (nnz <= max_sparse_nnz)
+        {
+            type = SparseLU;
+        }
+        else
+        {
+            type = IterativeCG;
+        }
+    }
+
+    switch (type)
+    {
+        case SparseLU:
+            return new ParSparseCoarseSolver();
+        case IterativeCG:
+            return new ParIterativeCoarseSolver();
+        default:
+            return new ParDenseCoarseSolver();
+    }
+}
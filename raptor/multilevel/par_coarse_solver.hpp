@@ -0,0 +1,184 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_ML_PARCOARSESOLVER_H
+#define RAPTOR_ML_PARCOARSESOLVER_H
+
+#include <mpi.h>
+
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "core/par_vector.hpp"
+#include "core/par_multivector.hpp"
+
+/**************************************************************
+ *****   ParCoarseSolver Classes
+ **************************************************************
+ ***** These classes solve the coarsest level of a parallel
+ ***** multigrid hierarchy.  Each backend works only on the
+ ***** processes that hold rows of the coarse matrix (the active
+ ***** communicator), so idle processes return immediately.
+ *****
+ ***** Backends
+ ***** -------------
+ ***** ParDenseCoarseSolver :
+ *****    Allgathers the coarse matrix as a dense array onto every
+ *****    active process and solves with LAPACK LU.  O(n^2) memory
+ *****    per process, so only used for very small coarse levels.
+ ***** ParSparseCoarseSolver :
+ *****    Gathers the coarse matrix in CSR format onto the root of
+ *****    the active communicator, which computes a sparse LU
+ *****    factorization (RCM ordered).  Each solve gathers b to
+ *****    the root and scatters x back.
+ ***** ParIterativeCoarseSolver :
+ *****    Jacobi preconditioned conjugate gradient on the
+ *****    distributed coarse matrix.  No data is gathered.
+ *****
+ ***** Methods
+ ***** -------
+ ***** setup(A)
+ *****    Forms active communicator and factorizes A (if direct)
+ ***** solve(A, x, b)
+ *****    Solves the coarse system Ax = b, for a single vector or
+ *****    for each vector of a ParMultiVector
+ **************************************************************/
+namespace raptor
+{
+    // BLAS LU routine that is used for coarse solve
+    extern "C" void dgetrf_(int* dim1, int* dim2, double* a, int* lda,
+            int* ipiv, int* info);
+    extern "C" void dgetrs_(char *TRANS, int *N, int *NRHS, double *A,
+            int *LDA, int *IPIV, double *B, int *LDB, int *INFO );
+
+    class ParCoarseSolver
+    {
+        public:
+            ParCoarseSolver()
+            {
+                active_comm = MPI_COMM_NULL;
+                coarse_n = 0;
+            }
+
+            virtual ~ParCoarseSolver()
+            {
+                if (active_comm != MPI_COMM_NULL)
+                {
+                    MPI_Comm_free(&active_comm);
+                }
+            }
+
+            virtual void setup(ParCSRMatrix* A) = 0;
+            virtual void solve(ParCSRMatrix* A, ParVector& x, ParVector& b) = 0;
+            virtual void solve(ParCSRMatrix* A, ParMultiVector& x, 
+                    ParMultiVector& b);
+
+            coarse_solve_t type;
+
+        protected:
+            void form_active_comm(ParCSRMatrix* A);
+
+            int coarse_n;
+            MPI_Comm active_comm;
+            aligned_vector<int> active_sizes;
+            aligned_vector<int> active_displs;
+    };
+
+    class ParDenseCoarseSolver : public ParCoarseSolver
+    {
+        public:
+            ParDenseCoarseSolver() : ParCoarseSolver()
+            {
+                type = DenseLU;
+            }
+
+            void setup(ParCSRMatrix* A);
+            void solve(ParCSRMatrix* A, ParVector& x, ParVector& b);
+            void solve(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b);
+
+        protected:
+            aligned_vector<double> A_coarse;
+            aligned_vector<int> LU_permute;
+    };
+
+    class ParSparseCoarseSolver : public ParCoarseSolver
+    {
+        public:
+            ParSparseCoarseSolver() : ParCoarseSolver()
+            {
+                type = SparseLU;
+            }
+
+            void setup(ParCSRMatrix* A);
+            void solve(ParCSRMatrix* A, ParVector& x, ParVector& b);
+            using ParCoarseSolver::solve;
+
+        protected:
+            void factor(const aligned_vector<int>& rowptr,
+                    const aligned_vector<int>& cols,
+                    const aligned_vector<double>& vals);
+
+            // Factors of permuted matrix, only stored on active root
+            // L is unit lower triangular (diagonal not stored)
+            // U is upper triangular, with diagonal first in each row
+            aligned_vector<int> perm;
+            aligned_vector<int> L_rowptr;
+            aligned_vector<int> L_cols;
+            aligned_vector<double> L_vals;
+            aligned_vector<int> U_rowptr;
+            aligned_vector<int> U_cols;
+            aligned_vector<double> U_vals;
+            aligned_vector<double> b_data;
+            aligned_vector<double> x_data;
+    };
+
+    class ParIterativeCoarseSolver : public ParCoarseSolver
+    {
+        public:
+            ParIterativeCoarseSolver(double _tol = 1e-10, int _max_iter = 500)
+                : ParCoarseSolver()
+            {
+                type = IterativeCG;
+                tol = _tol;
+                max_iter = _max_iter;
+            }
+
+            void setup(ParCSRMatrix* A);
+            void solve(ParCSRMatrix* A, ParVector& x, ParVector& b);
+            using ParCoarseSolver::solve;
+
+            double tol;
+            int max_iter;
+
+        protected:
+            aligned_vector<double> inv_diag;
+            ParVector r;
+            ParVector z;
+            ParVector p;
+            ParVector Ap;
+            ParVector Az;
+    };
+
+    /**************************************************************
+     *****   Create Coarse Solver
+     **************************************************************
+     ***** Returns a new coarse solver for the matrix A.  If type is
+     ***** AutoCoarse, the backend is selected from the global size
+     ***** and number of nonzeros of A:
+     *****    - dense LU if num rows <= max_dense_rows
+     *****    - sparse LU if nnz <= max_sparse_nnz
+     *****    - iterative (Jacobi PCG) otherwise
+     *****
+     ***** Parameters
+     ***** -------------
+     ***** A : ParCSRMatrix*
+     *****    Coarsest-level matrix
+     ***** type : coarse_solve_t
+     *****    Requested backend (or AutoCoarse)
+     ***** max_dense_rows : int
+     *****    Largest coarse level solved with dense LU
+     ***** max_sparse_nnz : long
+     *****    Largest coarse nnz solved with sparse LU
+     **************************************************************/
+    ParCoarseSolver* create_coarse_solver(ParCSRMatrix* A, coarse_solve_t type,
+            int max_dense_rows = 1000, long max_sparse_nnz = 2000000);
+}
+#endif
@@ -6,10 +6,13 @@
 #include "core/types.hpp"
 #include "core/par_matrix.hpp"
 #include "core/par_vector.hpp"
+#include "core/par_multivector.hpp"
 
 // Coarse Matrices (A) are CSR
 // Prolongation Matrices (P) are CSR
 // P^T*A*P is then CSR*(CSR*CSR) -- returns CSR Ac
+// Hierarchies of block systems instead hold A_bsr and P_bsr (with A 
+// and P NULL) on all but the coarsest level, whose A is CSR
 namespace raptor
 {
     class ParLevel
@@ -17,17 +20,37 @@ namespace raptor
         public:
             ParLevel()
             {
+                A = NULL;
+                P = NULL;
+                A_bsr = NULL;
+                P_bsr = NULL;
                 AP = NULL;
                 I = NULL;
+                rap_structure = NULL;
+                agg_parts = 0;
+                mpi_comm = MPI_COMM_WORLD;
+                max_eig = 0.0;
+                all_active = true;
+                tap_A = false;
+                tap_P = false;
+                tap_PT = false;
             }
 
             ~ParLevel()
             {
                 delete A;
                 delete P;
+                delete A_bsr;
+                delete P_bsr;
 
                 delete AP;
                 delete I;
+                delete rap_structure;
+
+                if (mpi_comm != MPI_COMM_WORLD && mpi_comm != MPI_COMM_NULL)
+                {
+                    MPI_Comm_free(&mpi_comm);
+                }
             }
 
             ParCSRMatrix* A;
@@ -36,8 +59,59 @@ namespace raptor
             ParVector b;
             ParVector tmp;
 
+            // Level matrix and interpolation of block hierarchies
+            ParBSRMatrix* A_bsr;
+            ParBSRMatrix* P_bsr;
+
             ParCSRMatrix* AP;
             ParCSRMatrix* I;
+
+            // Symbolic structure of the Galerkin product with P, with 
+            // which resetup forms the coarse matrix (NULL until formed)
+            RAPStructure* rap_structure;
+
+            // Number of processes the columns of P were agglomerated 
+            // onto (0 if not agglomerated)
+            int agg_parts;
+
+            // Communicator of the processes holding rows of this level, 
+            // split from MPI_COMM_WORLD on agglomerated levels (processes
+            // keep their world rank, and those without rows hold 
+            // MPI_COMM_NULL)
+            MPI_Comm mpi_comm;
+
+            // Inverse (l1-)diagonal used in relaxation (inverse 
+            // diagonal blocks on block levels)
+            aligned_vector<double> inv_diag;
+
+            // Chebyshev relaxation : estimated spectral radius of D^{-1}A
+            // and work vectors (only formed when relax_type is Chebyshev)
+            double max_eig;
+            ParVector r;
+            ParVector d;
+
+            // Whether every process takes part in cycles on this level
+            // (required by the reductions of the K-cycle)
+            bool all_active;
+
+            // Whether products with A, P, and P^T use TAP communication
+            // (only set when communication is selected with tap_auto)
+            bool tap_A;
+            bool tap_P;
+            bool tap_PT;
+
+            // K-cycle work vectors (resized on the first K-cycle)
+            ParVector k_r;
+            ParVector k_v;
+            ParVector k_c;
+
+            // Work vectors for solving multiple right-hand sides at once
+            // (resized on the first block solve)
+            ParMultiVector x_block;
+            ParMultiVector b_block;
+            ParMultiVector tmp_block;
+            ParMultiVector r_block;
+            ParMultiVector d_block;
     };
 }
 #endif
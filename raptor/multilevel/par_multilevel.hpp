@@ -7,10 +7,12 @@
 #include "core/par_matrix.hpp"
 #include "core/par_vector.hpp"
 #include "multilevel/par_level.hpp"
+#include "multilevel/par_coarse_solver.hpp"
 #include "util/linalg/par_relax.hpp"
 #include "ruge_stuben/par_interpolation.hpp"
 #include "ruge_stuben/par_cf_splitting.hpp"
 #include "multilevel/par_sparsify.hpp"
+#include "util/linalg/repartition.hpp"
 
 #ifdef USING_HYPRE
 #include "_hypre_utilities.h"
@@ -48,31 +50,104 @@
  *****      - Jacobi: weighted jacobi for both on and off proc
  *****      - SOR: weighted jacobi off_proc, SOR on_proc
  *****      - SSOR : weighted jacobi off_proc, SSOR on_proc
+ *****      - Chebyshev : Chebyshev polynomial in D^{-1}A, with the
+ *****            spectral radius of each level estimated in setup
+ *****      - L1Jacobi : jacobi scaled by the l1 norm of each row
+ *****      - L1SOR : SOR with the diagonal increased by the l1 norm
+ *****            of the off_proc row
+ *****    The inverse (l1-)diagonal of each level is formed in setup.
  ***** num_smooth_sweeps : int (defualt 1)
  *****    Number of relaxation sweeps (both pre and post smoothing)
  *****    to be performed during each cycle of the AMG solve.
+ ***** num_pre_sweeps, num_post_sweeps : aligned_vector<int> (default empty)
+ *****    Number of pre- and post-smoothing sweeps on each level.
+ *****    Levels past the end of either use num_smooth_sweeps.
+ ***** cycle_type : cycle_t (default VCycle)
+ *****    Multigrid cycle used in solve.  Options are
+ *****      - VCycle : visits each coarse level once per fine visit
+ *****      - WCycle : visits each coarse level twice per fine visit
+ *****      - FCycle : an F-cycle followed by a V-cycle on each coarse
+ *****            level
+ *****      - KCycle : two iterations of flexible CG on each coarse
+ *****            level, preconditioned by a K-cycle
+ ***** kcycle_tol : double (default 0.25)
+ *****    The K-cycle skips its second iteration if the first reduces
+ *****    the coarse residual by this factor
+ ***** mixed_precision : bool (default false)
+ *****    Store interpolation and all level matrices other than the 
+ *****    finest and coarsest in single precision after setup.  They
+ *****    are applied with double accumulation, and the finest level
+ *****    (residuals of solve and any outer Krylov method) stays in 
+ *****    double precision.
+ ***** revisit_agglomerated : bool (default false)
+ *****    Whether W-, F-, and K-cycles revisit levels on agglomerated
+ *****    sub-communicators, rather than visiting them once.  The
+ *****    K-cycle never accelerates levels on which any process idles.
  ***** relax_weight : double
  *****    Weight used in Jacobi, SOR, or SSOR
+ ***** chebyshev_degree : int (default 2)
+ *****    Degree of Chebyshev polynomial (SpMVs per sweep)
+ ***** chebyshev_ratio : double (default 0.3)
+ *****    Chebyshev damps eigenvalues of D^{-1}A above this fraction
+ *****    of the estimated spectral radius
  ***** max_coarse : int (default 50)
  *****    Maximum global num rows allowed in coarsest matrix
  ***** max_levels : int (default -1)
  *****    Maximum number of levels in hierarchy, or no maximum if -1
+ ***** coarse_solve_type : coarse_solve_t (default AutoCoarse)
+ *****    Solver used on coarsest level.  Options are
+ *****      - DenseLU : dense LU replicated on active processes
+ *****      - SparseLU : sparse LU gathered onto one active process
+ *****      - IterativeCG : Jacobi preconditioned CG
+ *****      - AutoCoarse : chosen from coarse size and nnz
+ ***** max_dense_coarse : int (default 1000)
+ *****    Largest coarse level (global rows) AutoCoarse solves with DenseLU
+ ***** max_sparse_coarse_nnz : long (default 2000000)
+ *****    Largest coarse nnz AutoCoarse solves with SparseLU
+ ***** agglomerate_rows : int (default 0)
+ *****    If positive, a coarse level averaging fewer rows per active
+ *****    process is redistributed onto the first (num rows /
+ *****    agglomerate_rows) processes (with repartition_matrix), which
+ *****    communicate on agglomerated levels through a communicator 
+ *****    split from MPI_COMM_WORLD.  Processes left without rows skip
+ *****    all coarser levels of each cycle.  TAP communication is not
+ *****    used on agglomerated levels.
+ ***** overlap_relax : bool (default false)
+ *****    Relax interior rows of each level while halo values are
+ *****    communicated (changes the row order of SOR and SSOR)
+ ***** comm_mode : comm_mode_t (default StandardComm)
+ *****    How level matrices exchange halo values in the solve phase.
+ *****    NeighborComm and SharedComm are only used on levels where
+ *****    every process holds rows, with PersistentComm used on all
+ *****    other levels.
+ ***** tap_auto : bool (default false)
+ *****    Choose between standard and node-aware (TAP) communication
+ *****    on each level by timing tap_auto_trials products with both,
+ *****    rather than using TAP from level tap_amg down.  Products 
+ *****    with A (used through setup and in the solve) are timed as
+ *****    each level is coarsened, and products with A, P, and P^T
+ *****    in the solve are timed again once the hierarchy is formed.
+ *****    Communicators that lose every comparison are freed, and 
+ *****    print_level_comms() reports the choices.
+ ***** tap_auto_trials : int (default 5)
+ *****    Number of timed products per operation when tap_auto is set
  ***** 
  ***** Methods
  ***** -------
  ***** solve(x, b, num_iters)
  *****    Solves system Ax = b, performing at most num_iters iterations
  *****    of AMG.
+ ***** setup(ParBSRMatrix* Af)
+ *****    Solvers supporting block systems (smoothed aggregation) 
+ *****    keep every level but the coarsest in BSR form, coarsening 
+ *****    nodes (block rows).  Block levels relax with block Jacobi 
+ *****    (weighted by relax_weight, whatever relax_type), and do
+ *****    not support TAP communication, agglomeration, 
+ *****    sparsification, mixed precision, resetup, or block solves.
  **************************************************************/
 
 namespace raptor
 {
-    // BLAS LU routine that is used for coarse solve
-    extern "C" void dgetrf_(int* dim1, int* dim2, double* a, int* lda, 
-            int* ipiv, int* info);
-    extern "C" void dgetrs_(char *TRANS, int *N, int *NRHS, double *A, 
-            int *LDA, int *IPIV, double *B, int *LDB, int *INFO );
-
     class ParMultilevel
     {
         public:
@@ -102,14 +177,28 @@ namespace raptor
                 n_solve_times = 0;
                 solve_tol = 1e-07;
                 max_iterations = 100;
+                coarse_solve_type = AutoCoarse;
+                max_dense_coarse = 1000;
+                max_sparse_coarse_nnz = 2000000;
+                coarse_solver = NULL;
+                agglomerate_rows = 0;
+                agglomerate_level = -1;
+                comm_mode = StandardComm;
+                overlap_relax = false;
+                chebyshev_degree = 2;
+                chebyshev_ratio = 0.3;
+                cycle_type = VCycle;
+                kcycle_tol = 0.25;
+                revisit_agglomerated = false;
+                mixed_precision = false;
+                keep_rap_structure = false;
+                tap_auto = false;
+                tap_auto_trials = 5;
             }
 
             virtual ~ParMultilevel()
             {
-                if (levels[num_levels-1]->A->local_num_rows)
-                {
-                    MPI_Comm_free(&coarse_comm);
-                }
+                delete coarse_solver;
                 for (std::vector<ParLevel*>::iterator it = levels.begin();
                         it != levels.end(); ++it)
                 {
@@ -133,6 +222,7 @@ namespace raptor
                 int last_level = 0;
 
                 t0 = MPI_Wtime();
+                agglomerate_level = -1;
 
                 // Add original, fine level to hierarchy
                 levels.push_back(new ParLevel());
@@ -167,6 +257,7 @@ namespace raptor
                 while (levels[last_level]->A->global_num_rows > max_coarse && 
                         (max_levels == -1 || (int) levels.size() < max_levels))
                 {
+                    if (tap_auto) select_setup_comm(last_level);
                     extend_hierarchy();
                     last_level++;
 
@@ -194,13 +285,447 @@ namespace raptor
                 num_levels = levels.size();
                 delete[] weights;
 
-                // Duplicate coarsest level across all processes that hold any
-                // rows of A_c
+                for (int i = 0; i < num_levels - 1; i++)
+                {
+                    form_P_comm(i);
+                }
+
+                setup_relax();
+
+                // Setup solver for coarsest level
                 if (setup_times) setup_times[0][num_levels - 1] -= MPI_Wtime();
-                duplicate_coarse();
+                setup_coarse();
                 if (setup_times) setup_times[0][num_levels - 1] += MPI_Wtime();
+
+                set_level_comm_modes();
+                if (tap_auto) select_level_comms();
+                setup_cycle();
+
+                if (mixed_precision) set_level_precision(true);
+            }
+
+
+            virtual void setup(ParBSRMatrix* Af)
+            {
+                printf("Block setup is not supported by this solver\n");
+                exit(-1);
+            }
+
+            /**************************************************************
+             *****   Block Setup
+             **************************************************************
+             ***** Forms a hierarchy of block levels from Af, coarsening 
+             ***** with extend_block_hierarchy() until the number of block
+             ***** rows is at most max_coarse.  The coarsest level is
+             ***** converted to CSR for the coarse solver.
+             **************************************************************/
+            void setup_helper(ParBSRMatrix* Af)
+            {
+                int last_level = 0;
+
+                if (tap_amg >= 0 || tap_auto || agglomerate_rows > 0 || 
+                        sparsify_tol > 0.0 || mixed_precision)
+                {
+                    printf("Block hierarchies do not support TAP, agglomeration, "
+                            "sparsification, or mixed precision\n");
+                    exit(-1);
+                }
+                agglomerate_level = -1;
+
+                // Add original, fine level to hierarchy
+                levels.push_back(new ParLevel());
+                levels[0]->A_bsr = Af->copy();
+                if (levels[0]->A_bsr->comm == NULL)
+                {
+                    levels[0]->A_bsr->comm = new ParComm(Af->partition, 
+                            Af->off_proc_column_map, Af->on_proc_column_map);
+                }
+                levels[0]->x.resize(Af->global_num_rows, Af->local_num_rows,
+                        Af->partition->first_local_row);
+                levels[0]->b.resize(Af->global_num_rows, Af->local_num_rows,
+                        Af->partition->first_local_row);
+                levels[0]->tmp.resize(Af->global_num_rows, Af->local_num_rows,
+                        Af->partition->first_local_row);
+
+                for (int i = 0; i < n_setup_times; i++)
+                {
+                    setup_times[i].push_back(0.0);
+                    setup_comm_times[i].push_back(0.0);
+                    setup_mat_comm_times[i].push_back(0.0);
+                }
+
+                // Aggregation weights are per node (block row)
+                if (weights == NULL)
+                {
+                    form_rand_weights(Af->local_num_rows / Af->b_rows, 
+                            Af->partition->first_local_row / Af->b_rows);
+                }
+
+                // Add coarse levels to hierarchy 
+                ParBSRMatrix* A = levels[0]->A_bsr;
+                while (A->global_num_rows / A->b_rows > max_coarse && 
+                        (max_levels == -1 || (int) levels.size() < max_levels))
+                {
+                    extend_block_hierarchy();
+                    last_level++;
+                    A = levels[last_level]->A_bsr;
+
+                    for (int i = 0; i < n_setup_times; i++)
+                    {
+                        setup_times[i].push_back(0.0);
+                        setup_comm_times[i].push_back(0.0);
+                        setup_mat_comm_times[i].push_back(0.0);
+                    }
+                }
+
+                num_levels = levels.size();
+                delete[] weights;
+                weights = NULL;
+
+                // Coarse solvers take CSR matrices
+                ParLevel* lc = levels[num_levels - 1];
+                lc->A = A->to_ParCSR();
+                lc->A->sort();
+                lc->A->on_proc->move_diag();
+                lc->A->comm = new ParComm(lc->A->partition, 
+                        lc->A->off_proc_column_map, lc->A->on_proc_column_map);
+                delete lc->A_bsr;
+                lc->A_bsr = NULL;
+
+                setup_relax();
+
+                // Setup solver for coarsest level
+                if (setup_times) setup_times[0][num_levels - 1] -= MPI_Wtime();
+                setup_coarse();
+                if (setup_times) setup_times[0][num_levels - 1] += MPI_Wtime();
+
+                set_level_comm_modes();
+                setup_cycle();
+            }
+
+            // Adds a block level to the hierarchy (see setup_helper)
+            virtual void extend_block_hierarchy()
+            {
+                printf("Block setup is not supported by this solver\n");
+                exit(-1);
+            }
+
+            // Level matrix and interpolation of level (BSR on block levels)
+            ParMatrix* level_A(int level)
+            {
+                ParLevel* l = levels[level];
+                if (l->A_bsr) return l->A_bsr;
+                return l->A;
+            }
+
+            ParMatrix* level_P(int level)
+            {
+                ParLevel* l = levels[level];
+                if (l->P_bsr) return l->P_bsr;
+                return l->P;
+            }
+
+            // Products with the level matrix and interpolation, through
+            // the ParCSRMatrix overloads on CSR levels
+            void level_residual(int level, ParVector& x, ParVector& b, 
+                    ParVector& r, bool tap = false, data_t* comm_t = NULL)
+            {
+                ParLevel* l = levels[level];
+                if (l->A_bsr) l->A_bsr->residual(x, b, r, tap, comm_t);
+                else l->A->residual(x, b, r, tap, comm_t);
+            }
+
+            void level_mult(int level, ParVector& x, ParVector& b, 
+                    bool tap = false)
+            {
+                ParLevel* l = levels[level];
+                if (l->A_bsr) l->A_bsr->mult(x, b, tap);
+                else l->A->mult(x, b, tap);
+            }
+
+            void level_restrict(int level, ParVector& r, ParVector& bc, 
+                    bool tap = false, data_t* comm_t = NULL)
+            {
+                ParLevel* l = levels[level];
+                if (l->P_bsr) l->P_bsr->mult_T(r, bc, tap, comm_t);
+                else l->P->mult_T(r, bc, tap, comm_t);
+            }
+
+            void level_interpolate(int level, ParVector& xc, ParVector& x, 
+                    bool tap = false, data_t* comm_t = NULL)
+            {
+                ParLevel* l = levels[level];
+                if (l->P_bsr) l->P_bsr->mult(xc, x, tap, comm_t);
+                else l->P->mult(xc, x, tap, comm_t);
+            }
+
+            /**************************************************************
+             *****   Re-setup Hierarchy
+             **************************************************************
+             ***** Updates the hierarchy for a new fine matrix Af, with the
+             ***** same sparsity pattern as the matrix passed to setup()
+             ***** but new values.  The CF splitting (or aggregates), the 
+             ***** pattern of each interpolation and coarse matrix, and all
+             ***** communication packages are reused.  Only interpolation 
+             ***** weights are recomputed (and copied into the pattern of
+             ***** setup), and each coarse matrix is formed with a numeric 
+             ***** pass over the symbolic structure of its Galerkin 
+             ***** product.  If Af has a different sparsity pattern, 
+             ***** resetup fails.  A sparsified hierarchy is setup from 
+             ***** scratch.
+             *****
+             ***** Parameters
+             ***** -------------
+             ***** Af : ParCSRMatrix*
+             *****    New fine matrix
+             **************************************************************/
+            void resetup(ParCSRMatrix* Af)
+            {
+                if (!levels.empty() && levels[0]->A_bsr)
+                {
+                    printf("Resetup is not supported for block hierarchies\n");
+                    exit(-1);
+                }
+                if (levels.empty() || sparsify_tol > 0.0)
+                {
+                    clear_hierarchy();
+                    setup(Af);
+                    return;
+                }
+
+                set_level_precision(false);
+
+                ParCSRMatrix* A = Af->copy();
+                A->sort();
+                A->on_proc->move_diag();
+                if (!levels[0]->A->copy_values(A))
+                {
+                    printf("Resetup requires a matrix with the sparsity pattern of setup\n");
+                    exit(-1);
+                }
+                delete A;
+
+                for (int level = 0; level < num_levels - 1; level++)
+                {
+                    ParLevel* l = levels[level];
+                    ParLevel* l_coarse = levels[level+1];
+
+                    // Interpolation weights from splitting of setup(), with
+                    // columns numbered as in l->P (renumbered contiguously 
+                    // on agglomerated levels)
+                    ParCSRMatrix* P = reform_interpolation(level);
+                    if (P && l->agg_parts)
+                    {
+                        ParCSRMatrix* P_cont = contiguous_cols(P);
+                        delete P;
+                        P = P_cont;
+                    }
+                    if (P)
+                    {
+                        fill_interpolation(l->P, P);
+                        delete P;
+                    }
+
+                    if (l->rap_structure)
+                    {
+                        l->A->RAP_numeric(l->P, l_coarse->A, l->rap_structure);
+                        continue;
+                    }
+
+                    // Levels without a structure form it on the first 
+                    // resetup, over the final P
+                    l->rap_structure = new RAPStructure();
+                    ParCSRMatrix* Ac = l->A->RAP_symbolic(l->P, l->rap_structure);
+                    if (!l_coarse->A->copy_values(Ac))
+                    {
+                        printf("Galerkin product on level %d changed pattern\n", level);
+                        exit(-1);
+                    }
+                    delete Ac;
+                }
+
+                setup_relax();
+                setup_coarse();
+                set_level_comm_modes();
+
+                if (mixed_precision) set_level_precision(true);
+            }
+
+            // Stores the preconditioner matrices (P of each level, and A
+            // of all but the finest and coarsest levels) in single or
+            // double precision
+            void set_level_precision(bool single)
+            {
+                for (int i = 0; i < num_levels - 1; i++)
+                {
+                    ParLevel* l = levels[i];
+                    if (single)
+                    {
+                        if (i > 0) l->A->to_single();
+                        l->P->to_single();
+                    }
+                    else
+                    {
+                        l->A->to_double();
+                        l->P->to_double();
+                    }
+                }
+            }
+
+            /**************************************************************
+             *****   Fill Interpolation
+             **************************************************************
+             ***** Copies the values of P_new (with the same rows as P) into
+             ***** the pattern of P, matching columns by global index.  
+             ***** Entries of P not in P_new are set to zero, and entries 
+             ***** of P_new outside the pattern of P are dropped.  The 
+             ***** order of entries of P is unchanged.
+             **************************************************************/
+            void fill_interpolation(ParCSRMatrix* P, ParCSRMatrix* P_new)
+            {
+                int n_on = P->on_proc_num_cols;
+                int on_nnz = P->on_proc->nnz;
+                int start, end, idx;
+
+                // Local column of P (on_proc, then off_proc) of each 
+                // column of P_new, or -1
+                std::map<index_t, int> global_to_P;
+                for (int i = 0; i < n_on; i++)
+                {
+                    global_to_P[P->on_proc_column_map[i]] = i;
+                }
+                for (int i = 0; i < P->off_proc_num_cols; i++)
+                {
+                    global_to_P[P->off_proc_column_map[i]] = n_on + i;
+                }
+                aligned_vector<int> on_to_P(P_new->on_proc_num_cols, -1);
+                aligned_vector<int> off_to_P(P_new->off_proc_num_cols, -1);
+                for (int i = 0; i < P_new->on_proc_num_cols; i++)
+                {
+                    std::map<index_t, int>::iterator it = 
+                        global_to_P.find(P_new->on_proc_column_map[i]);
+                    if (it != global_to_P.end()) on_to_P[i] = it->second;
+                }
+                for (int i = 0; i < P_new->off_proc_num_cols; i++)
+                {
+                    std::map<index_t, int>::iterator it = 
+                        global_to_P.find(P_new->off_proc_column_map[i]);
+                    if (it != global_to_P.end()) off_to_P[i] = it->second;
+                }
+
+                // Position of each column in the current row of P
+                // (on_proc entries, then on_nnz + off_proc entries)
+                aligned_vector<int> pos(n_on + P->off_proc_num_cols, -1);
+                for (int i = 0; i < P->local_num_rows; i++)
+                {
+                    start = P->on_proc->idx1[i];
+                    end = P->on_proc->idx1[i+1];
+                    for (int j = start; j < end; j++)
+                    {
+                        pos[P->on_proc->idx2[j]] = j;
+                        P->on_proc->vals[j] = 0.0;
+                    }
+                    start = P->off_proc->idx1[i];
+                    end = P->off_proc->idx1[i+1];
+                    for (int j = start; j < end; j++)
+                    {
+                        pos[n_on + P->off_proc->idx2[j]] = on_nnz + j;
+                        P->off_proc->vals[j] = 0.0;
+                    }
+
+                    start = P_new->on_proc->idx1[i];
+                    end = P_new->on_proc->idx1[i+1];
+                    for (int j = start; j < end; j++)
+                    {
+                        idx = on_to_P[P_new->on_proc->idx2[j]];
+                        if (idx < 0 || pos[idx] < 0) continue;
+                        if (pos[idx] < on_nnz) 
+                            P->on_proc->vals[pos[idx]] += P_new->on_proc->vals[j];
+                        else P->off_proc->vals[pos[idx] - on_nnz] += P_new->on_proc->vals[j];
+                    }
+                    start = P_new->off_proc->idx1[i];
+                    end = P_new->off_proc->idx1[i+1];
+                    for (int j = start; j < end; j++)
+                    {
+                        idx = off_to_P[P_new->off_proc->idx2[j]];
+                        if (idx < 0 || pos[idx] < 0) continue;
+                        if (pos[idx] < on_nnz) 
+                            P->on_proc->vals[pos[idx]] += P_new->off_proc->vals[j];
+                        else P->off_proc->vals[pos[idx] - on_nnz] += P_new->off_proc->vals[j];
+                    }
+
+                    start = P->on_proc->idx1[i];
+                    end = P->on_proc->idx1[i+1];
+                    for (int j = start; j < end; j++)
+                    {
+                        pos[P->on_proc->idx2[j]] = -1;
+                    }
+                    start = P->off_proc->idx1[i];
+                    end = P->off_proc->idx1[i+1];
+                    for (int j = start; j < end; j++)
+                    {
+                        pos[n_on + P->off_proc->idx2[j]] = -1;
+                    }
+                }
             }
 
+            /**************************************************************
+             *****   Galerkin Product
+             **************************************************************
+             ***** Returns P^T*A*P for the matrix A of level, keeping 
+             ***** structural zeros so that the pattern of the coarse 
+             ***** matrix depends only on the patterns of A and P.  The 
+             ***** product is formed in blocks of rows, and its symbolic 
+             ***** structure is formed by the first resetup.  If 
+             ***** keep_rap_structure is set, the structure is instead 
+             ***** recorded here (holding A*P for the life of the 
+             ***** hierarchy), except on levels with TAP communication or 
+             ***** agglomerated coarse levels.
+             **************************************************************/
+            ParCSRMatrix* galerkin_product(int level, ParCSRMatrix* P, 
+                    data_t* comm_t = NULL)
+            {
+                ParLevel* l = levels[level];
+                bool tap_level = use_tap(level);
+
+                if (sparsify_tol > 0.0) return l->A->RAP(P, tap_level, comm_t);
+                if (!keep_rap_structure || tap_level || l->agg_parts) 
+                {
+                    return l->A->RAP(P, tap_level, comm_t, true);
+                }
+
+                l->rap_structure = new RAPStructure();
+                return l->A->RAP_symbolic(P, l->rap_structure, comm_t);
+            }
+
+            // Recomputes levels[level]->P from the current values of 
+            // levels[level]->A, reusing the splitting (or aggregates) of
+            // setup().  Returns NULL if P is kept as is.
+            virtual ParCSRMatrix* reform_interpolation(int level)
+            {
+                return NULL;
+            }
+
+            // Removes all levels (and timers) of the hierarchy
+            virtual void clear_hierarchy()
+            {
+                delete coarse_solver;
+                coarse_solver = NULL;
+                for (std::vector<ParLevel*>::iterator it = levels.begin();
+                        it != levels.end(); ++it)
+                {
+                    delete *it;
+                }
+                levels.clear();
+                num_levels = 0;
+
+                delete[] setup_times;
+                delete[] setup_comm_times;
+                delete[] setup_mat_comm_times;
+                setup_times = NULL;
+                setup_comm_times = NULL;
+                setup_mat_comm_times = NULL;
+            }
 
             void form_rand_weights(int local_n, int first_n)
             {
@@ -216,121 +741,516 @@ namespace raptor
                 
             virtual void extend_hierarchy() = 0;
 
-            void duplicate_coarse()
+            // TAP communication is used from level tap_amg down to the
+            // first agglomerated level, or on the levels (and for the 
+            // operations) selected with tap_auto
+            bool use_tap(int level)
             {
-                int rank, num_procs;
-                MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-                MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+                if (agglomerate_level >= 0 && level >= agglomerate_level) return false;
+                if (tap_auto) return level < (int) levels.size() && levels[level]->tap_A;
+                if (tap_amg < 0 || tap_amg > level) return false;
+                return true;
+            }
+
+            bool use_tap_P(int level)
+            {
+                if (tap_auto) return levels[level]->tap_P;
+                return use_tap(level);
+            }
 
-                int last_level = num_levels - 1;
-                ParCSRMatrix* Ac = levels[last_level]->A;
-                aligned_vector<int> proc_sizes(num_procs);
-                aligned_vector<int> active_procs;
-                MPI_Allgather(&(Ac->local_num_rows), 1, MPI_INT, proc_sizes.data(),
-                        1, MPI_INT, MPI_COMM_WORLD);
-                for (int i = 0; i < num_procs; i++)
+            bool use_tap_PT(int level)
+            {
+                if (tap_auto) return levels[level]->tap_PT;
+                return use_tap(level);
+            }
+
+            /**************************************************************
+             *****   Time Level Product
+             **************************************************************
+             ***** Returns the time of num_trials products with A (op 0),
+             ***** P (op 1), or P^T (op 2) of level, communicating with
+             ***** TAPComm if tap is set and ParComm otherwise.  The time
+             ***** is that of the slowest process, so every process makes
+             ***** the same choice from it.
+             **************************************************************/
+            double time_level_product(int level, int op, bool tap, 
+                    int num_trials)
+            {
+                ParLevel* l = levels[level];
+                double t0, t;
+
+                MPI_Barrier(MPI_COMM_WORLD);
+                t0 = MPI_Wtime();
+                for (int i = 0; i < num_trials; i++)
                 {
-                    if (proc_sizes[i])
+                    if (op == 0)
+                        l->A->mult(l->x, l->tmp, tap);
+                    else if (op == 1)
+                        l->P->mult(levels[level+1]->x, l->tmp, tap);
+                    else
+                        l->P->mult_T(l->tmp, levels[level+1]->b, tap);
+                }
+                t = MPI_Wtime() - t0;
+                MPI_Allreduce(MPI_IN_PLACE, &t, 1, MPI_DOUBLE, MPI_MAX, 
+                        MPI_COMM_WORLD);
+
+                return t;
+            }
+
+            // Whether products of op (as in time_level_product) on level
+            // are faster with TAP communication.  An untimed product with 
+            // each communicator forms any missing TAPComm and initializes
+            // persistent requests or windows first.
+            bool faster_tap(int level, int op)
+            {
+                time_level_product(level, op, false, 1);
+                time_level_product(level, op, true, 1);
+                double t_std = time_level_product(level, op, false, tap_auto_trials);
+                double t_tap = time_level_product(level, op, true, tap_auto_trials);
+                return t_tap < t_std;
+            }
+
+            // Chooses the communication of levels[level]->A before the
+            // level is coarsened, so strength, coarsening, interpolation, 
+            // and the Galerkin product use the faster for A's pattern
+            void select_setup_comm(int level)
+            {
+                if (agglomerate_level >= 0 && level >= agglomerate_level) return;
+
+                ParLevel* l = levels[level];
+                l->x.set_const_value(1.0);
+                l->tap_A = faster_tap(level, 0);
+            }
+
+            /**************************************************************
+             *****   Select Level Communication
+             **************************************************************
+             ***** Times products with A, P, and P^T of each (non-
+             ***** agglomerated) level with both communicators, in the
+             ***** comm_mode of the solve, and keeps the faster for each.
+             ***** TAPComms no longer used are freed.
+             **************************************************************/
+            void select_level_comms()
+            {
+                for (int i = 0; i < num_levels - 1; i++)
+                {
+                    if (agglomerate_level >= 0 && i >= agglomerate_level) break;
+
+                    ParLevel* l = levels[i];
+                    ParCSRMatrix* P = l->P;
+
+                    // Form TAPComms first, so they are timed in comm_mode
+                    if (!l->A->tap_comm)
                     {
-                        active_procs.push_back(i);
+                        l->A->tap_comm = new TAPComm(l->A->partition, 
+                                l->A->off_proc_column_map, l->A->on_proc_column_map);
                     }
+                    if (!P->tap_comm)
+                    {
+                        P->tap_comm = new TAPComm(P->partition, 
+                                P->off_proc_column_map, P->on_proc_column_map);
+                    }
+                    set_matrix_comm_mode(l->A, level_comm_mode(i));
+                    set_matrix_comm_mode(P, level_comm_mode(i));
+
+                    l->x.set_const_value(1.0);
+                    levels[i+1]->x.set_const_value(1.0);
+                    l->tap_A = faster_tap(i, 0);
+                    l->tap_P = faster_tap(i, 1);
+                    l->tap_PT = faster_tap(i, 2);
+
+                    if (!l->tap_A)
+                    {
+                        delete l->A->tap_comm;
+                        l->A->tap_comm = NULL;
+                    }
+                    if (!l->tap_P && !l->tap_PT)
+                    {
+                        delete P->tap_comm;
+                        P->tap_comm = NULL;
+                    }
+                }
+            }
+
+            // Reports the communication used by products with A, P, and
+            // P^T on each level
+            void print_level_comms()
+            {
+                int rank;
+                MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+                if (rank) return;
+
+                printf("Level\tA\tP\tP^T\n");
+                for (int i = 0; i < num_levels - 1; i++)
+                {
+                    printf("%d\t%s\t%s\t%s\n", i, 
+                            use_tap(i) ? "TAP" : "Std",
+                            use_tap_P(i) ? "TAP" : "Std",
+                            use_tap_PT(i) ? "TAP" : "Std");
                 }
-                MPI_Group world_group;
-                MPI_Comm_group(MPI_COMM_WORLD, &world_group);                
-                MPI_Group active_group;
-                MPI_Group_incl(world_group, active_procs.size(), active_procs.data(),
-                        &active_group);
-                MPI_Comm_create_group(MPI_COMM_WORLD, active_group, 0, &coarse_comm);
-                if (Ac->local_num_rows)
+            }
+
+            /**************************************************************
+             *****   Agglomerate Coarse Level
+             **************************************************************
+             ***** If the coarse level formed from P has fewer than 
+             ***** agglomerate_rows rows per active process, marks the 
+             ***** level to be agglomerated onto the first 
+             ***** (P->global_num_cols / agglomerate_rows) processes and
+             ***** replaces levels[level]->P with a copy whose columns 
+             ***** are renumbered contiguously (in their original order)
+             ***** but kept in place, so that the Galerkin product is 
+             ***** still formed on every process.  The coarse matrix is
+             ***** then moved with agglomerate_coarse.  Returns the 
+             ***** (possibly new) P.
+             *****
+             ***** Parameters
+             ***** -------------
+             ***** P : ParCSRMatrix*
+             *****    Interpolation operator from level + 1 to level
+             ***** level : int
+             *****    Level of fine matrix A (and P)
+             **************************************************************/
+            ParCSRMatrix* agglomerate(ParCSRMatrix* P, int level)
+            {
+                if (agglomerate_rows <= 0) return P;
+
+                int num_agg;
+                int lcl_active = P->on_proc_num_cols > 0;
+                int num_active;
+                MPI_Allreduce(&lcl_active, &num_active, 1, MPI_INT, MPI_SUM,
+                        MPI_COMM_WORLD);
+                if (num_active <= 1 || 
+                        P->global_num_cols >= agglomerate_rows * num_active)
                 {
-                    int num_active, active_rank;
-                    MPI_Comm_rank(coarse_comm, &active_rank);
-                    MPI_Comm_size(coarse_comm, &num_active);
+                    return P;
+                }
 
-                    int proc;
-                    int global_col, local_col;
-                    int start, end;
+                num_agg = P->global_num_cols / agglomerate_rows;
+                if (num_agg < 1) num_agg = 1;
 
-                    aligned_vector<double> A_coarse_lcl;
+                ParCSRMatrix* P_cont = contiguous_cols(P);
+                delete levels[level]->P;
+                levels[level]->P = P_cont;
+                levels[level]->agg_parts = num_agg;
 
-                    // Gather global col indices
-                    coarse_sizes.resize(num_active);
-                    coarse_displs.resize(num_active+1);
-                    coarse_displs[0] = 0;
-                    for (int i = 0; i < num_active; i++)
+                if (agglomerate_level < 0)
+                {
+                    agglomerate_level = level + 1;
+                }
+
+                return P_cont;
+            }
+
+            /**************************************************************
+             *****   Agglomerate Coarse Matrix
+             **************************************************************
+             ***** If level is agglomerated, moves the rows of the coarse
+             ***** matrix Ac (the Galerkin product with levels[level]->P)
+             ***** onto the first agg_parts processes with 
+             ***** repartition_matrix, and replaces levels[level]->P with
+             ***** a copy whose columns are split to match.  Returns the
+             ***** (possibly new) Ac, without a communication package.
+             **************************************************************/
+            ParCSRMatrix* agglomerate_coarse(ParCSRMatrix* Ac, int level)
+            {
+                ParLevel* l = levels[level];
+                if (!l->agg_parts) return Ac;
+
+                ParCSRMatrix* Ac_agg = agglomerate_matrix(Ac, l->agg_parts);
+                delete Ac;
+                delete Ac_agg->comm;
+                Ac_agg->comm = NULL;
+
+                ParCSRMatrix* P_agg = agglomerate_cols(l->P, l->agg_parts);
+                delete l->P;
+                l->P = P_agg;
+
+                return Ac_agg;
+            }
+
+            // Splits the communicator of level from MPI_COMM_WORLD if the
+            // level is (or is coarser than) an agglomerated level.  Only
+            // the processes holding rows of the last agglomeration join,
+            // keeping their world rank, so communication packages formed
+            // from the (world) partition are valid in the new communicator.
+            void form_level_comm(int level)
+            {
+                int rank, color;
+                int num_agg = 0;
+                MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+                for (int i = level - 1; i >= 0; i--)
+                {
+                    if (levels[i]->agg_parts)
                     {
-                        proc = active_procs[i];
-                        coarse_sizes[i] = proc_sizes[proc];
-                        coarse_displs[i+1] = coarse_displs[i] + coarse_sizes[i]; 
+                        num_agg = levels[i]->agg_parts;
+                        break;
                     }
+                }
+                if (num_agg == 0) return;
+
+                color = rank < num_agg ? 0 : MPI_UNDEFINED;
+                MPI_Comm_split(MPI_COMM_WORLD, color, rank, 
+                        &(levels[level]->mpi_comm));
+            }
 
-                    aligned_vector<int> global_row_indices(coarse_displs[num_active]);
+            // Interpolation forms the communication package of P over
+            // MPI_COMM_WORLD.  On agglomerated levels, it is formed again
+            // over the level's communicator.
+            void form_P_comm(int level)
+            {
+                ParLevel* l = levels[level];
+                if (l->mpi_comm == MPI_COMM_WORLD) return;
+
+                ParCSRMatrix* P = l->P;
+                int key = P->comm->key;
+                delete P->comm;
+                P->comm = new ParComm(P->partition, P->off_proc_column_map,
+                        P->on_proc_column_map, key, l->mpi_comm);
+            }
 
-                    MPI_Allgatherv(Ac->local_row_map.data(), Ac->local_num_rows, MPI_INT,
-                            global_row_indices.data(), coarse_sizes.data(), 
-                            coarse_displs.data(), MPI_INT, coarse_comm);
-    
-                    std::map<int, int> global_to_local;
-                    int ctr = 0;
-                    for (aligned_vector<int>::iterator it = global_row_indices.begin();
-                            it != global_row_indices.end(); ++it)
+            // Forms the inverse (l1-)diagonal of each non-coarsest level,
+            // and anything else relax_type needs
+            void setup_relax()
+            {
+                for (int i = 0; i < num_levels - 1; i++)
+                {
+                    ParLevel* l = levels[i];
+                    if (l->A_bsr)
                     {
-                        global_to_local[*it] = ctr++;
+                        form_inv_diag_blocks(l->A_bsr, l->inv_diag);
+                        continue;
                     }
 
-                    coarse_n = Ac->global_num_rows;
-                    A_coarse_lcl.resize(coarse_n*Ac->local_num_rows, 0);
-                    for (int i = 0; i < Ac->local_num_rows; i++)
-                    {
-                        start = Ac->on_proc->idx1[i];
-                        end = Ac->on_proc->idx1[i+1];
-                        for (int j = start; j < end; j++)
-                        {
-                            global_col = Ac->on_proc_column_map[Ac->on_proc->idx2[j]];
-                            local_col = global_to_local[global_col];
-                            A_coarse_lcl[i*coarse_n + local_col] = Ac->on_proc->vals[j];
-                        }
+                    ParCSRMatrix* A = l->A;
+                    form_inv_diag(A, l->inv_diag, relax_type);
 
-                        start = Ac->off_proc->idx1[i];
-                        end = Ac->off_proc->idx1[i+1];
-                        for (int j = start; j < end; j++)
-                        {
-                            global_col = Ac->off_proc_column_map[Ac->off_proc->idx2[j]];
-                            local_col = global_to_local[global_col];
-                            A_coarse_lcl[i*coarse_n + local_col] = Ac->off_proc->vals[j];
-                        }
+                    if (relax_type == Chebyshev)
+                    {
+                        l->r.resize(A->global_num_rows, A->local_num_rows,
+                                A->partition->first_local_row);
+                        l->d.resize(A->global_num_rows, A->local_num_rows,
+                                A->partition->first_local_row);
+                        l->max_eig = dinv_spectral_radius(A, 10, use_tap(i));
                     }
+                }
+            }
 
-                    A_coarse.resize(coarse_n*coarse_n);
-                    for (int i = 0; i < num_active; i++)
+            // Performs num_sweeps of relax_type on level
+            void relax(int level, ParVector& x, ParVector& b, int num_sweeps,
+                    data_t* comm_t = NULL)
+            {
+                ParLevel* l = levels[level];
+                ParCSRMatrix* A = l->A;
+                bool tap_level = use_tap(level);
+
+                if (l->A_bsr)
+                {
+                    block_jacobi(l->A_bsr, x, b, l->tmp, l->inv_diag, num_sweeps,
+                            relax_weight, tap_level, comm_t);
+                    return;
+                }
+
+                switch (relax_type)
+                {
+                    case Jacobi:
+                    case L1Jacobi:
+                        jacobi(A, x, b, l->tmp, l->inv_diag, num_sweeps,
+                                relax_weight, tap_level, comm_t, overlap_relax);
+                        break;
+                    case SOR:
+                    case L1SOR:
+                        sor(A, x, b, l->tmp, l->inv_diag, num_sweeps, 
+                                relax_weight, tap_level, comm_t, overlap_relax);
+                        break;
+                    case SSOR:
+                        ssor(A, x, b, l->tmp, l->inv_diag, num_sweeps,
+                                relax_weight, tap_level, comm_t, overlap_relax);
+                        break;
+                    case Chebyshev:
+                        chebyshev(A, x, b, l->tmp, l->r, l->d, l->inv_diag,
+                                l->max_eig, num_sweeps, chebyshev_degree,
+                                chebyshev_ratio, tap_level, comm_t);
+                        break;
+                }
+            }
+
+            // Performs num_sweeps of relax_type on each vector
+            // of a block
+            void relax(int level, ParMultiVector& x, ParMultiVector& b,
+                    int num_sweeps)
+            {
+                ParLevel* l = levels[level];
+                ParCSRMatrix* A = l->A;
+                bool tap_level = use_tap(level);
+
+                switch (relax_type)
+                {
+                    case Jacobi:
+                    case L1Jacobi:
+                        jacobi(A, x, b, l->tmp_block, l->inv_diag, 
+                                num_sweeps, relax_weight, tap_level);
+                        break;
+                    case SOR:
+                    case L1SOR:
+                        sor(A, x, b, l->tmp_block, l->inv_diag, 
+                                num_sweeps, relax_weight, tap_level);
+                        break;
+                    case SSOR:
+                        ssor(A, x, b, l->tmp_block, l->inv_diag, 
+                                num_sweeps, relax_weight, tap_level);
+                        break;
+                    case Chebyshev:
+                        chebyshev(A, x, b, l->tmp_block, l->r_block, l->d_block,
+                                l->inv_diag, l->max_eig, num_sweeps, 
+                                chebyshev_degree, chebyshev_ratio, tap_level);
+                        break;
+                }
+            }
+
+            /**************************************************************
+             *****   Set Level Communication Modes
+             **************************************************************
+             ***** Sets comm_mode on the communication packages of each
+             ***** level matrix and interpolation.  Neighbor collectives 
+             ***** and shared windows need every process of the 
+             ***** communicator, so levels on which any process holds no
+             ***** rows (and skips the cycle) use persistent requests
+             ***** instead.
+             **************************************************************/
+            void set_level_comm_modes()
+            {
+                comm_mode_t mode;
+
+                for (int i = 0; i < num_levels; i++)
+                {
+                    ParLevel* l = levels[i];
+                    mode = level_comm_mode(i);
+                    set_matrix_comm_mode(level_A(i), mode);
+                    if (i < num_levels - 1)
                     {
-                        coarse_sizes[i] *= coarse_n;
-                        coarse_displs[i+1] *= coarse_n;
+                        set_matrix_comm_mode(level_P(i), mode);
                     }
-                    
-                    MPI_Allgatherv(A_coarse_lcl.data(), A_coarse_lcl.size(), MPI_DOUBLE,
-                            A_coarse.data(), coarse_sizes.data(), coarse_displs.data(), 
-                            MPI_DOUBLE, coarse_comm);
+                }
+            }
 
-                    LU_permute.resize(coarse_n);
-                    int info;
-                    dgetrf_(&coarse_n, &coarse_n, A_coarse.data(), &coarse_n, 
-                            LU_permute.data(), &info);
+            comm_mode_t level_comm_mode(int level)
+            {
+                int lcl_active, all_active;
+                if (comm_mode == NeighborComm || comm_mode == SharedComm)
+                {
+                    // Collectives of the level only include the processes
+                    // of its communicator
+                    MPI_Comm mpi_comm = levels[level]->mpi_comm;
+                    if (mpi_comm == MPI_COMM_NULL) return PersistentComm;
+
+                    lcl_active = level_A(level)->local_num_rows > 0;
+                    MPI_Allreduce(&lcl_active, &all_active, 1, MPI_INT,
+                            MPI_MIN, mpi_comm);
+                    if (!all_active) return PersistentComm;
+                }
+                return comm_mode;
+            }
 
-                    for (int i = 0; i < num_active; i++)
+            void set_matrix_comm_mode(ParMatrix* A, comm_mode_t mode)
+            {
+                if (A->comm && A->comm->comm_mode != mode)
+                {
+                    A->comm->set_comm_mode(mode);
+                }
+                if (A->tap_comm && A->tap_comm->local_L_par_comm->comm_mode != mode)
+                {
+                    A->tap_comm->set_comm_mode(mode);
+                }
+            }
+
+            void setup_coarse()
+            {
+                ParCSRMatrix* Ac = levels[num_levels - 1]->A;
+                delete coarse_solver;
+                coarse_solver = create_coarse_solver(Ac, coarse_solve_type,
+                        max_dense_coarse, max_sparse_coarse_nnz);
+                coarse_solver->setup(Ac);
+            }
+
+            // Number of pre- (or post-) smoothing sweeps on level
+            int num_sweeps(const aligned_vector<int>& sweeps, int level)
+            {
+                if (level < (int) sweeps.size()) return sweeps[level];
+                return num_smooth_sweeps;
+            }
+
+            // Processes holding no rows on a level (and therefore any
+            // coarser level) skip the rest of the cycle, unless TAP
+            // communication may still route through them
+            bool skip_level(int level)
+            {
+                if (level_A(level)->local_num_rows) return false;
+                if (agglomerate_level >= 0 && level >= agglomerate_level) return true;
+                if (tap_auto)
+                {
+                    for (int i = level; i < num_levels; i++)
                     {
-                        coarse_sizes[i] /= coarse_n;
-                        coarse_displs[i+1] /= coarse_n;
+                        if (use_tap(i) || use_tap_P(i) || use_tap_PT(i)) return false;
                     }
+                    return true;
+                }
+                return tap_amg < 0;
+            }
+
+            // Records which levels every process takes part in
+            void setup_cycle()
+            {
+                int lcl_skip, any_skip;
+                for (int i = 0; i < num_levels; i++)
+                {
+                    lcl_skip = skip_level(i);
+                    MPI_Allreduce(&lcl_skip, &any_skip, 1, MPI_INT, MPI_MAX,
+                            MPI_COMM_WORLD);
+                    levels[i]->all_active = !any_skip;
                 }
             }
 
+            // Whether a cycle visits the coarse level only once, whatever
+            // the cycle type: the coarsest level is solved directly, and
+            // levels on agglomerated sub-communicators are not revisited
+            // unless revisit_agglomerated is set
+            bool single_visit(int coarse)
+            {
+                if (coarse == num_levels - 1) return true;
+                if (agglomerate_level >= 0 && coarse >= agglomerate_level 
+                        && !revisit_agglomerated) return true;
+                return false;
+            }
+
             void cycle(ParVector& x, ParVector& b, int level = 0)
             {
-                ParCSRMatrix* A = levels[level]->A;
-                ParCSRMatrix* P = levels[level]->P;
+                cycle(x, b, level, cycle_type);
+            }
+
+            /**************************************************************
+             *****   Cycle
+             **************************************************************
+             ***** Performs a multigrid cycle of type cycle_type on level,
+             ***** with num_pre_sweeps[level] and num_post_sweeps[level]
+             ***** relaxation sweeps before and after the coarse grid
+             ***** correction.  The coarse correction visits level+1:
+             *****    - VCycle : once
+             *****    - WCycle : twice, recursively with W-cycles
+             *****    - FCycle : with an F-cycle and then a V-cycle
+             *****    - KCycle : as preconditioner of two flexible CG 
+             *****          iterations on level+1 (Notay and Vassilevski)
+             **************************************************************/
+            void cycle(ParVector& x, ParVector& b, int level, cycle_t type)
+            {
                 ParVector& tmp = levels[level]->tmp;
-                bool tap_level = tap_amg >= 0 && tap_amg <= level;
+                bool tap_level = use_tap(level);
+
+                if (skip_level(level))
+                {
+                    return;
+                }
 
                 double* relax_t = NULL;
                 double* resid_t = NULL;
@@ -349,27 +1269,7 @@ namespace raptor
                 {
                     if (solve_times) solve_times[0][level] -= MPI_Wtime();
 
-                    if (A->local_num_rows)
-                    {
-                        int active_rank;
-                        MPI_Comm_rank(coarse_comm, &active_rank);
-
-                        char trans = 'N'; //No transpose
-                        int nhrs = 1; // Number of right hand sides
-                        int info; // result
-
-                        aligned_vector<double> b_data(coarse_n);
-                        MPI_Allgatherv(b.local.data(), b.local_n, MPI_DOUBLE, b_data.data(), 
-                                coarse_sizes.data(), coarse_displs.data(), 
-                                MPI_DOUBLE, coarse_comm);
-
-                        dgetrs_(&trans, &coarse_n, &nhrs, A_coarse.data(), &coarse_n, 
-                                LU_permute.data(), b_data.data(), &coarse_n, &info);
-                        for (int i = 0; i < b.local_n; i++)
-                        {
-                            x.local[i] = b_data[i + coarse_displs[active_rank]];
-                        }
-                    }
+                    coarse_solver->solve(levels[level]->A, x, b);
 
                     if (solve_times) solve_times[0][level] += MPI_Wtime();
                 }
@@ -381,66 +1281,40 @@ namespace raptor
                     
                     // Relax
                     if (solve_times) solve_times[1][level] -= MPI_Wtime();
-                    switch (relax_type)
-                    {
-                        case Jacobi:
-                            jacobi(A, x, b, tmp, num_smooth_sweeps, relax_weight,
-                                    tap_level, relax_t);
-                            break;
-                        case SOR:
-                            sor(A, x, b, tmp, num_smooth_sweeps, relax_weight,
-                                    tap_level, relax_t);
-                            break;
-                        case SSOR:
-                            ssor(A, x, b, tmp, num_smooth_sweeps, relax_weight,
-                                    tap_level, relax_t);
-                            break;
-                    }
+                    relax(level, x, b, num_sweeps(num_pre_sweeps, level), relax_t);
                     if (solve_times) solve_times[1][level] += MPI_Wtime();
 
 
                     if (solve_times) solve_times[2][level] -= MPI_Wtime();
-                    A->residual(x, b, tmp, tap_level, resid_t);
+                    level_residual(level, x, b, tmp, tap_level, resid_t);
                     if (solve_times) solve_times[2][level] += MPI_Wtime();
 
                     if (solve_times) solve_times[3][level] -= MPI_Wtime();
-                    P->mult_T(tmp, levels[level+1]->b, tap_level, restrict_t);
+                    level_restrict(level, tmp, levels[level+1]->b, use_tap_PT(level), 
+                            restrict_t);
                     if (solve_times) solve_times[3][level] += MPI_Wtime();
 
                     if (solve_times) solve_times[0][level] += MPI_Wtime();
 
 
 
-                    cycle(levels[level+1]->x, levels[level+1]->b, level+1);
+                    coarse_correction(level, type);
 
 
 
                     if (solve_times) solve_times[0][level] -= MPI_Wtime();
 
                     if (solve_times) solve_times[4][level] -= MPI_Wtime();
-                    P->mult(levels[level+1]->x, tmp, tap_level, interp_t);
-                    for (int i = 0; i < A->local_num_rows; i++)
+                    level_interpolate(level, levels[level+1]->x, tmp, use_tap_P(level), 
+                            interp_t);
+                    for (int i = 0; i < tmp.local_n; i++)
                     {
                         x.local[i] += tmp.local[i];
                     }
                     if (solve_times) solve_times[4][level] += MPI_Wtime();
 
                     if (solve_times) solve_times[1][level] -= MPI_Wtime();
-                    switch (relax_type)
-                    {
-                        case Jacobi:
-                            jacobi(A, x, b, tmp, num_smooth_sweeps, relax_weight,
-                                    tap_level, relax_t);
-                            break;
-                        case SOR:
-                            sor(A, x, b, tmp, num_smooth_sweeps, relax_weight,
-                                    tap_level, relax_t);
-                            break;
-                        case SSOR:
-                            ssor(A, x, b, tmp, num_smooth_sweeps, relax_weight,
-                                    tap_level, relax_t);
-                            break;
-                    }
+                    relax(level, x, b, num_sweeps(num_post_sweeps, level), relax_t);
                     if (solve_times) solve_times[1][level] += MPI_Wtime();
                 }
 
@@ -450,6 +1324,289 @@ namespace raptor
                 }
             }
 
+            // Approximately solves for levels[level+1]->x (initially zero)
+            // from the restricted residual levels[level+1]->b
+            void coarse_correction(int level, cycle_t type)
+            {
+                int coarse = level + 1;
+                ParLevel* lc = levels[coarse];
+
+                if (type == VCycle || single_visit(coarse))
+                {
+                    cycle(lc->x, lc->b, coarse, VCycle);
+                }
+                else if (type == WCycle)
+                {
+                    cycle(lc->x, lc->b, coarse, WCycle);
+                    cycle(lc->x, lc->b, coarse, WCycle);
+                }
+                else if (type == FCycle)
+                {
+                    cycle(lc->x, lc->b, coarse, FCycle);
+                    cycle(lc->x, lc->b, coarse, VCycle);
+                }
+                else if (lc->all_active)
+                {
+                    kcycle_correction(coarse);
+                }
+                else
+                {
+                    // K-cycle reductions need every process
+                    cycle(lc->x, lc->b, coarse, VCycle);
+                }
+            }
+
+            /**************************************************************
+             *****   K-Cycle Coarse Correction
+             **************************************************************
+             ***** Two iterations of flexible CG on A_c x = b, each 
+             ***** preconditioned by a K-cycle on the coarse level.  The
+             ***** second iteration is skipped if the first reduces the 
+             ***** residual norm below kcycle_tol * ||b||.
+             *****
+             ***** c1 = B(b), v1 = A c1, rho1 = <c1, v1>, alpha1 = <c1, b>
+             ***** r = b - (alpha1 / rho1) v1
+             ***** c2 = B(r), v2 = A c2
+             ***** gamma = <c2, v1>, beta = <c2, v2>, alpha2 = <c2, r>
+             ***** rho2 = beta - gamma^2 / rho1
+             ***** x = (alpha1 / rho1 - gamma alpha2 / (rho1 rho2)) c1 
+             *****       + (alpha2 / rho2) c2
+             *****
+             ***** If rho1 <= 0, the correction falls back to a V-cycle.
+             ***** If rho2 <= 0, only the first iteration is applied.
+             **************************************************************/
+            void kcycle_correction(int coarse)
+            {
+                ParLevel* lc = levels[coarse];
+                ParVector& x = lc->x;
+                ParVector& b = lc->b;
+                ParVector& r = lc->k_r;
+                ParVector& v = lc->k_v;
+                ParVector& c = lc->k_c;
+                bool tap_level = use_tap(coarse);
+                aligned_vector<ParVector*> vecs(3);
+                data_t inner[3];
+
+                if (r.local_n != b.local_n)
+                {
+                    r.resize(b.global_n, b.local_n, b.first_local);
+                    v.resize(b.global_n, b.local_n, b.first_local);
+                    c.resize(b.global_n, b.local_n, b.first_local);
+                }
+
+                // c1 (stored in x) and v1
+                cycle(x, b, coarse, KCycle);
+                level_mult(coarse, x, v, tap_level);
+
+                // rho1, alpha1, and ||b||^2 in a single reduction
+                vecs.resize(2);
+                vecs[0] = &v;
+                vecs[1] = &b;
+                x.local_inner_products(vecs, inner);
+                vecs.resize(1);
+                b.local_inner_products(vecs, &(inner[2]));
+                MPI_Allreduce(MPI_IN_PLACE, inner, 3, MPI_DATA_T, MPI_SUM, 
+                        MPI_COMM_WORLD);
+                double rho1 = inner[0];
+                double alpha1 = inner[1];
+                double b_norm = sqrt(inner[2]);
+
+                // A is not positive along c1 (c1 is zero, or A or the 
+                // K-cycle is indefinite), so the Krylov step is undefined
+                if (rho1 <= 0.0)
+                {
+                    x.set_const_value(0.0);
+                    if (b_norm > 0.0) cycle(x, b, coarse, VCycle);
+                    return;
+                }
+
+                r.copy(b);
+                r.axpy(v, -alpha1 / rho1);
+                if (r.norm(2) <= kcycle_tol * b_norm)
+                {
+                    x.scale(alpha1 / rho1);
+                    return;
+                }
+
+                // c2 and v2 (stored in tmp)
+                c.set_const_value(0.0);
+                cycle(c, r, coarse, KCycle);
+                level_mult(coarse, c, lc->tmp, tap_level);
+
+                vecs.resize(3);
+                vecs[0] = &v;
+                vecs[1] = &(lc->tmp);
+                vecs[2] = &r;
+                c.inner_products(vecs, inner);
+                double gamma = inner[0];
+                double beta = inner[1];
+                double alpha2 = inner[2];
+                double rho2 = beta - gamma * gamma / rho1;
+                if (rho2 <= 0.0)
+                {
+                    x.scale(alpha1 / rho1);
+                    return;
+                }
+
+                x.scale(alpha1 / rho1 - gamma * alpha2 / (rho1 * rho2));
+                x.axpy(c, alpha2 / rho2);
+            }
+
+            // Resizes the block work vectors of each level to hold
+            // num_vectors vectors
+            void setup_block_vectors(int num_vectors)
+            {
+                for (int i = 0; i < num_levels; i++)
+                {
+                    ParLevel* l = levels[i];
+                    if (l->x_block.num_vectors == num_vectors) continue;
+
+                    ParCSRMatrix* A = l->A;
+                    index_t global_n = A->global_num_rows;
+                    int local_n = A->local_num_rows;
+                    index_t first = A->partition->first_local_row;
+                    l->x_block.resize(global_n, local_n, first, num_vectors);
+                    l->b_block.resize(global_n, local_n, first, num_vectors);
+                    l->tmp_block.resize(global_n, local_n, first, num_vectors);
+                    if (relax_type == Chebyshev)
+                    {
+                        l->r_block.resize(global_n, local_n, first, num_vectors);
+                        l->d_block.resize(global_n, local_n, first, num_vectors);
+                    }
+                }
+            }
+
+            /**************************************************************
+             *****   Block Cycle
+             **************************************************************
+             ***** Performs a cycle on every vector of a block at once.
+             ***** Each relaxation sweep, residual, restriction, and 
+             ***** interpolation streams the level matrices once and 
+             ***** exchanges a single halo for all vectors.  V-, W-, and
+             ***** F-cycles visit coarse levels as in cycle(); the K-cycle
+             ***** would need a separate Krylov recurrence for each vector,
+             ***** so blocks use W-cycles in its place.
+             **************************************************************/
+            void cycle(ParMultiVector& x, ParMultiVector& b, int level = 0)
+            {
+                cycle(x, b, level, cycle_type == KCycle ? WCycle : cycle_type);
+            }
+
+            void cycle(ParMultiVector& x, ParMultiVector& b, int level, 
+                    cycle_t type)
+            {
+                ParCSRMatrix* A = levels[level]->A;
+                ParCSRMatrix* P = levels[level]->P;
+                ParMultiVector& tmp = levels[level]->tmp_block;
+                bool tap_level = use_tap(level);
+
+                if (skip_level(level))
+                {
+                    return;
+                }
+
+                if (level == num_levels - 1)
+                {
+                    coarse_solver->solve(A, x, b);
+                    return;
+                }
+
+                int coarse = level + 1;
+                ParMultiVector& xc = levels[coarse]->x_block;
+                ParMultiVector& bc = levels[coarse]->b_block;
+                xc.set_const_value(0.0);
+
+                relax(level, x, b, num_sweeps(num_pre_sweeps, level));
+                A->residual(x, b, tmp, tap_level);
+                P->mult_T(tmp, bc, use_tap_PT(level));
+
+                if (type == VCycle || single_visit(coarse))
+                {
+                    cycle(xc, bc, coarse, VCycle);
+                }
+                else
+                {
+                    cycle(xc, bc, coarse, type);
+                    cycle(xc, bc, coarse, type == FCycle ? VCycle : type);
+                }
+
+                P->mult(xc, tmp, use_tap_P(level));
+                x.axpy(tmp, 1.0);
+                relax(level, x, b, num_sweeps(num_post_sweeps, level));
+            }
+
+            /**************************************************************
+             *****   Block Solve
+             **************************************************************
+             ***** Solves A*sol = rhs for each vector of the block, 
+             ***** cycling until the largest relative residual falls 
+             ***** below solve_tol.  Stored residuals are this largest
+             ***** relative residual.
+             **************************************************************/
+            int solve(ParMultiVector& sol, ParMultiVector& rhs)
+            {
+                int k = rhs.num_vectors;
+                int iter = 0;
+                double r_norm;
+                aligned_vector<double> b_norms(k);
+                aligned_vector<double> r_norms(k);
+
+                if (levels[0]->A_bsr)
+                {
+                    printf("Block solves are not supported for block hierarchies\n");
+                    exit(-1);
+                }
+
+                setup_block_vectors(k);
+                if (store_residuals)
+                {
+                    residuals.resize(max_iterations + 1);
+                }
+
+                rhs.norms(b_norms.data());
+                ParMultiVector resid(rhs.global_n, rhs.local_n, rhs.first_local, k);
+                levels[0]->A->residual(sol, rhs, resid);
+                r_norm = max_relative_norm(resid, b_norms, r_norms);
+                if (store_residuals)
+                {
+                    residuals[iter] = r_norm;
+                }
+
+                while (r_norm > solve_tol && iter < max_iterations)
+                {
+                    cycle(sol, rhs, 0);
+
+                    iter++;
+                    levels[0]->A->residual(sol, rhs, resid);
+                    r_norm = max_relative_norm(resid, b_norms, r_norms);
+                    if (store_residuals)
+                    {
+                        residuals[iter] = r_norm;
+                    }
+                }
+
+                return iter;
+            }
+
+            double max_relative_norm(ParMultiVector& resid, 
+                    aligned_vector<double>& b_norms, aligned_vector<double>& r_norms)
+            {
+                double max_norm = 0.0;
+                resid.norms(r_norms.data());
+                for (int v = 0; v < resid.num_vectors; v++)
+                {
+                    if (fabs(b_norms[v]) > zero_tol)
+                    {
+                        r_norms[v] /= b_norms[v];
+                    }
+                    if (r_norms[v] > max_norm)
+                    {
+                        max_norm = r_norms[v];
+                    }
+                }
+                return max_norm;
+            }
+
             int solve(ParVector& sol, ParVector& rhs)
             {
                 double b_norm = rhs.norm(2);
@@ -481,7 +1638,7 @@ namespace raptor
 
                 // Iterate until convergence or max iterations
                 ParVector resid(rhs.global_n, rhs.local_n, rhs.first_local);
-                levels[0]->A->residual(sol, rhs, resid);
+                level_residual(0, sol, rhs, resid);
                 if (fabs(b_norm) > zero_tol)
                 {
                     r_norm = resid.norm(2) / b_norm;
@@ -500,7 +1657,7 @@ namespace raptor
                     cycle(sol, rhs, 0);
 
                     iter++;
-                    levels[0]->A->residual(sol, rhs, resid);
+                    level_residual(0, sol, rhs, resid);
                     if (fabs(b_norm) > zero_tol)
                     {
                         r_norm = resid.norm(2) / b_norm;
@@ -532,7 +1689,7 @@ namespace raptor
 
                 for (int i = 0; i < num_levels; i++)
                 {
-                    ParCSRMatrix* Al = levels[i]->A;
+                    ParMatrix* Al = level_A(i);
 	                long lcl_nnz = Al->local_nnz;
 	                long nnz;
 	                MPI_Reduce(&lcl_nnz, &nnz, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
@@ -627,6 +1784,8 @@ namespace raptor
             int max_levels;
             int tap_amg;
             int n_setup_times, n_solve_times;
+            bool tap_auto;
+            int tap_auto_trials;
             int max_iterations;
 
             double strong_threshold;
@@ -641,7 +1800,6 @@ namespace raptor
             aligned_vector<double> residuals;
 
             std::vector<ParLevel*> levels;
-            aligned_vector<int> LU_permute;
             int num_levels;
             int num_variables;
             
@@ -653,11 +1811,29 @@ namespace raptor
             double setup_comm_t;
             double solve_comm_t;
 
-            int coarse_n;
-            aligned_vector<double> A_coarse;
-            aligned_vector<int> coarse_sizes;
-            aligned_vector<int> coarse_displs;
-            MPI_Comm coarse_comm;
+            coarse_solve_t coarse_solve_type;
+            int max_dense_coarse;
+            long max_sparse_coarse_nnz;
+            ParCoarseSolver* coarse_solver;
+
+            int agglomerate_rows;
+            int agglomerate_level;
+
+            comm_mode_t comm_mode;
+            bool overlap_relax;
+            int chebyshev_degree;
+            double chebyshev_ratio;
+
+            cycle_t cycle_type;
+            aligned_vector<int> num_pre_sweeps;
+            aligned_vector<int> num_post_sweeps;
+            double kcycle_tol;
+            bool revisit_agglomerated;
+            bool mixed_precision;
+
+            // Record the symbolic Galerkin structure during setup() rather 
+            // than on the first resetup()
+            bool keep_rap_structure;
     };
 }
 #endif
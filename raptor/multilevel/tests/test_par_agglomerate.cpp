@@ -0,0 +1,129 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+#include "aggregation/par_smoothed_aggregation_solver.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/par_stencil.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+void check_agglomerated(ParMultilevel* ml, int agg_rows)
+{
+    int num_procs;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    for (int i = 1; i < ml->num_levels; i++)
+    {
+        ParCSRMatrix* A = ml->levels[i]->A;
+        int lcl_active = A->local_num_rows > 0;
+        int num_active;
+        MPI_Allreduce(&lcl_active, &num_active, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+        // Once agglomerated, rows only live on the first procs
+        if (ml->agglomerate_level >= 0 && i >= ml->agglomerate_level)
+        {
+            int max_active = ml->levels[ml->agglomerate_level]->A->global_num_rows 
+                / agg_rows;
+            if (max_active < 1) max_active = 1;
+            ASSERT_LE(num_active, max_active);
+        }
+
+        // Agglomerated levels communicate on a sub-communicator of 
+        // the processes holding rows, which keep their world rank
+        if (ml->agglomerate_level >= 0 && i >= ml->agglomerate_level)
+        {
+            MPI_Comm mpi_comm = ml->levels[i]->mpi_comm;
+            ASSERT_EQ(A->comm->mpi_comm, mpi_comm);
+            if (A->local_num_rows)
+            {
+                ASSERT_NE(mpi_comm, MPI_COMM_NULL);
+            }
+            if (mpi_comm != MPI_COMM_NULL)
+            {
+                int rank, sub_rank, sub_size;
+                MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+                MPI_Comm_rank(mpi_comm, &sub_rank);
+                MPI_Comm_size(mpi_comm, &sub_size);
+                ASSERT_EQ(sub_rank, rank);
+                ASSERT_LT(sub_size, num_procs);
+                if (i < ml->num_levels - 1)
+                {
+                    ASSERT_EQ(ml->levels[i]->P->comm->mpi_comm, mpi_comm);
+                }
+            }
+        }
+
+        // Agglomerated level is numbered contiguously
+        if (i == ml->agglomerate_level)
+        {
+            for (int j = 0; j < A->local_num_rows; j++)
+            {
+                ASSERT_EQ(A->local_row_map[j], A->partition->first_local_row + j);
+            }
+        }
+    }
+}
+
+TEST(ParAgglomerateTest, TestsInMultilevel)
+{
+    int num_procs;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int grid[3] = {10, 10, 10};
+    int agg_rows = 100;
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    for (int t = 0; t < 2; t++)
+    {
+        ParMultilevel* ml;
+        if (t == 0) ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+        else ml = new ParSmoothedAggregationSolver(0.0);
+        ml->agglomerate_rows = agg_rows;
+        ml->max_coarse = 10;
+        ml->setup(A);
+        if (num_procs > 1)
+        {
+            ASSERT_GT(ml->agglomerate_level, 0);
+        }
+        check_agglomerated(ml, agg_rows);
+
+        x.set_const_value(1.0);
+        A->mult(x, b);
+        x.set_const_value(0.0);
+        int iter = ml->solve(x, b);
+        aligned_vector<double>& res = ml->get_residuals();
+        ASSERT_LT(res[iter], 1e-7);
+        double final_res = res[iter];
+
+        // Neighbor collectives (on the sub-communicators of 
+        // agglomerated levels) must not change the solve
+        ml->comm_mode = NeighborComm;
+        ml->set_level_comm_modes();
+        x.set_const_value(0.0);
+        int mode_iter = ml->solve(x, b);
+        ASSERT_EQ(mode_iter, iter);
+        ASSERT_NEAR(ml->get_residuals()[mode_iter], final_res, 1e-12);
+        delete ml;
+    }
+
+    delete A;
+} // end of TEST(ParAgglomerateTest, TestsInMultilevel) //
@@ -11,6 +11,7 @@
 #include "gallery/diffusion.hpp"
 #include "gallery/laplacian27pt.hpp"
 #include "gallery/par_stencil.hpp"
+#include "krylov/par_cg.hpp"
 
 using namespace raptor;
 
@@ -125,3 +126,365 @@ TEST(ParAMGTest, TestsInMultilevel)
     delete A;
 
 } // end of TEST(ParAMGTest, TestsInMultilevel) //
+
+TEST(ParAMGTest, TestChebyshev)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    for (int t = 0; t < 2; t++)
+    {
+        ParMultilevel* ml;
+        if (t == 0) ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, Chebyshev);
+        else ml = new ParSmoothedAggregationSolver(0.0, MIS, JacobiProlongation, 
+                Symmetric, Chebyshev);
+        ml->setup(A);
+        for (int i = 0; i < ml->num_levels - 1; i++)
+        {
+            ASSERT_GT(ml->levels[i]->max_eig, 0.0);
+            ASSERT_LT(ml->levels[i]->max_eig, 10.0);
+        }
+
+        x.set_const_value(1.0);
+        A->mult(x, b);
+        x.set_const_value(0.0);
+        int iter = ml->solve(x, b);
+        ASSERT_LT(iter, 30);
+        ASSERT_LT(ml->get_residuals()[iter], 1e-7);
+        delete ml;
+    }
+
+    delete A;
+} // end of TEST(ParAMGTest, TestChebyshev) //
+
+TEST(ParAMGTest, TestL1Relax)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    relax_t relax_types[2] = {L1Jacobi, L1SOR};
+
+    for (int t = 0; t < 2; t++)
+    {
+        ParMultilevel* ml = new ParRugeStubenSolver(0.25, HMIS, Extended, 
+                Classical, relax_types[t]);
+        ml->setup(A);
+        for (int i = 0; i < ml->num_levels - 1; i++)
+        {
+            ASSERT_EQ((int) ml->levels[i]->inv_diag.size(), 
+                    ml->levels[i]->A->local_num_rows);
+        }
+
+        x.set_const_value(1.0);
+        A->mult(x, b);
+        x.set_const_value(0.0);
+        int iter = ml->solve(x, b);
+        ASSERT_LT(ml->get_residuals()[iter], 1e-7);
+        delete ml;
+    }
+
+    delete A;
+} // end of TEST(ParAMGTest, TestL1Relax) //
+
+TEST(ParAMGTest, TestBlockSolve)
+{
+    int k = 4;
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    int global_n = A->global_num_rows;
+    int local_n = A->local_num_rows;
+    int first = A->partition->first_local_row;
+    ParMultiVector X(global_n, local_n, first, k);
+    ParMultiVector B(global_n, local_n, first, k);
+    ParVector x(global_n, local_n, first);
+    ParVector b(global_n, local_n, first);
+    relax_t relax_types[3] = {Jacobi, SOR, Chebyshev};
+    coarse_solve_t coarse_types[3] = {DenseLU, SparseLU, DenseLU};
+
+    for (int t = 0; t < 3; t++)
+    {
+        ParMultilevel* ml = new ParRugeStubenSolver(0.25, HMIS, Extended, 
+                Classical, relax_types[t]);
+        ml->coarse_solve_type = coarse_types[t];
+        ml->setup(A);
+
+        // A fixed number of block cycles matches cycling each vector
+        ml->solve_tol = 0.0;
+        ml->max_iterations = 4;
+        B.set_rand_values();
+        X.set_const_value(0.0);
+        ASSERT_EQ(ml->solve(X, B), 4);
+        for (int v = 0; v < k; v++)
+        {
+            B.get_vector(v, b);
+            x.set_const_value(0.0);
+            ml->solve(x, b);
+            for (int i = 0; i < local_n; i++)
+            {
+                ASSERT_NEAR(X(i, v), x[i], 1e-10);
+            }
+        }
+
+        // Block solve converges every vector
+        ml->solve_tol = 1e-7;
+        ml->max_iterations = 100;
+        X.set_const_value(0.0);
+        int iter = ml->solve(X, B);
+        ASSERT_LT(ml->get_residuals()[iter], 1e-7);
+        delete ml;
+    }
+
+    delete A;
+} // end of TEST(ParAMGTest, TestBlockSolve) //
+
+TEST(ParAMGTest, TestCycleTypes)
+{
+    // Rotated anisotropic diffusion
+    int grid[2] = {50, 50};
+    double* stencil = diffusion_stencil_2d(0.001, M_PI/8.0);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector x_sweeps(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    cycle_t cycle_types[4] = {VCycle, WCycle, FCycle, KCycle};
+    int iters[4];
+
+    ParMultilevel* ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+    ml->setup(A);
+    b.set_rand_values();
+    for (int t = 0; t < 4; t++)
+    {
+        ml->cycle_type = cycle_types[t];
+        x.set_const_value(0.0);
+        iters[t] = ml->solve(x, b);
+        ASSERT_LT(ml->get_residuals()[iters[t]], 1e-7);
+    }
+    for (int t = 1; t < 4; t++)
+    {
+        ASSERT_LE(iters[t], iters[0]);
+    }
+
+    // Per-level sweep counts equal to num_smooth_sweeps change nothing,
+    // and extra sweeps on the finest level reduce iterations
+    ml->cycle_type = VCycle;
+    ml->num_smooth_sweeps = 2;
+    x.set_const_value(0.0);
+    int iter = ml->solve(x, b);
+    ml->num_smooth_sweeps = 1;
+    ml->num_pre_sweeps.resize(ml->num_levels, 2);
+    ml->num_post_sweeps.resize(ml->num_levels, 2);
+    x_sweeps.set_const_value(0.0);
+    ASSERT_EQ(ml->solve(x_sweeps, b), iter);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_DOUBLE_EQ(x[i], x_sweeps[i]);
+    }
+    ml->num_pre_sweeps.clear();
+    ml->num_post_sweeps.clear();
+    ml->num_pre_sweeps.push_back(0);
+    ml->num_post_sweeps.push_back(4);
+    x.set_const_value(0.0);
+    ASSERT_LT(ml->solve(x, b), iters[0]);
+    delete ml;
+
+    // Agglomerated levels are visited once by W- and K-cycles
+    ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+    ml->agglomerate_rows = 200;
+    ml->setup(A);
+    for (int t = 1; t < 4; t += 2)
+    {
+        ml->cycle_type = cycle_types[t];
+        x.set_const_value(0.0);
+        iter = ml->solve(x, b);
+        ASSERT_LT(ml->get_residuals()[iter], 1e-7);
+    }
+    delete ml;
+
+    // On a negative definite matrix, rho1 < 0 on every coarse level, so
+    // the K-cycle falls back to (and matches) the V-cycle
+    ParCSRMatrix* A_neg = A->copy();
+    for (aligned_vector<double>::iterator it = A_neg->on_proc->vals.begin();
+            it != A_neg->on_proc->vals.end(); ++it) *it = -*it;
+    for (aligned_vector<double>::iterator it = A_neg->off_proc->vals.begin();
+            it != A_neg->off_proc->vals.end(); ++it) *it = -*it;
+    ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+    ml->setup(A_neg);
+    ASSERT_GT(ml->num_levels, 2);
+    ml->cycle_type = VCycle;
+    x.set_const_value(0.0);
+    iter = ml->solve(x, b);
+    aligned_vector<double> v_res = ml->get_residuals();
+    ml->cycle_type = KCycle;
+    x.set_const_value(0.0);
+    ASSERT_EQ(ml->solve(x, b), iter);
+    ASSERT_LT(ml->get_residuals()[iter], 1e-7);
+    for (int i = 0; i <= iter; i++)
+    {
+        ASSERT_DOUBLE_EQ(ml->get_residuals()[i], v_res[i]);
+    }
+    delete ml;
+    delete A_neg;
+
+    delete A;
+} // end of TEST(ParAMGTest, TestCycleTypes) //
+
+TEST(ParAMGTest, TestMixedPrecision)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    b.set_rand_values();
+
+    ParMultilevel* ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+    ml->setup(A);
+    x.set_const_value(0.0);
+    int iter = ml->solve(x, b);
+    delete ml;
+
+    // Single precision preconditioner converges as the double precision one
+    ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+    ml->mixed_precision = true;
+    ml->setup(A);
+    for (int i = 0; i < ml->num_levels - 1; i++)
+    {
+        CSRMatrix* A_on = (CSRMatrix*) ml->levels[i]->A->on_proc;
+        CSRMatrix* P_on = (CSRMatrix*) ml->levels[i]->P->on_proc;
+        ASSERT_EQ(A_on->single_precision(), i > 0 && A_on->nnz > 0);
+        ASSERT_EQ(P_on->single_precision(), P_on->nnz > 0);
+    }
+    x.set_const_value(0.0);
+    int iter_sp = ml->solve(x, b);
+    ASSERT_LE(iter_sp, iter + 1);
+    ASSERT_LT(ml->get_residuals()[iter_sp], 1e-7);
+
+    // Resetup recomputes values in double before storing them as float
+    ml->resetup(A);
+    x.set_const_value(0.0);
+    ASSERT_EQ(ml->solve(x, b), iter_sp);
+    delete ml;
+
+    delete A;
+} // end of TEST(ParAMGTest, TestMixedPrecision) //
+
+TEST(ParAMGTest, TestTapAuto)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    b.set_rand_values();
+
+    for (int t = 0; t < 2; t++)
+    {
+        ParMultilevel* ml;
+        if (t == 0) ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+        else ml = new ParSmoothedAggregationSolver(0.0);
+        ml->setup(A);
+        x.set_const_value(0.0);
+        int iter = ml->solve(x, b);
+        delete ml;
+
+        // Timed selection changes only how halos are exchanged
+        if (t == 0) ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+        else ml = new ParSmoothedAggregationSolver(0.0);
+        ml->tap_auto = true;
+        ml->tap_auto_trials = 2;
+        ml->setup(A);
+        ml->print_level_comms();
+        for (int i = 0; i < ml->num_levels - 1; i++)
+        {
+            ParLevel* l = ml->levels[i];
+            ASSERT_EQ(l->A->tap_comm != NULL, ml->use_tap(i));
+            ASSERT_EQ(l->P->tap_comm != NULL, ml->use_tap_P(i) || ml->use_tap_PT(i));
+        }
+        x.set_const_value(0.0);
+        int iter_auto = ml->solve(x, b);
+        ASSERT_LE(iter_auto, iter + 1);
+        ASSERT_LT(ml->get_residuals()[iter_auto], 1e-7);
+        delete ml;
+    }
+
+    delete A;
+} // end of TEST(ParAMGTest, TestTapAuto) //
+
+TEST(ParAMGTest, TestAggressive)
+{
+    int grid[3] = {12, 12, 12};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    b.set_rand_values();
+
+    coarsen_t coarsen_types[2] = {PMIS, HMIS};
+    for (int t = 0; t < 2; t++)
+    {
+        double complexity[2];
+        int iterations[2];
+        int pcg_iterations[2];
+        for (int k = 0; k < 2; k++)
+        {
+            ParRugeStubenSolver* ml = new ParRugeStubenSolver(0.25, coarsen_types[t],
+                    Extended, Classical, SOR);
+            ml->num_aggressive_levels = k;
+            ml->setup(A);
+
+            int local_nnz = 0;
+            int global_nnz, global_nnz_A;
+            for (int i = 0; i < ml->num_levels; i++)
+            {
+                local_nnz += ml->levels[i]->A->local_nnz;
+            }
+            MPI_Allreduce(&local_nnz, &global_nnz, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+            MPI_Allreduce(&A->local_nnz, &global_nnz_A, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+            complexity[k] = ((double) global_nnz) / global_nnz_A;
+
+            x.set_const_value(0.0);
+            int iter = ml->solve(x, b);
+            ASSERT_LT(ml->get_residuals()[iter], 1e-7);
+            iterations[k] = iter;
+
+            // As a preconditioner
+            aligned_vector<double> res;
+            x.set_const_value(0.0);
+            PCG(A, ml, x, b, res, 1e-7, 100);
+            pcg_iterations[k] = res.size() - 1;
+
+            // Resetup reuses the aggressive splitting
+            ml->resetup(A);
+            x.set_const_value(0.0);
+            ASSERT_EQ(ml->solve(x, b), iter);
+            delete ml;
+        }
+        ASSERT_LT(complexity[1], complexity[0]);
+
+        // Aggressive coarsening must not give up too much convergence
+        ASSERT_LE(((double) iterations[1]) / iterations[0], 2.0);
+        ASSERT_LE(((double) pcg_iterations[1]) / pcg_iterations[0], 2.0);
+    }
+
+    delete A;
+} // end of TEST(ParAMGTest, TestAggressive) //
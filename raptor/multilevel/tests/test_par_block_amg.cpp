@@ -0,0 +1,167 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include "aggregation/par_smoothed_aggregation_solver.hpp"
+
+#include <map>
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp=RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// System of 2 coupled unknowns per node : kron(L, M), with L the
+// 5-point Laplacian on an n x n grid of nodes and M = [2 -1; -1 2]
+ParCSRMatrix* form_coupled_laplacian(int n)
+{
+    double M[4] = {2.0, -1.0, -1.0, 2.0};
+    int n_nodes = n*n;
+    Partition* part = new Partition(n_nodes*2, n_nodes*2, 2, 2);
+    ParCSRMatrix* A = new ParCSRMatrix(part);
+    part->num_shared = 0;
+
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        index_t row = A->partition->first_local_row + i;
+        int node = row / 2;
+        int r = row % 2;
+        int x = node % n;
+        int y = node / n;
+        for (int c = 0; c < 2; c++)
+        {
+            A->add_value(i, node*2 + c, 4.0 * M[r*2+c]);
+            if (x > 0) A->add_value(i, (node-1)*2 + c, -M[r*2+c]);
+            if (x < n-1) A->add_value(i, (node+1)*2 + c, -M[r*2+c]);
+            if (y > 0) A->add_value(i, (node-n)*2 + c, -M[r*2+c]);
+            if (y < n-1) A->add_value(i, (node+n)*2 + c, -M[r*2+c]);
+        }
+        A->on_proc->idx1[i+1] = A->on_proc->idx2.size();
+        A->off_proc->idx1[i+1] = A->off_proc->idx2.size();
+    }
+    A->finalize();
+
+    return A;
+}
+
+void compare(ParCSRMatrix* A, ParBSRMatrix* A_bsr)
+{
+    ParCSRMatrix* B = A_bsr->to_ParCSR();
+    ASSERT_EQ(A->global_num_rows, B->global_num_rows);
+    ASSERT_EQ(A->global_num_cols, B->global_num_cols);
+    ASSERT_EQ(A->local_num_rows, B->local_num_rows);
+
+    std::map<index_t, double> row_A, row_B;
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        row_A.clear();
+        row_B.clear();
+        for (int j = A->on_proc->idx1[i]; j < A->on_proc->idx1[i+1]; j++)
+            row_A[A->on_proc_column_map[A->on_proc->idx2[j]]] += A->on_proc->vals[j];
+        for (int j = A->off_proc->idx1[i]; j < A->off_proc->idx1[i+1]; j++)
+            row_A[A->off_proc_column_map[A->off_proc->idx2[j]]] += A->off_proc->vals[j];
+        for (int j = B->on_proc->idx1[i]; j < B->on_proc->idx1[i+1]; j++)
+            row_B[B->on_proc_column_map[B->on_proc->idx2[j]]] += B->on_proc->vals[j];
+        for (int j = B->off_proc->idx1[i]; j < B->off_proc->idx1[i+1]; j++)
+            row_B[B->off_proc_column_map[B->off_proc->idx2[j]]] += B->off_proc->vals[j];
+
+        for (std::map<index_t, double>::iterator it = row_A.begin();
+                it != row_A.end(); ++it)
+        {
+            ASSERT_NEAR(it->second, row_B[it->first], 1e-10);
+        }
+        for (std::map<index_t, double>::iterator it = row_B.begin();
+                it != row_B.end(); ++it)
+        {
+            ASSERT_NEAR(it->second, row_A[it->first], 1e-10);
+        }
+    }
+
+    delete B;
+}
+
+TEST(ParBlockAMGTest, TestsInMultilevel)
+{
+    ParCSRMatrix* A = form_coupled_laplacian(32);
+    ParBSRMatrix* A_bsr = A->to_ParBSR(2, 2);
+    A_bsr->comm = new ParComm(A_bsr->partition, A_bsr->off_proc_column_map,
+            A_bsr->on_proc_column_map);
+
+    ParVector x(A->global_num_rows, A->local_num_rows,
+            A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows,
+            A->partition->first_local_row);
+
+    // Scalar smoothed aggregation with weighted Jacobi, as reference
+    ParSmoothedAggregationSolver* ml = new ParSmoothedAggregationSolver(0.0,
+            MIS, JacobiProlongation, Symmetric, Jacobi);
+    ml->max_coarse = 40;
+    ml->relax_weight = 2.0 / 3;
+    ml->setup(A);
+    x.set_const_value(1.0);
+    A->mult(x, b);
+    x.set_const_value(0.0);
+    int scalar_iter = ml->solve(x, b);
+    delete ml;
+
+    ml = new ParSmoothedAggregationSolver(0.0);
+    ml->max_coarse = 20;
+    ml->relax_weight = 2.0 / 3;
+    ml->setup(A_bsr);
+    ASSERT_GT(ml->num_levels, 2);
+
+    // Each block level is the Galerkin product of the finer level
+    for (int i = 0; i < ml->num_levels - 1; i++)
+    {
+        ParBSRMatrix* Al = ml->levels[i]->A_bsr;
+        ParBSRMatrix* Pl = ml->levels[i]->P_bsr;
+        ASSERT_EQ(Al->b_rows, 2);
+        ASSERT_EQ(Pl->b_rows, 2);
+        ASSERT_EQ(Pl->b_cols, 2);
+
+        ParCSRMatrix* Al_csr = Al->to_ParCSR();
+        ParCSRMatrix* Pl_csr = Pl->to_ParCSR();
+        Al_csr->comm = new ParComm(Al_csr->partition,
+                Al_csr->off_proc_column_map, Al_csr->on_proc_column_map);
+        ParCSRMatrix* AP = Al_csr->mult(Pl_csr);
+        ParCSRMatrix* Ac = AP->mult_T(Pl_csr);
+        if (i + 1 < ml->num_levels - 1)
+        {
+            compare(Ac, ml->levels[i+1]->A_bsr);
+        }
+        else
+        {
+            ASSERT_EQ(Ac->global_num_rows, ml->levels[i+1]->A->global_num_rows);
+        }
+        delete Ac;
+        delete AP;
+        delete Pl_csr;
+        delete Al_csr;
+    }
+
+    // Block relaxation and block cycles converge, capturing the 
+    // coupled smooth modes that scalar aggregation misses
+    x.set_const_value(1.0);
+    A->mult(x, b);
+    x.set_const_value(0.0);
+    int iter = ml->solve(x, b);
+    aligned_vector<double>& res = ml->get_residuals();
+    ASSERT_LT(res[iter], ml->solve_tol);
+    ASSERT_LT(iter, scalar_iter);
+
+    delete ml;
+    delete A_bsr;
+    delete A;
+
+} // end of TEST(ParBlockAMGTest, TestsInMultilevel) //
+
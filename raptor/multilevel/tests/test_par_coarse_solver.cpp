@@ -0,0 +1,83 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "multilevel/par_coarse_solver.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/par_stencil.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+TEST(ParCoarseSolverTest, TestsInMultilevel)
+{
+    int grid[3] = {6, 6, 6};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    // Each backend should solve the system directly
+    coarse_solve_t types[3] = {DenseLU, SparseLU, IterativeCG};
+    for (int t = 0; t < 3; t++)
+    {
+        x.set_const_value(1.0);
+        A->mult(x, b);
+        x.set_const_value(0.0);
+
+        ParCoarseSolver* solver = create_coarse_solver(A, types[t]);
+        ASSERT_EQ(solver->type, types[t]);
+        solver->setup(A);
+        solver->solve(A, x, b);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_NEAR(x[i], 1.0, 1e-8);
+        }
+        delete solver;
+    }
+
+    // Auto selection by coarse size and nnz
+    ParCoarseSolver* solver = create_coarse_solver(A, AutoCoarse);
+    ASSERT_EQ(solver->type, DenseLU);
+    delete solver;
+    solver = create_coarse_solver(A, AutoCoarse, 100);
+    ASSERT_EQ(solver->type, SparseLU);
+    delete solver;
+    solver = create_coarse_solver(A, AutoCoarse, 100, 100);
+    ASSERT_EQ(solver->type, IterativeCG);
+    delete solver;
+
+    // AMG converges with every coarse solver
+    for (int t = 0; t < 3; t++)
+    {
+        ParMultilevel* ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+        ml->coarse_solve_type = types[t];
+        ml->max_coarse = 100;
+        ml->setup(A);
+        ASSERT_EQ(ml->coarse_solver->type, types[t]);
+
+        x.set_const_value(1.0);
+        A->mult(x, b);
+        x.set_const_value(0.0);
+        int iter = ml->solve(x, b);
+        aligned_vector<double>& res = ml->get_residuals();
+        ASSERT_LT(res[iter], 1e-7);
+        delete ml;
+    }
+
+    delete A;
+} // end of TEST(ParCoarseSolverTest, TestsInMultilevel) //
@@ -0,0 +1,120 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "multilevel/par_multilevel.hpp"
+#include "ruge_stuben/par_ruge_stuben_solver.hpp"
+#include "aggregation/par_smoothed_aggregation_solver.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "gallery/par_stencil.hpp"
+#include "tests/par_compare.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+ParMultilevel* form_solver(int t)
+{
+    ParMultilevel* ml;
+    if (t < 2) ml = new ParRugeStubenSolver(0.25, HMIS, Extended, Classical, SOR);
+    else ml = new ParSmoothedAggregationSolver(0.0);
+    if (t == 1) ml->agglomerate_rows = 100;
+    ml->max_coarse = 10;
+    return ml;
+}
+
+TEST(ParResetupTest, TestsInMultilevel)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    // Same pattern as A, with shifted diagonal (so that strength of 
+    // connection, and therefore the splitting, is unchanged)
+    ParCSRMatrix* A_shift = A->copy();
+    for (int i = 0; i < A_shift->local_num_rows; i++)
+    {
+        for (int j = A_shift->on_proc->idx1[i]; j < A_shift->on_proc->idx1[i+1]; j++)
+        {
+            if (A_shift->on_proc_column_map[A_shift->on_proc->idx2[j]] 
+                    == A_shift->local_row_map[i])
+            {
+                A_shift->on_proc->vals[j] += 2.0;
+            }
+        }
+    }
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+
+    for (int t = 0; t < 3; t++)
+    {
+        ParMultilevel* ml = form_solver(t);
+        ml->setup(A);
+
+        // Galerkin structure is formed by the first resetup, unless 
+        // keep_rap_structure is set
+        for (int i = 0; i < ml->num_levels - 1; i++)
+        {
+            ASSERT_TRUE(ml->levels[i]->rap_structure == NULL);
+        }
+        ml->resetup(A_shift);
+
+        ParMultilevel* ml_shift = form_solver(t);
+        ml_shift->keep_rap_structure = true;
+        ml_shift->setup(A_shift);
+        if (t != 1)
+        {
+            ASSERT_TRUE(ml_shift->levels[0]->rap_structure != NULL);
+        }
+
+        // Splitting of the fine level is unchanged, so the first coarse
+        // level matches one setup from scratch
+        compare(ml->levels[0]->A, ml_shift->levels[0]->A);
+        compare(ml->levels[1]->A, ml_shift->levels[1]->A);
+
+        // Coarser levels (whose splitting is reused) are Galerkin 
+        // products of the new values, formed over the stored structure
+        for (int i = 0; i < ml->num_levels - 1; i++)
+        {
+            ASSERT_TRUE(ml->levels[i]->rap_structure != NULL);
+            ParCSRMatrix* AP = ml->levels[i]->A->mult(ml->levels[i]->P);
+            ParCSRMatrix* Ac = AP->mult_T(ml->levels[i]->P);
+            compare(ml->levels[i+1]->A, Ac);
+            delete Ac;
+            delete AP;
+        }
+
+        x.set_const_value(1.0);
+        A_shift->mult(x, b);
+        x.set_const_value(0.0);
+        int iter = ml->solve(x, b);
+        aligned_vector<double>& res = ml->get_residuals();
+        ASSERT_LT(res[iter], 1e-7);
+
+        x.set_const_value(0.0);
+        int iter_shift = ml_shift->solve(x, b);
+        ASSERT_LE(iter, iter_shift + 2);
+
+        // Resetup over the structure recorded in setup
+        ml_shift->resetup(A_shift);
+        x.set_const_value(0.0);
+        ASSERT_EQ(ml_shift->solve(x, b), iter_shift);
+
+        delete ml;
+        delete ml_shift;
+    }
+
+    delete A_shift;
+    delete A;
+} // end of TEST(ParResetupTest, TestsInMultilevel) //
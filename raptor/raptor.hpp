@@ -18,6 +18,7 @@
 #ifndef NO_MPI
     #include "core/par_matrix.hpp"
     #include "core/par_vector.hpp"
+    #include "core/par_multivector.hpp"
 #endif 
 
 // Communication classes
@@ -80,11 +81,13 @@
 #ifndef NO_MPI
     #include "multilevel/par_multilevel.hpp"
     #include "multilevel/par_level.hpp"
+    #include "multilevel/par_coarse_solver.hpp"
 #endif 
 
 // Krylov methods
 #include "krylov/cg.hpp"
 #include "krylov/par_cg.hpp"
+#include "krylov/par_gmres.hpp"
 #include "krylov/bicgstab.hpp"
 #include "krylov/par_bicgstab.hpp"
 
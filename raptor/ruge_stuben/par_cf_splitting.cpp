@@ -114,6 +114,215 @@ void split_hmis(ParCSRMatrix* S, aligned_vector<int>& states,
     pmis_main_loop(S, states, off_proc_states, tap_cf, rand_vals, comm_t);
 }
 
+// Strength of connection between the C-points of states, with i strongly
+// connected to j if there is a path of length at most two from i to j in S
+// (S2 = I_C^T * S * S * I_C, with I_C injection onto the C-points).
+// Entries of S2 count these paths, and only those with at least theta
+// times the row maximum are kept.  Local rows of S2 are the local C-points,
+// in order, and rows and columns keep the fine global rows of the C-points
+// as their global indices (so S2 shares the partition of S).
+ParCSRMatrix* distance_two_strength(ParCSRMatrix* S,
+        const aligned_vector<int>& states, double theta, bool tap_cf,
+        data_t* comm_t)
+{
+    int ctr;
+    index_t global_num_coarse;
+
+    // Pattern of S, with unit values so no entries of S*S cancel
+    ParCSRMatrix* S_I = S->copy();
+    std::fill(S_I->on_proc->vals.begin(), S_I->on_proc->vals.end(), 1.0);
+    std::fill(S_I->off_proc->vals.begin(), S_I->off_proc->vals.end(), 1.0);
+    ParCSRMatrix* SS = S_I->mult(S_I, tap_cf, comm_t);
+    delete S_I;
+
+    // Injection from local C-points to rows of S
+    index_t local_num_coarse = 0;
+    for (int i = 0; i < S->local_num_rows; i++)
+    {
+        if (states[i] == 1) local_num_coarse++;
+    }
+    MPI_Allreduce(&local_num_coarse, &global_num_coarse, 1, MPI_INDEX_T,
+            MPI_SUM, MPI_COMM_WORLD);
+
+    ParCSRMatrix* I_C = new ParCSRMatrix(S->partition, S->global_num_rows,
+            global_num_coarse, S->local_num_rows, local_num_coarse, 0);
+    I_C->local_row_map = S->get_local_row_map();
+    ctr = 0;
+    I_C->on_proc->idx1[0] = 0;
+    I_C->off_proc->idx1[0] = 0;
+    for (int i = 0; i < S->local_num_rows; i++)
+    {
+        if (states[i] == 1)
+        {
+            I_C->on_proc->idx2.push_back(ctr++);
+            I_C->on_proc->vals.push_back(1.0);
+            I_C->on_proc_column_map.push_back(S->on_proc_column_map[i]);
+        }
+        I_C->on_proc->idx1[i+1] = I_C->on_proc->idx2.size();
+        I_C->off_proc->idx1[i+1] = 0;
+    }
+    I_C->on_proc->nnz = I_C->on_proc->idx2.size();
+    I_C->local_nnz = I_C->on_proc->nnz;
+
+    ParCSRMatrix* S2 = SS->RAP(I_C, tap_cf, comm_t);
+    delete SS;
+    delete I_C;
+
+    // Keep only connections along at least theta times the largest number
+    // of length-two paths in each row (the diagonal is always kept)
+    if (theta > 0)
+    {
+        int start, off_start, on_ptr, off_ptr;
+        double row_max;
+        S2->on_proc->move_diag();
+
+        on_ptr = 0;
+        off_ptr = 0;
+        start = 0;
+        off_start = 0;
+        for (int i = 0; i < S2->local_num_rows; i++)
+        {
+            row_max = 0.0;
+            for (int j = start; j < S2->on_proc->idx1[i+1]; j++)
+            {
+                if (S2->on_proc->idx2[j] != i && S2->on_proc->vals[j] > row_max)
+                    row_max = S2->on_proc->vals[j];
+            }
+            for (int j = off_start; j < S2->off_proc->idx1[i+1]; j++)
+            {
+                if (S2->off_proc->vals[j] > row_max)
+                    row_max = S2->off_proc->vals[j];
+            }
+
+            for (int j = start; j < S2->on_proc->idx1[i+1]; j++)
+            {
+                if (S2->on_proc->idx2[j] == i || S2->on_proc->vals[j] >= theta * row_max)
+                {
+                    S2->on_proc->idx2[on_ptr] = S2->on_proc->idx2[j];
+                    S2->on_proc->vals[on_ptr++] = S2->on_proc->vals[j];
+                }
+            }
+            start = S2->on_proc->idx1[i+1];
+            S2->on_proc->idx1[i+1] = on_ptr;
+
+            for (int j = off_start; j < S2->off_proc->idx1[i+1]; j++)
+            {
+                if (S2->off_proc->vals[j] >= theta * row_max)
+                {
+                    S2->off_proc->idx2[off_ptr] = S2->off_proc->idx2[j];
+                    S2->off_proc->vals[off_ptr++] = S2->off_proc->vals[j];
+                }
+            }
+            off_start = S2->off_proc->idx1[i+1];
+            S2->off_proc->idx1[i+1] = off_ptr;
+        }
+        S2->on_proc->nnz = on_ptr;
+        S2->off_proc->nnz = off_ptr;
+        S2->on_proc->idx2.resize(on_ptr);
+        S2->on_proc->vals.resize(on_ptr);
+        S2->off_proc->idx2.resize(off_ptr);
+        S2->off_proc->vals.resize(off_ptr);
+        S2->local_nnz = on_ptr + off_ptr;
+    }
+
+    int key = 9999;
+    MPI_Comm mpi_comm = MPI_COMM_WORLD;
+    if (S->comm)
+    {
+        key = S->comm->key;
+        mpi_comm = S->comm->mpi_comm;
+    }
+    S2->comm = new ParComm(S2->partition, S2->off_proc_column_map,
+            S2->on_proc_column_map, key, mpi_comm, comm_t);
+    if (tap_cf)
+    {
+        S2->tap_comm = new TAPComm(S2->partition, S2->off_proc_column_map,
+                S2->on_proc_column_map, true, MPI_COMM_WORLD, comm_t);
+    }
+
+    return S2;
+}
+
+// Aggressive coarsening : PMIS (or HMIS) on S, followed by a second pass
+// of PMIS on the distance-two strength between the resulting C-points.
+// C-points of the first pass that become fine in the second are marked -2,
+// so that two_stage_interpolation can interpolate through them.
+void split_aggressive(ParCSRMatrix* S, aligned_vector<int>& states,
+        aligned_vector<int>& off_proc_states, bool hmis, double theta,
+        bool tap_cf, double* rand_vals, data_t* comm_t)
+{
+    int ctr;
+    aligned_vector<int> coarse_states;
+    aligned_vector<int> off_proc_coarse_states;
+    aligned_vector<double> coarse_rand_vals;
+    double* coarse_rand_ptr = NULL;
+
+    CommPkg* comm = S->comm;
+    if (tap_cf)
+    {
+        comm = S->tap_comm;
+    }
+
+    // First pass
+    if (hmis)
+    {
+        split_hmis(S, states, off_proc_states, tap_cf, rand_vals, comm_t);
+    }
+    else
+    {
+        split_pmis(S, states, off_proc_states, tap_cf, rand_vals, comm_t);
+    }
+
+    // Second pass, on the C-points of the first
+    ParCSRMatrix* S2 = distance_two_strength(S, states, theta, tap_cf,
+            comm_t);
+    if (rand_vals)
+    {
+        if (S2->local_num_rows) coarse_rand_vals.resize(S2->local_num_rows);
+        ctr = 0;
+        for (int i = 0; i < S->local_num_rows; i++)
+        {
+            if (states[i] == 1)
+            {
+                coarse_rand_vals[ctr++] = rand_vals[i];
+            }
+        }
+        coarse_rand_ptr = coarse_rand_vals.data();
+    }
+    if (hmis)
+    {
+        split_hmis(S2, coarse_states, off_proc_coarse_states, tap_cf,
+                coarse_rand_ptr, comm_t);
+    }
+    else
+    {
+        split_pmis(S2, coarse_states, off_proc_coarse_states, tap_cf,
+                coarse_rand_ptr, comm_t);
+    }
+    delete S2;
+
+    // C-points of the second pass (including those with no distance-two
+    // neighbors) remain coarse
+    ctr = 0;
+    for (int i = 0; i < S->local_num_rows; i++)
+    {
+        if (states[i] == 1)
+        {
+            if (coarse_states[ctr] == 0)
+            {
+                states[i] = -2;
+            }
+            ctr++;
+        }
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<int>& recvbuf = comm->communicate(states);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    std::copy(recvbuf.begin(), recvbuf.end(), off_proc_states.begin());
+}
+
 void set_initial_states(ParCSRMatrix* S, aligned_vector<int>& states)
 {
     if (S->local_num_rows == 0) return;
@@ -362,6 +571,7 @@ void find_max_off_weights(CommPkg* comm,
     {
         send_weights.resize(off_proc_num_cols);
     }
+#pragma omp parallel for private(start, end, idx, max_weight) schedule(static)
     for (int i = 0; i < off_proc_num_cols; i++)
     {
         if (off_proc_states[i] == -1 || first_pass)
@@ -420,6 +630,9 @@ int select_independent_set(const ParCSRMatrix* S,
     int num_new_coarse = 0;
     double weight;
 
+    // Each candidate only reads weights, so candidates are compared 
+    // in parallel
+#pragma omp parallel for private(start, end, idx, j, u, weight) schedule(static)
     for (int i = 0; i < remaining; i++)
     {
         u = unassigned[i];
@@ -490,7 +703,15 @@ int select_independent_set(const ParCSRMatrix* S,
         // If i made it this far, weight is greater than all unassigned
         // neighbors
         states[u] = 2;
-        new_coarse_list[num_new_coarse++] = u;
+    }
+
+    for (int i = 0; i < remaining; i++)
+    {
+        u = unassigned[i];
+        if (states[u] == 2)
+        {
+            new_coarse_list[num_new_coarse++] = u;
+        }
     }
 
     return num_new_coarse;
@@ -935,7 +1156,7 @@ int find_off_proc_states(CommPkg* comm,
 
 void find_off_proc_new_coarse(const ParCSRMatrix* S,
         CommPkg* comm,
-        const std::map<int, int>& global_to_local,
+        const std::map<index_t, int>& global_to_local,
         const aligned_vector<int>& states,
         const aligned_vector<int>& off_proc_states,
         const int* part_to_col,
@@ -950,14 +1171,14 @@ void find_off_proc_new_coarse(const ParCSRMatrix* S,
     int proc, count, buf_ptr;
     int ctr;
     int tag = 2999;
-    int global_col;
+    index_t global_col;
     int n_sends = 0;
     int msg_avail;
     MPI_Status recv_status;
 
     aligned_vector<int> send_ptr;
-    aligned_vector<int> send_buffer;
-    aligned_vector<int> recv_buffer;
+    aligned_vector<index_t> send_buffer;
+    aligned_vector<index_t> recv_buffer;
 
     off_proc_col_coarse.clear();
     int off_proc_num_cols = off_proc_states.size();
@@ -999,7 +1220,8 @@ void find_off_proc_new_coarse(const ParCSRMatrix* S,
             send_ptr[i+1] =  send_buffer.size();
         }
 
-        CSRMatrix* recv_mat = comm->communicate(send_ptr, send_buffer); 
+        aligned_vector<index_t> recv_cols;
+        CSRMatrix* recv_mat = comm->communicate(send_ptr, send_buffer, recv_cols);
 
         off_proc_col_ptr[0] = 0;
         for (int i = 0; i < off_proc_num_cols; i++)
@@ -1008,7 +1230,7 @@ void find_off_proc_new_coarse(const ParCSRMatrix* S,
             end = recv_mat->idx1[i+1];
             for (int j = start; j < end; j++)
             {
-                global_col = recv_mat->idx2[j];
+                global_col = recv_cols[j];
                 if (global_col >= S->partition->first_local_col 
                         && global_col <= S->partition->last_local_col)
                 {
@@ -1017,7 +1239,7 @@ void find_off_proc_new_coarse(const ParCSRMatrix* S,
                 }
                 else
                 {
-                    std::map<int, int>::const_iterator ptr = 
+                    std::map<index_t, int>::const_iterator ptr = 
                     global_to_local.find(global_col);
                     if (ptr != global_to_local.end())
                     {
@@ -1099,7 +1321,7 @@ void find_off_proc_new_coarse(const ParCSRMatrix* S,
             end = send_ptr[i+1];
             if (end - start)
             {
-                MPI_Isend(&(send_buffer[start]), end - start, MPI_INT, proc,
+                MPI_Isend(&(send_buffer[start]), end - start, MPI_INDEX_T, proc,
                         tag, MPI_COMM_WORLD, &(S->comm->send_data->requests[n_sends++]));
             }
         }
@@ -1124,13 +1346,13 @@ void find_off_proc_new_coarse(const ParCSRMatrix* S,
             if (msg_avail)
             {
                 MPI_Probe(proc, tag, MPI_COMM_WORLD, &recv_status);
-                MPI_Get_count(&recv_status, MPI_INT, &count);
+                MPI_Get_count(&recv_status, MPI_INDEX_T, &count);
 
                 if ((int) recv_buffer.size() < count)
                 {
                     recv_buffer.resize(count);
                 }
-                MPI_Recv(&recv_buffer[0], count, MPI_INT, proc, tag, MPI_COMM_WORLD,
+                MPI_Recv(&recv_buffer[0], count, MPI_INDEX_T, proc, tag, MPI_COMM_WORLD,
                         &recv_status);
             }
             ctr = 0;
@@ -1150,7 +1372,7 @@ void find_off_proc_new_coarse(const ParCSRMatrix* S,
                         }
                         else
                         {
-                            std::map<int, int>::const_iterator ptr = 
+                            std::map<index_t, int>::const_iterator ptr = 
                             global_to_local.find(global_col);
                             if (ptr != global_to_local.end())
                             {
@@ -1198,6 +1420,145 @@ void combine_weight_updates(CommPkg* comm,
     }
 }
 
+/**************************************************************
+ *****   Find Off Proc States and Max Weights
+ **************************************************************
+ ***** One round of PMIS communication, after new fine points
+ ***** are marked (state 3).  Rows unassigned at the start of the 
+ ***** round and not made coarse (state -1 or 3) send their state
+ ***** to each process holding them as an off_proc column.  For 
+ ***** each such off_proc column, the max weight of local rows 
+ ***** still unassigned (state -1) and strongly depending on it is
+ ***** sent back to its owner.  Both messages are conditional on 
+ ***** states the sender and receiver already agree on, so both
+ ***** directions are posted at once and completed by one wait.
+ **************************************************************/
+void find_off_proc_states_max_weights(ParComm* comm,
+        const aligned_vector<int>& off_col_ptr,
+        const aligned_vector<int>& off_col_indices,
+        const aligned_vector<int>& states,
+        aligned_vector<int>& off_proc_states,
+        const aligned_vector<double>& weights,
+        aligned_vector<double>& max_weights)
+{
+    int proc, start, end, idx;
+    int ctr, prev_ctr;
+    int n_requests = 0;
+    int state_key = 325494;
+    int weight_key = 453247;
+    double max_weight;
+
+    CommData* send_data = comm->send_data;
+    CommData* recv_data = comm->recv_data;
+    aligned_vector<int>& send_states = send_data->get_buffer<int>();
+    aligned_vector<int>& recv_states = recv_data->get_buffer<int>();
+    aligned_vector<double>& send_weights = recv_data->get_buffer<double>();
+    aligned_vector<double>& recv_weights = send_data->get_buffer<double>();
+    aligned_vector<MPI_Request> requests(2*(send_data->num_msgs + recv_data->num_msgs));
+
+    // Max unassigned weight in each off_proc column still unassigned
+    // (not made coarse this round)
+#pragma omp parallel for private(start, end, idx, max_weight) schedule(static)
+    for (int i = 0; i < recv_data->size_msgs; i++)
+    {
+        if (off_proc_states[i] != -1) continue;
+
+        max_weight = 0;
+        start = off_col_ptr[i];
+        end = off_col_ptr[i+1];
+        for (int j = start; j < end; j++)
+        {
+            idx = off_col_indices[j];
+            if (states[idx] == -1 && weights[idx] > max_weight)
+            {
+                max_weight = weights[idx];
+            }
+        }
+        send_weights[i] = max_weight;
+    }
+
+    // Send states of rows, and recv max weights of columns
+    ctr = 0;
+    prev_ctr = 0;
+    for (int i = 0; i < send_data->num_msgs; i++)
+    {
+        proc = send_data->procs[i];
+        start = send_data->indptr[i];
+        end = send_data->indptr[i+1];
+        for (int j = start; j < end; j++)
+        {
+            idx = send_data->indices[j];
+            if (states[idx] == -1 || states[idx] == 3)
+            {
+                send_states[ctr++] = states[idx];
+            }
+        }
+        if (ctr - prev_ctr)
+        {
+            MPI_Isend(&(send_states[prev_ctr]), ctr - prev_ctr, MPI_INT, proc,
+                    state_key, comm->mpi_comm, &(requests[n_requests++]));
+            MPI_Irecv(&(recv_weights[prev_ctr]), ctr - prev_ctr, MPI_DOUBLE, proc,
+                    weight_key, comm->mpi_comm, &(requests[n_requests++]));
+            prev_ctr = ctr;
+        }
+    }
+
+    // Recv states of off_proc columns, and send their max weights
+    // (packed in place, as ctr never passes j)
+    ctr = 0;
+    prev_ctr = 0;
+    for (int i = 0; i < recv_data->num_msgs; i++)
+    {
+        proc = recv_data->procs[i];
+        start = recv_data->indptr[i];
+        end = recv_data->indptr[i+1];
+        for (int j = start; j < end; j++)
+        {
+            if (off_proc_states[j] == -1)
+            {
+                send_weights[ctr++] = send_weights[j];
+            }
+        }
+        if (ctr - prev_ctr)
+        {
+            MPI_Irecv(&(recv_states[prev_ctr]), ctr - prev_ctr, MPI_INT, proc,
+                    state_key, comm->mpi_comm, &(requests[n_requests++]));
+            MPI_Isend(&(send_weights[prev_ctr]), ctr - prev_ctr, MPI_DOUBLE, proc,
+                    weight_key, comm->mpi_comm, &(requests[n_requests++]));
+            prev_ctr = ctr;
+        }
+    }
+
+    if (n_requests)
+    {
+        MPI_Waitall(n_requests, requests.data(), MPI_STATUSES_IGNORE);
+    }
+
+    ctr = 0;
+    for (int i = 0; i < recv_data->size_msgs; i++)
+    {
+        if (off_proc_states[i] == -1)
+        {
+            off_proc_states[i] = recv_states[ctr++];
+        }
+    }
+
+    std::fill(max_weights.begin(), max_weights.end(), 0);
+    ctr = 0;
+    for (int i = 0; i < send_data->size_msgs; i++)
+    {
+        idx = send_data->indices[i];
+        if (states[idx] == -1 || states[idx] == 3)
+        {
+            if (recv_weights[ctr] > max_weights[idx])
+            {
+                max_weights[idx] = recv_weights[ctr];
+            }
+            ctr++;
+        }
+    }
+}
+
 int update_states(aligned_vector<double>& weights, 
         aligned_vector<int>& states, const int remaining, aligned_vector<int>& unassigned)
 {
@@ -1241,6 +1602,7 @@ void pmis_main_loop(ParCSRMatrix* S,
     aligned_vector<double> off_proc_weights;
     aligned_vector<double> max_weights;
     aligned_vector<int> new_coarse_list;
+    aligned_vector<int> new_fine;
     aligned_vector<int> unassigned;
     aligned_vector<int> unassigned_off;
 
@@ -1259,6 +1621,7 @@ void pmis_main_loop(ParCSRMatrix* S,
         unassigned.resize(S->local_num_rows);
         max_weights.resize(S->local_num_rows);
         new_coarse_list.resize(S->local_num_rows);
+        new_fine.resize(S->local_num_rows);
     }
     if (S->off_proc_num_cols)
     {
@@ -1323,22 +1686,25 @@ void pmis_main_loop(ParCSRMatrix* S,
         }
     }
 
-    // Find off_proc_weights
+    // Find off_proc_weights and the max weight in each column, 
+    // after which only unassigned rows are communicated
     bool first_pass = true;
 
     if (comm_t) *comm_t -= MPI_Wtime();
     find_off_proc_weights(comm, states, off_proc_states, 
             weights, off_proc_weights, first_pass);
+    find_max_off_weights(comm, off_col_ptr, off_col_indices, 
+            states, off_proc_states, weights, max_weights, first_pass);
     if (comm_t) *comm_t += MPI_Wtime();
 
-    while (num_remaining || num_remaining_off || first_pass)
+    first_pass = false;
+    comm = S->comm;
+
+    // Each round communicates twice, and a process leaves the loop
+    // once its rows and off_proc columns are all assigned (neighbors 
+    // expect no messages for assigned rows)
+    while (num_remaining || num_remaining_off)
     {
-        // Find max unassigned weight in each row / column
-        if (comm_t) *comm_t -= MPI_Wtime();
-        find_max_off_weights(comm, off_col_ptr, off_col_indices, 
-                states, off_proc_states, weights, max_weights, first_pass);
-        if (comm_t) *comm_t += MPI_Wtime();
-        
         // For each vertex, if max in neighborhood, add to C
         num_new_coarse = select_independent_set(S, num_remaining, unassigned,
                 weights, off_proc_weights, max_weights, on_col_ptr,
@@ -1349,48 +1715,59 @@ void pmis_main_loop(ParCSRMatrix* S,
         if (comm_t) *comm_t += MPI_Wtime();
 
         // For each row, if new C point in row, add row to F
-        for (int i = 0; i < num_new_coarse; i++)
+#pragma omp parallel for private(start, end, row, idx) schedule(static)
+        for (int i = 0; i < num_remaining; i++)
         {
-            idx = new_coarse_list[i];
-            start = on_col_ptr[idx];
-            end = on_col_ptr[idx+1];
+            row = unassigned[i];
+            new_fine[i] = 0;
+            if (states[row] != -1) continue;
+
+            start = S->on_proc->idx1[row];
+            end = S->on_proc->idx1[row+1];
+            if (S->on_proc->idx2[start] == row)
+            {
+                start++;
+            }
             for (int j = start; j < end; j++)
             {
-                row = on_col_indices[j];
-                if (states[row] == -1)
+                idx = S->on_proc->idx2[j];
+                if (states[idx] == 2)
                 {
-                    states[row] = 3;
+                    new_fine[i] = 1;
+                    break;
                 }
             }
-        }
-        for (int i = 0; i < num_remaining_off; i++)
-        {
-            idx = unassigned_off[i];
-            if (off_proc_states[idx] == 2)
+            if (new_fine[i]) continue;
+
+            start = S->off_proc->idx1[row];
+            end = S->off_proc->idx1[row+1];
+            for (int j = start; j < end; j++)
             {
-                start = off_col_ptr[idx];
-                end = off_col_ptr[idx+1];
-                for (int j = start; j < end; j++)
+                idx = S->off_proc->idx2[j];
+                if (off_proc_states[idx] == 2)
                 {
-                    row = off_col_indices[j];
-                    if (states[row] == -1)
-                    {
-                        states[row] = 3;
-                    }
+                    new_fine[i] = 1;
+                    break;
                 }
-            }       
+            }
+        }
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < num_remaining; i++)
+        {
+            if (new_fine[i])
+            {
+                states[unassigned[i]] = 3;
+            }
         }
 
         if (comm_t) *comm_t -= MPI_Wtime();
-        find_off_proc_states(comm, states, off_proc_states, first_pass);
+        find_off_proc_states_max_weights((ParComm*) comm, off_col_ptr, 
+                off_col_indices, states, off_proc_states, weights, max_weights);
         if (comm_t) *comm_t += MPI_Wtime();
 
         num_remaining = update_states(weights, states, num_remaining, unassigned);
         num_remaining_off = update_states(off_proc_weights,
                off_proc_states, num_remaining_off, unassigned_off);
-
-        first_pass = false;
-        comm = S->comm;
     }
 }
 
@@ -1422,7 +1799,7 @@ void cljp_main_loop(ParCSRMatrix* S,
     aligned_vector<int> off_proc_col_coarse;
     aligned_vector<int> off_proc_weight_updates;
     aligned_vector<int> off_proc_col_ptr;
-    std::map<int, int> global_to_local;
+    std::map<index_t, int> global_to_local;
     aligned_vector<int> new_coarse_list;
     aligned_vector<int> off_new_coarse_list;
     aligned_vector<int> unassigned;
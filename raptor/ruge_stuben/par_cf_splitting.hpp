@@ -41,4 +41,13 @@ void split_pmis(ParCSRMatrix* S, aligned_vector<int>& states,
 void split_hmis(ParCSRMatrix* S, aligned_vector<int>& states,
         aligned_vector<int>& off_proc_states, bool tap_cf = false, 
         double* rand_vals = NULL, data_t* comm_t = NULL);
+
+ParCSRMatrix* distance_two_strength(ParCSRMatrix* S,
+        const aligned_vector<int>& states, double theta = 0.0,
+        bool tap_cf = false, data_t* comm_t = NULL);
+
+void split_aggressive(ParCSRMatrix* S, aligned_vector<int>& states,
+        aligned_vector<int>& off_proc_states, bool hmis = false,
+        double theta = 0.5, bool tap_cf = false, double* rand_vals = NULL,
+        data_t* comm_t = NULL);
 #endif
@@ -7,17 +7,20 @@
 using namespace raptor;
 
 // TODO -- if in S, col is positive, otherwise col is -(col+1)
+// Global columns of recv_on and recv_off are returned in recv_on_cols
+// and recv_off_cols (idx2 of each is left empty)
 void communicate(ParCSRMatrix* A, ParCSRMatrix* S, const aligned_vector<int>& states,
         const aligned_vector<int>& off_proc_states, CommPkg* comm,
-        CSRMatrix** recv_on_ptr, CSRMatrix** recv_off_ptr)
+        CSRMatrix** recv_on_ptr, CSRMatrix** recv_off_ptr,
+        aligned_vector<index_t>& recv_on_cols, aligned_vector<index_t>& recv_off_cols)
 {
     
     int start, end, col;
-    int ctr_S, end_S, global_col;
-    int tmp_col;
+    int ctr_S, end_S;
+    index_t global_col, tmp_col;
 
     aligned_vector<int> rowptr(A->local_num_rows + 1);
-    aligned_vector<int> col_indices;
+    aligned_vector<index_t> col_indices;
     aligned_vector<double> values;
     if (A->local_nnz)
     {
@@ -85,17 +88,20 @@ void communicate(ParCSRMatrix* A, ParCSRMatrix* S, const aligned_vector<int>& st
         rowptr[i+1] = col_indices.size();
     }
 
-    CSRMatrix* recv_mat = comm->communicate(rowptr, col_indices, values);
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = comm->communicate(rowptr, col_indices, values, recv_cols);
     CSRMatrix* recv_on = new CSRMatrix(recv_mat->n_rows, -1, recv_mat->nnz);
     CSRMatrix* recv_off = new CSRMatrix(recv_mat->n_rows, -1, recv_mat->nnz);
+    recv_on_cols.clear();
+    recv_off_cols.clear();
     for (int i = 0; i < recv_mat->n_rows; i++)
     {
         start = recv_mat->idx1[i];
         end = recv_mat->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            col = recv_mat->idx2[j];
-            tmp_col = col;
+            global_col = recv_cols[j];
+            tmp_col = global_col;
             if (tmp_col < 0) 
             {
                 tmp_col = (-tmp_col) - 1;
@@ -108,25 +114,25 @@ void communicate(ParCSRMatrix* A, ParCSRMatrix* S, const aligned_vector<int>& st
             if (tmp_col < A->partition->first_local_col || 
                     tmp_col > A->partition->last_local_col)
             {
-                if (col >= A->partition->global_num_cols || 
-                        col < -(A->partition->global_num_cols))
+                if (global_col >= A->partition->global_num_cols || 
+                        global_col < -(A->partition->global_num_cols))
                         continue; // Don't add fine points to off proc
 
-                recv_off->idx2.push_back(col);
+                recv_off_cols.push_back(global_col);
                 recv_off->vals.push_back(recv_mat->vals[j]);
             }
             else
             {
-                recv_on->idx2.push_back(col);
+                recv_on_cols.push_back(global_col);
                 recv_on->vals.push_back(recv_mat->vals[j]);
             }
         }
-        recv_on->idx1[i+1] = recv_on->idx2.size();
-        recv_off->idx1[i+1] = recv_off->idx2.size();
+        recv_on->idx1[i+1] = recv_on_cols.size();
+        recv_off->idx1[i+1] = recv_off_cols.size();
     }
 
-    recv_on->nnz = recv_on->idx2.size();
-    recv_off->nnz = recv_off->idx2.size();
+    recv_on->nnz = recv_on_cols.size();
+    recv_off->nnz = recv_off_cols.size();
 
     delete recv_mat;
     *recv_on_ptr = recv_on;
@@ -134,14 +140,18 @@ void communicate(ParCSRMatrix* A, ParCSRMatrix* S, const aligned_vector<int>& st
 }
 
 
+// Global columns of recv_on and recv_off are returned in recv_on_cols
+// and recv_off_cols (idx2 of each is left empty)
 void communicate(ParCSRMatrix* A, const aligned_vector<int>& states,
         const aligned_vector<int>& off_proc_states, CommPkg* comm,
-        CSRMatrix** recv_on_ptr, CSRMatrix** recv_off_ptr)
+        CSRMatrix** recv_on_ptr, CSRMatrix** recv_off_ptr,
+        aligned_vector<index_t>& recv_on_cols, aligned_vector<index_t>& recv_off_cols)
 {
     int start, end, col;
+    index_t global_col;
 
     aligned_vector<int> rowptr(A->local_num_rows + 1);
-    aligned_vector<int> col_indices;
+    aligned_vector<index_t> col_indices;
     aligned_vector<double> values;
     if (A->local_nnz)
     {
@@ -177,54 +187,63 @@ void communicate(ParCSRMatrix* A, const aligned_vector<int>& states,
         rowptr[i+1] = col_indices.size();
     }
 
-    CSRMatrix* recv_mat = comm->communicate(rowptr, col_indices, values);
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = comm->communicate(rowptr, col_indices, values, recv_cols);
     CSRMatrix* recv_on = new CSRMatrix(recv_mat->n_rows, -1, recv_mat->nnz);
     CSRMatrix* recv_off = new CSRMatrix(recv_mat->n_rows, -1, recv_mat->nnz);
+    recv_on_cols.clear();
+    recv_off_cols.clear();
     for (int i = 0; i < recv_mat->n_rows; i++)
     {
         start = recv_mat->idx1[i];
         end = recv_mat->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            col = recv_mat->idx2[j];
-            if (col < A->partition->first_local_col || col > A->partition->last_local_col)
+            global_col = recv_cols[j];
+            if (global_col < A->partition->first_local_col 
+                    || global_col > A->partition->last_local_col)
             {
-                recv_off->idx2.push_back(col);
+                recv_off_cols.push_back(global_col);
                 recv_off->vals.push_back(recv_mat->vals[j]);
             }
             else
             {
-                recv_on->idx2.push_back(col);
+                recv_on_cols.push_back(global_col);
                 recv_on->vals.push_back(recv_mat->vals[j]);
             }
         }
-        recv_on->idx1[i+1] = recv_on->idx2.size();
-        recv_off->idx1[i+1] = recv_off->idx2.size();
+        recv_on->idx1[i+1] = recv_on_cols.size();
+        recv_off->idx1[i+1] = recv_off_cols.size();
     }
-    recv_on->nnz = recv_on->idx2.size();
-    recv_off->nnz = recv_off->idx2.size();
+    recv_on->nnz = recv_on_cols.size();
+    recv_off->nnz = recv_off_cols.size();
 
     delete recv_mat;
     *recv_on_ptr = recv_on;
     *recv_off_ptr = recv_off;
 }
 
-ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
+// Extended+i interpolation.  If rows is not NULL, only the rows i with
+// rows[i] == 1 are formed (in order), as rows of the returned matrix.
+// Communication packages are created for P only if form_comm is true.
+static ParCSRMatrix* extended_interpolation_rows(ParCSRMatrix* A,
         ParCSRMatrix* S, const aligned_vector<int>& states,
         const aligned_vector<int>& off_proc_states, 
+        const aligned_vector<int>* rows, bool form_comm,
         bool tap_interp, int num_variables, int* variables, 
         data_t* comm_t, data_t* comm_mat_t)
 {
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    int start, end, idx;
+    int start, end, row;
     int start_S, end_S;
     int start_k, end_k;
-    int col, global_col;
+    int col;
+    index_t global_col;
     int ctr, col_k, col_P;
     int col_S, col_A;
-    int global_num_cols;
+    index_t global_num_cols;
     int on_proc_cols, off_proc_cols;
     int sign;
     int row_start_on, row_end_on;
@@ -238,9 +257,9 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
         comm = A->tap_comm;
     }
 
-    std::set<int> global_set;
-    std::map<int, int> global_to_local;
-    aligned_vector<int> off_proc_column_map;
+    std::set<index_t> global_set;
+    std::map<index_t, int> global_to_local;
+    aligned_vector<index_t> off_proc_column_map;
     aligned_vector<int> off_variables;
 
     CSRMatrix* recv_on; // On Proc Block of Recvd A
@@ -296,7 +315,9 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
 
     // Communicate parallel matrix A (Costly!)
     if (comm_mat_t) *comm_mat_t -= MPI_Wtime();
-    communicate(A, S, states, off_proc_states_A, comm, &recv_on, &recv_off);
+    aligned_vector<index_t> recv_on_cols, recv_off_cols;
+    communicate(A, S, states, off_proc_states_A, comm, &recv_on, &recv_off,
+            recv_on_cols, recv_off_cols);
     if (comm_mat_t) *comm_mat_t += MPI_Wtime();
 
     // Change on_proc_cols to local
@@ -315,37 +336,37 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
         end = recv_on->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            col = recv_on->idx2[j];
+            global_col = recv_on_cols[j];
             val = recv_on->vals[j];
-            if (col >= 0)
+            if (global_col >= 0)
             {
-                if (col >= A->partition->global_num_cols)
+                if (global_col >= A->partition->global_num_cols)
                 {
-                    col -= A->partition->global_num_cols;
-                    col = on_proc_partition_to_col[col - A->partition->first_local_row];
+                    global_col -= A->partition->global_num_cols;
+                    col = on_proc_partition_to_col[global_col - A->partition->first_local_row];
                     D_recv_on->idx2.push_back(col);
                     D_recv_on->vals.push_back(val);
                 }
                 else
                 {
-                    col = on_proc_partition_to_col[col - A->partition->first_local_row];
+                    col = on_proc_partition_to_col[global_col - A->partition->first_local_row];
                     S_recv_on->idx2.push_back(col);
                     S_recv_on->vals.push_back(val);
                 }
             }
             else
             {
-                col = (-col)-1;
-                if (col >= A->partition->global_num_cols)
+                global_col = (-global_col)-1;
+                if (global_col >= A->partition->global_num_cols)
                 {
-                    col -= A->partition->global_num_cols;
-                    col = on_proc_partition_to_col[col - A->partition->first_local_row];
+                    global_col -= A->partition->global_num_cols;
+                    col = on_proc_partition_to_col[global_col - A->partition->first_local_row];
                     D_recv_on->idx2.push_back(col);
                     D_recv_on->vals.push_back(val);
                 }
                 else
                 {
-                    col = on_proc_partition_to_col[col - A->partition->first_local_row];
+                    col = on_proc_partition_to_col[global_col - A->partition->first_local_row];
                     A_recv_on->idx2.push_back(col);
                     A_recv_on->vals.push_back(val);
                 }
@@ -377,10 +398,10 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
             end = recv_off->idx1[col_A+1];
             for (int j = start; j < end; j++)
             {
-                global_col = recv_off->idx2[j];
+                global_col = recv_off_cols[j];
                 if (global_col < 0)
                     global_col = - (global_col - 1);
-                std::set<int>::iterator it = global_set.find(global_col);
+                std::set<index_t>::iterator it = global_set.find(global_col);
                 if (it == global_set.end())
                 {
                     global_set.insert(global_col);
@@ -389,7 +410,7 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
             }
         }
     }
-    for (std::set<int>::iterator it = global_set.begin(); it != global_set.end(); ++it)
+    for (std::set<index_t>::iterator it = global_set.begin(); it != global_set.end(); ++it)
     {
         global_to_local[*it] = off_proc_column_map.size();
         off_proc_column_map.push_back(*it);
@@ -406,14 +427,14 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
         end = recv_off->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            global_col = recv_off->idx2[j];
+            global_col = recv_off_cols[j];
             sign = 1.0;
             if (global_col < 0)
             {
                 sign = -1.0;
                 global_col = (-global_col) - 1;
             }
-            std::map<int, int>::iterator it = global_to_local.find(global_col);
+            std::map<index_t, int>::iterator it = global_to_local.find(global_col);
             if (it != global_to_local.end())
             {
                 if (sign > 0)
@@ -453,10 +474,26 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
             on_proc_cols++;
         }
     }
-    MPI_Allreduce(&(on_proc_cols), &global_num_cols, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    index_t local_num_cols = on_proc_cols;
+    MPI_Allreduce(&local_num_cols, &global_num_cols, 1, MPI_INDEX_T, MPI_SUM, 
+            MPI_COMM_WORLD);
+
+    int local_num_rows = A->local_num_rows;
+    index_t global_num_rows = A->global_num_rows;
+    if (rows)
+    {
+        local_num_rows = 0;
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            if ((*rows)[i] == 1) local_num_rows++;
+        }
+        index_t local_rows = local_num_rows;
+        MPI_Allreduce(&local_rows, &global_num_rows, 1, MPI_INDEX_T, MPI_SUM,
+                MPI_COMM_WORLD);
+    }
    
-    ParCSRMatrix* P = new ParCSRMatrix(A->partition, A->global_num_rows, global_num_cols, 
-            A->local_num_rows, on_proc_cols, off_proc_cols);
+    ParCSRMatrix* P = new ParCSRMatrix(A->partition, global_num_rows, global_num_cols, 
+            local_num_rows, on_proc_cols, off_proc_cols);
 
     for (int i = 0; i < S->on_proc_num_cols; i++)
     {
@@ -466,7 +503,17 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
             P->on_proc_column_map.push_back(S->on_proc_column_map[i]);
         }
     }
-    P->local_row_map = S->get_local_row_map();
+    if (rows)
+    {
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            if ((*rows)[i] == 1) P->local_row_map.push_back(S->local_row_map[i]);
+        }
+    }
+    else
+    {
+        P->local_row_map = S->get_local_row_map();
+    }
 
     aligned_vector<int> off_proc_A_to_P;
     if (A->off_proc_num_cols) 
@@ -513,8 +560,11 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
         off_proc_pos.resize(P->off_proc_num_cols, -1);
         off_proc_row_coarse.resize(P->off_proc_num_cols, 0);
     }
+    row = 0;
     for (int i = 0; i < A->local_num_rows; i++)
     {
+        if (rows && (*rows)[i] != 1) continue;
+
         // If coarse row, add to P
         if (states[i] != 0)
         {
@@ -523,8 +573,9 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
                 P->on_proc->idx2.push_back(on_proc_col_to_new[i]);
                 P->on_proc->vals.push_back(1);
             }
-            P->on_proc->idx1[i+1] = P->on_proc->idx2.size();
-            P->off_proc->idx1[i+1] = P->off_proc->idx2.size();
+            P->on_proc->idx1[row+1] = P->on_proc->idx2.size();
+            P->off_proc->idx1[row+1] = P->off_proc->idx2.size();
+            row++;
             continue;
         }
 
@@ -730,7 +781,7 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
                 }
                 if (fabs(coarse_sum) < zero_tol)
                 {
-                    weak_sum += A->on_proc->vals[j];
+                    weak_sum += row_strong[col];
                     row_strong[col] = 0;
                 }
                 else
@@ -814,7 +865,7 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
 
                 if (fabs(coarse_sum) < zero_tol)
                 {
-                    weak_sum += A->off_proc->vals[j];
+                    weak_sum += off_proc_row_strong[col];
                     off_proc_row_strong[col] = 0;
                 }
                 else
@@ -978,8 +1029,9 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
             col = off_proc_S_to_A[S->off_proc->idx2[j]];
             off_proc_row_strong[col] = 0;
         }
-        P->on_proc->idx1[i+1] = P->on_proc->idx2.size();
-        P->off_proc->idx1[i+1] = P->off_proc->idx2.size();
+        P->on_proc->idx1[row+1] = P->on_proc->idx2.size();
+        P->off_proc->idx1[row+1] = P->off_proc->idx2.size();
+        row++;
     }
     P->on_proc->nnz = P->on_proc->idx2.size();
     P->off_proc->nnz = P->off_proc->idx2.size();
@@ -1009,13 +1061,13 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
     P->off_proc->n_cols = P->off_proc_num_cols;
     P->on_proc->n_cols = P->on_proc_num_cols;
 
-    if (S->comm)
+    if (form_comm && S->comm)
     {
         P->comm = new ParComm(P->partition, P->off_proc_column_map,
                 P->on_proc_column_map, 9243, MPI_COMM_WORLD, comm_t);
     }
 
-    if (S->tap_comm)
+    if (form_comm && S->tap_comm)
     {
         P->tap_comm = new TAPComm(P->partition, P->off_proc_column_map,
                 P->on_proc_column_map);
@@ -1030,6 +1082,16 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
     return P;
 }
 
+ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
+        ParCSRMatrix* S, const aligned_vector<int>& states,
+        const aligned_vector<int>& off_proc_states, 
+        bool tap_interp, int num_variables, int* variables, 
+        data_t* comm_t, data_t* comm_mat_t)
+{
+    return extended_interpolation_rows(A, S, states, off_proc_states, NULL,
+            true, tap_interp, num_variables, variables, comm_t, comm_mat_t);
+}
+
 ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
         ParCSRMatrix* S, const aligned_vector<int>& states,
         const aligned_vector<int>& off_proc_states, 
@@ -1041,8 +1103,8 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
     int end_S;
     int col, col_k, col_S;
     int ctr;
-    int global_col;
-    int global_num_cols;
+    index_t global_col;
+    index_t global_num_cols;
     double diag, val;
     double weak_sum, coarse_sum;
     double sign;
@@ -1105,7 +1167,9 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
             off_proc_cols++;
         }
     }
-    MPI_Allreduce(&(on_proc_cols), &global_num_cols, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    index_t local_num_cols = on_proc_cols;
+    MPI_Allreduce(&local_num_cols, &global_num_cols, 1, MPI_INDEX_T, MPI_SUM, 
+            MPI_COMM_WORLD);
    
     ParCSRMatrix* P = new ParCSRMatrix(A->partition, A->global_num_rows, global_num_cols, 
             A->local_num_rows, on_proc_cols, off_proc_cols);
@@ -1147,28 +1211,32 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
 
     // Communicate parallel matrix A (Costly!)
     if (comm_mat_t) *comm_mat_t -= MPI_Wtime();
-    communicate(A, states, off_proc_states_A, comm, &recv_on, &recv_off);
+    aligned_vector<index_t> recv_on_cols, recv_off_cols;
+    communicate(A, states, off_proc_states_A, comm, &recv_on, &recv_off,
+            recv_on_cols, recv_off_cols);
     if (comm_mat_t) *comm_mat_t += MPI_Wtime();
 
     // Change on_proc_cols to local
     recv_on->n_cols = A->on_proc_num_cols;
     int* on_proc_partition_to_col = A->map_partition_to_local();
-    for (aligned_vector<int>::iterator it = recv_on->idx2.begin();
-            it != recv_on->idx2.end(); ++it)
+    recv_on->idx2.resize(recv_on_cols.size());
+    for (int i = 0; i < (int) recv_on_cols.size(); i++)
     {
-        *it = on_proc_partition_to_col[*it - A->partition->first_local_row];
+        recv_on->idx2[i] = on_proc_partition_to_col[recv_on_cols[i] 
+            - A->partition->first_local_row];
     }
     delete[] on_proc_partition_to_col;
 
     // Change off_proc_cols to local (remove cols not on rank)
     ctr = 0;
-    std::map<int, int> global_to_local;
-    for (aligned_vector<int>::iterator it = A->off_proc_column_map.begin();
+    std::map<index_t, int> global_to_local;
+    for (aligned_vector<index_t>::iterator it = A->off_proc_column_map.begin();
             it != A->off_proc_column_map.end(); ++it)
     {
         global_to_local[*it] = ctr++;
     }
     recv_off->n_cols = A->off_proc_num_cols;
+    recv_off->idx2.resize(recv_off_cols.size());
     ctr = 0;
     start = recv_off->idx1[0];
     for (int i = 0; i < recv_off->n_rows; i++)
@@ -1176,8 +1244,8 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
         end = recv_off->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            global_col = recv_off->idx2[j];
-            std::map<int, int>::iterator it = global_to_local.find(global_col);
+            global_col = recv_off_cols[j];
+            std::map<index_t, int>::iterator it = global_to_local.find(global_col);
             if (it != global_to_local.end())
             {
                 recv_off->idx2[ctr] = it->second;
@@ -1561,13 +1629,205 @@ ParCSRMatrix* mod_classical_interpolation(ParCSRMatrix* A,
     return P;
 }
 
+// Keeps the max_elmts largest (in magnitude) entries of each row of P, 
+// scaling the kept entries so that each row sum is unchanged
+static void truncate_interpolation(ParCSRMatrix* P, int max_elmts)
+{
+    int on_start, on_end, off_start, off_end;
+    int on_ptr, off_ptr, n_kept;
+    double cutoff, row_sum, kept_sum, scale;
+    aligned_vector<double> row_abs;
+
+    on_ptr = 0;
+    off_ptr = 0;
+    on_start = 0;
+    off_start = 0;
+    for (int i = 0; i < P->local_num_rows; i++)
+    {
+        on_end = P->on_proc->idx1[i+1];
+        off_end = P->off_proc->idx1[i+1];
+
+        // Smallest magnitude kept in row i
+        cutoff = 0.0;
+        scale = 1.0;
+        if ((on_end - on_start) + (off_end - off_start) > max_elmts)
+        {
+            row_abs.clear();
+            row_sum = 0.0;
+            for (int j = on_start; j < on_end; j++)
+            {
+                row_abs.push_back(fabs(P->on_proc->vals[j]));
+                row_sum += P->on_proc->vals[j];
+            }
+            for (int j = off_start; j < off_end; j++)
+            {
+                row_abs.push_back(fabs(P->off_proc->vals[j]));
+                row_sum += P->off_proc->vals[j];
+            }
+            std::nth_element(row_abs.begin(), row_abs.begin() + (max_elmts - 1),
+                    row_abs.end(), std::greater<double>());
+            cutoff = row_abs[max_elmts - 1];
+
+            kept_sum = 0.0;
+            n_kept = 0;
+            for (int j = on_start; j < on_end; j++)
+            {
+                if (fabs(P->on_proc->vals[j]) >= cutoff && n_kept < max_elmts)
+                {
+                    kept_sum += P->on_proc->vals[j];
+                    n_kept++;
+                }
+            }
+            for (int j = off_start; j < off_end; j++)
+            {
+                if (fabs(P->off_proc->vals[j]) >= cutoff && n_kept < max_elmts)
+                {
+                    kept_sum += P->off_proc->vals[j];
+                    n_kept++;
+                }
+            }
+            if (fabs(kept_sum) > zero_tol)
+            {
+                scale = row_sum / kept_sum;
+            }
+        }
+
+        // Compact kept entries (in their original order)
+        n_kept = 0;
+        for (int j = on_start; j < on_end; j++)
+        {
+            if (fabs(P->on_proc->vals[j]) >= cutoff && n_kept < max_elmts)
+            {
+                P->on_proc->idx2[on_ptr] = P->on_proc->idx2[j];
+                P->on_proc->vals[on_ptr++] = P->on_proc->vals[j] * scale;
+                n_kept++;
+            }
+        }
+        for (int j = off_start; j < off_end; j++)
+        {
+            if (fabs(P->off_proc->vals[j]) >= cutoff && n_kept < max_elmts)
+            {
+                P->off_proc->idx2[off_ptr] = P->off_proc->idx2[j];
+                P->off_proc->vals[off_ptr++] = P->off_proc->vals[j] * scale;
+                n_kept++;
+            }
+        }
+        P->on_proc->idx1[i+1] = on_ptr;
+        P->off_proc->idx1[i+1] = off_ptr;
+        on_start = on_end;
+        off_start = off_end;
+    }
+    P->on_proc->nnz = on_ptr;
+    P->off_proc->nnz = off_ptr;
+    P->on_proc->idx2.resize(on_ptr);
+    P->on_proc->vals.resize(on_ptr);
+    P->off_proc->idx2.resize(off_ptr);
+    P->off_proc->vals.resize(off_ptr);
+    P->local_nnz = on_ptr + off_ptr;
+
+    // Remove off_proc columns no longer referenced by P
+    if (P->off_proc_num_cols)
+    {
+        aligned_vector<int> col_to_new(P->off_proc_num_cols, -1);
+        aligned_vector<index_t> off_proc_column_map;
+        for (aligned_vector<int>::iterator it = P->off_proc->idx2.begin();
+                it != P->off_proc->idx2.end(); ++it)
+        {
+            col_to_new[*it] = 0;
+        }
+        for (int i = 0; i < P->off_proc_num_cols; i++)
+        {
+            if (col_to_new[i] == 0)
+            {
+                col_to_new[i] = off_proc_column_map.size();
+                off_proc_column_map.push_back(P->off_proc_column_map[i]);
+            }
+        }
+        for (aligned_vector<int>::iterator it = P->off_proc->idx2.begin();
+                it != P->off_proc->idx2.end(); ++it)
+        {
+            *it = col_to_new[*it];
+        }
+        P->off_proc_column_map.swap(off_proc_column_map);
+        P->off_proc_num_cols = P->off_proc_column_map.size();
+        P->off_proc->n_cols = P->off_proc_num_cols;
+    }
+}
+
+// Two-stage extended+i interpolation, for states formed by split_aggressive.
+// P1 interpolates from all C-points of the first pass (states 1 and -2),
+// P2 interpolates these from the final C-points (extended+i through the
+// fine points of A), and P = P1*P2 reaches coarse points up to four
+// strong connections away.  If max_elmts > 0, rows of P are truncated 
+// to their max_elmts largest entries.
+ParCSRMatrix* two_stage_interpolation(ParCSRMatrix* A,
+        ParCSRMatrix* S, const aligned_vector<int>& states,
+        const aligned_vector<int>& off_proc_states,
+        int max_elmts, bool tap_interp, int num_variables, int* variables,
+        data_t* comm_t, data_t* comm_mat_t)
+{
+    // -2 is coarse in the first stage, fine in the second
+    aligned_vector<int> states_C1(states);
+    aligned_vector<int> states_C2(states);
+    aligned_vector<int> off_proc_states_C1(off_proc_states);
+    aligned_vector<int> off_proc_states_C2(off_proc_states);
+    for (int i = 0; i < (int) states.size(); i++)
+    {
+        if (states[i] == -2)
+        {
+            states_C1[i] = 1;
+            states_C2[i] = 0;
+        }
+    }
+    for (int i = 0; i < (int) off_proc_states.size(); i++)
+    {
+        if (off_proc_states[i] == -2)
+        {
+            off_proc_states_C1[i] = 1;
+            off_proc_states_C2[i] = 0;
+        }
+    }
+
+    ParCSRMatrix* P1 = extended_interpolation(A, S, states_C1,
+            off_proc_states_C1, tap_interp, num_variables, variables,
+            comm_t, comm_mat_t);
+
+    // P2 : second stage rows at first stage C-points only, in the order 
+    // of the on_proc columns of P1 (no communication package needed)
+    ParCSRMatrix* P2 = extended_interpolation_rows(A, S, states_C2,
+            off_proc_states_C2, &states_C1, false, tap_interp, num_variables,
+            variables, comm_t, comm_mat_t);
+
+    ParCSRMatrix* P = P1->mult(P2, tap_interp, comm_mat_t);
+    if (max_elmts > 0)
+    {
+        truncate_interpolation(P, max_elmts);
+    }
+
+    if (S->comm)
+    {
+        P->comm = new ParComm(P->partition, P->off_proc_column_map,
+                P->on_proc_column_map, P1->comm->key, P1->comm->mpi_comm, comm_t);
+    }
+    if (S->tap_comm)
+    {
+        P->tap_comm = new TAPComm(P->partition, P->off_proc_column_map,
+                P->on_proc_column_map, true, MPI_COMM_WORLD, comm_t);
+    }
+
+    delete P1;
+    delete P2;
+
+    return P;
+}
+
 
 ParCSRMatrix* direct_interpolation(ParCSRMatrix* A,
         ParCSRMatrix* S, const aligned_vector<int>& states,
         const aligned_vector<int>& off_proc_states, data_t* comm_t)
 {
     int start, end, col;
-    int global_num_cols;
+    index_t global_num_cols;
     int ctr;
     double sum_strong_pos, sum_strong_neg;
     double sum_all_pos, sum_all_neg;
@@ -1646,7 +1906,9 @@ ParCSRMatrix* direct_interpolation(ParCSRMatrix* A,
             off_proc_cols++;
         }
     }
-    MPI_Allreduce(&(on_proc_cols), &global_num_cols, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    index_t local_num_cols = on_proc_cols;
+    MPI_Allreduce(&local_num_cols, &global_num_cols, 1, MPI_INDEX_T, MPI_SUM, 
+            MPI_COMM_WORLD);
    
     ParCSRMatrix* P = new ParCSRMatrix(S->partition, S->global_num_rows, global_num_cols, 
             S->local_num_rows, on_proc_cols, off_proc_cols);
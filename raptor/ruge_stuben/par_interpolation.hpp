@@ -25,5 +25,11 @@ ParCSRMatrix* extended_interpolation(ParCSRMatrix* A,
         bool tap_amg = false, int num_variables = 1, int* variables = NULL,
         data_t* comm_t = NULL, data_t* comm_mat_t = NULL);
 
+ParCSRMatrix* two_stage_interpolation(ParCSRMatrix* A,
+        ParCSRMatrix* S, const aligned_vector<int>& states,
+        const aligned_vector<int>& off_proc_states, int max_elmts = 0,
+        bool tap_amg = false, int num_variables = 1, int* variables = NULL,
+        data_t* comm_t = NULL, data_t* comm_mat_t = NULL);
+
 #endif
 
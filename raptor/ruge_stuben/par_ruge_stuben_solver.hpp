@@ -21,11 +21,14 @@ namespace raptor
             interp_type = _interp_type;
             variables = NULL;
             num_variables = 1;
+            num_aggressive_levels = 0;
+            aggressive_strong_threshold = 0.5;
+            aggressive_max_elmts = 8;
         }
 
         ~ParRugeStubenSolver()
         {
-
+            clear_strength();
         }
 
         void setup(ParCSRMatrix *Af)
@@ -43,6 +46,10 @@ namespace raptor
                 form_variable_list(Af, num_variables);
             }
 
+            level_states.clear();
+            level_variables.clear();
+            clear_strength();
+
             setup_helper(Af);
 
             delete[] variables;
@@ -64,7 +71,7 @@ namespace raptor
        void extend_hierarchy()
         {
             int level_ctr = levels.size() - 1;
-            bool tap_level = tap_amg >= 0 && tap_amg <= level_ctr;
+            bool tap_level = use_tap(level_ctr);
 
             double* total_time = NULL;
             double* strength_time = NULL;
@@ -100,7 +107,6 @@ namespace raptor
             ParCSRMatrix* A = levels[level_ctr]->A;
             ParCSRMatrix* S;
             ParCSRMatrix* P;
-            ParCSRMatrix* AP;
 
             aligned_vector<int> states;
             aligned_vector<int> off_proc_states;
@@ -112,8 +118,14 @@ namespace raptor
             if (setup_times) setup_times[1][level_ctr] += MPI_Wtime();
 
             // Form CF Splitting
+            bool aggressive = level_ctr < num_aggressive_levels;
             if (setup_times) setup_times[2][level_ctr] -= MPI_Wtime();
-            switch (coarsen_type)
+            if (aggressive)
+            {
+                split_aggressive(S, states, off_proc_states, coarsen_type == HMIS,
+                        aggressive_strong_threshold, tap_level, weights, coarsen_time);
+            }
+            else switch (coarsen_type)
             {
                 case RS:
                     if (level_ctr < 3) 
@@ -145,9 +157,24 @@ namespace raptor
             }
             if (setup_times) setup_times[2][level_ctr] += MPI_Wtime();
 
+            // Keep splitting (and variables) for resetup
+            level_states.push_back(states);
+            level_variables.push_back(aligned_vector<int>());
+            if (num_variables > 1 && variables)
+            {
+                level_variables[level_ctr].assign(variables, 
+                        variables + A->local_num_rows);
+            }
+
             // Form modified classical interpolation
             if (setup_times) setup_times[3][level_ctr] -= MPI_Wtime();
-            switch (interp_type)
+            if (aggressive)
+            {
+                P = two_stage_interpolation(A, S, states, off_proc_states,
+                        aggressive_max_elmts, tap_level, num_variables, variables,
+                        interp_time, interp_mat_time);
+            }
+            else switch (interp_type)
             {
                 case Direct:
                     P = direct_interpolation(A, S, states, off_proc_states, 
@@ -179,22 +206,44 @@ namespace raptor
                 }
             }
 
+            // Redistribute coarse level onto fewer processes if needed
+            int n_coarse = P->on_proc_num_cols;
+            P = agglomerate(P, level_ctr);
+
             // Form coarse grid operator
             levels.push_back(new ParLevel());
 
-            if (setup_times) setup_times[4][level_ctr] -= MPI_Wtime();
-            AP = A->mult(levels[level_ctr]->P, tap_level, AP_mat_time);
-            if (setup_times) setup_times[4][level_ctr] += MPI_Wtime();
-
+            // Galerkin product P^T*A*P, without forming A*P
             if (setup_times) setup_times[5][level_ctr] -= MPI_Wtime();
-            A = AP->mult_T(P, tap_level, PTAP_mat_time);
+            A = galerkin_product(level_ctr, P, PTAP_mat_time);
+            A = agglomerate_coarse(A, level_ctr);
+            P = levels[level_ctr]->P;
             if (setup_times) setup_times[5][level_ctr] += MPI_Wtime();
 
+            if (levels[level_ctr]->agg_parts && num_variables > 1)
+            {
+                aligned_vector<double> vars(n_coarse);
+                aligned_vector<double> agg_vars;
+                for (int i = 0; i < n_coarse; i++)
+                {
+                    vars[i] = variables[i];
+                }
+                repartition_vector(vars, agg_vars, n_coarse, 
+                        A->local_num_rows);
+                delete[] variables;
+                variables = new int[A->local_num_rows];
+                for (int i = 0; i < A->local_num_rows; i++)
+                {
+                    variables[i] = agg_vars[i];
+                }
+            }
+
             level_ctr++;
+            form_level_comm(level_ctr);
             levels[level_ctr]->A = A;
             A->comm = new ParComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map, P->comm->key, P->comm->mpi_comm,
-                    total_time);
+                    A->on_proc_column_map, P->comm->key, 
+                    levels[level_ctr]->mpi_comm, total_time);
             levels[level_ctr]->x.resize(A->global_num_rows, A->local_num_rows,
                     A->partition->first_local_row);
             levels[level_ctr]->b.resize(A->global_num_rows, A->local_num_rows,
@@ -203,7 +252,7 @@ namespace raptor
                     A->partition->first_local_row);
             levels[level_ctr]->P = NULL;
 
-            if (tap_amg >= 0 && tap_amg <= level_ctr)
+            if (use_tap(level_ctr))
             {
                 levels[level_ctr]->A->tap_comm = new TAPComm(
                         levels[level_ctr]->A->partition,
@@ -212,8 +261,14 @@ namespace raptor
                         true, MPI_COMM_WORLD, total_time);
             }
 
-            delete AP;
-            delete S;
+            // Keep strength of connection (without its communication 
+            // packages) for resetup
+            delete S->comm;
+            delete S->tap_comm;
+            S->comm = NULL;
+            S->tap_comm = NULL;
+            level_strength.push_back(S);
+            level_off_states.push_back(off_proc_states);
 
             if (setup_times) 
             {
@@ -225,6 +280,58 @@ namespace raptor
             }
         }    
 
+        // Interpolation from the strength of connection and splitting of
+        // setup().  S has no communication packages, so P is formed 
+        // without them.
+        ParCSRMatrix* reform_interpolation(int level)
+        {
+            ParCSRMatrix* A = levels[level]->A;
+            ParCSRMatrix* S = level_strength[level];
+            ParCSRMatrix* P = NULL;
+            bool tap_level = use_tap(level);
+            int* vars = NULL;
+            if (level_variables[level].size())
+            {
+                vars = level_variables[level].data();
+            }
+
+            aligned_vector<int>& states = level_states[level];
+            aligned_vector<int>& off_proc_states = level_off_states[level];
+
+            if (level < num_aggressive_levels)
+            {
+                P = two_stage_interpolation(A, S, states, off_proc_states,
+                        aggressive_max_elmts, tap_level, num_variables, vars);
+            }
+            else switch (interp_type)
+            {
+                case Direct:
+                    P = direct_interpolation(A, S, states, off_proc_states);
+                    break;
+                case ModClassical:
+                    P = mod_classical_interpolation(A, S, states, off_proc_states, 
+                            tap_level, num_variables, vars);
+                    break;
+                case Extended:
+                    P = extended_interpolation(A, S, states, off_proc_states,
+                            tap_level, num_variables, vars);
+                    break;
+            }
+
+            return P;
+        }
+
+        void clear_strength()
+        {
+            for (std::vector<ParCSRMatrix*>::iterator it = level_strength.begin();
+                    it != level_strength.end(); ++it)
+            {
+                delete *it;
+            }
+            level_strength.clear();
+            level_off_states.clear();
+        }
+
         void print_setup_times()
         {
             if (setup_times == NULL) return;
@@ -317,6 +424,27 @@ namespace raptor
 
         int* variables;
 
+        // Levels coarsened aggressively (two passes of PMIS, or HMIS if
+        // coarsen_type is HMIS), with two-stage extended+i interpolation.
+        // These trade iterations for operator complexity : on 3D
+        // Laplacians, about twice as many V-cycles with PMIS and fewer
+        // with HMIS, and less as a preconditioner (PCG).  HMIS is much
+        // more robust for anisotropic problems.
+        int num_aggressive_levels;
+
+        // Relative threshold on the number of length-two strong paths
+        // for the second pass, and maximum nonzeros per row of the 
+        // two-stage P (0 for no truncation)
+        double aggressive_strong_threshold;
+        int aggressive_max_elmts;
+
+        // Strength of connection, CF splitting (with off_proc states), 
+        // and variables of each level, reused by resetup()
+        std::vector<ParCSRMatrix*> level_strength;
+        std::vector<aligned_vector<int> > level_states;
+        std::vector<aligned_vector<int> > level_off_states;
+        std::vector<aligned_vector<int> > level_variables;
+
     };
 }
    
@@ -59,7 +59,6 @@ namespace raptor
             CSRMatrix* A = levels[level_ctr]->A;
             CSRMatrix* S;
             CSRMatrix* P;
-            CSRMatrix* AP;
             CSCMatrix* P_csc;
             aligned_vector<int> states;
 
@@ -116,9 +115,9 @@ namespace raptor
 
             // Form coarse-grid operator
             levels.push_back(new Level());
-            AP = A->mult(P);
             P_csc = P->to_CSC();
-            A = AP->mult_T(P_csc);
+            A = new CSRMatrix(P->n_cols, P->n_cols);
+            levels[level_ctr]->A->RAP(*P_csc, A);
 
             level_ctr++;
             levels[level_ctr]->A = A;
@@ -127,7 +126,6 @@ namespace raptor
             levels[level_ctr]->tmp.resize(A->n_rows);
             levels[level_ctr]->P = NULL;
 
-            delete AP;
             delete P_csc;
             delete S;
         }
@@ -0,0 +1,173 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+
+
+#include "gtest/gtest.h"
+#include "mpi.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/diffusion.hpp"
+#include "gallery/par_stencil.hpp"
+#include "ruge_stuben/par_cf_splitting.hpp"
+#include <map>
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// Gathers the global (row, col) pattern of the local rows of A on
+// every process
+void gather_pattern(ParCSRMatrix* A, aligned_vector<index_t>& global_rows,
+        aligned_vector<index_t>& global_cols)
+{
+    int num_procs;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    aligned_vector<index_t> rows, cols;
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        for (int j = A->on_proc->idx1[i]; j < A->on_proc->idx1[i+1]; j++)
+        {
+            rows.push_back(A->local_row_map[i]);
+            cols.push_back(A->on_proc_column_map[A->on_proc->idx2[j]]);
+        }
+        for (int j = A->off_proc->idx1[i]; j < A->off_proc->idx1[i+1]; j++)
+        {
+            rows.push_back(A->local_row_map[i]);
+            cols.push_back(A->off_proc_column_map[A->off_proc->idx2[j]]);
+        }
+    }
+
+    int size = rows.size();
+    aligned_vector<int> sizes(num_procs);
+    aligned_vector<int> displs(num_procs + 1);
+    MPI_Allgather(&size, 1, MPI_INT, sizes.data(), 1, MPI_INT, MPI_COMM_WORLD);
+    displs[0] = 0;
+    for (int i = 0; i < num_procs; i++)
+    {
+        displs[i+1] = displs[i] + sizes[i];
+    }
+    global_rows.resize(displs[num_procs]);
+    global_cols.resize(displs[num_procs]);
+    MPI_Allgatherv(rows.data(), size, MPI_INDEX_T, global_rows.data(),
+            sizes.data(), displs.data(), MPI_INDEX_T, MPI_COMM_WORLD);
+    MPI_Allgatherv(cols.data(), size, MPI_INDEX_T, global_cols.data(),
+            sizes.data(), displs.data(), MPI_INDEX_T, MPI_COMM_WORLD);
+}
+
+TEST(TestParDistanceTwo, TestsInRuge_Stuben)
+{
+    int grid[2] = {25, 25};
+    double* stencil = diffusion_stencil_2d(0.001, M_PI/8.0);
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 2);
+    delete[] stencil;
+    ParCSRMatrix* S = A->strength(Classical, 0.25);
+
+    // C-points independent of the partition
+    aligned_vector<int> states(S->local_num_rows);
+    for (int i = 0; i < S->local_num_rows; i++)
+    {
+        index_t row = S->local_row_map[i];
+        states[i] = (row % 3 == 0 || row % 7 == 0) ? 1 : 0;
+    }
+
+    // Serial reference : paths of length two in the gathered pattern of S,
+    // between C-points (labeled by their fine global rows, as in S2)
+    aligned_vector<index_t> S_rows, S_cols;
+    gather_pattern(S, S_rows, S_cols);
+    std::map<index_t, aligned_vector<index_t> > S_adj;
+    for (int i = 0; i < (int) S_rows.size(); i++)
+    {
+        S_adj[S_rows[i]].push_back(S_cols[i]);
+    }
+    index_t n_coarse = 0;
+    std::map<index_t, std::map<index_t, double> > S2_ref;
+    for (index_t row = 0; row < A->global_num_rows; row++)
+    {
+        if (row % 3 && row % 7) continue;
+        n_coarse++;
+
+        std::map<index_t, double>& row_ref = S2_ref[row];
+        aligned_vector<index_t>& adj = S_adj[row];
+        for (int j = 0; j < (int) adj.size(); j++)
+        {
+            aligned_vector<index_t>& adj_k = S_adj[adj[j]];
+            for (int k = 0; k < (int) adj_k.size(); k++)
+            {
+                if (adj_k[k] % 3 == 0 || adj_k[k] % 7 == 0)
+                    row_ref[adj_k[k]] += 1.0;
+            }
+        }
+    }
+
+    double thetas[3] = {0.0, 0.5, 0.9};
+    for (int t = 0; t < 3; t++)
+    {
+        double theta = thetas[t];
+        ParCSRMatrix* S2 = distance_two_strength(S, states, theta);
+
+        aligned_vector<index_t> S2_rows, S2_cols;
+        gather_pattern(S2, S2_rows, S2_cols);
+
+        // Reference entries kept by the threshold
+        int n_ref = 0;
+        std::map<index_t, std::map<index_t, double> > kept;
+        for (std::map<index_t, std::map<index_t, double> >::iterator it =
+                S2_ref.begin(); it != S2_ref.end(); ++it)
+        {
+            double row_max = 0.0;
+            for (std::map<index_t, double>::iterator jt = it->second.begin();
+                    jt != it->second.end(); ++jt)
+            {
+                if (jt->first != it->first && jt->second > row_max)
+                    row_max = jt->second;
+            }
+            for (std::map<index_t, double>::iterator jt = it->second.begin();
+                    jt != it->second.end(); ++jt)
+            {
+                if (jt->first == it->first || jt->second >= theta * row_max)
+                {
+                    kept[it->first][jt->first] = jt->second;
+                    n_ref++;
+                }
+            }
+        }
+
+        ASSERT_EQ(S2->global_num_rows, n_coarse);
+        ASSERT_EQ((int) S2_rows.size(), n_ref);
+        for (int i = 0; i < (int) S2_rows.size(); i++)
+        {
+            ASSERT_TRUE(kept[S2_rows[i]].count(S2_cols[i]));
+        }
+
+        // Values of the local rows match the reference counts
+        for (int i = 0; i < S2->local_num_rows; i++)
+        {
+            std::map<index_t, double>& row = kept[S2->local_row_map[i]];
+            for (int j = S2->on_proc->idx1[i]; j < S2->on_proc->idx1[i+1]; j++)
+            {
+                ASSERT_NEAR(S2->on_proc->vals[j],
+                        row[S2->on_proc_column_map[S2->on_proc->idx2[j]]], 1e-10);
+            }
+            for (int j = S2->off_proc->idx1[i]; j < S2->off_proc->idx1[i+1]; j++)
+            {
+                ASSERT_NEAR(S2->off_proc->vals[j],
+                        row[S2->off_proc_column_map[S2->off_proc->idx2[j]]], 1e-10);
+            }
+        }
+
+        delete S2;
+    }
+
+    delete S;
+    delete A;
+
+} // end of TEST(TestParDistanceTwo, TestsInRuge_Stuben) //
+
@@ -45,6 +45,9 @@ TEST(TestParRAP, TestsInRuge_Stuben)
     Ac = AP->mult_T(P_csc);
     Ac_rap = readParMatrix(A1_fn);
     compare(Ac, Ac_rap);
+    delete Ac;
+    Ac = A->RAP(P);
+    compare(Ac, Ac_rap);
     delete Ac_rap;
     delete Ac;
     delete P_csc;
@@ -60,6 +63,9 @@ TEST(TestParRAP, TestsInRuge_Stuben)
     Ac = AP->mult_T(P_csc);
     Ac_rap = readParMatrix(A2_fn);
     compare(Ac, Ac_rap);
+    delete Ac;
+    Ac = A->RAP(P);
+    compare(Ac, Ac_rap);
     delete Ac_rap;
     delete Ac;
     delete P_csc;
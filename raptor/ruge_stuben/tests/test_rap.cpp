@@ -40,6 +40,10 @@ TEST(TestRAP, TestsInRuge_Stuben)
     Ac = AP->mult_T(P_csc);
     Ac_rap = readMatrix(A1_fn);
     compare(Ac, Ac_rap);
+    delete Ac;
+    Ac = new CSRMatrix(P->n_cols, P->n_cols);
+    A->RAP(*P_csc, Ac);
+    compare(Ac, Ac_rap);
     delete Ac_rap;
     delete Ac;
     delete P_csc;
@@ -55,6 +59,10 @@ TEST(TestRAP, TestsInRuge_Stuben)
     Ac = AP->mult_T(P_csc);
     Ac_rap = readMatrix(A2_fn);
     compare(Ac, Ac_rap);
+    delete Ac;
+    Ac = new CSRMatrix(P->n_cols, P->n_cols);
+    A->RAP(*P_csc, Ac);
+    compare(Ac, Ac_rap);
     delete Ac_rap;
     delete Ac;
     delete P_csc;
@@ -60,6 +60,9 @@ TEST(TestTAPRAP, TestsInRuge_Stuben)
     Ac = AP->tap_mult_T(P_csc);
     Ac_rap = readParMatrix(A1_fn);
     compare(Ac, Ac_rap);
+    delete Ac;
+    Ac = A->RAP(P, true);
+    compare(Ac, Ac_rap);
     delete Ac_rap;
     delete Ac;
     delete AP;
@@ -89,6 +92,9 @@ TEST(TestTAPRAP, TestsInRuge_Stuben)
     Ac = AP->tap_mult_T(P_csc);
     Ac_rap = readParMatrix(A2_fn);
     compare(Ac, Ac_rap);
+    delete Ac;
+    Ac = A->RAP(P, true);
+    compare(Ac, Ac_rap);
     delete Ac_rap;
     delete Ac;
     delete AP;
@@ -1,56 +1,14 @@
 #include "core/matrix.hpp"
+#include "util/linalg/spgemm.hpp"
 
 using namespace raptor;
 
 CSRMatrix* CSRMatrix::spgemm(const CSRMatrix* B)
 {
-    aligned_vector<int> next(n_cols, -1);
-    aligned_vector<double> sums(n_cols, 0);
-
     CSRMatrix* C = new CSRMatrix(n_rows, B->n_cols);
-    C->idx2.reserve(1.5*nnz);
-    C->vals.reserve(1.5*nnz);
-
-    C->idx1[0] = 0;
-    for (int i = 0; i < n_rows; i++)
-    {
-        int head = -2;
-        int length = 0;
-        int row_start_A = idx1[i];
-        int row_end_A = idx1[i+1];
-        for (int j = row_start_A; j < row_end_A; j++)
-        {
-            int col_A = idx2[j];
-            double val_A = vals[j];
-            int row_start_B = B->idx1[col_A];
-            int row_end_B = B->idx1[col_A+1];
-            for (int k = row_start_B; k < row_end_B; k++)
-            {
-                int col_B = B->idx2[k];
-                sums[col_B]+= val_A*B->vals[k];
-                if (next[col_B] == -1)
-                {
-                    next[col_B] = head;
-                    head = col_B;
-                    length++;
-                }
-            }
-        }
-        for (int j = 0; j < length; j++)
-        {
-            if (fabs(sums[head]) > zero_tol)
-            {
-                C->idx2.push_back(head);
-                C->vals.push_back(sums[head]);
-            }
-            int tmp = head;
-            head = next[head];
-            next[tmp] = -1;
-            sums[tmp] = 0;
-        }
-        C->idx1[i+1] = C->idx2.size();
-    }
-    C->nnz = C->idx2.size();
+
+    aligned_vector<SpGEMMTerm> terms(1, SpGEMMTerm(this, B));
+    spgemm_rows(n_rows, B->n_cols, terms, C);
 
     return C;
 }
@@ -58,53 +16,69 @@ CSRMatrix* CSRMatrix::spgemm(const CSRMatrix* B)
 CSRMatrix* CSRMatrix::spgemm_T(const CSCMatrix* A)
 {
     CSRMatrix* C = new CSRMatrix(A->n_cols, n_cols);
-    C->idx2.reserve(1.5*nnz);
-    C->vals.reserve(1.5*nnz);
-
-    aligned_vector<int> next(A->n_rows, -1); 
-    aligned_vector<double> sums(A->n_rows, 0);
-
-    C->idx1[0] = 0;
-    for (int i = 0; i < A->n_cols; i++)
-    {
-        int head = -2;
-        int length = 0;
-        int row_start_AT = A->idx1[i];
-        int row_end_AT = A->idx1[i+1];
-        for (int j = row_start_AT; j < row_end_AT; j++)
-        {
-            int col_AT = A->idx2[j];
-            double val_AT = A->vals[j];
-            int row_start = idx1[col_AT];
-            int row_end = idx1[col_AT+1];
-            for (int k = row_start; k < row_end; k++)
-            {
-                int col = idx2[k];
-                sums[col]+= val_AT*vals[k];
-                if (next[col] == -1)
-                {
-                    next[col] = head;
-                    head = col;
-                    length++;
-                }
-            }
-        }
-        for (int j = 0; j < length; j++)
-        {
-            if (fabs(sums[head]) > zero_tol)
-            {
-                C->idx2.push_back(head);
-                C->vals.push_back(sums[head]);
-            }
-            int tmp = head;
-            head = next[head];
-            next[tmp] = -1;
-            sums[tmp] = 0;
-        }
-        C->idx1[i+1] = C->idx2.size();
-    }
-    C->nnz = C->idx2.size();
 
+    aligned_vector<SpGEMMTerm> terms(1, SpGEMMTerm(A, this));
+    spgemm_rows(A->n_cols, n_cols, terms, C);
+
+    return C;
+}
+
+CSRMatrix* BSRMatrix::spgemm(const CSRMatrix* B)
+{
+    CSRMatrix* A = to_CSR();
+    CSRMatrix* C = A->spgemm(B);
+    delete A;
     return C;
 }
 
+CSRMatrix* BSRMatrix::spgemm_T(const CSCMatrix* A)
+{
+    CSRMatrix* B = to_CSR();
+    CSRMatrix* C = B->spgemm_T(A);
+    delete B;
+    return C;
+}
+
+BSRMatrix* BSRMatrix::spgemm(const BSRMatrix* B)
+{
+    // Space for blocks is reserved by bsr_spgemm_rows
+    BSRMatrix* C = new BSRMatrix(n_rows, B->n_cols, b_rows, B->b_cols, 1);
+
+    aligned_vector<BSRSpGEMMTerm> terms(1, BSRSpGEMMTerm(this, B));
+    bsr_spgemm_rows(n_rows / b_rows, B->n_cols / B->b_cols, terms, C);
+
+    return C;
+}
+
+BSRMatrix* BSRMatrix::spgemm_T(const BSRMatrix* A)
+{
+    BSRMatrix* AT = (BSRMatrix*) ((BSRMatrix*) A)->transpose();
+    BSRMatrix* C = AT->spgemm(this);
+    delete AT;
+    return C;
+}
+
+void Matrix::RAP(const CSCMatrix& P, CSRMatrix* Ac)
+{
+    // Rows of A and P, as CSR
+    CSRMatrix* A = to_CSR();
+    CSRMatrix P_csr(P.n_rows, P.n_cols);
+    P_csr.copy_helper(&P);
+
+    Ac->n_rows = P.n_cols;
+    Ac->n_cols = P.n_cols;
+
+    // Ac = P^T * (A*P), formed a block of rows at a time so that 
+    // A*P is never stored in full
+    aligned_vector<SpGEMMTerm> terms(1, SpGEMMTerm(A, &P_csr));
+    rap_rows(&P, A->n_rows, terms, P.n_cols, Ac);
+
+    if (A != this) delete A;
+}
+
+void Matrix::RAP(const CSCMatrix& P, CSCMatrix* Ac)
+{
+    CSRMatrix Ac_csr(P.n_cols, P.n_cols);
+    RAP(P, &Ac_csr);
+    Ac->copy_helper(&Ac_csr);
+}
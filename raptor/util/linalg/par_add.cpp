@@ -2,6 +2,7 @@
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 #include "assert.h"
 #include "core/par_matrix.hpp"
+#include "util/linalg/spgemm.hpp"
 
 using namespace raptor;
 
@@ -28,8 +29,8 @@ ParCSRMatrix* ParCSRMatrix::add(ParCSRMatrix* B)
 
     int ctr = 0;
     int ctr_B = 0;
-    int global_col = 0;
-    int global_col_B = 0;
+    index_t global_col = 0;
+    index_t global_col_B = 0;
     while (ctr < off_proc_num_cols || ctr_B < B->off_proc_num_cols)
     {
         if (ctr < off_proc_num_cols) global_col = off_proc_column_map[ctr];
@@ -158,8 +159,8 @@ ParCSRMatrix* ParCSRMatrix::subtract(ParCSRMatrix* B)
 
     int ctr = 0;
     int ctr_B = 0;
-    int global_col = 0;
-    int global_col_B = 0;
+    index_t global_col = 0;
+    index_t global_col_B = 0;
     while (ctr < off_proc_num_cols || ctr_B < B->off_proc_num_cols)
     {
         if (ctr < off_proc_num_cols) global_col = off_proc_column_map[ctr];
@@ -271,3 +272,123 @@ ParCSRMatrix* ParCSRMatrix::subtract(ParCSRMatrix* B)
 
     return C;
 }
+
+// C = A + alpha*B, with blocks summed through the block accumulator
+static ParBSRMatrix* add_helper(ParBSRMatrix* A, ParBSRMatrix* B, double alpha)
+{
+    ParBSRMatrix* C = new ParBSRMatrix(A->partition, A->b_rows, A->b_cols);
+    int b_cols = A->b_cols;
+    int n_block_rows = A->local_num_rows / A->b_rows;
+    int n_off = A->off_proc_column_map.size() / b_cols;
+    int n_off_B = B->off_proc_column_map.size() / b_cols;
+
+    C->global_num_rows = A->global_num_rows;
+    C->global_num_cols = A->global_num_cols;
+    C->local_num_rows = A->local_num_rows;
+    C->on_proc_num_cols = A->on_proc_num_cols;
+    C->on_proc_column_map = A->get_on_proc_column_map();
+    C->local_row_map = A->get_local_row_map();
+
+    // Merge (sorted) off_proc block columns of A and B
+    aligned_vector<int> off_proc_to_new;
+    aligned_vector<int> B_off_proc_to_new;
+    if (n_off) off_proc_to_new.resize(n_off, 0);
+    if (n_off_B) B_off_proc_to_new.resize(n_off_B, 0);
+
+    int ctr = 0;
+    int ctr_B = 0;
+    int n_blocks = 0;
+    index_t global_col, global_col_B;
+    while (ctr < n_off || ctr_B < n_off_B)
+    {
+        if (ctr < n_off) global_col = A->off_proc_column_map[ctr * b_cols];
+        else global_col = A->partition->global_num_cols;
+
+        if (ctr_B < n_off_B) global_col_B = B->off_proc_column_map[ctr_B * b_cols];
+        else global_col_B = B->partition->global_num_cols;
+
+        if (global_col_B < global_col)
+        {
+            global_col = global_col_B;
+        }
+        if (ctr < n_off && A->off_proc_column_map[ctr * b_cols] == global_col)
+        {
+            off_proc_to_new[ctr++] = n_blocks;
+        }
+        if (ctr_B < n_off_B && B->off_proc_column_map[ctr_B * b_cols] == global_col)
+        {
+            B_off_proc_to_new[ctr_B++] = n_blocks;
+        }
+        for (int c = 0; c < b_cols; c++)
+        {
+            C->off_proc_column_map.push_back(global_col + c);
+        }
+        n_blocks++;
+    }
+    C->off_proc_num_cols = C->off_proc_column_map.size();
+
+    BSRMatrix* C_on = (BSRMatrix*) C->on_proc;
+    C_on->n_rows = C->local_num_rows;
+    C_on->n_cols = C->on_proc_num_cols;
+    aligned_vector<BSRSpGEMMTerm> terms(2);
+    terms[0] = BSRSpGEMMTerm(NULL, (BSRMatrix*) A->on_proc);
+    terms[1] = BSRSpGEMMTerm(NULL, (BSRMatrix*) B->on_proc, NULL, alpha);
+    bsr_spgemm_rows(n_block_rows, C->on_proc_num_cols / b_cols, terms, C_on);
+
+    BSRMatrix* C_off = (BSRMatrix*) C->off_proc;
+    C_off->n_rows = C->local_num_rows;
+    C_off->n_cols = C->off_proc_num_cols;
+    terms[0] = BSRSpGEMMTerm(NULL, (BSRMatrix*) A->off_proc, off_proc_to_new.data());
+    terms[1] = BSRSpGEMMTerm(NULL, (BSRMatrix*) B->off_proc, B_off_proc_to_new.data(),
+            alpha);
+    bsr_spgemm_rows(n_block_rows, n_blocks, terms, C_off);
+
+    // Remove off_proc block columns with no remaining blocks
+    if (n_blocks)
+    {
+        aligned_vector<int> new_col(n_blocks, 0);
+        for (aligned_vector<int>::iterator it = C_off->idx2.begin();
+                it != C_off->idx2.end(); ++it)
+        {
+            new_col[*it] = 1;
+        }
+        ctr = 0;
+        for (int i = 0; i < n_blocks; i++)
+        {
+            if (new_col[i])
+            {
+                for (int c = 0; c < b_cols; c++)
+                {
+                    C->off_proc_column_map[ctr * b_cols + c] = 
+                        C->off_proc_column_map[i * b_cols + c];
+                }
+                new_col[i] = ctr++;
+            }
+            else 
+                new_col[i] = -1;
+        }
+        C->off_proc_num_cols = ctr * b_cols;
+        C_off->n_cols = C->off_proc_num_cols;
+        C->off_proc_column_map.resize(C->off_proc_num_cols);
+
+        for (aligned_vector<int>::iterator it = C_off->idx2.begin();
+                it != C_off->idx2.end(); ++it)
+        {
+            *it = new_col[*it];
+        }
+    }
+
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+
+    return C;
+}
+
+ParBSRMatrix* ParBSRMatrix::add(ParBSRMatrix* B)
+{
+    return add_helper(this, B, 1.0);
+}
+
+ParBSRMatrix* ParBSRMatrix::subtract(ParBSRMatrix* B)
+{
+    return add_helper(this, B, -1.0);
+}
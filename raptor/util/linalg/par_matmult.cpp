@@ -1,6 +1,10 @@
 // Copyright (c) 2015-2017, RAPtor Developer Team
 // License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
 #include "core/par_matrix.hpp"
+#include "util/linalg/spgemm.hpp"
+
+#include <map>
+#include <algorithm>
 
 using namespace raptor;
 
@@ -32,10 +36,11 @@ ParCSRMatrix* ParCSRMatrix::mult(ParCSRMatrix* B, bool tap, data_t* comm_t)
 
     // Communicate data and multiply
     if (comm_t) *comm_t -= MPI_Wtime();
-    CSRMatrix* recv_mat = comm->communicate(B);
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = comm->communicate(B, recv_cols);
     if (comm_t) *comm_t += MPI_Wtime();
 
-    mult_helper(B, C, recv_mat);
+    mult_helper(B, C, recv_mat, recv_cols);
     delete recv_mat;
 
     // Return matrix containing product
@@ -65,10 +70,11 @@ ParCSRMatrix* ParCSRMatrix::tap_mult(ParCSRMatrix* B, data_t* comm_t)
 
     // Communicate data and multiply
     if (comm_t) *comm_t -= MPI_Wtime();
-    CSRMatrix* recv_mat = tap_comm->communicate(B);
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = tap_comm->communicate(B, recv_cols);
     if (comm_t) *comm_t += MPI_Wtime();
 
-    mult_helper(B, C, recv_mat);
+    mult_helper(B, C, recv_mat, recv_cols);
     delete recv_mat;
 
     // Return matrix containing product
@@ -99,7 +105,7 @@ ParCSRMatrix* ParCSRMatrix::mult_T(ParCSCMatrix* A, bool tap, data_t* comm_t)
     }
 
     int start, end;
-    int row, col, idx;
+    index_t global_col;
 
     if (A->comm == NULL)
     {
@@ -119,42 +125,46 @@ ParCSRMatrix* ParCSRMatrix::mult_T(ParCSCMatrix* A, bool tap, data_t* comm_t)
         part->num_shared = 0;
     }
 
-    CSRMatrix* Ctmp = mult_T_partial(A);
+    aligned_vector<index_t> Ctmp_cols;
+    CSRMatrix* Ctmp = mult_T_partial(A, Ctmp_cols);
 
     if (comm_t) *comm_t -= MPI_Wtime();
-    CSRMatrix* recv_mat = A->comm->communicate_T(Ctmp->idx1, Ctmp->idx2, 
-            Ctmp->vals, A->on_proc_num_cols);
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = A->comm->communicate_T(Ctmp->idx1, Ctmp_cols, 
+            Ctmp->vals, A->on_proc_num_cols, recv_cols);
     if (comm_t) *comm_t += MPI_Wtime();
 
-    // Split recv_mat into on and off proc portions
+    // Split recv_mat into on and off proc portions (columns of recv_on
+    // are relative to first_local_col, and those of recv_off are global)
     CSRMatrix* recv_on = new CSRMatrix(A->on_proc_num_cols, -1);
     CSRMatrix* recv_off = new CSRMatrix(A->on_proc_num_cols, -1);
+    aligned_vector<index_t> recv_off_cols;
     for (int i = 0; i < A->on_proc_num_cols; i++)
     {
         start = recv_mat->idx1[i];
         end = recv_mat->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            col = recv_mat->idx2[j];
-            if (col < partition->first_local_col
-                    || col > partition->last_local_col)
+            global_col = recv_cols[j];
+            if (global_col < partition->first_local_col
+                    || global_col > partition->last_local_col)
             {
-                recv_off->idx2.push_back(col);
+                recv_off_cols.push_back(global_col);
                 recv_off->vals.push_back(recv_mat->vals[j]);
             }
             else
             {
-                recv_on->idx2.push_back(col);
+                recv_on->idx2.push_back(global_col - partition->first_local_col);
                 recv_on->vals.push_back(recv_mat->vals[j]);
             }
         }
         recv_on->idx1[i+1] = recv_on->idx2.size();
-        recv_off->idx1[i+1] = recv_off->idx2.size();
+        recv_off->idx1[i+1] = recv_off_cols.size();
     }
     recv_on->nnz = recv_on->idx2.size();
-    recv_off->nnz = recv_off->idx2.size();
+    recv_off->nnz = recv_off_cols.size();
 
-    mult_T_combine(A, C, recv_on, recv_off);
+    mult_T_combine(A, C, recv_on, recv_off, recv_off_cols);
 
     // Clean up
     delete Ctmp;
@@ -169,7 +179,7 @@ ParCSRMatrix* ParCSRMatrix::mult_T(ParCSCMatrix* A, bool tap, data_t* comm_t)
 ParCSRMatrix* ParCSRMatrix::tap_mult_T(ParCSCMatrix* A, data_t* comm_t)
 {
     int start, end;
-    int row, col, idx;
+    index_t global_col;
 
     if (A->tap_comm == NULL)
     {
@@ -190,43 +200,47 @@ ParCSRMatrix* ParCSRMatrix::tap_mult_T(ParCSCMatrix* A, data_t* comm_t)
         part->num_shared = 0;
     }
 
-    CSRMatrix* Ctmp = mult_T_partial(A);
+    aligned_vector<index_t> Ctmp_cols;
+    CSRMatrix* Ctmp = mult_T_partial(A, Ctmp_cols);
 
     if (comm_t) *comm_t -= MPI_Wtime();
-    CSRMatrix* recv_mat = A->tap_comm->communicate_T(Ctmp->idx1, Ctmp->idx2, 
-            Ctmp->vals, A->on_proc_num_cols);
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = A->tap_comm->communicate_T(Ctmp->idx1, Ctmp_cols, 
+            Ctmp->vals, A->on_proc_num_cols, recv_cols);
     if (comm_t) *comm_t += MPI_Wtime();
 
 
-    // Split recv_mat into on and off proc portions
+    // Split recv_mat into on and off proc portions (columns of recv_on
+    // are relative to first_local_col, and those of recv_off are global)
     CSRMatrix* recv_on = new CSRMatrix(A->on_proc_num_cols, -1);
     CSRMatrix* recv_off = new CSRMatrix(A->on_proc_num_cols, -1);
+    aligned_vector<index_t> recv_off_cols;
     for (int i = 0; i < A->on_proc_num_cols; i++)
     {
         start = recv_mat->idx1[i];
         end = recv_mat->idx1[i+1];
         for (int j = start; j < end; j++)
         {
-            col = recv_mat->idx2[j];
-            if (col < partition->first_local_col
-                    || col > partition->last_local_col)
+            global_col = recv_cols[j];
+            if (global_col < partition->first_local_col
+                    || global_col > partition->last_local_col)
             {
-                recv_off->idx2.push_back(col);
+                recv_off_cols.push_back(global_col);
                 recv_off->vals.push_back(recv_mat->vals[j]);
             }
             else
             {
-                recv_on->idx2.push_back(col);
+                recv_on->idx2.push_back(global_col - partition->first_local_col);
                 recv_on->vals.push_back(recv_mat->vals[j]);
             }
         }
         recv_on->idx1[i+1] = recv_on->idx2.size();
-        recv_off->idx1[i+1] = recv_off->idx2.size();
+        recv_off->idx1[i+1] = recv_off_cols.size();
     }
     recv_on->nnz = recv_on->idx2.size();
-    recv_off->nnz = recv_off->idx2.size();
+    recv_off->nnz = recv_off_cols.size();
 
-    mult_T_combine(A, C, recv_on, recv_off);
+    mult_T_combine(A, C, recv_on, recv_off, recv_off_cols);
 
     // Clean up
     delete Ctmp;
@@ -238,6 +252,543 @@ ParCSRMatrix* ParCSRMatrix::tap_mult_T(ParCSCMatrix* A, data_t* comm_t)
     return C;
 }
 
+// Forms C = P^T*A*P (see ParCSRMatrix::RAP).  If structure is not NULL,
+// structural zeros are kept, the product is formed with standard 
+// communication, and its symbolic structure is recorded for RAP_numeric.
+static ParCSRMatrix* form_RAP(ParCSRMatrix* A, ParCSRMatrix* P, bool tap, 
+        data_t* comm_t, bool keep_zeros, RAPStructure* structure)
+{
+    int start, end, col;
+    index_t global_col;
+    int n_on = P->on_proc_num_cols;
+    index_t first_col = P->partition->first_local_col;
+    index_t last_col = P->partition->last_local_col;
+
+    // Check that communication packages have been initialized
+    if (tap)
+    {
+        if (A->tap_comm == NULL)
+        {
+            A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map, 
+                    A->on_proc_column_map);
+        }
+        if (P->tap_comm == NULL)
+        {
+            P->tap_comm = new TAPComm(P->partition, P->off_proc_column_map,
+                    P->on_proc_column_map);
+        }
+    }
+    else
+    {
+        if (A->comm == NULL)
+        {
+            A->comm = new ParComm(A->partition, A->off_proc_column_map, 
+                    A->on_proc_column_map);
+        }
+        if (P->comm == NULL)
+        {
+            P->comm = new ParComm(P->partition, P->off_proc_column_map, 
+                    P->on_proc_column_map);
+        }
+    }
+
+    // Values are later exchanged row by row, so rows may not be merged
+    // in messages
+    if (structure && (A->comm->send_data->indptr_T.size() || 
+                P->comm->recv_data->indptr_T.size()))
+    {
+        printf("RAP structure requires communication packages without merged rows\n");
+        exit(-1);
+    }
+
+    // Initialize C (matrix to be returned)
+    ParCSRMatrix* C;
+    if (A->partition == P->partition)
+    {
+        C = new ParCSRMatrix(A->partition);
+    }
+    else
+    {
+        Partition* part = new Partition(A->partition, P->partition);
+        C = new ParCSRMatrix(part);
+        part->num_shared = 0;
+    }
+
+    // Communicate rows of P corresponding to off_proc columns of A
+    if (comm_t) *comm_t -= MPI_Wtime();
+    CSRMatrix* recv_mat;
+    aligned_vector<index_t> recv_cols;
+    if (tap) recv_mat = A->tap_comm->communicate(P, recv_cols);
+    else recv_mat = A->comm->communicate(P, recv_cols);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    // Columns of AP : on_proc columns of P, followed by the union of 
+    // off_proc columns of P and those received
+    std::map<index_t, int> global_to_AP;
+    aligned_vector<index_t> AP_off_cols(P->off_proc_column_map.begin(),
+            P->off_proc_column_map.end());
+    for (aligned_vector<index_t>::iterator it = recv_cols.begin();
+            it != recv_cols.end(); ++it)
+    {
+        if (*it < first_col || *it > last_col)
+        {
+            AP_off_cols.push_back(*it);
+        }
+    }
+    std::sort(AP_off_cols.begin(), AP_off_cols.end());
+    AP_off_cols.erase(std::unique(AP_off_cols.begin(), AP_off_cols.end()),
+            AP_off_cols.end());
+    for (int i = 0; i < (int) AP_off_cols.size(); i++)
+    {
+        global_to_AP[AP_off_cols[i]] = n_on + i;
+    }
+    int n_AP = n_on + AP_off_cols.size();
+
+    aligned_vector<int> P_off_to_AP(P->off_proc_num_cols);
+    for (int i = 0; i < P->off_proc_num_cols; i++)
+    {
+        P_off_to_AP[i] = global_to_AP[P->off_proc_column_map[i]];
+    }
+    int* part_to_col = P->map_partition_to_local();
+    recv_mat->idx2.resize(recv_cols.size());
+    for (int i = 0; i < (int) recv_cols.size(); i++)
+    {
+        global_col = recv_cols[i];
+        if (global_col < first_col || global_col > last_col)
+        {
+            recv_mat->idx2[i] = global_to_AP[global_col];
+        }
+        else
+        {
+            recv_mat->idx2[i] = part_to_col[global_col - first_col];
+        }
+    }
+    delete[] part_to_col;
+    recv_mat->n_cols = n_AP;
+
+    // Rows of AP : A_on * P_on + A_on * P_off + A_off * recv_mat
+    aligned_vector<SpGEMMTerm> terms(3);
+    terms[0] = SpGEMMTerm(A->on_proc, P->on_proc);
+    terms[1] = SpGEMMTerm(A->on_proc, P->off_proc, P_off_to_AP.data());
+    terms[2] = SpGEMMTerm(A->off_proc, recv_mat);
+
+    // Contributions to rows of C owned by other processes 
+    // (P_off^T * AP).  With a structure, all rows of AP are formed 
+    // once (and their pattern kept), rather than in blocks.
+    CSCMatrix* P_off_csc = P->off_proc->to_CSC();
+    CSCMatrix* P_on_csc = P->on_proc->to_CSC();
+    CSRMatrix* Ctmp = new CSRMatrix(P->off_proc_num_cols, n_AP);
+    CSRMatrix* C_loc = new CSRMatrix(n_on, n_AP);
+    aligned_vector<SpGEMMTerm> PT_terms(1);
+    if (structure)
+    {
+        structure->AP = new CSRMatrix(A->local_num_rows, n_AP);
+        spgemm_rows(A->local_num_rows, n_AP, terms, structure->AP, NULL, true);
+        PT_terms[0] = SpGEMMTerm(P_off_csc, structure->AP);
+        spgemm_rows(P->off_proc_num_cols, n_AP, PT_terms, Ctmp, NULL, true);
+    }
+    else
+    {
+        rap_rows(P_off_csc, A->local_num_rows, terms, n_AP, Ctmp, 
+                rap_block_rows, keep_zeros);
+    }
+    delete P_off_csc;
+    aligned_vector<index_t> Ctmp_cols(Ctmp->idx2.size());
+    for (int i = 0; i < (int) Ctmp->idx2.size(); i++)
+    {
+        col = Ctmp->idx2[i];
+        if (col < n_on) Ctmp_cols[i] = P->on_proc_column_map[col];
+        else Ctmp_cols[i] = AP_off_cols[col - n_on];
+    }
+
+    // Send remote contributions to their owners (the only communication
+    // of the product), and form local rows of C (P_on^T * AP)
+    if (comm_t) *comm_t -= MPI_Wtime();
+    CSRMatrix* recv_C;
+    CSRMatrix* recv_rows = NULL;
+    CSRMatrix* recv_to_C = NULL;
+    aligned_vector<index_t> recv_C_cols;
+    aligned_vector<index_t> recv_rows_cols;
+    if (tap) recv_C = P->tap_comm->communicate_T(Ctmp->idx1, Ctmp_cols, 
+            Ctmp->vals, n_on, recv_C_cols);
+    else if (structure == NULL) recv_C = P->comm->communicate_T(Ctmp->idx1, 
+            Ctmp_cols, Ctmp->vals, n_on, recv_C_cols);
+    else
+    {
+        // Received rows are kept (in order of receipt), and added to
+        // the rows of C through recv_to_C
+        recv_rows = P->comm->communicate_T_rows(Ctmp->idx1, 
+                Ctmp_cols, Ctmp->vals, recv_rows_cols);
+        CommData* send_data = P->comm->send_data;
+        recv_to_C = new CSRMatrix(n_on, send_data->size_msgs);
+        for (int i = 0; i < send_data->size_msgs; i++)
+        {
+            recv_to_C->idx1[send_data->indices[i] + 1]++;
+        }
+        for (int i = 0; i < n_on; i++)
+        {
+            recv_to_C->idx1[i+1] += recv_to_C->idx1[i];
+        }
+        recv_to_C->nnz = send_data->size_msgs;
+        recv_to_C->idx2.resize(recv_to_C->nnz);
+        recv_to_C->vals.resize(recv_to_C->nnz, 1.0);
+        for (int i = 0; i < send_data->size_msgs; i++)
+        {
+            recv_to_C->idx2[recv_to_C->idx1[send_data->indices[i]]++] = i;
+        }
+        for (int i = n_on; i > 0; i--)
+        {
+            recv_to_C->idx1[i] = recv_to_C->idx1[i-1];
+        }
+        recv_to_C->idx1[0] = 0;
+
+        recv_C = new CSRMatrix(n_on, -1);
+        for (int i = 0; i < n_on; i++)
+        {
+            for (int j = recv_to_C->idx1[i]; j < recv_to_C->idx1[i+1]; j++)
+            {
+                int row = recv_to_C->idx2[j];
+                start = recv_rows->idx1[row];
+                end = recv_rows->idx1[row+1];
+                recv_C_cols.insert(recv_C_cols.end(), 
+                        recv_rows_cols.begin() + start, 
+                        recv_rows_cols.begin() + end);
+                recv_C->vals.insert(recv_C->vals.end(), 
+                        recv_rows->vals.begin() + start,
+                        recv_rows->vals.begin() + end);
+            }
+            recv_C->idx1[i+1] = recv_C_cols.size();
+        }
+        recv_C->nnz = recv_C_cols.size();
+    }
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (structure)
+    {
+        PT_terms[0] = SpGEMMTerm(P_on_csc, structure->AP);
+        spgemm_rows(n_on, n_AP, PT_terms, C_loc, NULL, true);
+    }
+    else
+    {
+        rap_rows(P_on_csc, A->local_num_rows, terms, n_AP, C_loc, 
+                rap_block_rows, keep_zeros);
+    }
+    delete P_on_csc;
+
+    // Set dimensions of C
+    C->global_num_rows = P->global_num_cols;
+    C->global_num_cols = P->global_num_cols;
+    C->local_num_rows = n_on;
+    C->on_proc_column_map = P->get_on_proc_column_map();
+    C->local_row_map = P->get_on_proc_column_map();
+    C->on_proc_num_cols = n_on;
+
+    // Columns of C->off_proc : union of off_proc columns in C_loc 
+    // and recv_C
+    std::set<index_t> C_col_set;
+    for (aligned_vector<int>::iterator it = C_loc->idx2.begin();
+            it != C_loc->idx2.end(); ++it)
+    {
+        if (*it >= n_on) C_col_set.insert(AP_off_cols[*it - n_on]);
+    }
+    for (aligned_vector<index_t>::iterator it = recv_C_cols.begin();
+            it != recv_C_cols.end(); ++it)
+    {
+        if (*it < first_col || *it > last_col) C_col_set.insert(*it);
+    }
+    std::map<index_t, int> global_to_C;
+    C->off_proc_column_map.clear();
+    for (std::set<index_t>::iterator it = C_col_set.begin();
+            it != C_col_set.end(); ++it)
+    {
+        global_to_C[*it] = C->off_proc_column_map.size();
+        C->off_proc_column_map.push_back(*it);
+    }
+    C->off_proc_num_cols = C->off_proc_column_map.size();
+
+    // Split C_loc and recv_C into on_proc and off_proc portions
+    CSRMatrix* loc_on = new CSRMatrix(n_on, -1);
+    CSRMatrix* loc_off = new CSRMatrix(n_on, -1);
+    CSRMatrix* recv_on = new CSRMatrix(n_on, -1);
+    CSRMatrix* recv_off = new CSRMatrix(n_on, -1);
+    part_to_col = P->map_partition_to_local();
+    for (int i = 0; i < n_on; i++)
+    {
+        start = C_loc->idx1[i];
+        end = C_loc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            col = C_loc->idx2[j];
+            if (col < n_on)
+            {
+                loc_on->idx2.push_back(col);
+                loc_on->vals.push_back(C_loc->vals[j]);
+            }
+            else
+            {
+                loc_off->idx2.push_back(global_to_C[AP_off_cols[col - n_on]]);
+                loc_off->vals.push_back(C_loc->vals[j]);
+            }
+        }
+        loc_on->idx1[i+1] = loc_on->idx2.size();
+        loc_off->idx1[i+1] = loc_off->idx2.size();
+
+        start = recv_C->idx1[i];
+        end = recv_C->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            global_col = recv_C_cols[j];
+            if (global_col < first_col || global_col > last_col)
+            {
+                recv_off->idx2.push_back(global_to_C[global_col]);
+                recv_off->vals.push_back(recv_C->vals[j]);
+            }
+            else
+            {
+                recv_on->idx2.push_back(part_to_col[global_col - first_col]);
+                recv_on->vals.push_back(recv_C->vals[j]);
+            }
+        }
+        recv_on->idx1[i+1] = recv_on->idx2.size();
+        recv_off->idx1[i+1] = recv_off->idx2.size();
+    }
+
+    // C->on_proc <- loc_on + recv_on, C->off_proc <- loc_off + recv_off
+    bool keep = keep_zeros || structure;
+    C->on_proc->n_rows = n_on;
+    C->on_proc->n_cols = n_on;
+    terms.resize(2);
+    terms[0] = SpGEMMTerm(NULL, loc_on);
+    terms[1] = SpGEMMTerm(NULL, recv_on);
+    spgemm_rows(n_on, n_on, terms, (CSRMatrix*) C->on_proc, NULL, keep);
+
+    C->off_proc->n_rows = n_on;
+    C->off_proc->n_cols = C->off_proc_num_cols;
+    terms[0] = SpGEMMTerm(NULL, loc_off);
+    terms[1] = SpGEMMTerm(NULL, recv_off);
+    spgemm_rows(n_on, C->off_proc_num_cols, terms, (CSRMatrix*) C->off_proc, 
+            NULL, keep);
+
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+
+    if (structure)
+    {
+        // C numbering of AP columns, C_loc, and received rows
+        int n_C = n_on + C->off_proc_num_cols;
+        structure->AP_to_C.resize(n_AP);
+        for (int i = 0; i < n_AP; i++)
+        {
+            if (i < n_on)
+            {
+                structure->AP_to_C[i] = i;
+                continue;
+            }
+            std::map<index_t, int>::iterator it = 
+                global_to_C.find(AP_off_cols[i - n_on]);
+            structure->AP_to_C[i] = it == global_to_C.end() ? -1 : n_on + it->second;
+        }
+        for (aligned_vector<int>::iterator it = C_loc->idx2.begin();
+                it != C_loc->idx2.end(); ++it)
+        {
+            *it = structure->AP_to_C[*it];
+        }
+        C_loc->n_cols = n_C;
+        recv_rows->idx2.resize(recv_rows_cols.size());
+        for (int i = 0; i < (int) recv_rows_cols.size(); i++)
+        {
+            global_col = recv_rows_cols[i];
+            if (global_col < first_col || global_col > last_col) 
+                recv_rows->idx2[i] = n_on + global_to_C[global_col];
+            else recv_rows->idx2[i] = part_to_col[global_col - first_col];
+        }
+        recv_rows->n_cols = n_C;
+
+        structure->recv_P = recv_mat;
+        structure->P_off_to_AP.swap(P_off_to_AP);
+        structure->Ctmp = Ctmp;
+        structure->C_loc = C_loc;
+        structure->recv_C = recv_rows;
+        structure->recv_to_C = recv_to_C;
+    }
+    else
+    {
+        delete recv_mat;
+        delete Ctmp;
+        delete C_loc;
+    }
+    delete[] part_to_col;
+
+    // Clean up
+    delete recv_C;
+    delete loc_on;
+    delete loc_off;
+    delete recv_on;
+    delete recv_off;
+
+    // Return matrix containing product
+    return C;
+}
+
+ParCSRMatrix* ParCSRMatrix::RAP(ParCSRMatrix* P, bool tap, data_t* comm_t,
+        bool keep_zeros)
+{
+    return form_RAP(this, P, tap, comm_t, keep_zeros, NULL);
+}
+
+ParCSRMatrix* ParCSRMatrix::RAP_symbolic(ParCSRMatrix* P, RAPStructure* structure,
+        data_t* comm_t)
+{
+    return form_RAP(this, P, false, comm_t, true, structure);
+}
+
+// Sends the values of rows of (rowptr, vals) to each process in send_data
+// (rows send_data->indices[j], or j if it has no indices), and receives
+// the values of the rows of recv_mat (with known pattern) from each 
+// process in recv_data.  Messages are waited on by wait_values.
+static void post_values(const int* rowptr, const double* vals, CommData* send_data, 
+        CommData* recv_data, CSRMatrix* recv_mat, aligned_vector<double>& send_buffer,
+        int key, MPI_Comm mpi_comm)
+{
+    int start, end, row, size;
+
+    send_buffer.clear();
+    aligned_vector<int> send_ptr(send_data->num_msgs + 1);
+    send_ptr[0] = 0;
+    for (int i = 0; i < send_data->num_msgs; i++)
+    {
+        for (int j = send_data->indptr[i]; j < send_data->indptr[i+1]; j++)
+        {
+            row = send_data->indices.size() ? send_data->indices[j] : j;
+            send_buffer.insert(send_buffer.end(), vals + rowptr[row],
+                    vals + rowptr[row+1]);
+        }
+        send_ptr[i+1] = send_buffer.size();
+    }
+
+    recv_mat->vals.resize(recv_mat->idx1[recv_mat->n_rows]);
+    for (int i = 0; i < recv_data->num_msgs; i++)
+    {
+        start = recv_mat->idx1[recv_data->indptr[i]];
+        end = recv_mat->idx1[recv_data->indptr[i+1]];
+        MPI_Irecv(&(recv_mat->vals[start]), end - start, MPI_DOUBLE, 
+                recv_data->procs[i], key, mpi_comm, &(recv_data->requests[i]));
+    }
+    for (int i = 0; i < send_data->num_msgs; i++)
+    {
+        size = send_ptr[i+1] - send_ptr[i];
+        MPI_Isend(&(send_buffer[send_ptr[i]]), size, MPI_DOUBLE, 
+                send_data->procs[i], key, mpi_comm, &(send_data->requests[i]));
+    }
+}
+
+static void wait_values(CommData* send_data, CommData* recv_data)
+{
+    MPI_Waitall(recv_data->num_msgs, recv_data->requests.data(), MPI_STATUSES_IGNORE);
+    MPI_Waitall(send_data->num_msgs, send_data->requests.data(), MPI_STATUSES_IGNORE);
+}
+
+void ParCSRMatrix::RAP_numeric(ParCSRMatrix* P, ParCSRMatrix* C, 
+        RAPStructure* structure, data_t* comm_t)
+{
+    int n_on = P->on_proc_num_cols;
+    int n_AP = structure->AP->n_cols;
+    int n_C = n_on + C->off_proc_num_cols;
+    aligned_vector<double> send_buffer;
+    ParComm* P_comm = P->comm;
+
+    // Values of the rows of P for off_proc columns of A (each row holds
+    // its on_proc values, followed by its off_proc values)
+    aligned_vector<int> P_rowptr(local_num_rows + 1);
+    aligned_vector<double> P_vals(P->on_proc->nnz + P->off_proc->nnz);
+    P_rowptr[0] = 0;
+    for (int i = 0; i < local_num_rows; i++)
+    {
+        int ctr = P_rowptr[i];
+        for (int j = P->on_proc->idx1[i]; j < P->on_proc->idx1[i+1]; j++)
+        {
+            P_vals[ctr++] = P->on_proc->vals[j];
+        }
+        for (int j = P->off_proc->idx1[i]; j < P->off_proc->idx1[i+1]; j++)
+        {
+            P_vals[ctr++] = P->off_proc->vals[j];
+        }
+        P_rowptr[i+1] = ctr;
+    }
+    if (comm_t) *comm_t -= MPI_Wtime();
+    post_values(P_rowptr.data(), P_vals.data(), comm->send_data, comm->recv_data,
+            structure->recv_P, send_buffer, comm->key, comm->mpi_comm);
+    wait_values(comm->send_data, comm->recv_data);
+    comm->key++;
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    // AP <- A_on * P_on + A_on * P_off + A_off * recv_P
+    aligned_vector<SpGEMMTerm> terms(3);
+    terms[0] = SpGEMMTerm(on_proc, P->on_proc);
+    terms[1] = SpGEMMTerm(on_proc, P->off_proc, structure->P_off_to_AP.data());
+    terms[2] = SpGEMMTerm(off_proc, structure->recv_P);
+    spgemm_rows_numeric(local_num_rows, n_AP, terms, structure->AP);
+
+    // Contributions to rows of C owned by other processes, sent while 
+    // local rows of C are formed
+    CSCMatrix* P_off_csc = P->off_proc->to_CSC();
+    terms.resize(1);
+    terms[0] = SpGEMMTerm(P_off_csc, structure->AP);
+    spgemm_rows_numeric(P->off_proc_num_cols, n_AP, terms, structure->Ctmp);
+    delete P_off_csc;
+
+    aligned_vector<double> Ctmp_send_buffer;
+    if (comm_t) *comm_t -= MPI_Wtime();
+    post_values(structure->Ctmp->idx1.data(), structure->Ctmp->vals.data(),
+            P_comm->recv_data, P_comm->send_data, structure->recv_C, 
+            Ctmp_send_buffer, P_comm->key, P_comm->mpi_comm);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    CSCMatrix* P_on_csc = P->on_proc->to_CSC();
+    terms[0] = SpGEMMTerm(P_on_csc, structure->AP, structure->AP_to_C.data());
+    spgemm_rows_numeric(n_on, n_C, terms, structure->C_loc);
+    delete P_on_csc;
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    wait_values(P_comm->recv_data, P_comm->send_data);
+    P_comm->key++;
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    // C <- C_loc + received rows, in the current pattern of C
+    CSRMatrix C_pattern(n_on, n_C);
+    C_pattern.idx2.resize(C->on_proc->nnz + C->off_proc->nnz);
+    C_pattern.idx1[0] = 0;
+    for (int i = 0; i < n_on; i++)
+    {
+        int ctr = C_pattern.idx1[i];
+        for (int j = C->on_proc->idx1[i]; j < C->on_proc->idx1[i+1]; j++)
+        {
+            C_pattern.idx2[ctr++] = C->on_proc->idx2[j];
+        }
+        for (int j = C->off_proc->idx1[i]; j < C->off_proc->idx1[i+1]; j++)
+        {
+            C_pattern.idx2[ctr++] = n_on + C->off_proc->idx2[j];
+        }
+        C_pattern.idx1[i+1] = ctr;
+    }
+    terms.resize(2);
+    terms[0] = SpGEMMTerm(NULL, structure->C_loc);
+    terms[1] = SpGEMMTerm(structure->recv_to_C, structure->recv_C);
+    spgemm_rows_numeric(n_on, n_C, terms, &C_pattern);
+
+    for (int i = 0; i < n_on; i++)
+    {
+        int ctr = C_pattern.idx1[i];
+        for (int j = C->on_proc->idx1[i]; j < C->on_proc->idx1[i+1]; j++)
+        {
+            C->on_proc->vals[j] = C_pattern.vals[ctr++];
+        }
+        for (int j = C->off_proc->idx1[i]; j < C->off_proc->idx1[i+1]; j++)
+        {
+            C->off_proc->vals[j] = C_pattern.vals[ctr++];
+        }
+    }
+}
+
 ParMatrix* ParMatrix::mult(ParCSRMatrix* B, bool tap, data_t* comm)
 {
     int rank;
@@ -248,7 +799,7 @@ ParMatrix* ParMatrix::mult(ParCSRMatrix* B, bool tap, data_t* comm)
 }
 
 void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C, 
-        CSRMatrix* recv_mat)
+        CSRMatrix* recv_mat, const aligned_vector<index_t>& recv_cols)
 {
     // Set dimensions of C
     C->global_num_rows = global_num_rows;
@@ -264,22 +815,12 @@ void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C,
 
     // Declare Variables
     int row_start, row_end;
-    int row_start_B, row_end_B;
-    int row_start_recv, row_end_recv;
-    int global_col, col, col_B, col_C;
-    int tmp;
-    double val;
+    index_t global_col;
 
     // Resize variables of on_proc
     C->on_proc->n_rows = local_num_rows;
     C->on_proc->n_cols = B->on_proc_num_cols;
     C->on_proc->nnz = 0;
-    C->on_proc->idx1.resize(local_num_rows + 1);
-    if (local_nnz)
-    {
-        C->on_proc->idx2.reserve(local_nnz);
-        C->on_proc->vals.reserve(local_nnz);
-    }
             
     // Split recv_mat into on and off proc portions
     aligned_vector<int> recv_on_rowptr(recv_mat->n_rows+1);
@@ -287,7 +828,7 @@ void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C,
     aligned_vector<double> recv_on_vals;
 
     aligned_vector<int> recv_off_rowptr(recv_mat->n_rows+1);
-    aligned_vector<int> recv_off_cols;
+    aligned_vector<index_t> recv_off_global;
     aligned_vector<double> recv_off_vals;
 
     int* part_to_col = B->map_partition_to_local();
@@ -299,11 +840,11 @@ void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C,
         row_end = recv_mat->idx1[i+1];
         for (int j = row_start; j < row_end; j++)
         {
-            global_col = recv_mat->idx2[j];
+            global_col = recv_cols[j];
             if (global_col < B->partition->first_local_col ||
                     global_col > B->partition->last_local_col)
             {
-                recv_off_cols.push_back(global_col);
+                recv_off_global.push_back(global_col);
                 recv_off_vals.push_back(recv_mat->vals[j]);
             }
             else
@@ -314,26 +855,26 @@ void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C,
             }
         }
         recv_on_rowptr[i+1] = recv_on_cols.size();
-        recv_off_rowptr[i+1] = recv_off_cols.size();
+        recv_off_rowptr[i+1] = recv_off_global.size();
     }
     delete[] part_to_col;
 
     // Calculate global_to_C and B_to_C column maps
-    std::map<int, int> global_to_C;
+    std::map<index_t, int> global_to_C;
     aligned_vector<int> B_to_C(B->off_proc_num_cols);
 
-    std::copy(recv_off_cols.begin(), recv_off_cols.end(),
+    std::copy(recv_off_global.begin(), recv_off_global.end(),
             std::back_inserter(C->off_proc_column_map));
-    for (aligned_vector<int>::iterator it = B->off_proc_column_map.begin();
+    for (aligned_vector<index_t>::iterator it = B->off_proc_column_map.begin();
             it != B->off_proc_column_map.end(); ++it)
     {
         C->off_proc_column_map.push_back(*it);
     }
     std::sort(C->off_proc_column_map.begin(), C->off_proc_column_map.end());
 
-    int prev_col = -1;
+    index_t prev_col = -1;
     C->off_proc_num_cols = 0;
-    for (aligned_vector<int>::iterator it = C->off_proc_column_map.begin();
+    for (aligned_vector<index_t>::iterator it = C->off_proc_column_map.begin();
             it != C->off_proc_column_map.end(); ++it)
     {
         if (*it != prev_col)
@@ -350,10 +891,10 @@ void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C,
         global_col = B->off_proc_column_map[i];
         B_to_C[i] = global_to_C[global_col];
     }
-    for (aligned_vector<int>::iterator it = recv_off_cols.begin(); 
-            it != recv_off_cols.end(); ++it)
+    aligned_vector<int> recv_off_cols(recv_off_global.size());
+    for (int i = 0; i < (int) recv_off_global.size(); i++)
     {
-        *it = global_to_C[*it];
+        recv_off_cols[i] = global_to_C[recv_off_global[i]];
     }
 
     C->off_proc_num_cols = C->off_proc_column_map.size();
@@ -362,277 +903,70 @@ void ParCSRMatrix::mult_helper(ParCSRMatrix* B, ParCSRMatrix* C,
     C->off_proc->n_rows = local_num_rows;
     C->off_proc->n_cols = C->off_proc_num_cols;
     C->off_proc->nnz = 0;
-    C->off_proc->idx1.resize(local_num_rows + 1);
-    C->off_proc->idx2.reserve(local_nnz);
-    C->off_proc->vals.reserve(local_nnz);
-
-    // Variables for calculating row sums
-    aligned_vector<double> sums(C->on_proc->n_cols, 0);
-    aligned_vector<int> next(C->on_proc->n_cols, -1);
-
-    C->on_proc->idx1[0] = 0;
-    for (int i = 0; i < local_num_rows; i++)
-    {
-        int head = -2;
-        int length = 0;
-
-        // Go through A_on_proc first (multiply but local rows of B)
-        row_start = on_proc->idx1[i];
-        row_end = on_proc->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            col = on_proc->idx2[j];
-            val = on_proc->vals[j];
-
-            // C->on_proc_proc <- A_on_proc * B_on_proc
-            row_start_B = B->on_proc->idx1[col];
-            row_end_B = B->on_proc->idx1[col+1];
-            for (int k = row_start_B; k < row_end_B; k++)
-            {
-                col_B = B->on_proc->idx2[k];
-                sums[col_B] += val * B->on_proc->vals[k];
-                if (next[col_B] == -1)
-                {
-                    next[col_B] = head;
-                    head = col_B;
-                    length++;
-                }
-            }
-        }
-
-        // Go through A_off_proc (multiply but rows in recv_mat)
-        row_start = off_proc->idx1[i];
-        row_end = off_proc->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            col = off_proc->idx2[j]; // off_proc col corresponds to row in recv_mat
-            val = off_proc->vals[j];
-
-            row_start_recv = recv_on_rowptr[col];
-            row_end_recv = recv_on_rowptr[col+1];
-            for (int k = row_start_recv; k < row_end_recv; k++)
-            {
-                col_C = recv_on_cols[k];
-                sums[col_C] += val * recv_on_vals[k];
-                if (next[col_C] == -1)
-                {
-                    next[col_C] = head;
-                    head = col_C;
-                    length++;
-                }
-            }
-        }
-
-        // Add sums to C and update rowptrs
-        for (int j = 0; j < length; j++)
-        {
-            val = sums[head];
-            if (fabs(val) > zero_tol)
-            {
-                C->on_proc->idx2.push_back(head);
-                C->on_proc->vals.push_back(val);
-            }
-            tmp = head;
-            head = next[head];
-            next[tmp] = -1;
-            sums[tmp] = 0;
-        }
-        C->on_proc->idx1[i+1] = C->on_proc->idx2.size();
-    }
-    C->on_proc->nnz = C->on_proc->idx2.size();
-
-    sums.resize(C->off_proc->n_cols, 0);
-    next.resize(C->off_proc->n_cols, -1);
-
-    C->off_proc->idx1[0] = 0;
-    for (int i = 0; i < local_num_rows; i++)
-    {
-        int head = -2;
-        int length = 0;
 
-        // Go through A_on_proc first (multiply but local rows of B)
-        row_start = on_proc->idx1[i];
-        row_end = on_proc->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            col = on_proc->idx2[j];
-            val = on_proc->vals[j];
+    // C->on_proc <- A_on_proc * B_on_proc + A_off_proc * recv_on
+    aligned_vector<SpGEMMTerm> terms(2);
+    terms[0] = SpGEMMTerm(on_proc, B->on_proc);
+    terms[1] = SpGEMMTerm(off_proc, recv_on_rowptr, recv_on_cols, recv_on_vals);
+    spgemm_rows(local_num_rows, C->on_proc->n_cols, terms, (CSRMatrix*) C->on_proc);
 
-            // C->off_proc_proc <- A_on_proc * B_off_proc
-            row_start_B = B->off_proc->idx1[col];
-            row_end_B = B->off_proc->idx1[col+1];
-            for (int k = row_start_B; k < row_end_B; k++)
-            {
-                col_B = B->off_proc->idx2[k];
-                col_C = B_to_C[col_B];
-                sums[col_C] += val * B->off_proc->vals[k];
-                if (next[col_C] == -1)
-                {
-                    next[col_C] = head;
-                    head = col_C;
-                    length++;
-                }
-            }
-        }
-
-        // Go through A_off_proc (multiply but rows in recv_mat)
-        row_start = off_proc->idx1[i];
-        row_end = off_proc->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            col = off_proc->idx2[j]; // off_proc col corresponds to row in recv_mat
-            val = off_proc->vals[j];
-
-            row_start_recv = recv_off_rowptr[col];
-            row_end_recv = recv_off_rowptr[col+1];
-            for (int k = row_start_recv; k < row_end_recv; k++)
-            {
-                col_C = recv_off_cols[k];
-                sums[col_C] += val * recv_off_vals[k];
-                if (next[col_C] == -1)
-                {
-                    next[col_C] = head;
-                    head = col_C;
-                    length++;
-                }
-            }
-        }
-
-        // Add sums to C and update rowptrs
-        for (int j = 0; j < length; j++)
-        {
-            val = sums[head];
-            if (fabs(val) > zero_tol)
-            {
-                C->off_proc->idx2.push_back(head);
-                C->off_proc->vals.push_back(val);
-            }
-            tmp = head;
-            head = next[head];
-            next[tmp] = -1;
-            sums[tmp] = 0;
-        }
-        C->off_proc->idx1[i+1] = C->off_proc->idx2.size();
-    }
-
-    C->off_proc->nnz = C->off_proc->idx2.size();
+    // C->off_proc <- A_on_proc * B_off_proc + A_off_proc * recv_off
+    terms[0] = SpGEMMTerm(on_proc, B->off_proc, B_to_C.data());
+    terms[1] = SpGEMMTerm(off_proc, recv_off_rowptr, recv_off_cols, recv_off_vals);
+    spgemm_rows(local_num_rows, C->off_proc->n_cols, terms, (CSRMatrix*) C->off_proc);
 
     C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
 }
 
-CSRMatrix* ParCSRMatrix::mult_T_partial(CSCMatrix* A_off)
+CSRMatrix* ParCSRMatrix::mult_T_partial(CSCMatrix* A_off, 
+        aligned_vector<index_t>& global_cols)
 {
-    int row_start_AT, row_end_AT;
-    int row_start, row_end;
-    int col, col_AT;
-    int tmp, head, length;
-    double val_AT, val;
-
     int n_cols = on_proc_num_cols + off_proc_num_cols;
     CSRMatrix* Ctmp = new CSRMatrix(A_off->n_cols, n_cols);
 
-    // Create vectors for holding sums of each row
-    aligned_vector<double> sums;
-    aligned_vector<int> next;
-    if (n_cols)
+    // Off_proc columns follow on_proc columns in Ctmp
+    aligned_vector<int> off_to_tmp(off_proc_num_cols);
+    for (int i = 0; i < off_proc_num_cols; i++)
     {
-        sums.resize(n_cols, 0);
-        next.resize(n_cols, -1);
+        off_to_tmp[i] = i + on_proc_num_cols;
     }
 
     // Multiply (A->off_proc)_T * (B->on_proc + B->off_proc)
     // to form Ctmp (partial result)
-    Ctmp->idx1[0] = 0;
-    for (int i = 0; i < A_off->n_cols; i++) // go through rows of AT
+    aligned_vector<SpGEMMTerm> terms(2);
+    terms[0] = SpGEMMTerm(A_off, on_proc);
+    terms[1] = SpGEMMTerm(A_off, off_proc, off_to_tmp.data());
+    spgemm_rows(A_off->n_cols, n_cols, terms, Ctmp);
+
+    // Global indices of columns
+    global_cols.resize(Ctmp->idx2.size());
+    for (int i = 0; i < (int) Ctmp->idx2.size(); i++)
     {
-        head = -2;
-        length = 0;
-
-        row_start_AT = A_off->idx1[i]; // col of A == row of AT
-        row_end_AT = A_off->idx1[i+1];
-        for (int j = row_start_AT; j < row_end_AT; j++)
+        if (Ctmp->idx2[i] >= on_proc_num_cols)
         {
-            col_AT = A_off->idx2[j]; // row of A == col of AT
-            val_AT = A_off->vals[j];
-
-            row_start = on_proc->idx1[col_AT];
-            row_end = on_proc->idx1[col_AT+1];
-            for (int k = row_start; k < row_end; k++)
-            {
-                col = on_proc->idx2[k];
-                sums[col] += val_AT * on_proc->vals[k];
-                if (next[col] == -1)
-                {
-                    next[col] = head;
-                    head = col;
-                    length++;
-                }
-            }
-
-            row_start = off_proc->idx1[col_AT];
-            row_end = off_proc->idx1[col_AT+1];
-            for (int k = row_start; k < row_end; k++)
-            {
-                col = off_proc->idx2[k] + on_proc_num_cols;
-                sums[col] += val_AT * off_proc->vals[k];
-                if (next[col] == -1)
-                {
-                    next[col] = head;
-                    head = col;
-                    length++;
-                }
-            }
+            global_cols[i] = off_proc_column_map[Ctmp->idx2[i] - on_proc_num_cols];
         }
-
-        for (int j = 0; j < length; j++)
+        else
         {
-            val = sums[head];
-            if (fabs(val) > zero_tol)
-            {
-                // Add global_col (need to know if on_proc for this)
-                if (head >= on_proc_num_cols)
-                {
-                    Ctmp->idx2.push_back(off_proc_column_map[head - on_proc_num_cols]);
-                }
-                else
-                {
-                    Ctmp->idx2.push_back(on_proc_column_map[head]);
-                }
-                Ctmp->vals.push_back(val);
-            }
-            tmp = head;
-            head = next[head];
-            next[tmp] = -1;
-            sums[tmp] = 0;
+            global_cols[i] = on_proc_column_map[Ctmp->idx2[i]];
         }
-        Ctmp->idx1[i+1] = Ctmp->idx2.size();
     }
-    Ctmp->nnz = Ctmp->idx2.size();
 
     return Ctmp;
 }
 
 // A_T * self
-CSRMatrix* ParCSRMatrix::mult_T_partial(ParCSCMatrix* A)
+CSRMatrix* ParCSRMatrix::mult_T_partial(ParCSCMatrix* A, 
+        aligned_vector<index_t>& global_cols)
 {
     // Declare Variables
-    return mult_T_partial((CSCMatrix*) A->off_proc); 
+    return mult_T_partial((CSCMatrix*) A->off_proc, global_cols); 
 }
 
 void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* recv_on, 
-        CSRMatrix* recv_off)
+        CSRMatrix* recv_off, const aligned_vector<index_t>& recv_off_cols)
 { 
-    int head, length, tmp;
-    int row_start_PT, row_end_PT;
-    int row_start, row_end;
-    
-    int col_PT, col, col_C;
-    
-    
-    double val_PT, val;
-
-    aligned_vector<double> sums;
-    aligned_vector<int> next;
+    int col, col_C;
 
     // Set dimensions of C
     C->global_num_rows = P->global_num_cols; // AT global rows
@@ -649,12 +983,6 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     C->on_proc->n_rows = P->on_proc->n_cols;
     C->on_proc->n_cols = on_proc->n_cols;
     C->on_proc->nnz = 0;
-    C->on_proc->idx1.resize(C->local_num_rows + 1);
-    if (local_nnz)
-    {
-        C->on_proc->idx2.reserve(local_nnz);
-        C->on_proc->vals.reserve(local_nnz);
-    }
 
     C->on_proc_column_map = get_on_proc_column_map();
     C->local_row_map = P->get_on_proc_column_map();
@@ -664,85 +992,23 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     int* part_to_col = map_partition_to_local();
     for (aligned_vector<int>::iterator it = recv_on->idx2.begin();
             it != recv_on->idx2.end(); ++it)
-    {
-        *it = part_to_col[(*it - partition->first_local_col)];
-    }
-    delete[] part_to_col;
-
-    // Multiply
-    if (on_proc_num_cols)
-    {
-        sums.resize(on_proc_num_cols, 0);
-        next.resize(on_proc_num_cols, -1);
-    }
-
-    // Multiply P->on_proc * (B->on_proc + recv_on)
-    C->on_proc->idx1[0] = 0;
-    for (int i = 0; i < P->on_proc_num_cols; i++)
-    {
-        head = -2;
-        length = 0;
-
-        row_start_PT = P->on_proc->idx1[i];
-        row_end_PT = P->on_proc->idx1[i+1];
-        for (int j = row_start_PT; j < row_end_PT; j++)
-        {
-            col_PT = P->on_proc->idx2[j];
-            val_PT = P->on_proc->vals[j];
-
-            row_start = on_proc->idx1[col_PT];
-            row_end = on_proc->idx1[col_PT+1];
-            for (int k = row_start; k < row_end; k++)
-            {
-                col = on_proc->idx2[k];
-                sums[col] += val_PT * on_proc->vals[k];
-                if (next[col] == -1)
-                {
-                    next[col] = head;
-                    head = col;
-                    length++;
-                }
-            }
-        }
-
-        row_start = recv_on->idx1[i];
-        row_end = recv_on->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            col = recv_on->idx2[j];
-            sums[col] += recv_on->vals[j];
-            if (next[col] == -1)
-            {
-                next[col] = head;
-                head = col;
-                length++;
-            }          
-        }
-
-        // Add sums to C and update rowptrs
-        for (int j = 0; j < length; j++)
-        {
-            val = sums[head];
-            if (fabs(val) > zero_tol)
-            {
-                C->on_proc->idx2.push_back(head);
-                C->on_proc->vals.push_back(val);
-            }
-            tmp = head;
-            head = next[head];
-            next[tmp] = -1;
-            sums[tmp] = 0;
-        }
-        C->on_proc->idx1[i+1] = C->on_proc->idx2.size();
+    {
+        *it = part_to_col[*it];
     }
-    C->on_proc->nnz = C->on_proc->idx2.size();
+    delete[] part_to_col;
+
+    // Multiply P->on_proc * (B->on_proc + recv_on)
+    aligned_vector<SpGEMMTerm> terms(2);
+    terms[0] = SpGEMMTerm(P->on_proc, on_proc);
+    terms[1] = SpGEMMTerm(NULL, recv_on);
+    spgemm_rows(C->local_num_rows, C->on_proc->n_cols, terms, (CSRMatrix*) C->on_proc);
 
 
     /******************************
      * Form off_proc
      ******************************/
     // Calculate global_to_C and map_to_C column maps
-    std::map<int, int> global_to_C;
+    std::map<index_t, int> global_to_C;
     aligned_vector<int> map_to_C;
     if (off_proc_num_cols)
     {
@@ -750,13 +1016,13 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     }
 
     // Create set of global columns in B_off_proc and recv_mat
-    std::set<int> C_col_set;
-    for (aligned_vector<int>::iterator it = recv_off->idx2.begin(); 
-            it != recv_off->idx2.end(); ++it)
+    std::set<index_t> C_col_set;
+    for (aligned_vector<index_t>::const_iterator it = recv_off_cols.begin(); 
+            it != recv_off_cols.end(); ++it)
     {
         C_col_set.insert(*it);
     }
-    for (aligned_vector<int>::iterator it = off_proc_column_map.begin(); 
+    for (aligned_vector<index_t>::iterator it = off_proc_column_map.begin(); 
             it != off_proc_column_map.end(); ++it)
     {
         C_col_set.insert(*it);
@@ -767,7 +1033,7 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     {
         C->off_proc_column_map.reserve(C->off_proc_num_cols);
     }
-    for (std::set<int>::iterator it = C_col_set.begin(); 
+    for (std::set<index_t>::iterator it = C_col_set.begin(); 
             it != C_col_set.end(); ++it)
     {
         global_to_C[*it] = C->off_proc_column_map.size();
@@ -775,7 +1041,7 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     }
 
     // Map local off_proc_cols to C->off_proc_column_map
-    for (aligned_vector<int>::iterator it = off_proc_column_map.begin();
+    for (aligned_vector<index_t>::iterator it = off_proc_column_map.begin();
             it != off_proc_column_map.end(); ++it)
     {
         col_C = global_to_C[*it];
@@ -783,10 +1049,10 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     }
 
     // Update recvd cols from global_col to local col in C
-    for (aligned_vector<int>::iterator it = recv_off->idx2.begin();
-            it != recv_off->idx2.end(); ++it)
+    recv_off->idx2.resize(recv_off_cols.size());
+    for (int i = 0; i < (int) recv_off_cols.size(); i++)
     {
-        *it = global_to_C[*it];
+        recv_off->idx2[i] = global_to_C[recv_off_cols[i]];
     }
 
 
@@ -794,78 +1060,11 @@ void ParCSRMatrix::mult_T_combine(ParCSCMatrix* P, ParCSRMatrix* C, CSRMatrix* r
     C->off_proc->n_rows = C->local_num_rows;
     C->off_proc->n_cols = C->off_proc_num_cols;
     C->off_proc->nnz = 0;
-    C->off_proc->idx1.resize(C->local_num_rows + 1);
-    if (local_nnz)
-    {
-        C->off_proc->idx2.reserve(local_nnz);
-        C->off_proc->vals.reserve(local_nnz);
-    }
 
     // Multiply A->on_proc * (B->off_proc) + recv_off
-    if (C->off_proc_num_cols)
-    {
-        sums.resize(C->off_proc_num_cols, 0);
-        next.resize(C->off_proc_num_cols, -1);
-    }
-    C->off_proc->idx1[0] = 0;
-    for (int i = 0; i < P->on_proc_num_cols; i++)
-    {
-        head = -2;
-        length = 0;
-
-        row_start_PT = P->on_proc->idx1[i];
-        row_end_PT = P->on_proc->idx1[i+1];
-        for (int j = row_start_PT; j < row_end_PT; j++)
-        {
-            col_PT = P->on_proc->idx2[j];
-            val_PT = P->on_proc->vals[j];
-
-            row_start = off_proc->idx1[col_PT];
-            row_end = off_proc->idx1[col_PT+1];
-            for (int k = row_start; k < row_end; k++)
-            {
-                col = off_proc->idx2[k];
-                col_C = map_to_C[col];
-                sums[col_C] += val_PT * off_proc->vals[k];
-                if (next[col_C] == -1)
-                {
-                    next[col_C] = head;
-                    head = col_C;
-                    length++;
-                }
-            }
-        }
-
-
-        row_start = recv_off->idx1[i];
-        row_end = recv_off->idx1[i+1];
-        for (int j = row_start; j < row_end; j++)
-        {
-            col = recv_off->idx2[j]; // Already mapped to column in C
-            sums[col] += recv_off->vals[j];
-            if (next[col] == -1)
-            {
-                next[col] = head;
-                head = col;
-                length++;
-            }
-        }
-        for (int j = 0; j < length; j++)
-        {
-            val = sums[head];
-            if (fabs(val) > zero_tol)
-            {
-                C->off_proc->idx2.push_back(head);
-                C->off_proc->vals.push_back(val);
-            }
-            tmp = head;
-            head = next[head];
-            next[tmp] = -1;
-            sums[tmp] = 0;
-        }
-        C->off_proc->idx1[i+1] = C->off_proc->idx2.size();
-    }
-    C->off_proc->nnz = C->off_proc->idx2.size();
+    terms[0] = SpGEMMTerm(P->on_proc, off_proc, map_to_C.data());
+    terms[1] = SpGEMMTerm(NULL, recv_off);
+    spgemm_rows(C->local_num_rows, C->off_proc->n_cols, terms, (CSRMatrix*) C->off_proc);
 
     C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
 
@@ -1179,7 +1378,8 @@ void ParCSRMatrix::print_mult_T(ParCSCMatrix* A, const aligned_vector<int>& proc
     ranks_per_socket = A->comm->topology->PPN / 2;
     rank_socket = rank / ranks_per_socket;
 
-    CSRMatrix* Ctmp = mult_T_partial(A);
+    aligned_vector<index_t> Ctmp_cols;
+    CSRMatrix* Ctmp = mult_T_partial(A, Ctmp_cols);
 
     // Communicate data and multiply
     // Will communicate the rows of B based on comm
@@ -1353,26 +1553,591 @@ void ParCSRMatrix::print_mult_T(ParCSCMatrix* A, const aligned_vector<int>& proc
 }
 
 
+// Splits block rows, received with global block columns recv_cols and 
+// b_size values per block, into blocks with block columns in 
+// [first_block, last_block], stored with local block columns in on_*, 
+// and all other blocks, with global block columns in off_*.
+static void split_blocks(const CSRMatrix* recv, 
+        const aligned_vector<index_t>& recv_cols, int n_block_rows,
+        int b_size, index_t first_block, index_t last_block,
+        aligned_vector<int>& on_rowptr, aligned_vector<int>& on_cols,
+        aligned_vector<double>& on_vals, aligned_vector<int>& off_rowptr, 
+        aligned_vector<index_t>& off_cols, aligned_vector<double>& off_vals)
+{
+    int start, end;
+    index_t global_block;
+
+    on_rowptr.resize(n_block_rows + 1);
+    off_rowptr.resize(n_block_rows + 1);
+    on_rowptr[0] = 0;
+    off_rowptr[0] = 0;
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        start = recv->idx1[i];
+        end = recv->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            global_block = recv_cols[j];
+            if (global_block >= first_block && global_block <= last_block)
+            {
+                on_cols.push_back(global_block - first_block);
+                on_vals.insert(on_vals.end(), recv->vals.begin() + j * b_size,
+                        recv->vals.begin() + (j+1) * b_size);
+            }
+            else
+            {
+                off_cols.push_back(global_block);
+                off_vals.insert(off_vals.end(), recv->vals.begin() + j * b_size,
+                        recv->vals.begin() + (j+1) * b_size);
+            }
+        }
+        on_rowptr[i+1] = on_cols.size();
+        off_rowptr[i+1] = off_cols.size();
+    }
+}
+
+// Forms the off_proc block columns of C from a sorted list of global 
+// block columns, expanding each to b_cols scalar columns, and maps each
+// global block column to its block column in C
+static void set_block_column_map(ParBSRMatrix* C, aligned_vector<index_t>& blocks,
+        std::map<index_t, int>& global_to_C)
+{
+    std::sort(blocks.begin(), blocks.end());
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+
+    C->off_proc_column_map.clear();
+    for (int i = 0; i < (int) blocks.size(); i++)
+    {
+        global_to_C[blocks[i]] = i;
+        for (int c = 0; c < C->b_cols; c++)
+        {
+            C->off_proc_column_map.push_back(blocks[i] * C->b_cols + c);
+        }
+    }
+    C->off_proc_num_cols = C->off_proc_column_map.size();
+}
+
 ParBSRMatrix* ParBSRMatrix::mult(ParBSRMatrix* B, bool tap, data_t* comm_t)
 {
-    // NOT IMPLEMENTED
-    return NULL;
+    if (tap)
+    {
+        return this->tap_mult(B, comm_t);
+    }
+
+    // Initialize C (matrix to be returned)
+    ParBSRMatrix* C;
+    if (partition == B->partition)
+    {
+        C = new ParBSRMatrix(partition, b_rows, B->b_cols);
+    }
+    else
+    {
+        Partition* part = new Partition(partition, B->partition);
+        C = new ParBSRMatrix(part, b_rows, B->b_cols);
+        part->num_shared = 0;
+    }
+
+    // Communicate data and multiply
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = get_block_comm()->communicate(B, recv_cols);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    mult_helper(B, C, recv_mat, recv_cols);
+    delete recv_mat;
+
+    // Return matrix containing product
+    return C;
 }
 
 ParBSRMatrix* ParBSRMatrix::tap_mult(ParBSRMatrix* B, data_t* comm_t)
 {
-    // NOT IMPLEMENTED
-    return NULL;
+    // Initialize C (matrix to be returned)
+    ParBSRMatrix* C;
+    if (partition == B->partition)
+    {
+        C = new ParBSRMatrix(partition, b_rows, B->b_cols);
+    }
+    else
+    {
+        Partition* part = new Partition(partition, B->partition);
+        C = new ParBSRMatrix(part, b_rows, B->b_cols);
+        part->num_shared = 0;
+    }
+
+    // Communicate data and multiply
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = get_block_comm(true)->communicate(B, recv_cols);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    mult_helper(B, C, recv_mat, recv_cols);
+    delete recv_mat;
+
+    // Return matrix containing product
+    return C;
 }
 
-ParBSRMatrix* ParBSRMatrix::mult_T(ParBSRMatrix* B, bool tap, data_t* comm_t)
+ParBSRMatrix* ParBSRMatrix::mult_T(ParBSRMatrix* A, bool tap, data_t* comm_t)
 {
-    // NOT IMPLEMENTED
-    return NULL;
+    if (tap)
+    {
+        return this->tap_mult_T(A, comm_t);
+    }
+
+    // Initialize C (matrix to be returned) : rows of C are the 
+    // columns of A
+    Partition* part_T = A->partition->transpose();
+    Partition* part = new Partition(part_T, partition);
+    ParBSRMatrix* C = new ParBSRMatrix(part, A->b_cols, b_cols);
+    part->num_shared = 0;
+    delete part_T;
+
+    aligned_vector<index_t> Ctmp_cols;
+    BSRMatrix* Ctmp = mult_T_partial(A, Ctmp_cols);
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = A->get_block_comm()->communicate_T_blocks(Ctmp->idx1, 
+            Ctmp_cols, Ctmp->vals, Ctmp->b_size, A->on_proc_num_cols / A->b_cols, 
+            recv_cols);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    mult_T_combine(A, C, recv_mat, recv_cols);
+
+    // Clean up
+    delete Ctmp;
+    delete recv_mat;
+
+    // Return matrix containing product
+    return C;
 }
 
-ParBSRMatrix* ParBSRMatrix::tap_mult_T(ParBSRMatrix* B, data_t* comm_t)
+ParBSRMatrix* ParBSRMatrix::tap_mult_T(ParBSRMatrix* A, data_t* comm_t)
 {
-    // NOT IMPLEMENTED
-    return NULL;
+    // Initialize C (matrix to be returned) : rows of C are the 
+    // columns of A
+    Partition* part_T = A->partition->transpose();
+    Partition* part = new Partition(part_T, partition);
+    ParBSRMatrix* C = new ParBSRMatrix(part, A->b_cols, b_cols);
+    part->num_shared = 0;
+    delete part_T;
+
+    aligned_vector<index_t> Ctmp_cols;
+    BSRMatrix* Ctmp = mult_T_partial(A, Ctmp_cols);
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = A->get_block_comm(true)->communicate_T_blocks(Ctmp->idx1, 
+            Ctmp_cols, Ctmp->vals, Ctmp->b_size, A->on_proc_num_cols / A->b_cols, 
+            recv_cols);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    mult_T_combine(A, C, recv_mat, recv_cols);
+
+    // Clean up
+    delete Ctmp;
+    delete recv_mat;
+
+    // Return matrix containing product
+    return C;
+}
+
+// Appends the blocks of block row i of (rowptr, cols, vals) to the 
+// on_proc (local block columns [0, n_on)) or off_proc portion, with 
+// off_proc block columns mapped by global_to_C
+static void split_block_row(int i, const aligned_vector<int>& rowptr,
+        const aligned_vector<index_t>& cols, const aligned_vector<double>& vals,
+        int b_size, index_t first_block, int n_on, 
+        std::map<index_t, int>& global_to_C, aligned_vector<int>& on_cols, 
+        aligned_vector<double>& on_vals, aligned_vector<int>& off_cols,
+        aligned_vector<double>& off_vals)
+{
+    index_t global_block;
+    for (int j = rowptr[i]; j < rowptr[i+1]; j++)
+    {
+        global_block = cols[j];
+        if (global_block >= first_block && global_block < first_block + n_on)
+        {
+            on_cols.push_back(global_block - first_block);
+            on_vals.insert(on_vals.end(), vals.begin() + j * b_size,
+                    vals.begin() + (j+1) * b_size);
+        }
+        else
+        {
+            off_cols.push_back(global_to_C[global_block]);
+            off_vals.insert(off_vals.end(), vals.begin() + j * b_size,
+                    vals.begin() + (j+1) * b_size);
+        }
+    }
+}
+
+ParBSRMatrix* ParBSRMatrix::RAP(ParBSRMatrix* P, bool tap, data_t* comm_t)
+{
+    int col;
+    int b_P = P->b_cols;
+    int n_on = P->on_proc_num_cols / b_P;
+    int n_P_off = P->off_proc_column_map.size() / b_P;
+    int n_block_rows = local_num_rows / b_rows;
+    index_t first_block = P->partition->first_local_col / b_P;
+    index_t global_block;
+
+    // Initialize C (matrix to be returned) : rows and columns of C are
+    // the columns of P
+    Partition* part_T = P->partition->transpose();
+    Partition* part = new Partition(part_T, P->partition);
+    ParBSRMatrix* C = new ParBSRMatrix(part, b_P, b_P);
+    part->num_shared = 0;
+    delete part_T;
+
+    // Communicate block rows of P corresponding to off_proc block 
+    // columns of A
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<index_t> recv_cols;
+    CSRMatrix* recv_mat = get_block_comm(tap)->communicate(P, recv_cols);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    // Block columns of AP : on_proc block columns of P, followed by the
+    // union of off_proc block columns of P and those received
+    std::map<index_t, int> global_to_AP;
+    aligned_vector<index_t> AP_off_blocks(n_P_off);
+    for (int i = 0; i < n_P_off; i++)
+    {
+        AP_off_blocks[i] = P->off_proc_column_map[i * b_P] / b_P;
+    }
+    for (aligned_vector<index_t>::iterator it = recv_cols.begin();
+            it != recv_cols.end(); ++it)
+    {
+        if (*it < first_block || *it >= first_block + n_on)
+        {
+            AP_off_blocks.push_back(*it);
+        }
+    }
+    std::sort(AP_off_blocks.begin(), AP_off_blocks.end());
+    AP_off_blocks.erase(std::unique(AP_off_blocks.begin(), AP_off_blocks.end()),
+            AP_off_blocks.end());
+    for (int i = 0; i < (int) AP_off_blocks.size(); i++)
+    {
+        global_to_AP[AP_off_blocks[i]] = n_on + i;
+    }
+    int n_AP = n_on + AP_off_blocks.size();
+
+    aligned_vector<int> P_off_to_AP(n_P_off);
+    for (int i = 0; i < n_P_off; i++)
+    {
+        P_off_to_AP[i] = global_to_AP[P->off_proc_column_map[i * b_P] / b_P];
+    }
+    aligned_vector<int> recv_AP_cols(recv_cols.size());
+    for (int i = 0; i < (int) recv_cols.size(); i++)
+    {
+        global_block = recv_cols[i];
+        if (global_block < first_block || global_block >= first_block + n_on)
+        {
+            recv_AP_cols[i] = global_to_AP[global_block];
+        }
+        else
+        {
+            recv_AP_cols[i] = global_block - first_block;
+        }
+    }
+
+    // Block rows of AP : A_on * P_on + A_on * P_off + A_off * recv_mat
+    aligned_vector<BSRSpGEMMTerm> terms(3);
+    terms[0] = BSRSpGEMMTerm((BSRMatrix*) on_proc, (BSRMatrix*) P->on_proc);
+    terms[1] = BSRSpGEMMTerm((BSRMatrix*) on_proc, (BSRMatrix*) P->off_proc, 
+            P_off_to_AP.data());
+    terms[2] = BSRSpGEMMTerm((BSRMatrix*) off_proc, recv_mat->idx1, recv_AP_cols,
+            recv_mat->vals, b_cols);
+
+    // Contributions to block rows of C owned by other processes 
+    // (P_off^T * AP), formed without storing AP
+    BSRMatrix* P_off_T = (BSRMatrix*) P->off_proc->transpose();
+    BSRMatrix* Ctmp = new BSRMatrix(P_off_T->n_rows, n_AP * b_P, b_P, b_P, 1);
+    bsr_rap_rows(P_off_T, n_block_rows, terms, n_AP, Ctmp);
+    delete P_off_T;
+    aligned_vector<index_t> Ctmp_cols(Ctmp->idx2.size());
+    for (int i = 0; i < (int) Ctmp->idx2.size(); i++)
+    {
+        col = Ctmp->idx2[i];
+        if (col < n_on) Ctmp_cols[i] = first_block + col;
+        else Ctmp_cols[i] = AP_off_blocks[col - n_on];
+    }
+
+    // Send remote contributions to their owners, and form local block
+    // rows of C (P_on^T * AP)
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<index_t> recv_C_cols;
+    CSRMatrix* recv_C = P->get_block_comm(tap)->communicate_T_blocks(Ctmp->idx1, 
+            Ctmp_cols, Ctmp->vals, Ctmp->b_size, n_on, recv_C_cols);
+    if (comm_t) *comm_t += MPI_Wtime();
+    delete Ctmp;
+
+    BSRMatrix* P_on_T = (BSRMatrix*) P->on_proc->transpose();
+    BSRMatrix* C_loc = new BSRMatrix(P_on_T->n_rows, n_AP * b_P, b_P, b_P, 1);
+    bsr_rap_rows(P_on_T, n_block_rows, terms, n_AP, C_loc);
+    delete P_on_T;
+    delete recv_mat;
+
+    // Set dimensions of C
+    C->global_num_rows = P->global_num_cols;
+    C->global_num_cols = P->global_num_cols;
+    C->local_num_rows = P->on_proc_num_cols;
+    C->on_proc_column_map = P->get_on_proc_column_map();
+    C->local_row_map = P->get_on_proc_column_map();
+    C->on_proc_num_cols = P->on_proc_num_cols;
+
+    // Off_proc block columns of C : union of those in C_loc and recv_C
+    aligned_vector<index_t> loc_cols(C_loc->idx2.size());
+    aligned_vector<index_t> C_blocks;
+    for (int i = 0; i < (int) C_loc->idx2.size(); i++)
+    {
+        col = C_loc->idx2[i];
+        if (col < n_on) loc_cols[i] = first_block + col;
+        else 
+        {
+            loc_cols[i] = AP_off_blocks[col - n_on];
+            C_blocks.push_back(loc_cols[i]);
+        }
+    }
+    for (aligned_vector<index_t>::iterator it = recv_C_cols.begin();
+            it != recv_C_cols.end(); ++it)
+    {
+        if (*it < first_block || *it >= first_block + n_on) C_blocks.push_back(*it);
+    }
+    std::map<index_t, int> global_to_C;
+    set_block_column_map(C, C_blocks, global_to_C);
+
+    // Split C_loc and recv_C into on_proc and off_proc portions
+    int b_size_C = b_P * b_P;
+    aligned_vector<int> on_rowptr(n_on + 1);
+    aligned_vector<int> off_rowptr(n_on + 1);
+    aligned_vector<int> on_cols, off_cols;
+    aligned_vector<double> on_vals, off_vals;
+    on_rowptr[0] = 0;
+    off_rowptr[0] = 0;
+    for (int i = 0; i < n_on; i++)
+    {
+        split_block_row(i, C_loc->idx1, loc_cols, C_loc->vals, b_size_C, 
+                first_block, n_on, global_to_C, on_cols, on_vals, 
+                off_cols, off_vals);
+        split_block_row(i, recv_C->idx1, recv_C_cols, recv_C->vals, b_size_C,
+                first_block, n_on, global_to_C, on_cols, on_vals, 
+                off_cols, off_vals);
+        on_rowptr[i+1] = on_cols.size();
+        off_rowptr[i+1] = off_cols.size();
+    }
+    delete C_loc;
+    delete recv_C;
+
+    // Sum duplicate blocks
+    BSRMatrix* C_on = (BSRMatrix*) C->on_proc;
+    C_on->n_rows = C->local_num_rows;
+    C_on->n_cols = C->on_proc_num_cols;
+    terms.resize(1);
+    terms[0] = BSRSpGEMMTerm(NULL, on_rowptr, on_cols, on_vals, 0);
+    bsr_spgemm_rows(n_on, n_on, terms, C_on);
+
+    BSRMatrix* C_off = (BSRMatrix*) C->off_proc;
+    C_off->n_rows = C->local_num_rows;
+    C_off->n_cols = C->off_proc_num_cols;
+    terms[0] = BSRSpGEMMTerm(NULL, off_rowptr, off_cols, off_vals, 0);
+    bsr_spgemm_rows(n_on, C->off_proc_num_cols / b_P, terms, C_off);
+
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+
+    // Return matrix containing product
+    return C;
+}
+
+void ParBSRMatrix::mult_helper(ParBSRMatrix* B, ParBSRMatrix* C, CSRMatrix* recv_mat,
+        const aligned_vector<index_t>& recv_cols)
+{
+    int n_block_rows = local_num_rows / b_rows;
+    int n_recv_blocks = off_proc_column_map.size() / b_cols;
+    int n_B_off_blocks = B->off_proc_column_map.size() / B->b_cols;
+
+    // Set dimensions of C
+    C->global_num_rows = global_num_rows;
+    C->global_num_cols = B->global_num_cols;
+    C->local_num_rows = local_num_rows;
+
+    C->on_proc_column_map = B->get_on_proc_column_map();
+    C->local_row_map = get_local_row_map();
+    C->on_proc_num_cols = C->on_proc_column_map.size();
+
+    // Split received block rows of B (one per off_proc block column)
+    // into on and off proc portions
+    aligned_vector<int> recv_on_rowptr;
+    aligned_vector<int> recv_on_cols;
+    aligned_vector<double> recv_on_vals;
+    aligned_vector<int> recv_off_rowptr;
+    aligned_vector<index_t> recv_off_global;
+    aligned_vector<double> recv_off_vals;
+    split_blocks(recv_mat, recv_cols, n_recv_blocks, B->b_size, 
+            B->partition->first_local_col / B->b_cols, 
+            (B->partition->last_local_col + 1) / B->b_cols - 1,
+            recv_on_rowptr, recv_on_cols, recv_on_vals, 
+            recv_off_rowptr, recv_off_global, recv_off_vals);
+
+    // Off_proc block columns of C : union of those of B and those 
+    // received
+    std::map<index_t, int> global_to_C;
+    aligned_vector<index_t> C_blocks(recv_off_global.begin(), recv_off_global.end());
+    for (int i = 0; i < n_B_off_blocks; i++)
+    {
+        C_blocks.push_back(B->off_proc_column_map[i * B->b_cols] / B->b_cols);
+    }
+    set_block_column_map(C, C_blocks, global_to_C);
+
+    aligned_vector<int> B_to_C(n_B_off_blocks);
+    for (int i = 0; i < n_B_off_blocks; i++)
+    {
+        B_to_C[i] = global_to_C[B->off_proc_column_map[i * B->b_cols] / B->b_cols];
+    }
+    aligned_vector<int> recv_off_cols(recv_off_global.size());
+    for (int i = 0; i < (int) recv_off_global.size(); i++)
+    {
+        recv_off_cols[i] = global_to_C[recv_off_global[i]];
+    }
+
+    // C->on_proc <- A_on_proc * B_on_proc + A_off_proc * recv_on
+    BSRMatrix* C_on = (BSRMatrix*) C->on_proc;
+    C_on->n_rows = local_num_rows;
+    C_on->n_cols = C->on_proc_num_cols;
+    aligned_vector<BSRSpGEMMTerm> terms(2);
+    terms[0] = BSRSpGEMMTerm((BSRMatrix*) on_proc, (BSRMatrix*) B->on_proc);
+    terms[1] = BSRSpGEMMTerm((BSRMatrix*) off_proc, recv_on_rowptr, recv_on_cols, 
+            recv_on_vals, b_cols);
+    bsr_spgemm_rows(n_block_rows, C->on_proc_num_cols / C->b_cols, terms, C_on);
+
+    // C->off_proc <- A_on_proc * B_off_proc + A_off_proc * recv_off
+    BSRMatrix* C_off = (BSRMatrix*) C->off_proc;
+    C_off->n_rows = local_num_rows;
+    C_off->n_cols = C->off_proc_num_cols;
+    terms[0] = BSRSpGEMMTerm((BSRMatrix*) on_proc, (BSRMatrix*) B->off_proc, 
+            B_to_C.data());
+    terms[1] = BSRSpGEMMTerm((BSRMatrix*) off_proc, recv_off_rowptr, recv_off_cols, 
+            recv_off_vals, b_cols);
+    bsr_spgemm_rows(n_block_rows, C->off_proc_num_cols / C->b_cols, terms, C_off);
+
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
+}
+
+// A^T * self : block rows of the product for the off_proc block columns 
+// of A, with global block columns in global_cols (to be sent to their 
+// owners)
+BSRMatrix* ParBSRMatrix::mult_T_partial(ParBSRMatrix* A, 
+        aligned_vector<index_t>& global_cols)
+{
+    int n_on_blocks = on_proc_num_cols / b_cols;
+    int n_off_blocks = off_proc_column_map.size() / b_cols;
+    int n_blocks = n_on_blocks + n_off_blocks;
+    int block;
+
+    // Off_proc block columns follow on_proc block columns in Ctmp
+    aligned_vector<int> off_to_tmp(n_off_blocks);
+    for (int i = 0; i < n_off_blocks; i++)
+    {
+        off_to_tmp[i] = i + n_on_blocks;
+    }
+
+    // Multiply (A->off_proc)^T * (on_proc + off_proc)
+    BSRMatrix* A_off_T = (BSRMatrix*) A->off_proc->transpose();
+    BSRMatrix* Ctmp = new BSRMatrix(A_off_T->n_rows, n_blocks * b_cols, 
+            A->b_cols, b_cols, 1);
+    aligned_vector<BSRSpGEMMTerm> terms(2);
+    terms[0] = BSRSpGEMMTerm(A_off_T, (BSRMatrix*) on_proc);
+    terms[1] = BSRSpGEMMTerm(A_off_T, (BSRMatrix*) off_proc, off_to_tmp.data());
+    bsr_spgemm_rows(A_off_T->n_rows / A->b_cols, n_blocks, terms, Ctmp);
+    delete A_off_T;
+
+    global_cols.resize(Ctmp->idx2.size());
+    for (int i = 0; i < (int) Ctmp->idx2.size(); i++)
+    {
+        block = Ctmp->idx2[i];
+        if (block < n_on_blocks)
+        {
+            global_cols[i] = on_proc_column_map[block * b_cols] / b_cols;
+        }
+        else
+        {
+            global_cols[i] = off_proc_column_map[(block - n_on_blocks) * b_cols] 
+                / b_cols;
+        }
+    }
+
+    return Ctmp;
+}
+
+void ParBSRMatrix::mult_T_combine(ParBSRMatrix* A, ParBSRMatrix* C, CSRMatrix* recv_mat,
+        const aligned_vector<index_t>& recv_cols)
+{
+    int n_block_rows = A->on_proc_num_cols / A->b_cols;
+    int n_off_blocks = off_proc_column_map.size() / b_cols;
+
+    // Set dimensions of C
+    C->global_num_rows = A->global_num_cols; // AT global rows
+    C->global_num_cols = global_num_cols;
+    C->local_num_rows = A->on_proc_num_cols; // AT local rows
+
+    C->on_proc_column_map = get_on_proc_column_map();
+    C->local_row_map = A->get_on_proc_column_map();
+    C->on_proc_num_cols = C->on_proc_column_map.size();
+
+    // Split received block rows into on and off proc portions
+    aligned_vector<int> recv_on_rowptr;
+    aligned_vector<int> recv_on_cols;
+    aligned_vector<double> recv_on_vals;
+    aligned_vector<int> recv_off_rowptr;
+    aligned_vector<index_t> recv_off_global;
+    aligned_vector<double> recv_off_vals;
+    split_blocks(recv_mat, recv_cols, n_block_rows, A->b_cols * b_cols, 
+            partition->first_local_col / b_cols, 
+            (partition->last_local_col + 1) / b_cols - 1,
+            recv_on_rowptr, recv_on_cols, recv_on_vals,
+            recv_off_rowptr, recv_off_global, recv_off_vals);
+
+    // Off_proc block columns of C : union of those of self and those
+    // received
+    std::map<index_t, int> global_to_C;
+    aligned_vector<index_t> C_blocks(recv_off_global.begin(), recv_off_global.end());
+    for (int i = 0; i < n_off_blocks; i++)
+    {
+        C_blocks.push_back(off_proc_column_map[i * b_cols] / b_cols);
+    }
+    set_block_column_map(C, C_blocks, global_to_C);
+
+    aligned_vector<int> map_to_C(n_off_blocks);
+    for (int i = 0; i < n_off_blocks; i++)
+    {
+        map_to_C[i] = global_to_C[off_proc_column_map[i * b_cols] / b_cols];
+    }
+    aligned_vector<int> recv_off_cols(recv_off_global.size());
+    for (int i = 0; i < (int) recv_off_global.size(); i++)
+    {
+        recv_off_cols[i] = global_to_C[recv_off_global[i]];
+    }
+
+    BSRMatrix* A_on_T = (BSRMatrix*) A->on_proc->transpose();
+
+    // C->on_proc <- (A->on_proc)^T * on_proc + recv_on
+    BSRMatrix* C_on = (BSRMatrix*) C->on_proc;
+    C_on->n_rows = C->local_num_rows;
+    C_on->n_cols = C->on_proc_num_cols;
+    aligned_vector<BSRSpGEMMTerm> terms(2);
+    terms[0] = BSRSpGEMMTerm(A_on_T, (BSRMatrix*) on_proc);
+    terms[1] = BSRSpGEMMTerm(NULL, recv_on_rowptr, recv_on_cols, recv_on_vals, 0);
+    bsr_spgemm_rows(n_block_rows, C->on_proc_num_cols / C->b_cols, terms, C_on);
+
+    // C->off_proc <- (A->on_proc)^T * off_proc + recv_off
+    BSRMatrix* C_off = (BSRMatrix*) C->off_proc;
+    C_off->n_rows = C->local_num_rows;
+    C_off->n_cols = C->off_proc_num_cols;
+    terms[0] = BSRSpGEMMTerm(A_on_T, (BSRMatrix*) off_proc, map_to_C.data());
+    terms[1] = BSRSpGEMMTerm(NULL, recv_off_rowptr, recv_off_cols, recv_off_vals, 0);
+    bsr_spgemm_rows(n_block_rows, C->off_proc_num_cols / C->b_cols, terms, C_off);
+
+    delete A_on_T;
+
+    C->local_nnz = C->on_proc->nnz + C->off_proc->nnz;
 }
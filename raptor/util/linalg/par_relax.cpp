@@ -26,160 +26,244 @@
  ***** dist_x : data_t*
  *****    Vector of distant x-values recvd from other processes
  **************************************************************/
-void SOR_forward(ParCSRMatrix* A, ParVector& x, const ParVector& y, 
-        const aligned_vector<double>& dist_x, double omega)
+inline void SOR_row(ParCSRMatrix* A, ParVector& x, const ParVector& y, 
+        const aligned_vector<double>& dist_x, const aligned_vector<double>& inv_diag,
+        double omega, int i)
 {
-    int start, end, col;
-    double diag;
-    double row_sum;
+    CSRMatrix* on_proc = (CSRMatrix*) A->on_proc;
+    CSRMatrix* off_proc = (CSRMatrix*) A->off_proc;
+
+    double res = on_proc->row_residual(i, x.local.values.data(), y[i]);
+    res = off_proc->row_residual(i, dist_x.data(), res);
+
+    x[i] += omega * inv_diag[i] * res;
+}
 
+void SOR_forward(ParCSRMatrix* A, ParVector& x, const ParVector& y, 
+        const aligned_vector<double>& dist_x, const aligned_vector<double>& inv_diag,
+        double omega)
+{
     for (int i = 0; i < A->local_num_rows; i++)
     {
-        row_sum = 0;
-        start = A->on_proc->idx1[i];
-        end = A->on_proc->idx1[i+1];
-        if (A->on_proc->idx2[start] == i)
-        {
-            diag = A->on_proc->vals[start];
-            start++;
-        }        
-        else continue;
-        for (int j = start; j < end; j++)
-        {
-            col = A->on_proc->idx2[j];
-            row_sum += A->on_proc->vals[j] * x[col];
-        }
+        SOR_row(A, x, y, dist_x, inv_diag, omega, i);
+    }
+}
 
-        start = A->off_proc->idx1[i];
-        end = A->off_proc->idx1[i+1];
-        for (int j = start; j < end; j++)
-        {
-            col = A->off_proc->idx2[j];
-            row_sum += A->off_proc->vals[j] * dist_x[col];
-        }
+void SOR_backward(ParCSRMatrix* A, ParVector& x, const ParVector& y,
+        const aligned_vector<double>& dist_x, const aligned_vector<double>& inv_diag,
+        double omega)
+{
+    for (int i = A->local_num_rows - 1; i >= 0; i--)
+    {
+        SOR_row(A, x, y, dist_x, inv_diag, omega, i);
+    }
+}
 
-        x[i] = ((1.0 - omega)*x[i]) + (omega*((y[i] - row_sum) / diag));
+// Sweeps only over the given subset of rows (e.g. interior or
+// boundary rows of A)
+void SOR_forward(ParCSRMatrix* A, ParVector& x, const ParVector& y, 
+        const aligned_vector<double>& dist_x, const aligned_vector<double>& inv_diag,
+        double omega, const aligned_vector<int>& rows)
+{
+    for (aligned_vector<int>::const_iterator it = rows.begin();
+            it != rows.end(); ++it)
+    {
+        SOR_row(A, x, y, dist_x, inv_diag, omega, *it);
     }
 }
 
 void SOR_backward(ParCSRMatrix* A, ParVector& x, const ParVector& y,
-        const aligned_vector<double>& dist_x, double omega)
+        const aligned_vector<double>& dist_x, const aligned_vector<double>& inv_diag,
+        double omega, const aligned_vector<int>& rows)
 {
-    int start, end, col;
-    double diag;
-    double row_sum;
-
-    for (int i = A->local_num_rows - 1; i >= 0; i--)
+    for (aligned_vector<int>::const_reverse_iterator it = rows.rbegin();
+            it != rows.rend(); ++it)
     {
-        row_sum = 0;
-        start = A->on_proc->idx1[i];
-        end = A->on_proc->idx1[i+1];
-        if (A->on_proc->idx2[start] == i)
-        {
-            diag = A->on_proc->vals[start];
-            start++;
-        }        
-        else continue;
-        for (int j = start; j < end; j++)
-        {
-            col = A->on_proc->idx2[j];
-            row_sum += A->on_proc->vals[j] * x[col];
-        }
+        SOR_row(A, x, y, dist_x, inv_diag, omega, *it);
+    }
+}
 
-        start = A->off_proc->idx1[i];
-        end = A->off_proc->idx1[i+1];
-        for (int j = start; j < end; j++)
-        {
-            col = A->off_proc->idx2[j];
-            row_sum += A->off_proc->vals[j] * dist_x[col];
-        }
+inline void jacobi_row(CSRMatrix* on_proc, CSRMatrix* off_proc, ParVector& x,
+        ParVector& b, ParVector& tmp, const aligned_vector<double>& dist_x,
+        const aligned_vector<double>& inv_diag, double omega, int i)
+{
+    double res = on_proc->row_residual(i, tmp.local.values.data(), b[i]);
+    res = off_proc->row_residual(i, dist_x.data(), res);
 
-        x[i] = ((1.0 - omega)*x[i]) + (omega*((y[i] - row_sum) / diag));
+    x[i] = tmp[i] + omega * inv_diag[i] * res;
+}
+
+void jacobi_rows(CSRMatrix* on_proc, CSRMatrix* off_proc, ParVector& x,
+        ParVector& b, ParVector& tmp, const aligned_vector<double>& dist_x,
+        const aligned_vector<double>& inv_diag, double omega,
+        const aligned_vector<int>& rows)
+{
+    int n_rows = rows.size();
+
+#pragma omp parallel for schedule(static)
+    for (int k = 0; k < n_rows; k++)
+    {
+        jacobi_row(on_proc, off_proc, x, b, tmp, dist_x, inv_diag, omega, rows[k]);
     }
 }
 
 void jacobi_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
-        int num_sweeps, double omega, CommPkg* comm, data_t* comm_t)
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        CommPkg* comm, bool overlap, data_t* comm_t)
 {
-    A->on_proc->sort();
-    A->off_proc->sort();
-    A->on_proc->move_diag();
-  
-    int start, end, col;
-    double diag, row_sum;
+    if (overlap) A->form_boundary_rows();
+
+    // Rows are split across threads by the (cached) partition of 
+    // the diagonal block
+    CSRMatrix* on_proc = (CSRMatrix*) A->on_proc;
+    CSRMatrix* off_proc = (CSRMatrix*) A->off_proc;
+    int num_threads = on_proc->form_thread_rows();
+    aligned_vector<int>& thread_rows = on_proc->thread_rows;
 
     for (int iter = 0; iter < num_sweeps; iter++)
     {
-        if (comm_t) *comm_t -= MPI_Wtime();
-        comm->communicate(x);
-        if (comm_t) *comm_t += MPI_Wtime();
-        aligned_vector<double>& dist_x = comm->get_recv_buffer<double>();
-        for (int i = 0; i < A->local_num_rows; i++)
+        if (overlap)
         {
-            tmp[i] = x[i];
-        }
-
-        for (int i = 0; i < A->local_num_rows; i++)
-        {    
-            diag = 0;
-            row_sum = 0;
+            // Interior rows are relaxed while halo values are in flight
+            if (comm_t) *comm_t -= MPI_Wtime();
+            comm->init_comm(x);
+            if (comm_t) *comm_t += MPI_Wtime();
 
-            start = A->on_proc->idx1[i]+1;
-            end = A->on_proc->idx1[i+1];
-            for (int j = start; j < end; j++)
+#pragma omp parallel for num_threads(num_threads) schedule(static, 1)
+            for (int t = 0; t < num_threads; t++)
             {
-                col = A->on_proc->idx2[j];
-                row_sum += A->on_proc->vals[j] * tmp[col];
+                for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+                {
+                    tmp[i] = x[i];
+                }
             }
+            jacobi_rows(on_proc, off_proc, x, b, tmp, 
+                    comm->get_recv_buffer<double>(), inv_diag, omega, 
+                    A->interior_rows);
 
-            start = A->off_proc->idx1[i];
-            end = A->off_proc->idx1[i+1];
-            for (int j = start; j < end; j++)
+            if (comm_t) *comm_t -= MPI_Wtime();
+            aligned_vector<double>& dist_x = comm->complete_comm<double>();
+            if (comm_t) *comm_t += MPI_Wtime();
+
+            jacobi_rows(on_proc, off_proc, x, b, tmp, dist_x, inv_diag, omega,
+                    A->boundary_rows);
+            continue;
+        }
+
+        if (comm_t) *comm_t -= MPI_Wtime();
+        comm->communicate(x);
+        if (comm_t) *comm_t += MPI_Wtime();
+        aligned_vector<double>& dist_x = comm->get_recv_buffer<double>();
+
+#pragma omp parallel num_threads(num_threads)
+        {
+#pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_threads; t++)
             {
-                col = A->off_proc->idx2[j];
-                row_sum += A->off_proc->vals[j] * dist_x[col];
+                for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+                {
+                    tmp[i] = x[i];
+                }
             }
 
-            if (fabs(diag) > zero_tol)
+#pragma omp for schedule(static, 1)
+            for (int t = 0; t < num_threads; t++)
             {
-                x[i] = ((1.0 - omega)*tmp[i]) + (omega*((b[i] - row_sum) / diag));
+                for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+                {    
+                    jacobi_row(on_proc, off_proc, x, b, tmp, dist_x, inv_diag,
+                            omega, i);
+                }
             }
         }
     }
 }
 
 void sor_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
-        int num_sweeps, double omega, CommPkg* comm, data_t* comm_t)
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        CommPkg* comm, bool overlap, data_t* comm_t)
 {
-    A->on_proc->sort();
-    A->off_proc->sort();
-    A->on_proc->move_diag();
+    if (overlap) A->form_boundary_rows();
 
     for (int iter = 0; iter < num_sweeps; iter++)
     {
+        if (overlap)
+        {
+            // Interior rows first (while halo values are in flight), 
+            // followed by boundary rows
+            if (comm_t) *comm_t -= MPI_Wtime();
+            comm->init_comm(x);
+            if (comm_t) *comm_t += MPI_Wtime();
+            SOR_forward(A, x, b, comm->get_recv_buffer<double>(), inv_diag,
+                    omega, A->interior_rows);
+            if (comm_t) *comm_t -= MPI_Wtime();
+            aligned_vector<double>& dist_x = comm->complete_comm<double>();
+            if (comm_t) *comm_t += MPI_Wtime();
+            SOR_forward(A, x, b, dist_x, inv_diag, omega, A->boundary_rows);
+            continue;
+        }
+
         if (comm_t) *comm_t -= MPI_Wtime();
         comm->communicate(x);
         if (comm_t) *comm_t += MPI_Wtime();
-        SOR_forward(A, x, b, comm->get_recv_buffer<double>(), omega);
+        SOR_forward(A, x, b, comm->get_recv_buffer<double>(), inv_diag, omega);
     }
 }
 
 
 void ssor_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
-        int num_sweeps, double omega, CommPkg* comm, data_t* comm_t)
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        CommPkg* comm, bool overlap, data_t* comm_t)
 {
-    A->on_proc->sort();
-    A->off_proc->sort();
-    A->on_proc->move_diag();
+    if (overlap) A->form_boundary_rows();
 
     for (int iter = 0; iter < num_sweeps; iter++)
     {
+        if (overlap)
+        {
+            // Forward sweep over interior then boundary rows, and 
+            // backward sweep in the reverse order
+            if (comm_t) *comm_t -= MPI_Wtime();
+            comm->init_comm(x);
+            if (comm_t) *comm_t += MPI_Wtime();
+            SOR_forward(A, x, b, comm->get_recv_buffer<double>(), inv_diag,
+                    omega, A->interior_rows);
+            if (comm_t) *comm_t -= MPI_Wtime();
+            aligned_vector<double>& dist_x = comm->complete_comm<double>();
+            if (comm_t) *comm_t += MPI_Wtime();
+            SOR_forward(A, x, b, dist_x, inv_diag, omega, A->boundary_rows);
+            SOR_backward(A, x, b, dist_x, inv_diag, omega, A->boundary_rows);
+            SOR_backward(A, x, b, dist_x, inv_diag, omega, A->interior_rows);
+            continue;
+        }
+
         if (comm_t) *comm_t -= MPI_Wtime();
         comm->communicate(x);
         if (comm_t) *comm_t += MPI_Wtime();
-        SOR_forward(A, x, b, comm->get_recv_buffer<double>(), omega);
-        SOR_backward(A, x, b, comm->get_recv_buffer<double>(), omega);
+        SOR_forward(A, x, b, comm->get_recv_buffer<double>(), inv_diag, omega);
+        SOR_backward(A, x, b, comm->get_recv_buffer<double>(), inv_diag, omega);
+    }
+}
+
+// Communication package used for relaxation, formed if needed
+CommPkg* relax_comm(ParCSRMatrix* A, bool tap)
+{
+    if (tap)
+    {
+        if (!A->tap_comm) 
+        {
+            A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
+                    A->on_proc_column_map);
+        }
+        return A->tap_comm;
+    }
+
+    if (!A->comm) 
+    {
+        A->comm = new ParComm(A->partition, A->off_proc_column_map,
+                A->on_proc_column_map);
     }
+    return A->comm;
 }
 
 /**************************************************************
@@ -191,88 +275,464 @@ void ssor_helper(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
  ***** -------------
  ***** l: Level*
  *****    Level in hierarchy to be relaxed
+ ***** inv_diag : aligned_vector<double>&
+ *****    Inverse (l1-)diagonal from form_inv_diag.  If not passed, 
+ *****    the inverse diagonal is formed on each call.
  ***** num_sweeps : int
  *****    Number of relaxation sweeps to perform
+ ***** overlap : bool
+ *****    Relax interior rows while communicating off_proc values
  **************************************************************/
 void jacobi(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
-        int num_sweeps, double omega, bool tap, data_t* comm_t)
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        bool tap, data_t* comm_t, bool overlap)
 {
-    CommPkg* comm;
-    if (tap)
+    jacobi_helper(A, x, b, tmp, inv_diag, num_sweeps, omega, relax_comm(A, tap),
+            overlap, comm_t);
+}
+void sor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        bool tap, data_t* comm_t, bool overlap)
+{
+    sor_helper(A, x, b, tmp, inv_diag, num_sweeps, omega, relax_comm(A, tap),
+            overlap, comm_t);
+}
+void ssor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        bool tap, data_t* comm_t, bool overlap)
+{
+    ssor_helper(A, x, b, tmp, inv_diag, num_sweeps, omega, relax_comm(A, tap),
+            overlap, comm_t);
+}
+
+void jacobi(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        int num_sweeps, double omega, bool tap, data_t* comm_t, bool overlap)
+{
+    aligned_vector<double> inv_diag;
+    form_inv_diag(A, inv_diag);
+    jacobi(A, x, b, tmp, inv_diag, num_sweeps, omega, tap, comm_t, overlap);
+}
+void sor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        int num_sweeps, double omega, bool tap, data_t* comm_t, bool overlap)
+{
+    aligned_vector<double> inv_diag;
+    form_inv_diag(A, inv_diag);
+    sor(A, x, b, tmp, inv_diag, num_sweeps, omega, tap, comm_t, overlap);
+}
+void ssor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        int num_sweeps, double omega, bool tap, data_t* comm_t, bool overlap)
+{
+    aligned_vector<double> inv_diag;
+    form_inv_diag(A, inv_diag);
+    ssor(A, x, b, tmp, inv_diag, num_sweeps, omega, tap, comm_t, overlap);
+}
+
+/**************************************************************
+ *****  Form Inverse Diagonal
+ **************************************************************
+ ***** Forms the inverse of the diagonal used by relax_type (zero 
+ ***** for rows with a zero diagonal):
+ *****    - L1Jacobi : l1 norm of the row
+ *****    - L1SOR : diagonal plus l1 norm of the off_proc row, the 
+ *****          part relaxed with Jacobi in hybrid Gauss-Seidel
+ *****    - otherwise : diagonal
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Matrix to be relaxed
+ ***** inv_diag : aligned_vector<double>&
+ *****    Returns inverse diagonal, of size A->local_num_rows
+ ***** relax_type : relax_t
+ *****    Relaxation method 
+ **************************************************************/
+void form_inv_diag(ParCSRMatrix* A, aligned_vector<double>& inv_diag,
+        relax_t relax_type)
+{
+    int start, end;
+    double diag, off_sum;
+
+    inv_diag.resize(A->local_num_rows);
+
+#pragma omp parallel for private(start, end, diag, off_sum) schedule(static)
+    for (int i = 0; i < A->local_num_rows; i++)
     {
-        if (!A->tap_comm) 
+        diag = 0.0;
+        off_sum = 0.0;
+        start = A->on_proc->idx1[i];
+        end = A->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
         {
-            A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map);
+            if (A->on_proc->idx2[j] == i) diag = A->on_proc->vals[j];
+            else if (relax_type == L1Jacobi) off_sum += fabs(A->on_proc->vals[j]);
         }
-        comm = A->tap_comm;
+
+        if (relax_type == L1Jacobi || relax_type == L1SOR)
+        {
+            start = A->off_proc->idx1[i];
+            end = A->off_proc->idx1[i+1];
+            for (int j = start; j < end; j++)
+            {
+                off_sum += fabs(A->off_proc->vals[j]);
+            }
+            diag = fabs(diag) + off_sum;
+        }
+
+        if (fabs(diag) > zero_tol) inv_diag[i] = 1.0 / diag;
+        else inv_diag[i] = 0.0;
     }
-    else
+}
+
+/**************************************************************
+ *****  Block Jacobi
+ **************************************************************
+ ***** Relaxes a ParBSRMatrix with the inverted diagonal blocks
+ ***** of on_proc, using the block size specialized kernels of
+ ***** BSRMatrix for the residual and the block updates
+ **************************************************************/
+void form_inv_diag_blocks(ParBSRMatrix* A, aligned_vector<double>& inv_diag)
+{
+    ((BSRMatrix*) A->on_proc)->form_inv_diag_blocks(inv_diag);
+}
+
+void block_jacobi(ParBSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        bool tap, data_t* comm_t)
+{
+    BSRMatrix* on_proc = (BSRMatrix*) A->on_proc;
+
+    for (int iter = 0; iter < num_sweeps; iter++)
     {
-        if (!A->comm) 
+        A->residual(x, b, tmp, tap, comm_t);
+        if (A->local_num_rows)
         {
-            A->comm = new ParComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map);
+            on_proc->apply_inv_diag_blocks(inv_diag, tmp.local.values.data(),
+                    x.local.values.data(), omega);
         }
-        comm = A->comm;
     }
-
-    jacobi_helper(A, x, b, tmp, num_sweeps, omega, comm, comm_t);
 }
-void sor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
-        int num_sweeps, double omega, bool tap, data_t* comm_t)
+
+// Largest eigenvalue of the symmetric tridiagonal matrix with diagonal
+// alpha and off-diagonal beta, by bisection on Sturm sequence counts
+double tridiag_max_eig(const aligned_vector<double>& alpha, 
+        const aligned_vector<double>& beta)
 {
-    CommPkg* comm;
-    if (tap)
+    int n = alpha.size();
+    int count;
+    double q, mid;
+    double lo = alpha[0];
+    double hi = alpha[0];
+
+    // Gershgorin bounds
+    for (int i = 0; i < n; i++)
     {
-        if (!A->tap_comm) 
+        double radius = 0.0;
+        if (i > 0) radius += fabs(beta[i-1]);
+        if (i < n-1) radius += fabs(beta[i]);
+        if (alpha[i] - radius < lo) lo = alpha[i] - radius;
+        if (alpha[i] + radius > hi) hi = alpha[i] + radius;
+    }
+
+    for (int iter = 0; iter < 100 && hi - lo > 1e-12 * fabs(hi); iter++)
+    {
+        // Number of eigenvalues less than mid
+        mid = 0.5 * (lo + hi);
+        count = 0;
+        q = alpha[0] - mid;
+        if (q < 0) count++;
+        for (int i = 1; i < n; i++)
         {
-            A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map);
+            if (fabs(q) < zero_tol) q = zero_tol;
+            q = alpha[i] - mid - beta[i-1] * beta[i-1] / q;
+            if (q < 0) count++;
         }
-        comm = A->tap_comm;
+
+        if (count == n) hi = mid;
+        else lo = mid;
     }
-    else
+
+    return hi;
+}
+
+/**************************************************************
+ *****  Spectral Radius of D^{-1}A
+ **************************************************************
+ ***** Estimates the largest eigenvalue of D^{-1}A with Lanczos 
+ ***** iteration on D^{-1/2} A D^{-1/2}, returning the largest 
+ ***** Ritz value.  Collective over all processes, including 
+ ***** those holding no rows of A.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Matrix to estimate
+ ***** num_iters : int
+ *****    Number of Lanczos iterations
+ ***** tap : bool
+ *****    Whether to use TAP communication in SpMVs
+ **************************************************************/
+double dinv_spectral_radius(ParCSRMatrix* A, int num_iters, bool tap)
+{
+    int n = A->local_num_rows;
+    double norm;
+    aligned_vector<double> alpha;
+    aligned_vector<double> beta;
+    aligned_vector<double> inv_sqrt_diag;
+    form_inv_diag(A, inv_sqrt_diag);
+    for (int i = 0; i < n; i++)
+    {
+        inv_sqrt_diag[i] = sqrt(fabs(inv_sqrt_diag[i]));
+    }
+
+    ParVector v(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector v_old(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector w(A->global_num_rows, n, A->partition->first_local_row);
+    ParVector tmp(A->global_num_rows, n, A->partition->first_local_row);
+    v.set_rand_values();
+    v.scale(1.0 / v.norm(2));
+    v_old.set_const_value(0.0);
+
+    for (int iter = 0; iter < num_iters; iter++)
     {
-        if (!A->comm) 
+        // w = D^{-1/2} A D^{-1/2} v - beta * v_old
+        for (int i = 0; i < n; i++)
         {
-            A->comm = new ParComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map);
+            tmp[i] = inv_sqrt_diag[i] * v[i];
+        }
+        A->mult(tmp, w, tap);
+        for (int i = 0; i < n; i++)
+        {
+            w[i] *= inv_sqrt_diag[i];
         }
-        comm = A->comm;
+        if (iter) w.axpy(v_old, -beta[iter-1]);
+
+        alpha.push_back(w.inner_product(v));
+        w.axpy(v, -alpha[iter]);
+        norm = w.norm(2);
+        if (norm < zero_tol) break;
+        beta.push_back(norm);
+
+        v_old.copy(v);
+        v.copy(w);
+        v.scale(1.0 / norm);
     }
 
-    sor_helper(A, x, b, tmp, num_sweeps, omega, comm, comm_t);
+    return tridiag_max_eig(alpha, beta);
 }
-void ssor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
-        int num_sweeps, double omega, bool tap, data_t* comm_t)
+
+/**************************************************************
+ *****  Chebyshev Relaxation
+ **************************************************************
+ ***** Applies a Chebyshev polynomial in D^{-1}A, damping the 
+ ***** eigenvalues in [eig_ratio * upper, upper], where upper is 
+ ***** 1.1 * max_eig.  Only SpMVs and vector updates are needed.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Matrix to relax over
+ ***** x, b : ParVector&
+ *****    Solution and right-hand side
+ ***** tmp, r, d : ParVector&
+ *****    Work vectors, sized as x
+ ***** inv_diag : aligned_vector<double>&
+ *****    Inverse diagonal of A (see form_inv_diag)
+ ***** max_eig : double
+ *****    Estimate of the spectral radius of D^{-1}A 
+ *****    (see dinv_spectral_radius)
+ ***** num_sweeps : int
+ *****    Number of times the polynomial is applied
+ ***** degree : int
+ *****    Degree of polynomial (SpMVs per sweep)
+ ***** eig_ratio : double
+ *****    Lower end of the damped interval, as a fraction of upper
+ **************************************************************/
+void chebyshev(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
+        ParVector& r, ParVector& d, const aligned_vector<double>& inv_diag, 
+        double max_eig, int num_sweeps, int degree, double eig_ratio, bool tap,
+        data_t* comm_t)
 {
-    CommPkg* comm;
-    if (tap)
+    int n = A->local_num_rows;
+    double upper = 1.1 * max_eig;
+    double lower = eig_ratio * upper;
+    double theta = 0.5 * (upper + lower);
+    double delta = 0.5 * (upper - lower);
+    double sigma = theta / delta;
+    double rho, rho_old;
+
+    for (int iter = 0; iter < num_sweeps; iter++)
     {
-        if (!A->tap_comm) 
+        A->residual(x, b, r, tap, comm_t);
+
+        rho_old = 1.0 / sigma;
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++)
         {
-            A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map);
+            d[i] = inv_diag[i] * r[i] / theta;
+        }
+
+        for (int k = 0; k < degree; k++)
+        {
+            x.axpy(d, 1.0);
+            if (k == degree - 1) break;
+
+            A->mult(d, tmp, tap, comm_t);
+            rho = 1.0 / (2.0 * sigma - rho_old);
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; i++)
+            {
+                r[i] -= tmp[i];
+                d[i] = rho * rho_old * d[i] + (2.0 * rho / delta) * inv_diag[i] * r[i];
+            }
+            rho_old = rho;
         }
-        comm = A->tap_comm;
     }
-    else
+}
+
+/**************************************************************
+ *****  Block Relaxation
+ **************************************************************
+ ***** Relaxes a block of k vectors (see ParMultiVector).  Each 
+ ***** sweep performs a single halo exchange for all vectors, and 
+ ***** reads each row of A once, updating all k values of the row.
+ **************************************************************/
+void jacobi(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, const aligned_vector<double>& inv_diag,
+        int num_sweeps, double omega, bool tap, data_t* comm_t)
+{
+    int k = x.num_vectors;
+    int n = A->local_num_rows;
+
+    for (int iter = 0; iter < num_sweeps; iter++)
     {
-        if (!A->comm) 
+        // x = x + omega * D^{-1} (b - A*x)
+        A->residual(x, b, tmp, tap, comm_t);
+
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++)
         {
-            A->comm = new ParComm(A->partition, A->off_proc_column_map,
-                    A->on_proc_column_map);
+            double scale = omega * inv_diag[i];
+            for (int v = 0; v < k; v++)
+            {
+                x.values[i*k + v] += scale * tmp.values[i*k + v];
+            }
         }
-        comm = A->comm;
     }
+}
+
+// Relaxes row i of each vector of the block with current on_proc 
+// values of x and off_proc values dist_x
+void sor_block_row(CSRMatrix* on_proc, CSRMatrix* off_proc, 
+        ParMultiVector& x, ParMultiVector& b, const aligned_vector<double>& dist_x,
+        const aligned_vector<double>& inv_diag, double omega, 
+        aligned_vector<double>& res, int i)
+{
+    int k = x.num_vectors;
 
-    ssor_helper(A, x, b, tmp, num_sweeps, omega, comm, comm_t);
+    for (int v = 0; v < k; v++)
+    {
+        res[v] = b.values[i*k + v];
+    }
+    on_proc->row_residual(i, x.values.data(), res.data(), k);
+    off_proc->row_residual(i, dist_x.data(), res.data(), k);
+    for (int v = 0; v < k; v++)
+    {
+        x.values[i*k + v] += omega * inv_diag[i] * res[v];
+    }
 }
 
+void sor_block_helper(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        const aligned_vector<double>& inv_diag, int num_sweeps, double omega,
+        bool symmetric, bool tap, data_t* comm_t)
+{
+    CSRMatrix* on_proc = (CSRMatrix*) A->on_proc;
+    CSRMatrix* off_proc = (CSRMatrix*) A->off_proc;
+    CommPkg* comm = relax_comm(A, tap);
+    int n = A->local_num_rows;
+    aligned_vector<double> res(x.num_vectors);
 
+    for (int iter = 0; iter < num_sweeps; iter++)
+    {
+        if (comm_t) *comm_t -= MPI_Wtime();
+        aligned_vector<double>& dist_x = comm->communicate(x);
+        if (comm_t) *comm_t += MPI_Wtime();
 
+        for (int i = 0; i < n; i++)
+        {
+            sor_block_row(on_proc, off_proc, x, b, dist_x, inv_diag, omega, res, i);
+        }
+        if (symmetric)
+        {
+            for (int i = n - 1; i >= 0; i--)
+            {
+                sor_block_row(on_proc, off_proc, x, b, dist_x, inv_diag, omega,
+                        res, i);
+            }
+        }
+    }
+}
 
+void sor(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, const aligned_vector<double>& inv_diag,
+        int num_sweeps, double omega, bool tap, data_t* comm_t)
+{
+    sor_block_helper(A, x, b, inv_diag, num_sweeps, omega, false, tap, comm_t);
+}
 
+void ssor(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, const aligned_vector<double>& inv_diag,
+        int num_sweeps, double omega, bool tap, data_t* comm_t)
+{
+    sor_block_helper(A, x, b, inv_diag, num_sweeps, omega, true, tap, comm_t);
+}
 
+void chebyshev(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, ParMultiVector& r, ParMultiVector& d, 
+        const aligned_vector<double>& inv_diag, double max_eig, int num_sweeps,
+        int degree, double eig_ratio, bool tap, data_t* comm_t)
+{
+    int k = x.num_vectors;
+    int n = A->local_num_rows;
+    double upper = 1.1 * max_eig;
+    double lower = eig_ratio * upper;
+    double theta = 0.5 * (upper + lower);
+    double delta = 0.5 * (upper - lower);
+    double sigma = theta / delta;
+    double rho, rho_old;
 
+    for (int iter = 0; iter < num_sweeps; iter++)
+    {
+        A->residual(x, b, r, tap, comm_t);
+
+        rho_old = 1.0 / sigma;
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < n; i++)
+        {
+            for (int v = 0; v < k; v++)
+            {
+                d.values[i*k + v] = inv_diag[i] * r.values[i*k + v] / theta;
+            }
+        }
+
+        for (int deg = 0; deg < degree; deg++)
+        {
+            x.axpy(d, 1.0);
+            if (deg == degree - 1) break;
+
+            A->mult(d, tmp, tap, comm_t);
+            rho = 1.0 / (2.0 * sigma - rho_old);
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; i++)
+            {
+                for (int v = 0; v < k; v++)
+                {
+                    int pos = i*k + v;
+                    r.values[pos] -= tmp.values[pos];
+                    d.values[pos] = rho * rho_old * d.values[pos] + 
+                        (2.0 * rho / delta) * inv_diag[i] * r.values[pos];
+                }
+            }
+            rho_old = rho;
+        }
+    }
+}
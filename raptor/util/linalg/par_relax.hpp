@@ -12,16 +12,71 @@
 
 using namespace raptor;
 
+// If overlap is true, interior rows (see ParCSRMatrix::form_boundary_rows)
+// are relaxed while off_proc values of x are communicated, and boundary 
+// rows once communication completes.  For sor and ssor this changes the
+// order in which rows are relaxed.
+//
+// Versions taking inv_diag (see form_inv_diag) use it in place of the
+// diagonal, so l1 variants are sor / jacobi with the l1 inverse diagonal.
+// Otherwise, the inverse diagonal is formed on every call.
+void jacobi(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        const aligned_vector<double>& inv_diag, int num_sweeps = 1, 
+        double omega = 1.0, bool tap = false, data_t* comm_t = NULL,
+        bool overlap = false);
+void sor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        const aligned_vector<double>& inv_diag, int num_sweeps = 1, 
+        double omega = 1.0, bool tap = false, data_t* comm_t = NULL,
+        bool overlap = false);
+void ssor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
+        const aligned_vector<double>& inv_diag, int num_sweeps = 1, 
+        double omega = 1.0, bool tap = false, data_t* comm_t = NULL,
+        bool overlap = false);
 void jacobi(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
         int num_sweeps = 1, double omega = 1.0, bool tap = false,
-        data_t* comm_t = NULL);
+        data_t* comm_t = NULL, bool overlap = false);
 void sor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
         int num_sweeps = 1, double omega = 1.0, bool tap = false, 
-        data_t* comm_t = NULL);
+        data_t* comm_t = NULL, bool overlap = false);
 void ssor(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp, 
         int num_sweeps = 1, double omega = 1.0, bool tap = false,
-        data_t* comm_t = NULL);
+        data_t* comm_t = NULL, bool overlap = false);
+void form_inv_diag(ParCSRMatrix* A, aligned_vector<double>& inv_diag,
+        relax_t relax_type = Jacobi);
+
+// Block Jacobi for a ParBSRMatrix with square blocks : 
+// x += omega * D^{-1} (b - A*x), with D the diagonal blocks of on_proc,
+// whose inverses are formed with form_inv_diag_blocks
+void block_jacobi(ParBSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
+        const aligned_vector<double>& inv_diag, int num_sweeps = 1,
+        double omega = 1.0, bool tap = false, data_t* comm_t = NULL);
+void form_inv_diag_blocks(ParBSRMatrix* A, aligned_vector<double>& inv_diag);
 
+double dinv_spectral_radius(ParCSRMatrix* A, int num_iters = 10, bool tap = false);
+void chebyshev(ParCSRMatrix* A, ParVector& x, ParVector& b, ParVector& tmp,
+        ParVector& r, ParVector& d, const aligned_vector<double>& inv_diag,
+        double max_eig, int num_sweeps = 1, int degree = 2, double eig_ratio = 0.3,
+        bool tap = false, data_t* comm_t = NULL);
 
+// Relaxation of a block of vectors (see ParMultiVector), sharing each 
+// pass over A and each halo exchange.  SOR is hybrid Gauss-Seidel, as 
+// for a single vector, without overlap.
+void jacobi(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, const aligned_vector<double>& inv_diag, 
+        int num_sweeps = 1, double omega = 1.0, bool tap = false, 
+        data_t* comm_t = NULL);
+void sor(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, const aligned_vector<double>& inv_diag, 
+        int num_sweeps = 1, double omega = 1.0, bool tap = false, 
+        data_t* comm_t = NULL);
+void ssor(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, const aligned_vector<double>& inv_diag, 
+        int num_sweeps = 1, double omega = 1.0, bool tap = false, 
+        data_t* comm_t = NULL);
+void chebyshev(ParCSRMatrix* A, ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& tmp, ParMultiVector& r, ParMultiVector& d, 
+        const aligned_vector<double>& inv_diag, double max_eig, 
+        int num_sweeps = 1, int degree = 2, double eig_ratio = 0.3,
+        bool tap = false, data_t* comm_t = NULL);
 
 #endif
@@ -696,6 +696,122 @@ void ParCSRMatrix::mult(ParVector& x, ParVector& b, bool tap,
     ParMatrix::mult(x, b, tap, comm_t);
 }
 
+void ParCSRMatrix::residual(ParVector& x, ParVector& b, ParVector& r, bool tap,
+        data_t* comm_t)
+{
+    ParMatrix::residual(x, b, r, tap, comm_t);
+}
+
+// Communication package for products with A, formed if needed
+CommPkg* spmm_comm(ParCSRMatrix* A, bool tap)
+{
+    if (tap)
+    {
+        if (A->tap_comm == NULL)
+        {
+            A->tap_comm = new TAPComm(A->partition, A->off_proc_column_map,
+                    A->on_proc_column_map);
+        }
+        return A->tap_comm;
+    }
+
+    if (A->comm == NULL)
+    {
+        A->comm = new ParComm(A->partition, A->off_proc_column_map,
+                A->on_proc_column_map);
+    }
+    return A->comm;
+}
+
+/**************************************************************
+ *****   Parallel Matrix-Block Multiplication
+ **************************************************************
+ ***** Performs b = A*x for a block of vectors.  All vectors share 
+ ***** one pass over the matrix and one halo exchange.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** x : ParMultiVector&
+ *****    Block of vectors to be multiplied
+ ***** b : ParMultiVector&
+ *****    Block the result is returned in
+ **************************************************************/
+void ParCSRMatrix::mult(ParMultiVector& x, ParMultiVector& b, bool tap,
+        data_t* comm_t)
+{
+    CommPkg* comm_pkg = spmm_comm(this, tap);
+    int k = x.num_vectors;
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->init_comm(x);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (local_num_rows)
+    {
+        ((CSRMatrix*) on_proc)->spmm(x.values.data(), b.values.data(), k);
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<double>& x_tmp = comm_pkg->complete_comm_vecs(k);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (off_proc_num_cols)
+    {
+        ((CSRMatrix*) off_proc)->spmm_append(x_tmp.data(), b.values.data(), k);
+    }
+}
+
+void ParCSRMatrix::residual(ParMultiVector& x, ParMultiVector& b, 
+        ParMultiVector& r, bool tap, data_t* comm_t)
+{
+    CommPkg* comm_pkg = spmm_comm(this, tap);
+    int k = x.num_vectors;
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->init_comm(x);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (local_num_rows)
+    {
+        ((CSRMatrix*) on_proc)->spmm_residual(x.values.data(), b.values.data(),
+                r.values.data(), k);
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    aligned_vector<double>& x_tmp = comm_pkg->complete_comm_vecs(k);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    if (off_proc_num_cols)
+    {
+        ((CSRMatrix*) off_proc)->spmm_append_neg(x_tmp.data(), r.values.data(), k);
+    }
+}
+
+void ParCSRMatrix::mult_T(ParMultiVector& x, ParMultiVector& b, bool tap,
+        data_t* comm_t)
+{
+    CommPkg* comm_pkg = spmm_comm(this, tap);
+    int k = x.num_vectors;
+
+    // Contributions to off_proc columns, summed on the owning processes
+    aligned_vector<double> x_tmp(off_proc_num_cols * k, 0.0);
+    ((CSRMatrix*) off_proc)->spmm_append_T(x.values.data(), x_tmp.data(), k);
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->init_comm_vecs_T(x_tmp.data(), k);
+    if (comm_t) *comm_t += MPI_Wtime();
+
+    b.set_const_value(0.0);
+    if (local_num_rows)
+    {
+        ((CSRMatrix*) on_proc)->spmm_append_T(x.values.data(), b.values.data(), k);
+    }
+
+    if (comm_t) *comm_t -= MPI_Wtime();
+    comm_pkg->complete_comm_vecs_T(b.values, k);
+    if (comm_t) *comm_t += MPI_Wtime();
+}
+
 void ParCSCMatrix::mult(ParVector& x, ParVector& b, bool tap,
         data_t* comm_t)
 {
@@ -705,7 +821,7 @@ void ParCSCMatrix::mult(ParVector& x, ParVector& b, bool tap,
 void ParBSRMatrix::mult(ParVector& x, ParVector& b, bool tap,
         data_t* comm_t)
 {
-    ParMatrix::mult(x, b);
+    ParMatrix::mult(x, b, tap, comm_t);
 }
 
 void ParCOOMatrix::tap_mult(ParVector& x, ParVector& b,
@@ -729,7 +845,7 @@ void ParCSCMatrix::tap_mult(ParVector& x, ParVector& b,
 void ParBSRMatrix::tap_mult(ParVector& x, ParVector& b,
         data_t* comm_t)
 {
-    ParMatrix::tap_mult(x, b);
+    ParMatrix::tap_mult(x, b, comm_t);
 }
 
 void ParCOOMatrix::mult_T(ParVector& x, ParVector& b, bool tap,
@@ -753,7 +869,7 @@ void ParCSCMatrix::mult_T(ParVector& x, ParVector& b, bool tap,
 void ParBSRMatrix::mult_T(ParVector& x, ParVector& b, bool tap,
         data_t* comm_t)
 {
-    ParMatrix::mult_T(x, b);
+    ParMatrix::mult_T(x, b, tap, comm_t);
 }
 
 void ParCOOMatrix::tap_mult_T(ParVector& x, ParVector& b,
@@ -777,5 +893,5 @@ void ParCSCMatrix::tap_mult_T(ParVector& x, ParVector& b,
 void ParBSRMatrix::tap_mult_T(ParVector& x, ParVector& b,
         data_t* comm_t)
 {
-    ParMatrix::tap_mult_T(x, b);
+    ParMatrix::tap_mult_T(x, b, comm_t);
 }
@@ -36,9 +36,16 @@ void make_contiguous(ParCSRMatrix* A)
 
     aligned_vector<MPI_Request> recv_requests;
 
-    std::map<int, int> global_to_local;
+    // Assumed partition and column messages are int-indexed
+    if (A->global_num_cols > (index_t) INT_MAX)
+    {
+        printf("make_contiguous requires fewer than 2^31 global columns.\n");
+        exit(-1);
+    }
+
+    std::map<index_t, int> global_to_local;
     ctr = 0;
-    for (aligned_vector<int>::const_iterator it = A->off_proc_column_map.begin();  
+    for (aligned_vector<index_t>::const_iterator it = A->off_proc_column_map.begin();  
             it != A->off_proc_column_map.end(); ++it)
     {
         global_to_local[*it] = ctr++;
@@ -378,6 +385,13 @@ void make_contiguous(ParCSRMatrix* A)
         }
     }
 
+    // Local rows (and on_proc columns) take their new global indices
+    for (int i = 0; i < A->on_proc_num_cols; i++)
+    {
+        A->on_proc_column_map[i] = A->partition->first_local_col + i;
+    }
+    A->local_row_map = A->get_on_proc_column_map();
+
     A->comm = new ParComm(A->partition, A->off_proc_column_map);
 
     // Sort rows, removing duplicate entries and moving diagonal 
@@ -400,7 +414,7 @@ ParCSRMatrix* repartition_matrix(ParCSRMatrix* A, int* partition, aligned_vector
     std::vector<PairData> recv_buffer;
     
     int proc, proc_idx;
-    int idx, ctr;
+    int idx;
     int num_rows, first_row;
     int start, end, col;
     int row_size;
@@ -424,6 +438,13 @@ ParCSRMatrix* repartition_matrix(ParCSRMatrix* A, int* partition, aligned_vector
     aligned_vector<int> recv_procs;
     aligned_vector<int> recv_ptr;
 
+    // Rows and columns are sent as int (PairData) messages
+    if (A->global_num_rows > (index_t) INT_MAX || A->global_num_cols > (index_t) INT_MAX)
+    {
+        printf("repartition_matrix requires fewer than 2^31 global rows and columns.\n");
+        exit(-1);
+    }
+
     // Find how many rows go to each proc
     for (int i = 0; i < A->local_num_rows; i++)
     {
@@ -624,27 +645,43 @@ ParCSRMatrix* repartition_matrix(ParCSRMatrix* A, int* partition, aligned_vector
     A_part = new ParCSRMatrix(A->global_num_rows, A->global_num_rows, num_rows, num_rows, 
             first_row, first_row, A->partition->topology);
 
+    // Order received rows by original global row, so that the new
+    // numbering (from make_contiguous) keeps the original order of rows
+    aligned_vector<int> recv_row_ptr(num_rows + 1);
+    aligned_vector<int> row_order(num_rows);
+    recv_row_ptr[0] = 0;
+    for (int i = 0; i < num_rows; i++)
+    {
+        recv_row_ptr[i+1] = recv_row_ptr[i] + recv_row_sizes[i];
+        row_order[i] = i;
+    }
+    std::sort(row_order.begin(), row_order.end(), 
+            [&](int i, int j)
+            {
+                return recv_rows[i] < recv_rows[j];
+            });
+
     // Create row_ptr
     // Add values/indices to appropriate positions
     std::map<int, int> on_proc_to_local;
     for(int i = 0; i < num_rows; i++)
     {
-       on_proc_to_local[recv_rows[i]] = i;
-       A_part->on_proc_column_map.push_back(recv_rows[i]);
+       on_proc_to_local[recv_rows[row_order[i]]] = i;
+       A_part->on_proc_column_map.push_back(recv_rows[row_order[i]]);
     }
     A_part->local_row_map = A_part->get_on_proc_column_map();
     A_part->on_proc_num_cols = A_part->on_proc_column_map.size();
 
-    ctr = 0;
     A_part->on_proc->idx1[0] = 0;
     A_part->off_proc->idx1[0] = 0;
     for (int i = 0; i < num_rows; i++)
     {
-        row_size = recv_row_sizes[i];
-        for (int j = 0; j < row_size; j++)
+        start = recv_row_ptr[row_order[i]];
+        end = recv_row_ptr[row_order[i] + 1];
+        for (int j = start; j < end; j++)
         {
-            col = recv_buffer[ctr].index;
-            val = recv_buffer[ctr++].val;
+            col = recv_buffer[j].index;
+            val = recv_buffer[j].val;
 
             if (on_proc_to_local.find(col) != on_proc_to_local.end())
             {
@@ -677,7 +714,7 @@ ParCSRMatrix* repartition_matrix(ParCSRMatrix* A, int* partition, aligned_vector
         {
             global_to_local[*it] = A_part->off_proc_column_map.size();
             A_part->off_proc_column_map.push_back(*it);
-            *it = prev_col;
+            prev_col = *it;
         }
     }
     A_part->off_proc_num_cols = A_part->off_proc_column_map.size();
@@ -696,4 +733,315 @@ ParCSRMatrix* repartition_matrix(ParCSRMatrix* A, int* partition, aligned_vector
     return A_part;
 }
 
+// Process holding global index idx when n indices are split into
+// contiguous blocks across the first num_parts processes
+static int block_owner(index_t idx, index_t n, int num_parts)
+{
+    index_t avg = n / num_parts;
+    index_t extra = n % num_parts;
+    if (idx < extra * (avg + 1)) return idx / (avg + 1);
+    return extra + (idx - extra * (avg + 1)) / avg;
+}
+
+// Returns a copy of A with columns renumbered contiguously (in order
+// of rank, then local column).  Columns are split into contiguous 
+// blocks across the first num_parts processes, or kept on the process
+// holding them if num_parts is 0.
+static ParCSRMatrix* renumber_cols(ParCSRMatrix* A, int num_parts)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int start, end, proc;
+    int local_cols, extra;
+    index_t col, first_col, avg_cols;
+    index_t col_offset = 0;
+    index_t num_cols = A->on_proc_num_cols;
+    index_t global_num_cols = A->global_num_cols;
+    aligned_vector<index_t> proc_offsets(num_procs);
+    bool created_comm = false;
+
+    if (num_parts > num_procs) num_parts = num_procs;
+
+    // New global index of each local column
+    MPI_Exscan(&num_cols, &col_offset, 1, MPI_INDEX_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) col_offset = 0;
+    MPI_Allgather(&col_offset, 1, MPI_INDEX_T, proc_offsets.data(), 1, 
+            MPI_INDEX_T, MPI_COMM_WORLD);
+    aligned_vector<index_t> new_cols(A->on_proc_num_cols);
+    aligned_vector<int> local_idx(A->on_proc_num_cols);
+    for (int i = 0; i < A->on_proc_num_cols; i++)
+    {
+        new_cols[i] = col_offset + i;
+        local_idx[i] = i;
+    }
 
+    // Communicate local indices of off_proc columns on the processes
+    // holding them, and add the offset of each holding process
+    if (A->comm == NULL)
+    {
+        A->comm = new ParComm(A->partition, A->off_proc_column_map, 
+                A->on_proc_column_map);
+        created_comm = true;
+    }
+    aligned_vector<int>& off_proc_local_idx = A->comm->communicate(local_idx);
+    aligned_vector<index_t> off_proc_new_cols(A->off_proc_num_cols);
+    for (int i = 0; i < A->comm->recv_data->num_msgs; i++)
+    {
+        proc = A->comm->recv_data->procs[i];
+        start = A->comm->recv_data->indptr[i];
+        end = A->comm->recv_data->indptr[i+1];
+        for (int j = start; j < end; j++)
+        {
+            off_proc_new_cols[j] = proc_offsets[proc] + off_proc_local_idx[j];
+        }
+    }
+
+    if (num_parts == 0)
+    {
+        // Columns stay on the process holding them
+        local_cols = A->on_proc_num_cols;
+        first_col = col_offset;
+    }
+    else if (rank < num_parts)
+    {
+        // Contiguous blocks of columns on first num_parts processes
+        avg_cols = global_num_cols / num_parts;
+        extra = global_num_cols % num_parts;
+        local_cols = avg_cols + (rank < extra);
+        first_col = rank * avg_cols + (rank < extra ? rank : extra);
+    }
+    else
+    {
+        local_cols = 0;
+        first_col = global_num_cols;
+    }
+
+    Partition* part = new Partition(A->partition->global_num_rows, 
+            global_num_cols, A->partition->local_num_rows, local_cols,
+            A->partition->first_local_row, first_col, 
+            A->partition->topology);
+    ParCSRMatrix* B = new ParCSRMatrix(part, A->global_num_rows, 
+            global_num_cols, A->local_num_rows, local_cols, 0);
+    part->num_shared = 0;
+
+    B->on_proc->idx1[0] = 0;
+    B->off_proc->idx1[0] = 0;
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        start = A->on_proc->idx1[i];
+        end = A->on_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            col = new_cols[A->on_proc->idx2[j]];
+            if (col >= first_col && col < first_col + local_cols)
+            {
+                B->on_proc->idx2.push_back(col - first_col);
+                B->on_proc->vals.push_back(A->on_proc->vals[j]);
+            }
+            else
+            {
+                B->off_proc->idx2.push_back(B->stage_off_proc_col(col));
+                B->off_proc->vals.push_back(A->on_proc->vals[j]);
+            }
+        }
+
+        start = A->off_proc->idx1[i];
+        end = A->off_proc->idx1[i+1];
+        for (int j = start; j < end; j++)
+        {
+            col = off_proc_new_cols[A->off_proc->idx2[j]];
+            if (col >= first_col && col < first_col + local_cols)
+            {
+                B->on_proc->idx2.push_back(col - first_col);
+                B->on_proc->vals.push_back(A->off_proc->vals[j]);
+            }
+            else
+            {
+                B->off_proc->idx2.push_back(B->stage_off_proc_col(col));
+                B->off_proc->vals.push_back(A->off_proc->vals[j]);
+            }
+        }
+        B->on_proc->idx1[i+1] = B->on_proc->idx2.size();
+        B->off_proc->idx1[i+1] = B->off_proc->idx2.size();
+    }
+    B->on_proc->nnz = B->on_proc->idx2.size();
+    B->off_proc->nnz = B->off_proc->idx2.size();
+    B->local_row_map = A->get_local_row_map();
+
+    if (created_comm)
+    {
+        delete A->comm;
+        A->comm = NULL;
+    }
+
+    B->finalize();
+
+    return B;
+}
+
+/**************************************************************
+ *****   Contiguous Columns
+ **************************************************************
+ ***** Returns a copy of A (typically an interpolation operator)
+ ***** with the same rows, and columns renumbered contiguously
+ ***** (in order of rank, then local column) but kept on the 
+ ***** processes holding them.  The coarse matrix P^T A P formed
+ ***** from the returned matrix is numbered contiguously, as 
+ ***** required by agglomerate_matrix.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Matrix whose columns are to be renumbered
+ **************************************************************/
+ParCSRMatrix* contiguous_cols(ParCSRMatrix* A)
+{
+    return renumber_cols(A, 0);
+}
+
+/**************************************************************
+ *****   Agglomerate Columns
+ **************************************************************
+ ***** Returns a copy of A (typically an interpolation operator)
+ ***** with the same rows, but with columns renumbered 
+ ***** contiguously (in order of rank, then local column) and 
+ ***** split into contiguous blocks across the first num_parts 
+ ***** processes.  The coarse matrix P^T A P formed from the 
+ ***** returned matrix lives only on these processes.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Matrix whose columns are to be agglomerated
+ ***** num_parts : int
+ *****    Number of processes to hold columns
+ **************************************************************/
+ParCSRMatrix* agglomerate_cols(ParCSRMatrix* A, int num_parts)
+{
+    if (num_parts < 1) num_parts = 1;
+    return renumber_cols(A, num_parts);
+}
+
+/**************************************************************
+ *****   Agglomerate Rows
+ **************************************************************
+ ***** Returns A, a square matrix numbered contiguously (such as
+ ***** the Galerkin product with contiguous_cols), moved with 
+ ***** repartition_matrix into contiguous blocks of rows across 
+ ***** the first num_parts processes.  Rows keep their global 
+ ***** indices, which match the columns of agglomerate_cols.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** A : ParCSRMatrix*
+ *****    Matrix whose rows are to be agglomerated
+ ***** num_parts : int
+ *****    Number of processes to hold rows
+ **************************************************************/
+ParCSRMatrix* agglomerate_matrix(ParCSRMatrix* A, int num_parts)
+{
+    int num_procs;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    if (num_parts > num_procs) num_parts = num_procs;
+    if (num_parts < 1) num_parts = 1;
+
+    aligned_vector<int> new_local_rows;
+    aligned_vector<int> proc_part(A->local_num_rows + 1);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        proc_part[i] = block_owner(A->local_row_map[i], A->global_num_rows, 
+                num_parts);
+    }
+
+    return repartition_matrix(A, proc_part.data(), new_local_rows);
+}
+
+/**************************************************************
+ *****   Repartition Vector
+ **************************************************************
+ ***** Moves values stored per local row (block_size values per
+ ***** row) between two distributions of the same global rows.
+ ***** Both distributions must hold contiguous blocks of rows,
+ ***** ordered by rank (as returned by agglomerate_cols).
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** values : aligned_vector<double>&
+ *****    Values for local rows of original distribution
+ ***** new_values : aligned_vector<double>&
+ *****    Returns values for local rows of new distribution
+ ***** old_local_rows : int
+ *****    Number of local rows in original distribution
+ ***** new_local_rows : int
+ *****    Number of local rows in new distribution
+ ***** block_size : int
+ *****    Number of values per row
+ **************************************************************/
+void repartition_vector(const aligned_vector<double>& values,
+        aligned_vector<double>& new_values, int old_local_rows, 
+        int new_local_rows, int block_size)
+{
+    int rank, num_procs;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int key = 372941;
+    int first, last, size;
+    aligned_vector<int> old_firsts(num_procs + 1);
+    aligned_vector<int> new_firsts(num_procs + 1);
+    aligned_vector<MPI_Request> requests;
+
+    MPI_Allgather(&old_local_rows, 1, MPI_INT, &(old_firsts[1]), 1, MPI_INT, 
+            MPI_COMM_WORLD);
+    MPI_Allgather(&new_local_rows, 1, MPI_INT, &(new_firsts[1]), 1, MPI_INT, 
+            MPI_COMM_WORLD);
+    old_firsts[0] = 0;
+    new_firsts[0] = 0;
+    for (int i = 0; i < num_procs; i++)
+    {
+        old_firsts[i+1] += old_firsts[i];
+        new_firsts[i+1] += new_firsts[i];
+    }
+
+    new_values.resize(new_local_rows * block_size);
+
+    // Send overlap of my old rows with new rows of each proc
+    for (int i = 0; i < num_procs; i++)
+    {
+        first = std::max(old_firsts[rank], new_firsts[i]);
+        last = std::min(old_firsts[rank+1], new_firsts[i+1]);
+        size = (last - first) * block_size;
+        if (size <= 0) continue;
+        if (i == rank)
+        {
+            std::copy(values.begin() + (first - old_firsts[rank]) * block_size,
+                    values.begin() + (last - old_firsts[rank]) * block_size,
+                    new_values.begin() + (first - new_firsts[rank]) * block_size);
+            continue;
+        }
+        requests.push_back(MPI_Request());
+        MPI_Isend(&(values[(first - old_firsts[rank]) * block_size]), size, 
+                MPI_DOUBLE, i, key, MPI_COMM_WORLD, &(requests.back()));
+    }
+
+    // Recv overlap of my new rows with old rows of each proc
+    for (int i = 0; i < num_procs; i++)
+    {
+        if (i == rank) continue;
+        first = std::max(old_firsts[i], new_firsts[rank]);
+        last = std::min(old_firsts[i+1], new_firsts[rank+1]);
+        size = (last - first) * block_size;
+        if (size <= 0) continue;
+        requests.push_back(MPI_Request());
+        MPI_Irecv(&(new_values[(first - new_firsts[rank]) * block_size]), size,
+                MPI_DOUBLE, i, key, MPI_COMM_WORLD, &(requests.back()));
+    }
+
+    if (requests.size())
+    {
+        MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    }
+}
@@ -15,6 +15,12 @@ using namespace raptor;
 
 ParCSRMatrix* repartition_matrix(ParCSRMatrix* A, int* partition, aligned_vector<int>& new_local_rows);
 void make_contiguous(ParCSRMatrix* A);
+ParCSRMatrix* contiguous_cols(ParCSRMatrix* A);
+ParCSRMatrix* agglomerate_cols(ParCSRMatrix* A, int num_parts);
+ParCSRMatrix* agglomerate_matrix(ParCSRMatrix* A, int num_parts);
+void repartition_vector(const aligned_vector<double>& values,
+        aligned_vector<double>& new_values, int old_local_rows,
+        int new_local_rows, int block_size = 1);
 
 #endif
 
@@ -0,0 +1,698 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "util/linalg/spgemm.hpp"
+
+using namespace raptor;
+
+// Finds slot of col in hash table (linear probing), inserting col if
+// not already present.  Table size is a power of 2 (mask + 1), at 
+// least twice the number of columns inserted, so probing terminates.
+// If the table holds at least n_cols slots, no collisions occur.
+static inline int hash_slot(int col, int mask, int* keys, 
+        aligned_vector<int>& used)
+{
+    int h = col & mask;
+    while (keys[h] != col)
+    {
+        if (keys[h] == -1)
+        {
+            keys[h] = col;
+            used.push_back(h);
+            break;
+        }
+        h = (h + 1) & mask;
+    }
+    return h;
+}
+
+// Accumulates row i of all terms into the hash table.  If numeric,
+// values are summed into sums.
+template <bool numeric>
+static void accumulate_row(int i, const aligned_vector<SpGEMMTerm>& terms,
+        int mask, int* keys, double* sums, aligned_vector<int>& used)
+{
+    int start, end, row_start, row_end;
+    int col_A, col, h;
+    double val_A;
+
+    for (aligned_vector<SpGEMMTerm>::const_iterator t = terms.begin();
+            t != terms.end(); ++t)
+    {
+        if (t->A_rowptr == NULL)
+        {
+            start = t->B_rowptr[i];
+            end = t->B_rowptr[i+1];
+            for (int k = start; k < end; k++)
+            {
+                col = t->col_map ? t->col_map[t->B_cols[k]] : t->B_cols[k];
+                h = hash_slot(col, mask, keys, used);
+                if (numeric) sums[h] += t->B_vals[k];
+            }
+            continue;
+        }
+
+        row_start = t->A_rowptr[i];
+        row_end = t->A_rowptr[i+1];
+        for (int j = row_start; j < row_end; j++)
+        {
+            col_A = t->A_cols[j];
+            val_A = numeric ? t->A_vals[j] : 0.0;
+            start = t->B_rowptr[col_A];
+            end = t->B_rowptr[col_A+1];
+            for (int k = start; k < end; k++)
+            {
+                col = t->col_map ? t->col_map[t->B_cols[k]] : t->B_cols[k];
+                h = hash_slot(col, mask, keys, used);
+                if (numeric) sums[h] += val_A * t->B_vals[k];
+            }
+        }
+    }
+}
+
+// Sizes the hash table for rows [first_row, last_row), returning its
+// mask.  The table holds twice the largest number of flops in a row, 
+// or n_cols if smaller (making the table a dense accumulator).
+static int table_mask(const aligned_vector<long>& row_flops, int first_row,
+        int last_row, int n_cols, aligned_vector<int>& keys, 
+        aligned_vector<double>& sums)
+{
+    long max_flops = 0;
+    for (int i = first_row; i < last_row; i++)
+    {
+        long flops = row_flops[i+1] - row_flops[i];
+        if (flops > max_flops) max_flops = flops;
+    }
+    int size = 1;
+    while (size < 2 * max_flops && size < n_cols) size *= 2;
+    if ((int) keys.size() < size)
+    {
+        keys.resize(size, -1);
+        sums.resize(size, 0.0);
+    }
+    return size - 1;
+}
+
+void spgemm_rows(int n_rows, int n_cols, const aligned_vector<SpGEMMTerm>& terms,
+        CSRMatrix* C, const int* row_list, bool keep_zeros)
+{
+    int num_threads = get_num_threads();
+    if (num_threads > n_rows) num_threads = n_rows > 0 ? n_rows : 1;
+
+    // Count flops (upper bound on nonzeros) in each row of C
+    aligned_vector<long> row_flops(n_rows + 1);
+    row_flops[0] = 0;
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+    for (int i = 0; i < n_rows; i++)
+    {
+        long flops = 0;
+        int row = row_list ? row_list[i] : i;
+        for (aligned_vector<SpGEMMTerm>::const_iterator t = terms.begin();
+                t != terms.end(); ++t)
+        {
+            if (t->A_rowptr == NULL)
+            {
+                flops += t->B_rowptr[row+1] - t->B_rowptr[row];
+                continue;
+            }
+            for (int j = t->A_rowptr[row]; j < t->A_rowptr[row+1]; j++)
+            {
+                int col_A = t->A_cols[j];
+                flops += t->B_rowptr[col_A+1] - t->B_rowptr[col_A];
+            }
+        }
+        row_flops[i+1] = flops;
+    }
+    for (int i = 0; i < n_rows; i++)
+    {
+        row_flops[i+1] += row_flops[i];
+    }
+
+    // Split rows into blocks with equal flops
+    aligned_vector<int> thread_rows(num_threads + 1);
+    thread_rows[0] = 0;
+    for (int t = 1; t < num_threads; t++)
+    {
+        long target = (row_flops[n_rows] * t) / num_threads;
+        thread_rows[t] = std::lower_bound(row_flops.begin() + thread_rows[t-1], 
+                row_flops.begin() + n_rows, target) - row_flops.begin();
+    }
+    thread_rows[num_threads] = n_rows;
+
+    C->idx1.resize(n_rows + 1);
+    C->idx1[0] = 0;
+    aligned_vector<int> row_nnz(n_rows);
+
+#pragma omp parallel num_threads(num_threads)
+    {
+        aligned_vector<int> keys;
+        aligned_vector<double> sums;
+        aligned_vector<int> used;
+        int mask = 0;
+
+        // Symbolic phase : count nonzeros in each row
+#pragma omp for schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
+        {
+            mask = table_mask(row_flops, thread_rows[t], thread_rows[t+1],
+                    n_cols, keys, sums);
+
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+            {
+                int row = row_list ? row_list[i] : i;
+                accumulate_row<false>(row, terms, mask, keys.data(), sums.data(), used);
+                C->idx1[i+1] = used.size();
+                for (aligned_vector<int>::iterator it = used.begin(); 
+                        it != used.end(); ++it)
+                {
+                    keys[*it] = -1;
+                }
+                used.clear();
+            }
+        }
+
+#pragma omp single
+        {
+            for (int i = 0; i < n_rows; i++)
+            {
+                C->idx1[i+1] += C->idx1[i];
+            }
+            C->idx2.resize(C->idx1[n_rows]);
+            C->vals.resize(C->idx1[n_rows]);
+        }
+
+        // Numeric phase : sum values, removing zeros
+#pragma omp for schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
+        {
+            mask = table_mask(row_flops, thread_rows[t], thread_rows[t+1],
+                    n_cols, keys, sums);
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+            {
+                int row = row_list ? row_list[i] : i;
+                accumulate_row<true>(row, terms, mask, keys.data(), sums.data(), used);
+                int ctr = C->idx1[i];
+                for (aligned_vector<int>::iterator it = used.begin(); 
+                        it != used.end(); ++it)
+                {
+                    if (keep_zeros || fabs(sums[*it]) > zero_tol)
+                    {
+                        C->idx2[ctr] = keys[*it];
+                        C->vals[ctr++] = sums[*it];
+                    }
+                    keys[*it] = -1;
+                    sums[*it] = 0.0;
+                }
+                row_nnz[i] = ctr - C->idx1[i];
+                used.clear();
+            }
+        }
+    }
+
+    // Remove space left by zero values
+    int nnz = 0;
+    for (int i = 0; i < n_rows; i++)
+    {
+        int start = C->idx1[i];
+        if (start != nnz)
+        {
+            for (int j = 0; j < row_nnz[i]; j++)
+            {
+                C->idx2[nnz + j] = C->idx2[start + j];
+                C->vals[nnz + j] = C->vals[start + j];
+            }
+        }
+        C->idx1[i] = nnz;
+        nnz += row_nnz[i];
+    }
+    C->idx1[n_rows] = nnz;
+    C->idx2.resize(nnz);
+    C->vals.resize(nnz);
+    C->nnz = nnz;
+}
+
+// Sums row i of all terms into the dense accumulator sums
+static void accumulate_row_dense(int i, const aligned_vector<SpGEMMTerm>& terms,
+        double* sums)
+{
+    int start, end, row_start, row_end;
+    int col_A, col;
+    double val_A;
+
+    for (aligned_vector<SpGEMMTerm>::const_iterator t = terms.begin();
+            t != terms.end(); ++t)
+    {
+        if (t->A_rowptr == NULL)
+        {
+            start = t->B_rowptr[i];
+            end = t->B_rowptr[i+1];
+            for (int k = start; k < end; k++)
+            {
+                col = t->col_map ? t->col_map[t->B_cols[k]] : t->B_cols[k];
+                sums[col] += t->B_vals[k];
+            }
+            continue;
+        }
+
+        row_start = t->A_rowptr[i];
+        row_end = t->A_rowptr[i+1];
+        for (int j = row_start; j < row_end; j++)
+        {
+            col_A = t->A_cols[j];
+            val_A = t->A_vals[j];
+            start = t->B_rowptr[col_A];
+            end = t->B_rowptr[col_A+1];
+            for (int k = start; k < end; k++)
+            {
+                col = t->col_map ? t->col_map[t->B_cols[k]] : t->B_cols[k];
+                sums[col] += val_A * t->B_vals[k];
+            }
+        }
+    }
+}
+
+void spgemm_rows_numeric(int n_rows, int n_cols, 
+        const aligned_vector<SpGEMMTerm>& terms, CSRMatrix* C)
+{
+    int num_threads = get_num_threads();
+    if (num_threads > n_rows) num_threads = n_rows > 0 ? n_rows : 1;
+
+    C->vals.resize(C->idx1[n_rows]);
+
+#pragma omp parallel num_threads(num_threads)
+    {
+        // Every column summed is in the pattern of the row, so 
+        // clearing the pattern resets the accumulator
+        aligned_vector<double> sums;
+        if (n_cols) sums.resize(n_cols, 0.0);
+
+#pragma omp for schedule(static)
+        for (int i = 0; i < n_rows; i++)
+        {
+            accumulate_row_dense(i, terms, sums.data());
+            for (int j = C->idx1[i]; j < C->idx1[i+1]; j++)
+            {
+                C->vals[j] = sums[C->idx2[j]];
+                sums[C->idx2[j]] = 0.0;
+            }
+        }
+    }
+}
+
+// Accumulates block row i of all terms into the hash table.  If 
+// numeric, blocks are summed into sums (b_size values per slot).
+template <bool numeric>
+static void accumulate_block_row(int i, const aligned_vector<BSRSpGEMMTerm>& terms,
+        int b_rows, int b_cols, int mask, int* keys, double* sums, 
+        aligned_vector<int>& used)
+{
+    int b_size = b_rows * b_cols;
+    int start, end, row_start, row_end;
+    int col_A, col, h, b_inner;
+    double alpha, a;
+    const double* A_block;
+    const double* B_block;
+    double* C_block;
+
+    for (aligned_vector<BSRSpGEMMTerm>::const_iterator t = terms.begin();
+            t != terms.end(); ++t)
+    {
+        alpha = t->alpha;
+        if (t->A_rowptr == NULL)
+        {
+            start = t->B_rowptr[i];
+            end = t->B_rowptr[i+1];
+            for (int k = start; k < end; k++)
+            {
+                col = t->col_map ? t->col_map[t->B_cols[k]] : t->B_cols[k];
+                h = hash_slot(col, mask, keys, used);
+                if (numeric)
+                {
+                    B_block = &(t->B_vals[k * b_size]);
+                    C_block = &(sums[h * b_size]);
+                    for (int l = 0; l < b_size; l++)
+                    {
+                        C_block[l] += alpha * B_block[l];
+                    }
+                }
+            }
+            continue;
+        }
+
+        b_inner = t->b_inner;
+        row_start = t->A_rowptr[i];
+        row_end = t->A_rowptr[i+1];
+        for (int j = row_start; j < row_end; j++)
+        {
+            col_A = t->A_cols[j];
+            A_block = &(t->A_vals[j * b_rows * b_inner]);
+            start = t->B_rowptr[col_A];
+            end = t->B_rowptr[col_A+1];
+            for (int k = start; k < end; k++)
+            {
+                col = t->col_map ? t->col_map[t->B_cols[k]] : t->B_cols[k];
+                h = hash_slot(col, mask, keys, used);
+                if (numeric)
+                {
+                    B_block = &(t->B_vals[k * b_inner * b_cols]);
+                    C_block = &(sums[h * b_size]);
+                    for (int r = 0; r < b_rows; r++)
+                    {
+                        for (int m = 0; m < b_inner; m++)
+                        {
+                            a = alpha * A_block[r * b_inner + m];
+                            if (a == 0.0) continue;
+                            for (int c = 0; c < b_cols; c++)
+                            {
+                                C_block[r * b_cols + c] += a * B_block[m * b_cols + c];
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void bsr_spgemm_rows(int n_block_rows, int n_block_cols, 
+        const aligned_vector<BSRSpGEMMTerm>& terms, BSRMatrix* C,
+        const int* row_list)
+{
+    int b_size = C->b_rows * C->b_cols;
+    int num_threads = get_num_threads();
+    if (num_threads > n_block_rows) num_threads = n_block_rows > 0 ? n_block_rows : 1;
+
+    // Count block products (upper bound on blocks) in each block row
+    aligned_vector<long> row_flops(n_block_rows + 1);
+    row_flops[0] = 0;
+#pragma omp parallel for num_threads(num_threads) schedule(static)
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        long flops = 0;
+        int row = row_list ? row_list[i] : i;
+        for (aligned_vector<BSRSpGEMMTerm>::const_iterator t = terms.begin();
+                t != terms.end(); ++t)
+        {
+            if (t->A_rowptr == NULL)
+            {
+                flops += t->B_rowptr[row+1] - t->B_rowptr[row];
+                continue;
+            }
+            for (int j = t->A_rowptr[row]; j < t->A_rowptr[row+1]; j++)
+            {
+                int col_A = t->A_cols[j];
+                flops += t->B_rowptr[col_A+1] - t->B_rowptr[col_A];
+            }
+        }
+        row_flops[i+1] = flops;
+    }
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        row_flops[i+1] += row_flops[i];
+    }
+
+    // Split block rows into blocks with equal flops
+    aligned_vector<int> thread_rows(num_threads + 1);
+    thread_rows[0] = 0;
+    for (int t = 1; t < num_threads; t++)
+    {
+        long target = (row_flops[n_block_rows] * t) / num_threads;
+        thread_rows[t] = std::lower_bound(row_flops.begin() + thread_rows[t-1], 
+                row_flops.begin() + n_block_rows, target) - row_flops.begin();
+    }
+    thread_rows[num_threads] = n_block_rows;
+
+    C->idx1.resize(n_block_rows + 1);
+    C->idx1[0] = 0;
+    aligned_vector<int> row_blocks(n_block_rows);
+
+#pragma omp parallel num_threads(num_threads)
+    {
+        aligned_vector<int> keys;
+        aligned_vector<double> sums;
+        aligned_vector<double> block_sums;
+        aligned_vector<int> used;
+        int mask = 0;
+
+        // Symbolic phase : count blocks in each block row
+#pragma omp for schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
+        {
+            mask = table_mask(row_flops, thread_rows[t], thread_rows[t+1],
+                    n_block_cols, keys, sums);
+
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+            {
+                int row = row_list ? row_list[i] : i;
+                accumulate_block_row<false>(row, terms, C->b_rows, C->b_cols, 
+                        mask, keys.data(), sums.data(), used);
+                C->idx1[i+1] = used.size();
+                for (aligned_vector<int>::iterator it = used.begin(); 
+                        it != used.end(); ++it)
+                {
+                    keys[*it] = -1;
+                }
+                used.clear();
+            }
+        }
+
+#pragma omp single
+        {
+            for (int i = 0; i < n_block_rows; i++)
+            {
+                C->idx1[i+1] += C->idx1[i];
+            }
+            C->idx2.resize(C->idx1[n_block_rows]);
+            C->vals.resize(C->idx1[n_block_rows] * b_size);
+        }
+
+        // Numeric phase : sum blocks, removing zero blocks
+#pragma omp for schedule(static, 1)
+        for (int t = 0; t < num_threads; t++)
+        {
+            mask = table_mask(row_flops, thread_rows[t], thread_rows[t+1],
+                    n_block_cols, keys, sums);
+            if (block_sums.size() < keys.size() * b_size)
+            {
+                block_sums.resize(keys.size() * b_size, 0.0);
+            }
+            for (int i = thread_rows[t]; i < thread_rows[t+1]; i++)
+            {
+                int row = row_list ? row_list[i] : i;
+                accumulate_block_row<true>(row, terms, C->b_rows, C->b_cols, 
+                        mask, keys.data(), block_sums.data(), used);
+                int ctr = C->idx1[i];
+                for (aligned_vector<int>::iterator it = used.begin(); 
+                        it != used.end(); ++it)
+                {
+                    double* block = &(block_sums[*it * b_size]);
+                    bool nonzero = false;
+                    for (int l = 0; l < b_size; l++)
+                    {
+                        if (fabs(block[l]) > zero_tol)
+                        {
+                            nonzero = true;
+                            break;
+                        }
+                    }
+                    if (nonzero)
+                    {
+                        C->idx2[ctr] = keys[*it];
+                        std::copy(block, block + b_size, &(C->vals[ctr * b_size]));
+                        ctr++;
+                    }
+                    keys[*it] = -1;
+                    std::fill(block, block + b_size, 0.0);
+                }
+                row_blocks[i] = ctr - C->idx1[i];
+                used.clear();
+            }
+        }
+    }
+
+    // Remove space left by zero blocks
+    int n_blocks = 0;
+    for (int i = 0; i < n_block_rows; i++)
+    {
+        int start = C->idx1[i];
+        if (start != n_blocks)
+        {
+            for (int j = 0; j < row_blocks[i]; j++)
+            {
+                C->idx2[n_blocks + j] = C->idx2[start + j];
+                std::copy(&(C->vals[(start + j) * b_size]), 
+                        &(C->vals[(start + j + 1) * b_size]),
+                        &(C->vals[(n_blocks + j) * b_size]));
+            }
+        }
+        C->idx1[i] = n_blocks;
+        n_blocks += row_blocks[i];
+    }
+    C->idx1[n_block_rows] = n_blocks;
+    C->idx2.resize(n_blocks);
+    C->vals.resize(n_blocks * b_size);
+    C->n_blocks = n_blocks;
+    C->nnz = n_blocks * b_size;
+}
+
+void rap_rows(const Matrix* T, int n_rows_A, const aligned_vector<SpGEMMTerm>& AP_terms,
+        int n_cols, CSRMatrix* C, int block_rows, bool keep_zeros)
+{
+    int n_rows = T->idx1.size() - 1;
+    int start, end, row, nnz;
+    if (block_rows <= 0) block_rows = n_rows;
+
+    aligned_vector<int> row_pos(n_rows_A, -1);
+    aligned_vector<int> sub_rows;
+    aligned_vector<int> T_rowptr;
+    aligned_vector<int> T_cols;
+    aligned_vector<double> T_vals;
+    aligned_vector<SpGEMMTerm> terms(1);
+    CSRMatrix AP_sub(0, n_cols);
+    CSRMatrix C_block(0, n_cols);
+
+    C->idx1.resize(n_rows + 1);
+    C->idx1[0] = 0;
+    C->idx2.clear();
+    C->vals.clear();
+
+    for (int first = 0; first < n_rows; first += block_rows)
+    {
+        int last = first + block_rows;
+        if (last > n_rows) last = n_rows;
+
+        // Rows of A (and AP) needed by this block of T, with the
+        // block of T renumbered to these rows
+        T_rowptr.resize(last - first + 1);
+        T_rowptr[0] = 0;
+        T_cols.clear();
+        T_vals.clear();
+        for (int i = first; i < last; i++)
+        {
+            start = T->idx1[i];
+            end = T->idx1[i+1];
+            for (int j = start; j < end; j++)
+            {
+                row = T->idx2[j];
+                if (row_pos[row] == -1)
+                {
+                    row_pos[row] = sub_rows.size();
+                    sub_rows.push_back(row);
+                }
+                T_cols.push_back(row_pos[row]);
+                T_vals.push_back(T->vals[j]);
+            }
+            T_rowptr[i - first + 1] = T_cols.size();
+        }
+
+        // AP_sub <- rows of A*P needed by block
+        spgemm_rows(sub_rows.size(), n_cols, AP_terms, &AP_sub, sub_rows.data(),
+                keep_zeros);
+
+        // C_block <- T_block * AP_sub
+        terms[0] = SpGEMMTerm(NULL, AP_sub.idx1, AP_sub.idx2, AP_sub.vals);
+        terms[0].A_rowptr = T_rowptr.data();
+        terms[0].A_cols = T_cols.data();
+        terms[0].A_vals = T_vals.data();
+        spgemm_rows(last - first, n_cols, terms, &C_block, NULL, keep_zeros);
+
+        nnz = C->idx2.size();
+        C->idx2.insert(C->idx2.end(), C_block.idx2.begin(), C_block.idx2.end());
+        C->vals.insert(C->vals.end(), C_block.vals.begin(), C_block.vals.end());
+        for (int i = first; i < last; i++)
+        {
+            C->idx1[i+1] = nnz + C_block.idx1[i - first + 1];
+        }
+
+        for (aligned_vector<int>::iterator it = sub_rows.begin();
+                it != sub_rows.end(); ++it)
+        {
+            row_pos[*it] = -1;
+        }
+        sub_rows.clear();
+    }
+    C->nnz = C->idx2.size();
+}
+
+void bsr_rap_rows(const BSRMatrix* T, int n_block_rows_A, 
+        const aligned_vector<BSRSpGEMMTerm>& AP_terms, int n_block_cols, 
+        BSRMatrix* C, int block_rows)
+{
+    int n_rows = T->idx1.size() - 1;
+    int T_size = T->b_size;
+    int start, end, row, n_blocks;
+    if (block_rows <= 0) block_rows = n_rows;
+
+    aligned_vector<int> row_pos(n_block_rows_A, -1);
+    aligned_vector<int> sub_rows;
+    aligned_vector<int> T_rowptr;
+    aligned_vector<int> T_cols;
+    aligned_vector<double> T_vals;
+    aligned_vector<BSRSpGEMMTerm> terms(1);
+    BSRMatrix AP_sub(0, 0, T->b_cols, C->b_cols, 1);
+    BSRMatrix C_block(0, 0, C->b_rows, C->b_cols, 1);
+
+    C->idx1.resize(n_rows + 1);
+    C->idx1[0] = 0;
+    C->idx2.clear();
+    C->vals.clear();
+
+    for (int first = 0; first < n_rows; first += block_rows)
+    {
+        int last = first + block_rows;
+        if (last > n_rows) last = n_rows;
+
+        // Block rows of A (and AP) needed by this block of T, with the
+        // block of T renumbered to these rows
+        T_rowptr.resize(last - first + 1);
+        T_rowptr[0] = 0;
+        T_cols.clear();
+        T_vals.clear();
+        for (int i = first; i < last; i++)
+        {
+            start = T->idx1[i];
+            end = T->idx1[i+1];
+            for (int j = start; j < end; j++)
+            {
+                row = T->idx2[j];
+                if (row_pos[row] == -1)
+                {
+                    row_pos[row] = sub_rows.size();
+                    sub_rows.push_back(row);
+                }
+                T_cols.push_back(row_pos[row]);
+                T_vals.insert(T_vals.end(), T->vals.begin() + j * T_size,
+                        T->vals.begin() + (j+1) * T_size);
+            }
+            T_rowptr[i - first + 1] = T_cols.size();
+        }
+
+        // AP_sub <- block rows of A*P needed by block
+        bsr_spgemm_rows(sub_rows.size(), n_block_cols, AP_terms, &AP_sub, 
+                sub_rows.data());
+
+        // C_block <- T_block * AP_sub
+        terms[0] = BSRSpGEMMTerm(NULL, AP_sub.idx1, AP_sub.idx2, AP_sub.vals,
+                T->b_cols);
+        terms[0].A_rowptr = T_rowptr.data();
+        terms[0].A_cols = T_cols.data();
+        terms[0].A_vals = T_vals.data();
+        bsr_spgemm_rows(last - first, n_block_cols, terms, &C_block);
+
+        n_blocks = C->idx2.size();
+        C->idx2.insert(C->idx2.end(), C_block.idx2.begin(), C_block.idx2.end());
+        C->vals.insert(C->vals.end(), C_block.vals.begin(), C_block.vals.end());
+        for (int i = first; i < last; i++)
+        {
+            C->idx1[i+1] = n_blocks + C_block.idx1[i - first + 1];
+        }
+
+        for (aligned_vector<int>::iterator it = sub_rows.begin();
+                it != sub_rows.end(); ++it)
+        {
+            row_pos[*it] = -1;
+        }
+        sub_rows.clear();
+    }
+    C->n_blocks = C->idx2.size();
+    C->nnz = C->n_blocks * C->b_size;
+}
@@ -0,0 +1,289 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#ifndef RAPTOR_UTILS_LINALG_SPGEMM_H
+#define RAPTOR_UTILS_LINALG_SPGEMM_H
+
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+
+namespace raptor
+{
+    // Default number of rows of a Galerkin product formed at once
+    constexpr int rap_block_rows = 1024;
+}
+
+using namespace raptor;
+
+/**************************************************************
+ *****   SpGEMM Term
+ **************************************************************
+ ***** One product contributing to the rows of C:
+ *****    C[i] += sum_{j in A[i]} A[i][j] * B[j] 
+ ***** A is given by row pointer, columns and values (for a CSC
+ ***** matrix, its column pointer gives the rows of the 
+ ***** transpose).  If A_rowptr is NULL, row i of B is added
+ ***** directly to row i of C.  If col_map is not NULL, columns
+ ***** of B are mapped to columns of C through col_map.
+ **************************************************************/
+struct SpGEMMTerm
+{
+    SpGEMMTerm()
+    {
+        A_rowptr = NULL;
+        A_cols = NULL;
+        A_vals = NULL;
+        B_rowptr = NULL;
+        B_cols = NULL;
+        B_vals = NULL;
+        col_map = NULL;
+    }
+
+    SpGEMMTerm(const Matrix* A, const Matrix* B, const int* _col_map = NULL)
+    {
+        A_rowptr = A ? A->idx1.data() : NULL;
+        A_cols = A ? A->idx2.data() : NULL;
+        A_vals = A ? A->vals.data() : NULL;
+        B_rowptr = B->idx1.data();
+        B_cols = B->idx2.data();
+        B_vals = B->vals.data();
+        col_map = _col_map;
+    }
+
+    SpGEMMTerm(const Matrix* A, const aligned_vector<int>& rowptr,
+            const aligned_vector<int>& cols, const aligned_vector<double>& vals,
+            const int* _col_map = NULL)
+    {
+        A_rowptr = A ? A->idx1.data() : NULL;
+        A_cols = A ? A->idx2.data() : NULL;
+        A_vals = A ? A->vals.data() : NULL;
+        B_rowptr = rowptr.data();
+        B_cols = cols.data();
+        B_vals = vals.data();
+        col_map = _col_map;
+    }
+
+    const int* A_rowptr;
+    const int* A_cols;
+    const double* A_vals;
+    const int* B_rowptr;
+    const int* B_cols;
+    const double* B_vals;
+    const int* col_map;
+};
+
+/**************************************************************
+ *****   Block SpGEMM Term
+ **************************************************************
+ ***** One product contributing to the block rows of a BSR 
+ ***** matrix C, as in SpGEMMTerm, with each nonzero a dense 
+ ***** block stored row-wise.  Blocks of A are b_rows x b_inner 
+ ***** and blocks of B are b_inner x b_cols (b_rows x b_cols if 
+ ***** A_rowptr is NULL).  Each product is scaled by alpha.
+ **************************************************************/
+struct BSRSpGEMMTerm
+{
+    BSRSpGEMMTerm()
+    {
+        A_rowptr = NULL;
+        A_cols = NULL;
+        A_vals = NULL;
+        B_rowptr = NULL;
+        B_cols = NULL;
+        B_vals = NULL;
+        col_map = NULL;
+        b_inner = 0;
+        alpha = 1.0;
+    }
+
+    BSRSpGEMMTerm(const BSRMatrix* A, const BSRMatrix* B, const int* _col_map = NULL,
+            double _alpha = 1.0)
+    {
+        A_rowptr = A ? A->idx1.data() : NULL;
+        A_cols = A ? A->idx2.data() : NULL;
+        A_vals = A ? A->vals.data() : NULL;
+        B_rowptr = B->idx1.data();
+        B_cols = B->idx2.data();
+        B_vals = B->vals.data();
+        col_map = _col_map;
+        b_inner = B->b_rows;
+        alpha = _alpha;
+    }
+
+    BSRSpGEMMTerm(const BSRMatrix* A, const aligned_vector<int>& rowptr,
+            const aligned_vector<int>& cols, const aligned_vector<double>& vals,
+            int _b_inner, const int* _col_map = NULL, double _alpha = 1.0)
+    {
+        A_rowptr = A ? A->idx1.data() : NULL;
+        A_cols = A ? A->idx2.data() : NULL;
+        A_vals = A ? A->vals.data() : NULL;
+        B_rowptr = rowptr.data();
+        B_cols = cols.data();
+        B_vals = vals.data();
+        col_map = _col_map;
+        b_inner = _b_inner;
+        alpha = _alpha;
+    }
+
+    const int* A_rowptr;
+    const int* A_cols;
+    const double* A_vals;
+    const int* B_rowptr;
+    const int* B_cols;
+    const double* B_vals;
+    const int* col_map;
+    int b_inner;
+    double alpha;
+};
+
+/**************************************************************
+ *****   Sparse Matrix-Matrix Multiplication (Accumulate)
+ **************************************************************
+ ***** Forms the n_rows rows of C = sum of all terms, with 
+ ***** columns in [0, n_cols).  The product is computed in two
+ ***** phases.  The symbolic phase counts the nonzeros in each 
+ ***** row, so C is allocated exactly, and the numeric phase 
+ ***** fills the values.  Rows are split into one block per 
+ ***** thread, balanced by the number of flops in each row, and 
+ ***** each thread accumulates rows in its own hash table.  
+ ***** Values smaller than zero_tol are removed, unless keep_zeros
+ ***** is set (so the pattern of C depends only on the patterns of 
+ ***** the terms).  Columns within each row are not sorted.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** n_rows : int
+ *****    Number of rows in C
+ ***** n_cols : int
+ *****    Number of columns in C
+ ***** terms : aligned_vector<SpGEMMTerm>&
+ *****    Products summed to form C
+ ***** C : CSRMatrix*
+ *****    Matrix in which idx1, idx2, vals, and nnz are returned
+ ***** row_list : const int* (optional)
+ *****    If not NULL, row i of C is formed from row row_list[i] 
+ *****    of each term
+ ***** keep_zeros : bool (optional)
+ *****    If true, zero values are kept in C (default false)
+ **************************************************************/
+void spgemm_rows(int n_rows, int n_cols, const aligned_vector<SpGEMMTerm>& terms,
+        CSRMatrix* C, const int* row_list = NULL, bool keep_zeros = false);
+
+/**************************************************************
+ *****   Sparse Matrix-Matrix Multiplication (Numeric)
+ **************************************************************
+ ***** Fills the values of C = sum of all terms, where the 
+ ***** pattern of C (idx1 and idx2) is already known, such as one
+ ***** formed by spgemm_rows with keep_zeros.  Only the numeric
+ ***** phase is performed : each thread sums rows in a dense 
+ ***** accumulator of n_cols values, with no hash table.  Every 
+ ***** column formed in a row must be in the pattern of that row.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** n_rows : int
+ *****    Number of rows in C
+ ***** n_cols : int
+ *****    Number of columns in C
+ ***** terms : aligned_vector<SpGEMMTerm>&
+ *****    Products summed to form C
+ ***** C : CSRMatrix*
+ *****    Matrix holding the pattern, in which vals are returned
+ **************************************************************/
+void spgemm_rows_numeric(int n_rows, int n_cols, 
+        const aligned_vector<SpGEMMTerm>& terms, CSRMatrix* C);
+
+/**************************************************************
+ *****   Block Sparse Matrix-Matrix Multiplication (Accumulate)
+ **************************************************************
+ ***** Forms the n_block_rows block rows of the BSR matrix 
+ ***** C = sum of all terms, with block columns in 
+ ***** [0, n_block_cols), in the same two phases as spgemm_rows.
+ ***** Block rows are accumulated in a hash table of block 
+ ***** columns, and each product of blocks is a small dense 
+ ***** multiplication.  Blocks with all values smaller than 
+ ***** zero_tol are removed.  Block columns within each row are 
+ ***** not sorted.  C->b_rows and C->b_cols give the size of the
+ ***** blocks of C.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** n_block_rows : int
+ *****    Number of block rows in C
+ ***** n_block_cols : int
+ *****    Number of block columns in C
+ ***** terms : aligned_vector<BSRSpGEMMTerm>&
+ *****    Products summed to form C
+ ***** C : BSRMatrix*
+ *****    Matrix in which idx1, idx2, vals, n_blocks, and nnz 
+ *****    are returned
+ ***** row_list : const int* (optional)
+ *****    Block rows of the terms forming the block rows of C 
+ *****    (block row i of C is row_list[i], default i)
+ **************************************************************/
+void bsr_spgemm_rows(int n_block_rows, int n_block_cols, 
+        const aligned_vector<BSRSpGEMMTerm>& terms, BSRMatrix* C,
+        const int* row_list = NULL);
+
+/**************************************************************
+ *****   Triple Product (Blocked)
+ **************************************************************
+ ***** Forms C = T * (A*P) without storing A*P.  Rows of C are
+ ***** formed in blocks of block_rows.  For each block, only the
+ ***** rows of A*P referenced by the block of T are formed (with
+ ***** spgemm_rows), so intermediate storage is bounded by the
+ ***** block size.  Typically T = P^T, given as the CSC matrix P.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** T : const Matrix*
+ *****    Left matrix, CSR (or CSC, in which case its transpose
+ *****    is used), with columns indexing rows of A
+ ***** n_rows_A : int
+ *****    Number of rows in A
+ ***** AP_terms : aligned_vector<SpGEMMTerm>&
+ *****    Products summed to form the rows of A*P
+ ***** n_cols : int
+ *****    Number of columns in A*P (and C)
+ ***** C : CSRMatrix*
+ *****    Matrix in which idx1, idx2, vals, and nnz are returned
+ ***** block_rows : int (optional)
+ *****    Number of rows of C formed at once (all if <= 0, default
+ *****    rap_block_rows)
+ ***** keep_zeros : bool (optional)
+ *****    If true, zero values are kept in C (default false)
+ **************************************************************/
+void rap_rows(const Matrix* T, int n_rows_A, const aligned_vector<SpGEMMTerm>& AP_terms,
+        int n_cols, CSRMatrix* C, int block_rows = rap_block_rows, 
+        bool keep_zeros = false);
+
+/**************************************************************
+ *****   Block Triple Product (Blocked)
+ **************************************************************
+ ***** Forms C = T * (A*P) for BSR matrices without storing A*P,
+ ***** as rap_rows does for CSR.  For each set of block_rows 
+ ***** block rows of T, only the block rows of A*P referenced by
+ ***** the set are formed (with bsr_spgemm_rows).  Typically T is
+ ***** the local transpose of P.
+ *****
+ ***** Parameters
+ ***** -------------
+ ***** T : const BSRMatrix*
+ *****    Left matrix, with block columns indexing block rows of A
+ ***** n_block_rows_A : int
+ *****    Number of block rows in A
+ ***** AP_terms : aligned_vector<BSRSpGEMMTerm>&
+ *****    Products summed to form the block rows of A*P
+ ***** n_block_cols : int
+ *****    Number of block columns in A*P (and C)
+ ***** C : BSRMatrix*
+ *****    Matrix in which idx1, idx2, vals, n_blocks, and nnz 
+ *****    are returned.  C->b_rows and C->b_cols must be set.
+ ***** block_rows : int (optional)
+ *****    Number of block rows of C formed at once (all if <= 0, 
+ *****    default rap_block_rows)
+ **************************************************************/
+void bsr_rap_rows(const BSRMatrix* T, int n_block_rows_A, 
+        const aligned_vector<BSRSpGEMMTerm>& AP_terms, int n_block_cols, 
+        BSRMatrix* C, int block_rows = rap_block_rows);
+
+#endif
@@ -0,0 +1,178 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "aggregation/par_prolongation.hpp"
+
+#include <map>
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// Block tridiagonal system of 3x3 blocks, with zeros inside some
+// blocks and a long range coupling between nodes
+ParCSRMatrix* form_block_system(int n_nodes)
+{
+    Partition* part = new Partition(n_nodes*3, n_nodes*3, 3, 3);
+    ParCSRMatrix* A = new ParCSRMatrix(part);
+    part->num_shared = 0;
+
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        index_t row = A->partition->first_local_row + i;
+        int node = row / 3;
+        int r = row % 3;
+        for (int c = 0; c < 3; c++)
+        {
+            A->add_value(i, node*3 + c, r == c ? 10.0 : 1.0 + 0.1*(r+c));
+            if (r == 2 && c == 0) continue;
+            if (node > 0)
+                A->add_value(i, (node-1)*3 + c, -1.0 - 0.01*(r*3+c));
+            if (node < n_nodes - 1)
+                A->add_value(i, (node+1)*3 + c, -1.0 + 0.01*(r*3+c));
+        }
+        if (r == 0)
+            A->add_value(i, ((node + n_nodes/3) % n_nodes)*3 + 1, 0.5);
+        A->on_proc->idx1[i+1] = A->on_proc->idx2.size();
+        A->off_proc->idx1[i+1] = A->off_proc->idx2.size();
+    }
+    A->finalize();
+
+    return A;
+}
+
+// Tentative-like prolongator with 3x2 blocks : each node maps to
+// its aggregate and (weakly) to a distant aggregate
+ParCSRMatrix* form_block_prolongator(int n_nodes)
+{
+    int n_aggs = n_nodes / 3;
+    Partition* part = new Partition(n_nodes*3, n_aggs*2, 3, 2);
+    ParCSRMatrix* P = new ParCSRMatrix(part);
+    part->num_shared = 0;
+
+    for (int i = 0; i < P->local_num_rows; i++)
+    {
+        index_t row = P->partition->first_local_row + i;
+        int node = row / 3;
+        int r = row % 3;
+        int agg = node / 3;
+        for (int c = 0; c < 2; c++)
+        {
+            P->add_value(i, agg*2 + c, (r+1)*(c+1)*0.1 + (node % 3));
+        }
+        if (r == 1)
+            P->add_value(i, ((agg + 5) % n_aggs)*2, 0.25);
+        P->on_proc->idx1[i+1] = P->on_proc->idx2.size();
+        P->off_proc->idx1[i+1] = P->off_proc->idx2.size();
+    }
+    P->finalize();
+
+    return P;
+}
+
+void compare(ParCSRMatrix* A, ParBSRMatrix* A_bsr)
+{
+    ParCSRMatrix* B = A_bsr->to_ParCSR();
+    ASSERT_EQ(A->global_num_rows, B->global_num_rows);
+    ASSERT_EQ(A->global_num_cols, B->global_num_cols);
+    ASSERT_EQ(A->local_num_rows, B->local_num_rows);
+
+    std::map<index_t, double> row_A, row_B;
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        row_A.clear();
+        row_B.clear();
+        for (int j = A->on_proc->idx1[i]; j < A->on_proc->idx1[i+1]; j++)
+            row_A[A->on_proc_column_map[A->on_proc->idx2[j]]] += A->on_proc->vals[j];
+        for (int j = A->off_proc->idx1[i]; j < A->off_proc->idx1[i+1]; j++)
+            row_A[A->off_proc_column_map[A->off_proc->idx2[j]]] += A->off_proc->vals[j];
+        for (int j = B->on_proc->idx1[i]; j < B->on_proc->idx1[i+1]; j++)
+            row_B[B->on_proc_column_map[B->on_proc->idx2[j]]] += B->on_proc->vals[j];
+        for (int j = B->off_proc->idx1[i]; j < B->off_proc->idx1[i+1]; j++)
+            row_B[B->off_proc_column_map[B->off_proc->idx2[j]]] += B->off_proc->vals[j];
+
+        for (std::map<index_t, double>::iterator it = row_A.begin();
+                it != row_A.end(); ++it)
+        {
+            ASSERT_NEAR(it->second, row_B[it->first], 1e-10);
+        }
+        for (std::map<index_t, double>::iterator it = row_B.begin();
+                it != row_B.end(); ++it)
+        {
+            ASSERT_NEAR(it->second, row_A[it->first], 1e-10);
+        }
+    }
+
+    delete B;
+}
+
+TEST(ParBSRSpGEMMTest, TestsInUtil)
+{
+    int num_procs;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int n_nodes = 18 * num_procs;
+    ParCSRMatrix* A = form_block_system(n_nodes);
+    ParCSRMatrix* P = form_block_prolongator(n_nodes);
+    ParBSRMatrix* A_bsr = A->to_ParBSR(3, 3);
+    ParBSRMatrix* P_bsr = P->to_ParBSR(3, 2);
+    compare(A, A_bsr);
+    compare(P, P_bsr);
+
+    for (int tap = 0; tap < 2; tap++)
+    {
+        // C = A*P (3x2 blocks)
+        ParCSRMatrix* AP = A->mult(P, tap);
+        ParBSRMatrix* AP_bsr = A_bsr->mult(P_bsr, tap);
+        compare(AP, AP_bsr);
+
+        // C = P^T*(A*P) (2x2 blocks)
+        ParCSRMatrix* PTAP = AP->mult_T(P, tap);
+        ParBSRMatrix* PTAP_bsr = AP_bsr->mult_T(P_bsr, tap);
+        compare(PTAP, PTAP_bsr);
+        delete PTAP_bsr;
+
+        PTAP_bsr = A_bsr->RAP(P_bsr, tap);
+        compare(PTAP, PTAP_bsr);
+        delete PTAP_bsr;
+
+        // C = A - A*A
+        ParCSRMatrix* AA = A->mult(A, tap);
+        ParCSRMatrix* diff = A->subtract(AA);
+        ParBSRMatrix* AA_bsr = A_bsr->mult(A_bsr, tap);
+        ParBSRMatrix* diff_bsr = A_bsr->subtract(AA_bsr);
+        compare(diff, diff_bsr);
+
+        delete AP;
+        delete AP_bsr;
+        delete PTAP;
+        delete AA;
+        delete diff;
+        delete AA_bsr;
+        delete diff_bsr;
+    }
+
+    // Smoothed prolongation
+    ParCSRMatrix* SP = jacobi_prolongation(A, P);
+    ParBSRMatrix* SP_bsr = jacobi_prolongation(A_bsr, P_bsr);
+    compare(SP, SP_bsr);
+    delete SP;
+    delete SP_bsr;
+
+    delete A;
+    delete P;
+    delete A_bsr;
+    delete P_bsr;
+
+} // end of TEST(ParBSRSpGEMMTest, TestsInUtil) //
+
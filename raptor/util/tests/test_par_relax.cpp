@@ -0,0 +1,224 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/par_matrix.hpp"
+#include "gallery/par_stencil.hpp"
+#include "gallery/laplacian27pt.hpp"
+#include "util/linalg/par_relax.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+    ::testing::InitGoogleTest(&argc, argv);
+    int temp = RUN_ALL_TESTS();
+    MPI_Finalize();
+    return temp;
+} // end of main() //
+
+// Forward Gauss-Seidel over the rows in the given order, with
+// off_proc values from dist_x
+void gs_rows(ParCSRMatrix* A, ParVector& x, ParVector& b,
+        aligned_vector<double>& dist_x, aligned_vector<int>& rows)
+{
+    for (aligned_vector<int>::iterator it = rows.begin(); it != rows.end(); ++it)
+    {
+        int i = *it;
+        double diag = 0;
+        double row_sum = 0;
+        for (int j = A->on_proc->idx1[i]; j < A->on_proc->idx1[i+1]; j++)
+        {
+            if (A->on_proc->idx2[j] == i) diag = A->on_proc->vals[j];
+            else row_sum += A->on_proc->vals[j] * x[A->on_proc->idx2[j]];
+        }
+        for (int j = A->off_proc->idx1[i]; j < A->off_proc->idx1[i+1]; j++)
+        {
+            row_sum += A->off_proc->vals[j] * dist_x[A->off_proc->idx2[j]];
+        }
+        x[i] = (b[i] - row_sum) / diag;
+    }
+}
+
+TEST(ParRelaxTest, TestsInUtil)
+{
+    int num_procs;
+    MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
+
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector x_overlap(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector tmp(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    b.set_rand_values();
+
+    A->on_proc->move_diag();
+    A->form_boundary_rows();
+    ASSERT_EQ((int) (A->interior_rows.size() + A->boundary_rows.size()),
+            A->local_num_rows);
+    for (int i = 0; i < (int) A->interior_rows.size(); i++)
+    {
+        int row = A->interior_rows[i];
+        ASSERT_EQ(A->off_proc->idx1[row+1], A->off_proc->idx1[row]);
+    }
+    for (int i = 0; i < (int) A->boundary_rows.size(); i++)
+    {
+        int row = A->boundary_rows[i];
+        ASSERT_GT(A->off_proc->idx1[row+1], A->off_proc->idx1[row]);
+    }
+
+    // Jacobi is unchanged by overlapping communication
+    for (int tap = 0; tap < 2; tap++)
+    {
+        x.set_const_value(0.0);
+        x_overlap.set_const_value(0.0);
+        jacobi(A, x, b, tmp, 3, 2.0/3, tap);
+        jacobi(A, x_overlap, b, tmp, 3, 2.0/3, tap, NULL, true);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_DOUBLE_EQ(x[i], x_overlap[i]);
+        }
+    }
+
+    // SOR relaxes interior rows and then boundary rows
+    x.set_rand_values();
+    x_overlap.copy(x);
+    aligned_vector<double> dist_x = A->comm->communicate(x);
+    gs_rows(A, x, b, dist_x, A->interior_rows);
+    gs_rows(A, x, b, dist_x, A->boundary_rows);
+    sor(A, x_overlap, b, tmp, 1, 1.0, false, NULL, true);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_NEAR(x[i], x_overlap[i], 1e-12);
+    }
+
+    // With a single process, every row is interior
+    if (num_procs == 1)
+    {
+        ASSERT_EQ((int) A->interior_rows.size(), A->local_num_rows);
+        x.set_const_value(0.0);
+        x_overlap.set_const_value(0.0);
+        ssor(A, x, b, tmp, 2, 1.0);
+        ssor(A, x_overlap, b, tmp, 2, 1.0, false, NULL, true);
+        for (int i = 0; i < A->local_num_rows; i++)
+        {
+            ASSERT_DOUBLE_EQ(x[i], x_overlap[i]);
+        }
+    }
+
+    // SSOR with overlap still reduces the residual
+    x.set_const_value(0.0);
+    A->residual(x, b, tmp);
+    double r0 = tmp.norm(2);
+    ssor(A, x, b, tmp, 5, 1.0, false, NULL, true);
+    A->residual(x, b, tmp);
+    ASSERT_LT(tmp.norm(2), r0);
+
+    delete A;
+} // end of TEST(ParRelaxTest, TestsInUtil) //
+
+TEST(ParRelaxTest, TestChebyshev)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector tmp(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector r(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector d(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    aligned_vector<double> inv_diag;
+    form_inv_diag(A, inv_diag);
+
+    // Ritz values bound the spectral radius from below, and 
+    // Gershgorin bounds that of D^{-1}A by 2
+    double rho = dinv_spectral_radius(A, 10);
+    double rho_fine = dinv_spectral_radius(A, 100);
+    ASSERT_GT(rho, 1.0);
+    ASSERT_LE(rho, 2.0);
+    ASSERT_LE(rho_fine, 2.0);
+    ASSERT_GT(rho, 0.95 * rho_fine);
+
+    // Smoothing a random error reduces the residual 
+    b.set_const_value(0.0);
+    for (int tap = 0; tap < 2; tap++)
+    {
+        x.set_rand_values();
+        A->residual(x, b, tmp);
+        double r0 = tmp.norm(2);
+        chebyshev(A, x, b, tmp, r, d, inv_diag, rho, 2, 3, 0.3, tap);
+        A->residual(x, b, tmp);
+        ASSERT_LT(tmp.norm(2), 0.5 * r0);
+    }
+
+    delete A;
+} // end of TEST(ParRelaxTest, TestChebyshev) //
+
+TEST(ParRelaxTest, TestL1)
+{
+    int grid[3] = {10, 10, 10};
+    double* stencil = laplace_stencil_27pt();
+    ParCSRMatrix* A = par_stencil_grid(stencil, grid, 3);
+    delete[] stencil;
+
+    ParVector x(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector b(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    ParVector tmp(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    aligned_vector<double> inv_diag, l1_jacobi, l1_sor;
+    form_inv_diag(A, inv_diag);
+    form_inv_diag(A, l1_jacobi, L1Jacobi);
+    form_inv_diag(A, l1_sor, L1SOR);
+
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        double diag = 0.0;
+        double on_sum = 0.0;
+        double off_sum = 0.0;
+        for (int j = A->on_proc->idx1[i]; j < A->on_proc->idx1[i+1]; j++)
+        {
+            if (A->on_proc->idx2[j] == i) diag = A->on_proc->vals[j];
+            else on_sum += fabs(A->on_proc->vals[j]);
+        }
+        for (int j = A->off_proc->idx1[i]; j < A->off_proc->idx1[i+1]; j++)
+        {
+            off_sum += fabs(A->off_proc->vals[j]);
+        }
+        ASSERT_NEAR(inv_diag[i], 1.0 / diag, 1e-14);
+        ASSERT_NEAR(l1_jacobi[i], 1.0 / (diag + on_sum + off_sum), 1e-14);
+        ASSERT_NEAR(l1_sor[i], 1.0 / (diag + off_sum), 1e-14);
+    }
+
+    // Cached inverse diagonal matches forming it on each call
+    b.set_rand_values();
+    x.set_const_value(0.0);
+    ParVector x_cached(A->global_num_rows, A->local_num_rows, A->partition->first_local_row);
+    x_cached.set_const_value(0.0);
+    sor(A, x, b, tmp, 2, 1.0);
+    sor(A, x_cached, b, tmp, inv_diag, 2, 1.0);
+    for (int i = 0; i < A->local_num_rows; i++)
+    {
+        ASSERT_DOUBLE_EQ(x[i], x_cached[i]);
+    }
+
+    // Undamped l1 smoothers reduce the error of a random guess
+    b.set_const_value(0.0);
+    for (int t = 0; t < 2; t++)
+    {
+        x.set_rand_values();
+        A->residual(x, b, tmp);
+        double r0 = tmp.norm(2);
+        if (t == 0) jacobi(A, x, b, tmp, l1_jacobi, 3, 1.0);
+        else sor(A, x, b, tmp, l1_sor, 3, 1.0);
+        A->residual(x, b, tmp);
+        ASSERT_LT(tmp.norm(2), r0);
+    }
+
+    delete A;
+} // end of TEST(ParRelaxTest, TestL1) //
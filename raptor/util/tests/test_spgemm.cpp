@@ -0,0 +1,124 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+#include "util/linalg/spgemm.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+
+} // end of main() //
+
+CSRMatrix* form_random(int n_rows, int n_cols, int max_row_size,
+        aligned_vector<double>& dense)
+{
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols);
+    dense.resize(n_rows * n_cols);
+    std::fill(dense.begin(), dense.end(), 0.0);
+    A->idx1[0] = 0;
+    for (int i = 0; i < n_rows; i++)
+    {
+        int row_size = rand() % (max_row_size + 1);
+        for (int j = 0; j < row_size; j++)
+        {
+            int col = rand() % n_cols;
+            if (dense[i*n_cols + col] != 0.0) continue;
+            double val = (rand() % 7) - 3.0;
+            if (val == 0.0) val = 1.0;
+            A->idx2.push_back(col);
+            A->vals.push_back(val);
+            dense[i*n_cols + col] = val;
+        }
+        A->idx1[i+1] = A->idx2.size();
+    }
+    A->nnz = A->idx2.size();
+    return A;
+}
+
+void compare_dense(CSRMatrix* C, const aligned_vector<double>& dense)
+{
+    int n_cols = C->n_cols;
+    int nnz = 0;
+    for (int i = 0; i < C->n_rows; i++)
+    {
+        aligned_vector<double> row(n_cols, 0.0);
+        for (int j = C->idx1[i]; j < C->idx1[i+1]; j++)
+        {
+            // Each column appears once, and zeros are removed
+            ASSERT_EQ(row[C->idx2[j]], 0.0);
+            ASSERT_GT(fabs(C->vals[j]), zero_tol);
+            row[C->idx2[j]] = C->vals[j];
+        }
+        for (int j = 0; j < n_cols; j++)
+        {
+            ASSERT_NEAR(row[j], dense[i*n_cols + j], 1e-12);
+            if (fabs(dense[i*n_cols + j]) > zero_tol) nnz++;
+        }
+    }
+    ASSERT_EQ(C->nnz, nnz);
+    ASSERT_EQ(C->idx2.size(), nnz);
+}
+
+TEST(SpGEMMTest, TestsInUtil)
+{
+#ifdef USING_OPENMP
+    omp_set_num_threads(4);
+#endif
+    srand(1093);
+
+    int n = 83;
+    int m = 57;
+    int k = 301;
+    aligned_vector<double> A_dense, B_dense, P_dense;
+
+    // Small integer values, so many products cancel to zero
+    CSRMatrix* A = form_random(n, m, 9, A_dense);
+    CSRMatrix* B = form_random(m, k, 25, B_dense);
+    CSRMatrix* P = form_random(n, k, 3, P_dense);
+
+    // C = A*B
+    aligned_vector<double> C_dense(n*k, 0.0);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < m; j++)
+            for (int l = 0; l < k; l++)
+                C_dense[i*k + l] += A_dense[i*m + j] * B_dense[j*k + l];
+    CSRMatrix* C = A->mult(B);
+    compare_dense(C, C_dense);
+    delete C;
+
+    // C = A^T*P
+    aligned_vector<double> CT_dense(m*k, 0.0);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < m; j++)
+            for (int l = 0; l < k; l++)
+                CT_dense[j*k + l] += A_dense[i*m + j] * P_dense[i*k + l];
+    CSCMatrix* A_csc = A->to_CSC();
+    C = P->mult_T(A_csc);
+    compare_dense(C, CT_dense);
+    delete C;
+    delete A_csc;
+
+    // C = P^T*(A*B), formed in blocks of 7 rows
+    aligned_vector<double> RAP_dense(k*k, 0.0);
+    for (int i = 0; i < n; i++)
+        for (int j = 0; j < k; j++)
+            for (int l = 0; l < k; l++)
+                RAP_dense[j*k + l] += P_dense[i*k + j] * C_dense[i*k + l];
+    CSCMatrix* P_csc = P->to_CSC();
+    aligned_vector<SpGEMMTerm> terms(1, SpGEMMTerm(A, B));
+    C = new CSRMatrix(k, k);
+    rap_rows(P_csc, n, terms, k, C, 7);
+    compare_dense(C, RAP_dense);
+    delete C;
+    delete P_csc;
+
+    delete A;
+    delete B;
+    delete P;
+
+} // end of TEST(SpGEMMTest, TestsInUtil) //
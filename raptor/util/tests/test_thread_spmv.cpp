@@ -0,0 +1,103 @@
+// Copyright (c) 2015-2017, RAPtor Developer Team
+// License: Simplified BSD, http://opensource.org/licenses/BSD-2-Clause
+#include "gtest/gtest.h"
+#include "core/types.hpp"
+#include "core/matrix.hpp"
+
+using namespace raptor;
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+
+} // end of main() //
+
+TEST(ThreadSpMVTest, TestsInUtil)
+{
+#ifdef USING_OPENMP
+    omp_set_num_threads(4);
+#endif
+    int n_rows = 97;
+    int n_cols = 61;
+    srand(2417);
+
+    // Nonsymmetric matrix with uneven row lengths (some empty)
+    CSRMatrix* A = new CSRMatrix(n_rows, n_cols);
+    aligned_vector<double> dense(n_rows * n_cols, 0.0);
+    A->idx1[0] = 0;
+    for (int i = 0; i < n_rows; i++)
+    {
+        int row_size = (i % 7 == 3) ? 0 : (i % 13) + 1;
+        for (int j = 0; j < row_size; j++)
+        {
+            int col = (i * 17 + j * 5) % n_cols;
+            if (dense[i*n_cols + col] != 0.0) continue;
+            double val = ((double) rand()) / RAND_MAX - 0.5;
+            A->idx2.push_back(col);
+            A->vals.push_back(val);
+            dense[i*n_cols + col] = val;
+        }
+        A->idx1[i+1] = A->idx2.size();
+    }
+    A->nnz = A->idx2.size();
+
+    // Thread partition covers all rows, in order
+    int num_threads = A->form_thread_rows();
+    ASSERT_EQ(A->thread_rows.size(), num_threads + 1);
+    ASSERT_EQ(A->thread_rows[0], 0);
+    ASSERT_EQ(A->thread_rows[num_threads], n_rows);
+    for (int t = 0; t < num_threads; t++)
+    {
+        ASSERT_LE(A->thread_rows[t], A->thread_rows[t+1]);
+    }
+
+    Vector x(n_cols);
+    Vector b(n_rows);
+    Vector r(n_rows);
+    Vector y(n_rows);
+    Vector z(n_cols);
+    for (int i = 0; i < n_cols; i++) x[i] = ((double) rand()) / RAND_MAX;
+    for (int i = 0; i < n_rows; i++) y[i] = ((double) rand()) / RAND_MAX;
+
+    // b <- A*x and r <- y - A*x
+    A->mult(x, b);
+    A->residual(x, y, r);
+    for (int i = 0; i < n_rows; i++)
+    {
+        double sum = 0.0;
+        for (int j = 0; j < n_cols; j++)
+        {
+            sum += dense[i*n_cols + j] * x[j];
+        }
+        ASSERT_NEAR(b[i], sum, 1e-12);
+        ASSERT_NEAR(r[i], y[i] - sum, 1e-12);
+    }
+
+    // b <- b - A*x
+    A->mult_append_neg(x, b);
+    for (int i = 0; i < n_rows; i++)
+    {
+        ASSERT_NEAR(b[i], 0.0, 1e-12);
+    }
+
+    // z <- A^T*y, then z <- z - A^T*y
+    A->mult_T(y, z);
+    for (int j = 0; j < n_cols; j++)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < n_rows; i++)
+        {
+            sum += dense[i*n_cols + j] * y[i];
+        }
+        ASSERT_NEAR(z[j], sum, 1e-12);
+    }
+    A->mult_append_neg_T(y, z);
+    for (int j = 0; j < n_cols; j++)
+    {
+        ASSERT_NEAR(z[j], 0.0, 1e-12);
+    }
+
+    delete A;
+
+} // end of TEST(ThreadSpMVTest, TestsInUtil) //